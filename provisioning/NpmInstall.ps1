@@ -22,7 +22,12 @@ Invoke-Command $msbuild "SettingsHelper.sln /p:Configuration=Release /p:Platform
 ## Original from master
 ## Invoke-Command $msbuild "SettingsHelper.sln /p:Configuration=Release /p:Platform=`"Any CPU`" /p:FrameworkPathOverride=`"C:\Program Files (x86)\Reference Assemblies\Microsoft\Framework\.NETFramework\v4.6.1`"" $settingsHelperDir
 
+# Build the settingsHelper addon, linking the library built above
+$settingsHelperAddonDir = Join-Path $settingsHelperDir "SettingsHelperAddon"
+Invoke-Command "npm" "install" $settingsHelperAddonDir
+
 # Build the volumeControl solution
+nuget restore .\gpii\node_modules\nativeSettingsHandler\nativeSolutions\VolumeControl\VolumeControl.sln
 $volumeControlDir = Join-Path $rootDir "gpii\node_modules\nativeSettingsHandler\nativeSolutions\VolumeControl"
 Invoke-Command $msbuild "VolumeControl.sln /p:Configuration=Release /p:Platform=`"x86`" /p:FrameworkPathOverride=`"C:\Program Files (x86)\Reference Assemblies\Microsoft\Framework\.NETFramework\v4.6.1`"" $volumeControlDir
 
@@ -0,0 +1,223 @@
+/**
+ * SettingsCatalog tool main definition.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <Windows.h>
+
+#include <cwchar>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CatalogProbe.h"
+#include "SettingUtils.h"
+#include "SettingsCatalog.h"
+#include "WorkerPool.h"
+#include "WorkerProcess.h"
+
+using std::wstring;
+using std::vector;
+using std::pair;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+namespace {
+    /// <summary>
+    ///  Command line switches accepted by the tool.
+    /// </summary>
+    struct CatalogOptions {
+        /// <summary>
+        ///  Path in which to write the catalog, set with '-out'.
+        /// </summary>
+        wstring outPath {};
+        /// <summary>
+        ///  Number of worker processes probing the settings, set with '-workers'.
+        /// </summary>
+        std::size_t workersNum { 4 };
+        /// <summary>
+        ///  Time a worker has to probe a setting, set with '-timeout'.
+        /// </summary>
+        std::uint32_t timeoutMs { 10 * 1000 };
+        /// <summary>
+        ///  Set with '-worker' by the supervisor on its workers.
+        /// </summary>
+        wstring workerId {};
+    };
+
+    HRESULT parseNumber(const wstring& str, unsigned long& rValue) {
+        if (str.empty() || str.find_first_not_of(L"0123456789") != wstring::npos) {
+            return E_INVALIDARG;
+        }
+
+        rValue = std::wcstoul(str.c_str(), NULL, 10);
+
+        return ERROR_SUCCESS;
+    }
+
+    HRESULT getCatalogOptions(int argc, wchar_t** argv, CatalogOptions& rOptions) {
+        HRESULT errCode { ERROR_SUCCESS };
+        CatalogOptions options {};
+
+        // Every switch is followed by its value
+        for (int i = 1; i < argc && errCode == ERROR_SUCCESS; i += 2) {
+            const wstring optSwitch { argv[i] };
+            unsigned long value { 0 };
+
+            if (i + 1 >= argc) {
+                errCode = E_INVALIDARG;
+            } else if (optSwitch == L"-out") {
+                options.outPath = argv[i + 1];
+            } else if (optSwitch == L"-workers") {
+                errCode = parseNumber(argv[i + 1], value);
+                options.workersNum = value;
+            } else if (optSwitch == L"-timeout") {
+                errCode = parseNumber(argv[i + 1], value);
+                options.timeoutMs = value;
+            } else if (optSwitch == L"-worker") {
+                options.workerId = argv[i + 1];
+            } else {
+                errCode = E_INVALIDARG;
+            }
+        }
+
+        if (errCode == ERROR_SUCCESS && options.workerId.empty() && options.outPath.empty()) {
+            errCode = E_INVALIDARG;
+        }
+
+        if (errCode == ERROR_SUCCESS) {
+            rOptions = options;
+        }
+
+        return errCode;
+    }
+
+    /// <summary>
+    ///  Gets the ids of every setting registered in the system.
+    /// </summary>
+    HRESULT getSystemSettingIds(vector<wstring>& rSettingIds) {
+        HKEY hSettingsKey { NULL };
+        HRESULT errCode {
+            RegOpenKeyEx(
+                HKEY_LOCAL_MACHINE,
+                TEXT("SOFTWARE\\Microsoft\\SystemSettings\\SettingId"),
+                0,
+                KEY_READ,
+                &hSettingsKey
+            )
+        };
+
+        if (errCode == ERROR_SUCCESS) {
+            errCode = getRegSubKeys(hSettingsKey, rSettingIds);
+            RegCloseKey(hSettingsKey);
+        }
+
+        return errCode;
+    }
+
+    /// <summary>
+    ///  Probes the settings sent by the supervisor until it closes the channel.
+    /// </summary>
+    HRESULT runCatalogWorker() {
+        HRESULT res { ERROR_SUCCESS };
+        SettingAPI& sAPI { LoadSettingAPI(res) };
+
+        if (res != ERROR_SUCCESS) {
+            return res;
+        }
+
+        {
+            CatalogWorkerSession session { sAPI };
+            std::unique_ptr<WorkerChannel> supervisor { openSupervisorChannel() };
+
+            runWorker(*supervisor, session);
+        }
+
+        return UnloadSettingsAPI(sAPI);
+    }
+
+    /// <summary>
+    ///  Probes every setting of the system in worker processes and writes the
+    ///  catalog.
+    /// </summary>
+    HRESULT runCatalogSupervisor(const CatalogOptions& options) {
+        vector<wstring> settingIds {};
+        HRESULT errCode { getSystemSettingIds(settingIds) };
+
+        if (errCode != ERROR_SUCCESS) {
+            std::wcerr << L"Failed to read the registered settings - ErrorCode: '0x" << std::hex << errCode << L"'\n";
+            return errCode;
+        }
+
+        vector<wchar_t> exePathBuf(MAX_PATH);
+        const DWORD exePathSize { GetModuleFileNameW(NULL, exePathBuf.data(), static_cast<DWORD>(exePathBuf.size())) };
+        const wstring exePath { exePathBuf.data(), exePathSize };
+
+        WorkerPool pool {
+            [exePath, spawned = std::size_t { 0 }]() mutable { return spawnWorkerProcess(exePath, spawned++); },
+            options.workersNum,
+            options.timeoutMs
+        };
+
+        if (pool.start() == 0) {
+            std::wcerr << L"Failed to start the worker processes\n";
+            return E_FAIL;
+        }
+
+        SettingsCatalog catalog { getOsBuild() };
+        const std::size_t cataloged { buildCatalog(pool, settingIds, catalog) };
+        pool.stop();
+
+        std::ofstream catalogStream { options.outPath, std::ios::binary | std::ios::trunc };
+        if (!catalogStream || catalog.write(catalogStream) == false) {
+            std::wcerr << L"Failed to write the catalog into '" << options.outPath << L"'\n";
+            return E_ACCESSDENIED;
+        }
+
+        std::wcout << L"Cataloged " << cataloged << L" of " << settingIds.size() << L" settings, "
+            << pool.getRestarts() << L" workers restarted\n";
+
+        return ERROR_SUCCESS;
+    }
+
+    DWORD WINAPI runCatalog(LPVOID pArgs) {
+        const pair<int, wchar_t**>& args { *static_cast<pair<int, wchar_t**>*>(pArgs) };
+        CatalogOptions options {};
+
+        if (getCatalogOptions(args.first, args.second, options) != ERROR_SUCCESS) {
+            std::wcerr << L"Usage: SettingsCatalog.exe -out <path> [-workers <n>] [-timeout <ms>]\n";
+            return static_cast<DWORD>(E_INVALIDARG);
+        }
+
+        const HRESULT res {
+            options.workerId.empty() ? runCatalogSupervisor(options) : runCatalogWorker()
+        };
+
+        return static_cast<DWORD>(res);
+    }
+}
+
+[System::STAThread]
+int wmain(int argc, wchar_t* argv[]) {
+    pair<int, wchar_t**> args { argc, argv };
+    DWORD threadID { 0 };
+    DWORD exitCode { 0 };
+
+    HANDLE thHandle = CreateThread(NULL, 0, runCatalog, &args, 0, &threadID);
+
+    WaitForSingleObject(thHandle, INFINITE);
+    GetExitCodeThread(thHandle, &exitCode);
+    CloseHandle(thHandle);
+
+    return static_cast<int>(exitCode);
+}
@@ -0,0 +1,30 @@
+{
+    "targets": [
+        {
+            "target_name": "settingsHelper",
+            # The engine backend of 'SettingsHelperLib' is built with the common
+            # language runtime support, which a native module can't load, so the
+            # binding is only built and tested over a mocked backend.
+            "sources": [
+                "src/SettingsHelperAddon.cpp",
+                "../SettingsHelperLib/ActionEngine.cpp",
+                "src/MockEngineBackend.cpp"
+            ],
+            "include_dirs": [
+                "../SettingsHelperLib"
+            ],
+            "conditions": [
+                ["OS=='win'", {
+                    "msvs_settings": {
+                        "VCCLCompilerTool": {
+                            "ExceptionHandling": 1
+                        }
+                    }
+                }, {
+                    "cflags_cc": [ "-std=c++14", "-fexceptions" ],
+                    "cflags_cc!": [ "-fno-exceptions" ]
+                }]
+            ]
+        }
+    ]
+}
@@ -0,0 +1,25 @@
+/*
+ * Settings helper addon.
+ * Runs the actions of the settings helper in a warm engine, inside the Node process.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+"use strict";
+
+/**
+ * execute(payload, options): Runs a payload, either the JSON text or the array of actions accepted by
+ * SettingsHelper.exe. Returns a promise resolving with the array of results, as objects holding the same fields the
+ * executable prints. The payloads run one at a time, in order, in a thread owned by the addon. The optional
+ * `options.deadlineMs` is the time in which the payload should be answered once it starts running, like `-deadline`;
+ * without it the deadline is read from SETTINGS_HELPER_DEADLINE when the engine starts.
+ *
+ * stop(): Waits for the pending payloads and stops the engine thread, which the next 'execute' starts again.
+ */
+module.exports = require("./build/Release/settingsHelper.node");
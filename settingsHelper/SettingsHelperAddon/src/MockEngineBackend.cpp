@@ -0,0 +1,80 @@
+/**
+ * Mocked engine backend, used to test the addon outside Windows.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include <SettingsEngineBackend.h>
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Answers each line of the payload with a result:
+    ///     - 'settingId=json': Succeeds, returning the JSON value.
+    ///     - 'settingId!message': Fails with the message.
+    ///     - '@thread': Returns the id of the thread running the batch.
+    ///     - '@deadline': Returns the deadline of the batch.
+    ///  Any other line fails without a setting id, like an action that couldn't
+    ///  be parsed.
+    /// </summary>
+    class MockEngineBackend : public EngineBackend {
+    public:
+        bool start() override { return true; }
+
+        vector<EngineResult> runBatch(const wstring& payload, std::uint32_t deadlineMs) override {
+            vector<EngineResult> results {};
+            std::size_t lineStart { 0 };
+
+            while (lineStart < payload.size()) {
+                std::size_t lineEnd { payload.find(L'\n', lineStart) };
+                if (lineEnd == wstring::npos) { lineEnd = payload.size(); }
+
+                const wstring line { payload.substr(lineStart, lineEnd - lineStart) };
+                const std::size_t sep { line.find_first_of(L"=!") };
+                EngineResult result {};
+
+                if (line == L"@thread") {
+                    result.settingId = L"@thread";
+                    result.returnValue = std::to_wstring(currentThreadId());
+                } else if (line == L"@deadline") {
+                    result.settingId = L"@deadline";
+                    result.returnValue = std::to_wstring(deadlineMs);
+                } else if (sep != wstring::npos && sep > 0) {
+                    result.settingId = line.substr(0, sep);
+
+                    if (line[sep] == L'=') {
+                        result.returnValue = line.substr(sep + 1);
+                    } else {
+                        result.isError = true;
+                        result.errorMessage = line.substr(sep + 1);
+                    }
+                } else {
+                    result.isError = true;
+                    result.errorMessage = L"Unrecognized action: " + line;
+                }
+
+                results.push_back(std::move(result));
+                lineStart = lineEnd + 1;
+            }
+
+            return results;
+        }
+
+        void stop() override {}
+    };
+}
+
+std::unique_ptr<EngineBackend> createSettingsEngineBackend() {
+    return std::unique_ptr<EngineBackend> { new MockEngineBackend {} };
+}
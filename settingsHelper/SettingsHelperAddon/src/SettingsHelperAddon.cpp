@@ -0,0 +1,426 @@
+/**
+ * Node addon running the settings helper actions in process.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#define NAPI_VERSION 4
+#include <node_api.h>
+
+#include <ActionEngine.h>
+#include <SettingsEngineBackend.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  The engine shared by every call, started by the first one.
+    /// </summary>
+    std::unique_ptr<ActionEngine> engine {};
+
+    /// <summary>
+    ///  A call to 'execute' waiting for the engine to run its payload.
+    /// </summary>
+    struct PendingCall {
+        napi_deferred deferred { nullptr };
+        napi_threadsafe_function onDone { nullptr };
+        vector<EngineResult> results {};
+    };
+
+    // ------------------------------------------------------------------------
+    //  Strings, JavaScript strings are UTF-16 while 'wchar_t' is 32 bits wide
+    //  outside Windows.
+    // ------------------------------------------------------------------------
+
+    wstring toWString(const std::u16string& str) {
+        wstring result {};
+        result.reserve(str.size());
+
+        for (std::size_t i = 0; i < str.size(); i++) {
+            const char16_t unit { str[i] };
+            const bool isPair {
+                sizeof(wchar_t) > 2 && unit >= 0xD800 && unit <= 0xDBFF &&
+                i + 1 < str.size() && str[i + 1] >= 0xDC00 && str[i + 1] <= 0xDFFF
+            };
+
+            if (isPair) {
+                const char32_t high { static_cast<char32_t>(unit - 0xD800) };
+                const char32_t low { static_cast<char32_t>(str[++i] - 0xDC00) };
+                result.push_back(static_cast<wchar_t>(0x10000 + (high << 10) + low));
+            } else {
+                result.push_back(static_cast<wchar_t>(unit));
+            }
+        }
+
+        return result;
+    }
+
+    std::u16string toU16String(const wstring& str) {
+        std::u16string result {};
+        result.reserve(str.size());
+
+        for (const wchar_t c : str) {
+            const char32_t point { static_cast<char32_t>(c) };
+
+            if (point > 0xFFFF) {
+                result.push_back(static_cast<char16_t>(0xD800 + ((point - 0x10000) >> 10)));
+                result.push_back(static_cast<char16_t>(0xDC00 + ((point - 0x10000) & 0x3FF)));
+            } else {
+                result.push_back(static_cast<char16_t>(point));
+            }
+        }
+
+        return result;
+    }
+
+    napi_status getString(napi_env env, napi_value value, wstring& rStr) {
+        std::size_t length { 0 };
+        napi_status status { napi_get_value_string_utf16(env, value, nullptr, 0, &length) };
+
+        if (status == napi_ok) {
+            std::u16string str(length + 1, u'\0');
+            status = napi_get_value_string_utf16(env, value, &str[0], str.size(), &length);
+            str.resize(length);
+
+            rStr = toWString(str);
+        }
+
+        return status;
+    }
+
+    napi_value createString(napi_env env, const wstring& str) {
+        napi_value result { nullptr };
+        const std::u16string u16Str { toU16String(str) };
+
+        napi_create_string_utf16(env, u16Str.data(), u16Str.size(), &result);
+
+        return result;
+    }
+
+    /// <summary>
+    ///  Creates a string, or null for an empty one, same as the executable
+    ///  does when serializing the results.
+    /// </summary>
+    napi_value createStringOrNull(napi_env env, const wstring& str) {
+        napi_value result { nullptr };
+
+        if (str.empty()) {
+            napi_get_null(env, &result);
+        } else {
+            result = createString(env, str);
+        }
+
+        return result;
+    }
+
+    /// <summary>
+    ///  Gets a function of the global JSON object.
+    /// </summary>
+    napi_value getJSONFunction(napi_env env, const char* name) {
+        napi_value global { nullptr };
+        napi_value json { nullptr };
+        napi_value function { nullptr };
+
+        napi_get_global(env, &global);
+        napi_get_named_property(env, global, "JSON", &json);
+        napi_get_named_property(env, json, name, &function);
+
+        return function;
+    }
+
+    /// <summary>
+    ///  Gets the JSON text of an 'execute' payload, strings are taken as is.
+    /// </summary>
+    napi_status getPayload(napi_env env, napi_value value, wstring& rPayload) {
+        napi_valuetype type { napi_undefined };
+        napi_status status { napi_typeof(env, value, &type) };
+
+        if (status == napi_ok && type != napi_string) {
+            napi_value global { nullptr };
+            napi_value json { nullptr };
+            napi_get_global(env, &global);
+            status = napi_call_function(env, global, getJSONFunction(env, "stringify"), 1, &value, &json);
+
+            if (status == napi_ok) {
+                status = napi_typeof(env, json, &type);
+                value = json;
+            }
+        }
+
+        if (status == napi_ok && type != napi_string) {
+            status = napi_string_expected;
+        }
+
+        if (status == napi_ok) {
+            status = getString(env, value, rPayload);
+        }
+
+        return status;
+    }
+
+    /// <summary>
+    ///  Longest deadline of a batch, same limit as the '-deadline' switch.
+    /// </summary>
+    const double maxDeadlineMs { 10 * 60 * 1000 };
+
+    /// <summary>
+    ///  Gets the options of an 'execute' call, an object whose 'deadlineMs' is
+    ///  the time in which the batch should be answered. Missing options leave
+    ///  the deadline at zero, so the default of the engine applies.
+    /// </summary>
+    napi_status getOptions(napi_env env, napi_value value, std::uint32_t& rDeadlineMs) {
+        napi_valuetype type { napi_undefined };
+        napi_status status { napi_typeof(env, value, &type) };
+
+        if (status != napi_ok || type == napi_undefined) {
+            return status;
+        }
+
+        if (type != napi_object) {
+            return napi_object_expected;
+        }
+
+        napi_value deadline { nullptr };
+        status = napi_get_named_property(env, value, "deadlineMs", &deadline);
+
+        if (status == napi_ok) {
+            status = napi_typeof(env, deadline, &type);
+        }
+
+        if (status != napi_ok || type == napi_undefined) {
+            return status;
+        }
+
+        double deadlineMs { 0 };
+        status = type == napi_number ? napi_get_value_double(env, deadline, &deadlineMs) : napi_number_expected;
+
+        // NaN fails every comparison
+        if (status == napi_ok && (deadlineMs >= 0 && deadlineMs <= maxDeadlineMs) == false) {
+            status = napi_invalid_arg;
+        }
+
+        if (status == napi_ok) {
+            rDeadlineMs = static_cast<std::uint32_t>(deadlineMs);
+        }
+
+        return status;
+    }
+
+    /// <summary>
+    ///  Creates the JavaScript value of a serialized 'returnValue', falling
+    ///  back to the string if it isn't valid JSON.
+    /// </summary>
+    napi_value createReturnValue(napi_env env, napi_value parse, const wstring& returnValue) {
+        napi_value text { createStringOrNull(env, returnValue) };
+
+        if (returnValue.empty()) {
+            return text;
+        }
+
+        napi_value global { nullptr };
+        napi_value value { nullptr };
+        napi_get_global(env, &global);
+
+        if (napi_call_function(env, global, parse, 1, &text, &value) != napi_ok) {
+            napi_value error { nullptr };
+            napi_get_and_clear_last_exception(env, &error);
+
+            value = text;
+        }
+
+        return value;
+    }
+
+    napi_value createResults(napi_env env, const vector<EngineResult>& results) {
+        napi_value array { nullptr };
+        napi_value parse { getJSONFunction(env, "parse") };
+        napi_create_array_with_length(env, results.size(), &array);
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const EngineResult& result { results[i] };
+            napi_value object { nullptr };
+            napi_value isError { nullptr };
+
+            napi_create_object(env, &object);
+            napi_get_boolean(env, result.isError, &isError);
+
+            napi_set_named_property(env, object, "settingID", createStringOrNull(env, result.settingId));
+            napi_set_named_property(env, object, "isError", isError);
+            napi_set_named_property(env, object, "errorMessage", createStringOrNull(env, result.errorMessage));
+            napi_set_named_property(env, object, "returnValue", createReturnValue(env, parse, result.returnValue));
+
+            napi_set_element(env, array, static_cast<uint32_t>(i), object);
+        }
+
+        return array;
+    }
+
+    napi_value createError(napi_env env, const char* message) {
+        napi_value text { nullptr };
+        napi_value error { nullptr };
+
+        napi_create_string_utf8(env, message, NAPI_AUTO_LENGTH, &text);
+        napi_create_error(env, nullptr, text, &error);
+
+        return error;
+    }
+
+    // ------------------------------------------------------------------------
+    //  Engine
+    // ------------------------------------------------------------------------
+
+    /// <summary>
+    ///  Resolves the promise of a call with its results, in the main thread.
+    ///  The environment is null if Node is exiting, then the call is dropped.
+    /// </summary>
+    void resolveCall(napi_env env, napi_value, void*, void* data) {
+        std::unique_ptr<PendingCall> call { static_cast<PendingCall*>(data) };
+
+        if (env != nullptr) {
+            napi_resolve_deferred(env, call->deferred, createResults(env, call->results));
+        }
+    }
+
+    void stopEngine() {
+        if (engine != nullptr) {
+            engine->stop();
+            engine.reset();
+        }
+    }
+
+    void stopEngineHook(void*) {
+        stopEngine();
+    }
+
+    // ------------------------------------------------------------------------
+    //  Exported functions
+    // ------------------------------------------------------------------------
+
+    /// <summary>
+    ///  execute(payload, options): Runs the actions of a payload, either the
+    ///  JSON text or the array of actions, returning a promise resolving with
+    ///  the array of results. The optional 'options.deadlineMs' bounds the time
+    ///  taken by this batch.
+    /// </summary>
+    napi_value execute(napi_env env, napi_callback_info info) {
+        std::size_t argc { 2 };
+        napi_value argv[2] { nullptr, nullptr };
+        napi_value promise { nullptr };
+        napi_value resourceName { nullptr };
+        wstring payload {};
+        std::uint32_t deadlineMs { 0 };
+
+        napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+
+        if (argc < 1 || getPayload(env, argv[0], payload) != napi_ok) {
+            bool pending { false };
+            napi_is_exception_pending(env, &pending);
+
+            if (pending == false) {
+                napi_throw_type_error(env, nullptr, "The payload must be a JSON string or an array of actions");
+            }
+
+            return nullptr;
+        }
+
+        if (argc > 1 && getOptions(env, argv[1], deadlineMs) != napi_ok) {
+            bool pending { false };
+            napi_is_exception_pending(env, &pending);
+
+            if (pending == false) {
+                napi_throw_type_error(
+                    env, nullptr, "The options must be an object, with 'deadlineMs' between 0 and 600000"
+                );
+            }
+
+            return nullptr;
+        }
+
+        std::unique_ptr<PendingCall> call { new PendingCall {} };
+        napi_create_promise(env, &call->deferred, &promise);
+        napi_create_string_utf8(env, "settingsHelper.execute", NAPI_AUTO_LENGTH, &resourceName);
+
+        napi_status status {
+            napi_create_threadsafe_function(
+                env, nullptr, nullptr, resourceName, 0, 1, nullptr, nullptr, nullptr, resolveCall, &call->onDone
+            )
+        };
+
+        if (status == napi_ok && engine == nullptr) {
+            engine.reset(new ActionEngine { createSettingsEngineBackend() });
+
+            if (engine->start() == false) {
+                engine.reset();
+            }
+        }
+
+        PendingCall* pCall { call.get() };
+        const bool submitted {
+            status == napi_ok && engine != nullptr &&
+            engine->submit(std::move(payload), deadlineMs, [pCall](vector<EngineResult> results) {
+                napi_threadsafe_function onDone { pCall->onDone };
+                pCall->results = std::move(results);
+
+                // Closing while Node exits, the results won't be delivered
+                if (napi_call_threadsafe_function(onDone, pCall, napi_tsfn_blocking) != napi_ok) {
+                    delete pCall;
+                }
+
+                napi_release_threadsafe_function(onDone, napi_tsfn_release);
+            })
+        };
+
+        if (submitted) {
+            // Owned by the engine until the results are delivered
+            call.release();
+        } else {
+            if (status == napi_ok) {
+                napi_release_threadsafe_function(call->onDone, napi_tsfn_release);
+            }
+
+            napi_reject_deferred(env, call->deferred, createError(env, "The settings engine couldn't be started"));
+        }
+
+        return promise;
+    }
+
+    /// <summary>
+    ///  stop(): Waits for the pending payloads and stops the engine, the next
+    ///  call to 'execute' starts a new one.
+    /// </summary>
+    napi_value stop(napi_env env, napi_callback_info) {
+        stopEngine();
+
+        napi_value result { nullptr };
+        napi_get_undefined(env, &result);
+
+        return result;
+    }
+
+    napi_value init(napi_env env, napi_value exports) {
+        const napi_property_descriptor properties[] {
+            { "execute", nullptr, execute, nullptr, nullptr, nullptr, napi_default, nullptr },
+            { "stop", nullptr, stop, nullptr, nullptr, nullptr, napi_default, nullptr }
+        };
+
+        napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties);
+        napi_add_env_cleanup_hook(env, stopEngineHook, nullptr);
+
+        return exports;
+    }
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
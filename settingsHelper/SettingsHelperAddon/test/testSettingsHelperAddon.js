@@ -0,0 +1,126 @@
+/*
+ * Settings helper addon tests.
+ * Exercise the binding over the mocked backend, which answers each line of the payload:
+ *  - "settingId=json": Succeeds, returning the JSON value.
+ *  - "settingId!message": Fails with the message.
+ *  - "@thread": Returns the id of the thread running the batch.
+ *  - "@deadline": Returns the deadline of the batch.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+"use strict";
+
+var assert = require("assert");
+var addon = require("../index.js");
+
+var tests = [];
+
+var test = function (name, run) {
+    tests.push({ name: name, run: run });
+};
+
+test("Results are converted into objects", function () {
+    return addon.execute("A=true\nB={\"x\":[1,2]}\nC!Failed é 😀\nD=not json\nbad line").then(function (results) {
+        assert.deepStrictEqual(results, [
+            { settingID: "A", isError: false, errorMessage: null, returnValue: true },
+            { settingID: "B", isError: false, errorMessage: null, returnValue: { x: [1, 2] } },
+            { settingID: "C", isError: true, errorMessage: "Failed é 😀", returnValue: null },
+            { settingID: "D", isError: false, errorMessage: null, returnValue: "not json" },
+            { settingID: null, isError: true, errorMessage: "Unrecognized action: bad line", returnValue: null }
+        ]);
+    });
+});
+
+test("Actions are serialized", function () {
+    // The mock takes the JSON text as a single line
+    return addon.execute(["x"]).then(function (results) {
+        assert.strictEqual(results.length, 1);
+        assert.strictEqual(results[0].errorMessage, "Unrecognized action: [\"x\"]");
+    });
+});
+
+test("Invalid payloads throw", function () {
+    assert.throws(function () { addon.execute(); }, TypeError);
+    assert.throws(function () { addon.execute(undefined); }, TypeError);
+});
+
+test("Each payload gets its own deadline", function () {
+    return Promise.all([
+        addon.execute("@deadline", { deadlineMs: 1500 }),
+        addon.execute("@deadline"),
+        addon.execute("@deadline", {})
+    ]).then(function (results) {
+        assert.deepStrictEqual(results.map(function (result) { return result[0].returnValue; }), [1500, 0, 0]);
+    });
+});
+
+test("Invalid options throw", function () {
+    assert.throws(function () { addon.execute("A=1", 1500); }, TypeError);
+    assert.throws(function () { addon.execute("A=1", { deadlineMs: "1500" }); }, TypeError);
+    assert.throws(function () { addon.execute("A=1", { deadlineMs: -1 }); }, TypeError);
+    assert.throws(function () { addon.execute("A=1", { deadlineMs: 600001 }); }, TypeError);
+});
+
+test("Payloads run in order in the engine thread", function () {
+    var order = [];
+    var calls = [];
+
+    for (var i = 0; i < 20; i++) {
+        calls.push(addon.execute("@thread\nN=" + i).then(function (results) {
+            order.push(results[1].returnValue);
+            return results[0].returnValue;
+        }));
+    }
+
+    return Promise.all(calls).then(function (threads) {
+        assert.deepStrictEqual(order, Array.from({ length: 20 }, function (value, index) { return index; }));
+        threads.forEach(function (thread) {
+            assert.strictEqual(thread, threads[0]);
+        });
+    });
+});
+
+test("The engine restarts after being stopped", function () {
+    return addon.execute("A=1").then(function () {
+        addon.stop();
+        addon.stop();
+        return addon.execute("A=2");
+    }).then(function (results) {
+        assert.strictEqual(results[0].returnValue, 2);
+    });
+});
+
+test("Pending payloads complete when stopping", function () {
+    var pending = addon.execute("A=1");
+    addon.stop();
+
+    return pending.then(function (results) {
+        assert.strictEqual(results[0].returnValue, 1);
+    });
+});
+
+var runTests = function (index) {
+    if (index >= tests.length) {
+        console.log("All " + tests.length + " tests passed");
+        return;
+    }
+
+    var current = tests[index];
+    Promise.resolve().then(current.run).then(function () {
+        console.log("ok - " + current.name);
+        runTests(index + 1);
+    }, function (err) {
+        console.error("not ok - " + current.name);
+        console.error(err);
+        process.exitCode = 1;
+    });
+};
+
+runTests(0);
@@ -0,0 +1,45 @@
+/**
+ * Global allocation counter used by the benchmarks.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<std::size_t> allocations { 0 };
+
+std::size_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* mem { std::malloc(size == 0 ? 1 : size) };
+    if (mem == nullptr) { throw std::bad_alloc {}; }
+
+    return mem;
+}
+
+void operator delete(void* mem) noexcept {
+    std::free(mem);
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* mem) noexcept {
+    operator delete(mem);
+}
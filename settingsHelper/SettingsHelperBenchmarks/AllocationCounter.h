@@ -0,0 +1,22 @@
+/**
+ * Global allocation counter used by the benchmarks.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/// <summary>
+///  Returns the number of calls to the global 'operator new' performed by
+///  the process so far. Allocations performed by the system libraries using
+///  their own heaps aren't accounted.
+/// </summary>
+std::size_t allocationCount();
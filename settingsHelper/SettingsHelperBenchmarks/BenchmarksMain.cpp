@@ -0,0 +1,15 @@
+/**
+ * Entry point for the benchmarks.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+BENCHMARK_MAIN();
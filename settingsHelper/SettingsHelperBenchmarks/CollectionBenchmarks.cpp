@@ -0,0 +1,211 @@
+/**
+ * Benchmarks for the traversal of collection settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include "AllocationCounter.h"
+#include <SettingItem.h>
+#include <SettingUtils.h>
+#include <SimulatedSettings.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+/// <summary>
+///  Creates a simulated notifications app list with the supplied number of elements.
+/// </summary>
+ATL::CComPtr<ISettingItem> createAppListCollection(std::size_t elemsNum, vector<wstring>& elemIds) {
+    ATL::CComPtr<SimulatedSettingItem> collection {
+        createSimulatedCollection(L"SystemSettings_Notifications_AppList", elemsNum, elemIds)
+    };
+
+    return ATL::CComPtr<ISettingItem> { static_cast<ISettingItem*>(collection) };
+}
+
+/// <summary>
+///  Layout of SettingItem before it became a handle, copies of it duplicate
+///  the ids and the vectors it holds. Used as the baseline of the benchmarks.
+/// </summary>
+struct DeepSettingItem {
+    wstring parentId;
+    wstring settingId;
+    ATL::CComPtr<ISettingItem> setting;
+    vector<DeepSettingItem> assocSettings;
+    vector<DbSettingItem> dbSettings;
+};
+
+/// <summary>
+///  Mirrors the shape of the previous implementation of 'getCollectionSettings'
+///  followed by the iteration done in 'handleCollectionAction'.
+/// </summary>
+HRESULT traverseDeepCopies(ISettingItem* pCollection, const vector<wstring>& ids) {
+    ATL::CComPtr<IInspectable> collection { NULL };
+    HSTRING hValueId { NULL };
+    WindowsCreateString(L"Value", 5, &hValueId);
+    HRESULT errCode = pCollection->GetValue(hValueId, &collection);
+    WindowsDeleteString(hValueId);
+    if (errCode != ERROR_SUCCESS) { return errCode; }
+
+    auto pSettingVector = static_cast<IVector<IInspectable*>*>(static_cast<IInspectable*>(collection));
+    vector<wstring> _ids { ids };
+    vector<DeepSettingItem> settingItems {};
+    UINT32 vectorSize { 0 };
+
+    pSettingVector->get_Size(&vectorSize);
+
+    for (UINT32 i = 0; i < vectorSize; i++) {
+        ATL::CComPtr<ISettingItem> pCurSetting = NULL;
+        pSettingVector->GetAt(i, reinterpret_cast<IInspectable**>(&pCurSetting));
+
+        for (auto id = _ids.begin(); id != _ids.end();) {
+            DeepSettingItem setting { L"SystemSettings_Notifications_AppList", *id, pCurSetting };
+
+            HSTRING hId { NULL };
+            UINT32 length { 0 };
+            pCurSetting->get_Id(&hId);
+            const wstring curSettingId { WindowsGetStringRawBuffer(hId, &length) };
+            WindowsDeleteString(hId);
+
+            if (*id == curSettingId) {
+                settingItems.push_back(setting);
+                id = _ids.erase(id);
+            } else {
+                ++id;
+            }
+        }
+    }
+
+    vector<DeepSettingItem> rSettings {};
+    rSettings = settingItems;
+
+    for (auto setting : rSettings) {
+        SettingType type { SettingType::Empty };
+        setting.setting->get_SettingType(&type);
+        benchmark::DoNotOptimize(type);
+    }
+
+    return errCode;
+}
+
+static void BM_CollectionDeepCopies(benchmark::State& state) {
+    const std::size_t elemsNum { static_cast<std::size_t>(state.range(0)) };
+    vector<wstring> elemIds {};
+    ATL::CComPtr<ISettingItem> collection { createAppListCollection(elemsNum, elemIds) };
+    std::size_t allocs { 0 };
+
+    for (auto _ : state) {
+        const std::size_t start { allocationCount() };
+        traverseDeepCopies(collection, elemIds);
+        allocs += allocationCount() - start;
+    }
+
+    state.counters["allocsPerElement"] =
+        static_cast<double>(allocs) / (static_cast<double>(state.iterations()) * elemsNum);
+}
+BENCHMARK(BM_CollectionDeepCopies)->Arg(1000);
+
+static void BM_CollectionHandles(benchmark::State& state) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    backend.load();
+
+    const std::size_t elemsNum { static_cast<std::size_t>(state.range(0)) };
+    vector<wstring> elemIds {};
+    SettingItem collection {
+        SettingAtom { L"SystemSettings_Notifications_AppList" }, createAppListCollection(elemsNum, elemIds)
+    };
+    std::size_t allocs { 0 };
+
+    for (auto _ : state) {
+        const std::size_t start { allocationCount() };
+        vector<SettingItem> settings {};
+
+        sAPI.getCollectionSettings(elemIds, collection, settings);
+
+        for (auto setting : settings) {
+            SettingType type { SettingType::Empty };
+            setting.GetSettingType(&type);
+            benchmark::DoNotOptimize(type);
+        }
+
+        allocs += allocationCount() - start;
+    }
+
+    state.counters["allocsPerElement"] =
+        static_cast<double>(allocs) / (static_cast<double>(state.iterations()) * elemsNum);
+}
+BENCHMARK(BM_CollectionHandles)->Arg(1000);
+
+static void BM_SettingItemCopy(benchmark::State& state) {
+    const std::size_t elemsNum { static_cast<std::size_t>(state.range(0)) };
+    vector<wstring> elemIds {};
+    ATL::CComPtr<ISettingItem> pCollection { createAppListCollection(elemsNum, elemIds) };
+    const SettingAtom collectionId { L"SystemSettings_Notifications_AppList" };
+    vector<SettingItem> settings {};
+
+    for (const auto& elemId : elemIds) {
+        settings.emplace_back(collectionId, elemId, pCollection);
+    }
+
+    std::size_t allocs { 0 };
+
+    for (auto _ : state) {
+        const std::size_t start { allocationCount() };
+
+        for (auto setting : settings) {
+            benchmark::DoNotOptimize(setting.elementId);
+        }
+
+        allocs += allocationCount() - start;
+    }
+
+    state.counters["allocsPerElement"] =
+        static_cast<double>(allocs) / (static_cast<double>(state.iterations()) * elemsNum);
+}
+BENCHMARK(BM_SettingItemCopy)->Arg(1000);
+
+/// <summary>
+///  Matching loop of 'getCollectionSettings', requesting the last elements of
+///  the collection so all of them need to be visited.
+/// </summary>
+static void BM_CollectionMatching(benchmark::State& state) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    backend.load();
+
+    const std::size_t elemsNum { static_cast<std::size_t>(state.range(0)) };
+    const std::size_t idsNum { (std::min)(elemsNum, static_cast<std::size_t>(state.range(1))) };
+    vector<wstring> elemIds {};
+    SettingItem collection {
+        SettingAtom { L"SystemSettings_Notifications_AppList" }, createAppListCollection(elemsNum, elemIds)
+    };
+    const vector<wstring> ids { elemIds.end() - idsNum, elemIds.end() };
+
+    for (auto _ : state) {
+        vector<SettingItem> settings {};
+
+        sAPI.getCollectionSettings(ids, collection, settings);
+        benchmark::DoNotOptimize(settings.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * elemsNum);
+}
+BENCHMARK(BM_CollectionMatching)
+    ->ArgNames({ "elements", "ids" })
+    ->Args({ 1, 1 })->Args({ 10, 1 })->Args({ 100, 1 })->Args({ 1000, 1 })->Args({ 10000, 1 })
+    ->Args({ 100, 10 })->Args({ 1000, 10 })->Args({ 10000, 10 })
+    ->Args({ 10000, 100 });
@@ -0,0 +1,165 @@
+/**
+ * Benchmarks for the payload parsing and serialization.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include "AllocationCounter.h"
+
+#include <Payload.h>
+#include <PayloadProc.h>
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+/// <summary>
+///  Builds a payload with the supplied number of actions, mixing the kinds of
+///  actions found in the real payloads.
+/// </summary>
+wstring buildPayload(int actionsNum) {
+    const vector<wstring> actions {
+        LR"({ "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled", "method": "GetValue" })",
+        LR"({ "settingID": "SystemSettings_Display_BlueLight_ManualToggleQuickAction", "method": "SetValue", "parameters": [ true ] })",
+        LR"({ "settingID": "SystemSettings_Notifications_AppList.SystemSettings_Notifications_AppNotificationSoundToggle", "method": "GetValue", "parameters": [ { "elemId": "Microsoft.WindowsStore_8wekyb3d8bbwe" }, { "elemId": "Microsoft.Windows.Cortana_cw5n1h2txyewy" } ] })"
+    };
+
+    wstring payload { L"[" };
+
+    for (int i = 0; i < actionsNum; i++) {
+        payload.append(actions[i % actions.size()]);
+
+        if (i != actionsNum - 1) {
+            payload.append(L",");
+        }
+    }
+
+    payload.append(L"]");
+
+    return payload;
+}
+
+/// <summary>
+///  Fills the results of the batch actions without touching the system
+///  settings, so only the payload related work is measured.
+/// </summary>
+void fillResults(const vector<pair<Action, HRESULT>>& actions, vector<Result>& results) {
+    results.reserve(actions.size());
+
+    for (const auto& action : actions) {
+        results.push_back(Result { action.first.settingID, false, L"", L"true" });
+    }
+}
+
+static void BM_PayloadHeap(benchmark::State& state) {
+    const int actionsNum { static_cast<int>(state.range(0)) };
+    const wstring payload { buildPayload(actionsNum) };
+    std::size_t allocs { 0 };
+
+    for (auto _ : state) {
+        const std::size_t start { allocationCount() };
+
+        vector<pair<Action, HRESULT>> actions {};
+        vector<Result> results {};
+
+        parsePayload(payload, actions);
+        fillResults(actions, results);
+        wstring output { buildOutputStr(results) };
+        benchmark::DoNotOptimize(output.data());
+
+        allocs += allocationCount() - start;
+    }
+
+    state.counters["allocsPerAction"] =
+        static_cast<double>(allocs) / (static_cast<double>(state.iterations()) * actionsNum);
+}
+BENCHMARK(BM_PayloadHeap)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_PayloadBatch(benchmark::State& state) {
+    const int actionsNum { static_cast<int>(state.range(0)) };
+    const wstring payload { buildPayload(actionsNum) };
+    std::size_t allocs { 0 };
+    Batch batch {};
+
+    for (auto _ : state) {
+        const std::size_t start { allocationCount() };
+
+        {
+            BatchScope scope { batch.arena };
+
+            parsePayload(payload, batch.actions);
+            fillResults(batch.actions, batch.results);
+            wstring output { buildOutputStr(batch.results) };
+            benchmark::DoNotOptimize(output.data());
+        }
+
+        batch.reset();
+
+        allocs += allocationCount() - start;
+    }
+
+    state.counters["allocsPerAction"] =
+        static_cast<double>(allocs) / (static_cast<double>(state.iterations()) * actionsNum);
+    state.counters["arenaBytes"] = static_cast<double>(batch.arena.capacity());
+}
+BENCHMARK(BM_PayloadBatch)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_ParsePayload(benchmark::State& state) {
+    const int actionsNum { static_cast<int>(state.range(0)) };
+    const wstring payload { buildPayload(actionsNum) };
+
+    for (auto _ : state) {
+        vector<pair<Action, HRESULT>> actions {};
+
+        parsePayload(payload, actions);
+        benchmark::DoNotOptimize(actions.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * actionsNum);
+    state.SetBytesProcessed(state.iterations() * payload.size() * sizeof(wchar_t));
+}
+BENCHMARK(BM_ParsePayload)->RangeMultiplier(10)->Range(1, 10000);
+
+static void BM_SerializeResult(benchmark::State& state) {
+    const Result success { L"SystemSettings_Accessibility_Magnifier_IsEnabled", false, L"", L"true" };
+    const Result failure {
+        L"SystemSettings_Accessibility_Magnifier_IsEnabled", true, L"Setting not found", L""
+    };
+
+    for (auto _ : state) {
+        wstring successStr {};
+        wstring failureStr {};
+
+        serializeResult(success, successStr);
+        serializeResult(failure, failureStr);
+        benchmark::DoNotOptimize(successStr.data());
+        benchmark::DoNotOptimize(failureStr.data());
+    }
+}
+BENCHMARK(BM_SerializeResult);
+
+static void BM_BuildOutputStr(benchmark::State& state) {
+    const int actionsNum { static_cast<int>(state.range(0)) };
+    vector<pair<Action, HRESULT>> actions {};
+    vector<Result> results {};
+
+    parsePayload(buildPayload(actionsNum), actions);
+    fillResults(actions, results);
+
+    for (auto _ : state) {
+        wstring output { buildOutputStr(results) };
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * actionsNum);
+}
+BENCHMARK(BM_BuildOutputStr)->RangeMultiplier(10)->Range(1, 10000);
@@ -0,0 +1,155 @@
+/**
+ * Benchmarks of the complete payload processing over the simulated backend.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <IPropertyValueUtils.h>
+#include <Payload.h>
+#include <PayloadProc.h>
+#include <SettingUtils.h>
+#include <SimulatedSettings.h>
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+/// <summary>
+///  Creates a Boolean value for the simulated settings.
+/// </summary>
+ATL::CComPtr<IInspectable> createBoolValue(bool value) {
+    VARIANT variant {};
+    variant.vt = VARENUM::VT_BOOL;
+    variant.boolVal = value ? VARIANT_TRUE : VARIANT_FALSE;
+
+    ATL::CComPtr<IPropertyValue> propValue { NULL };
+    createPropertyValue(variant, propValue);
+
+    return ATL::CComPtr<IInspectable> { static_cast<IInspectable*>(propValue) };
+}
+
+/// <summary>
+///  Fills the backend with the settings targeted by 'buildSimulatedPayload'.
+/// </summary>
+void fillBackend(SimulatedSettingsBackend& backend, const SimulatedBehavior& behavior, vector<wstring>& rElemIds) {
+    backend.addSetting(
+        createSimulatedSetting(
+            L"SystemSettings_Accessibility_Magnifier_IsEnabled", SettingType::Boolean, createBoolValue(false), behavior
+        )
+    );
+    backend.addSetting(
+        createSimulatedSetting(
+            L"SystemSettings_Display_BlueLight_ManualToggleQuickAction", SettingType::Boolean, createBoolValue(false), behavior
+        )
+    );
+    backend.addSetting(createSimulatedCollection(L"SystemSettings_Notifications_AppList", 2, rElemIds, behavior));
+}
+
+/// <summary>
+///  Builds a payload with the supplied number of actions over the settings
+///  held by the backend filled by 'fillBackend'.
+/// </summary>
+wstring buildSimulatedPayload(int actionsNum, const vector<wstring>& elemIds) {
+    const vector<wstring> actions {
+        LR"({ "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled", "method": "GetValue" })",
+        LR"({ "settingID": "SystemSettings_Display_BlueLight_ManualToggleQuickAction", "method": "SetValue", "parameters": [ true ] })",
+        LR"({ "settingID": "SystemSettings_Notifications_AppList.SystemSettings_Notifications_AppNotificationSoundToggle", "method": "GetValue", "parameters": [ { "elemId": ")" +
+            elemIds[0] + LR"(" }, { "elemId": ")" + elemIds[1] + LR"(" } ] })"
+    };
+
+    wstring payload { L"[" };
+
+    for (int i = 0; i < actionsNum; i++) {
+        payload.append(actions[i % actions.size()]);
+
+        if (i != actionsNum - 1) {
+            payload.append(L",");
+        }
+    }
+
+    payload.append(L"]");
+
+    return payload;
+}
+
+/// <summary>
+///  Parses, handles and serializes a payload, the same work 'handlePayload'
+///  performs after reading its input.
+/// </summary>
+static void BM_SimulatedPipeline(benchmark::State& state) {
+    const int actionsNum { static_cast<int>(state.range(0)) };
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    vector<wstring> elemIds {};
+
+    backend.load();
+    fillBackend(backend, SimulatedBehavior {}, elemIds);
+
+    const wstring payload { buildSimulatedPayload(actionsNum, elemIds) };
+    Batch batch {};
+
+    for (auto _ : state) {
+        {
+            BatchScope scope { batch.arena };
+
+            parsePayload(payload, batch.actions);
+            handleBatchActions(sAPI, batch);
+            wstring output { buildOutputStr(batch.results) };
+            benchmark::DoNotOptimize(output.data());
+        }
+
+        batch.reset();
+    }
+
+    state.SetItemsProcessed(state.iterations() * actionsNum);
+}
+BENCHMARK(BM_SimulatedPipeline)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+
+/// <summary>
+///  Same as 'BM_SimulatedPipeline', with settings that keep updating for the
+///  supplied number of polls, and that raise 'SettingChanged' after them.
+/// </summary>
+static void BM_SimulatedPipelineUpdating(benchmark::State& state) {
+    const int actionsNum { 10 };
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    vector<wstring> elemIds {};
+
+    SimulatedBehavior behavior {};
+    behavior.updatingPolls = static_cast<std::uint32_t>(state.range(0));
+    behavior.changeEventPolls = static_cast<std::int32_t>(state.range(0));
+
+    backend.load();
+    fillBackend(backend, behavior, elemIds);
+
+    const wstring payload { buildSimulatedPayload(actionsNum, elemIds) };
+    Batch batch {};
+
+    for (auto _ : state) {
+        {
+            BatchScope scope { batch.arena };
+
+            parsePayload(payload, batch.actions);
+            handleBatchActions(sAPI, batch);
+            wstring output { buildOutputStr(batch.results) };
+            benchmark::DoNotOptimize(output.data());
+        }
+
+        batch.reset();
+    }
+
+    state.SetItemsProcessed(state.iterations() * actionsNum);
+}
+BENCHMARK(BM_SimulatedPipelineUpdating)->Arg(0)->Arg(1)->Arg(5)->Unit(benchmark::kMillisecond);
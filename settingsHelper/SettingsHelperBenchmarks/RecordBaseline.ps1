@@ -0,0 +1,52 @@
+<#
+  This script runs the SettingsHelperBenchmarks suite and stores the results
+  as a JSON baseline, which can be compared against later runs to detect
+  performance regressions.
+
+  The -compareTo parameter takes the path of a previous baseline, and the
+  -compareScript parameter the path to the 'compare.py' script shipped with
+  Google Benchmark (tools/compare.py). When both are supplied, the new results
+  are compared against the previous baseline after the run.
+#>
+param (
+    [string]$configuration = "Release",
+    [string]$platform = "x64",
+    [string]$out = "",
+    [string]$filter = ".",
+    [int]$repetitions = 5,
+    [string]$compareTo = "",
+    [string]$compareScript = ""
+)
+
+$ErrorActionPreference = "Stop"
+
+$projectDir = Split-Path -parent $PSCommandPath
+$solutionDir = (Get-Item $projectDir).Parent.FullName
+$benchmarksExe = Join-Path $solutionDir "$($platform)\$($configuration)\SettingsHelperBenchmarks.exe"
+
+If (!(Test-Path $benchmarksExe)) {
+    Write-Error "Benchmarks executable not found in '$($benchmarksExe)', build the 'SettingsHelperBenchmarks' project first."
+}
+
+If ($out -eq "") {
+    $baselinesDir = Join-Path $projectDir "baselines"
+    New-Item -ItemType Directory -Force -Path $baselinesDir | Out-Null
+    $out = Join-Path $baselinesDir "$($env:COMPUTERNAME)-$(Get-Date -Format 'yyyyMMdd-HHmmss').json"
+}
+
+Write-Host "Running '$($benchmarksExe)', results will be stored in '$($out)'"
+
+& $benchmarksExe `
+    "--benchmark_filter=$($filter)" `
+    "--benchmark_repetitions=$($repetitions)" `
+    "--benchmark_report_aggregates_only=true" `
+    "--benchmark_out=$($out)" `
+    "--benchmark_out_format=json"
+
+If ($LASTEXITCODE -ne 0) {
+    Write-Error "Benchmarks run failed with exit code $($LASTEXITCODE)"
+}
+
+If ($compareTo -ne "" -and $compareScript -ne "") {
+    & python $compareScript benchmarks $compareTo $out
+}
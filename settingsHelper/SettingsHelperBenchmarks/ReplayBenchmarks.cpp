@@ -0,0 +1,82 @@
+/**
+ * Benchmarks replaying the sessions of a recording over the simulated backend.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SessionReplay.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+namespace {
+    /// <summary>
+    ///  Environment variable holding the path of the recording to be replayed.
+    /// </summary>
+    const wchar_t* const REPLAY_ENV_VAR { L"SETTINGS_HELPER_REPLAY" };
+    /// <summary>
+    ///  Environment variable holding the speed of the replay, 1 by default.
+    /// </summary>
+    const wchar_t* const REPLAY_SPEED_ENV_VAR { L"SETTINGS_HELPER_REPLAY_SPEED" };
+
+    wstring getEnvironmentValue(const wchar_t* envVar) {
+        const DWORD valueSize { GetEnvironmentVariableW(envVar, NULL, 0) };
+        if (valueSize == 0) { return wstring {}; }
+
+        vector<wchar_t> valueBuf(valueSize);
+        GetEnvironmentVariableW(envVar, valueBuf.data(), valueSize);
+
+        return wstring { valueBuf.data() };
+    }
+
+    void replay(benchmark::State& state, const RecordedSession* pSession, double speed) {
+        ReplayResult result {};
+
+        for (auto _ : state) {
+            if (replaySession(*pSession, speed, result) != ERROR_SUCCESS) {
+                state.SkipWithError("Failed to build the replay backend");
+                break;
+            }
+        }
+
+        state.counters["recordedMs"] = static_cast<double>(pSession->durationUs) / 1000;
+        state.counters["outputMatches"] = result.outputMatches ? 1 : 0;
+    }
+
+    /// <summary>
+    ///  Registers one benchmark per session of the recording supplied in the
+    ///  environment, nothing is registered if there is none.
+    /// </summary>
+    bool registerReplayBenchmarks() {
+        static vector<RecordedSession> sessions {};
+
+        const wstring recordingPath { getEnvironmentValue(REPLAY_ENV_VAR) };
+        if (recordingPath.empty() || readRecording(recordingPath, sessions) != ERROR_SUCCESS) { return false; }
+
+        const wstring speedStr { getEnvironmentValue(REPLAY_SPEED_ENV_VAR) };
+        const double speed { speedStr.empty() ? 1.0 : wcstod(speedStr.c_str(), NULL) };
+
+        for (std::size_t i = 0; i < sessions.size(); i++) {
+            const std::string name { "BM_ReplaySession/" + std::to_string(i) };
+            benchmark::RegisterBenchmark(name.c_str(), &replay, &sessions[i], speed)->Unit(benchmark::kMillisecond);
+        }
+
+        return true;
+    }
+
+    const bool replayRegistered { registerReplayBenchmarks() };
+}
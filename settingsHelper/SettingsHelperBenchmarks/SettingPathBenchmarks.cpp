@@ -0,0 +1,98 @@
+/**
+ * Benchmarks for the setting path tokenizer.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <SettingPathTokenizer.h>
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+const vector<wstring>& settingPaths() {
+    static const vector<wstring> paths {
+        L"SystemSettings_Accessibility_Magnifier_IsEnabled",
+        L"SystemSettings_Notifications_AppList.Microsoft\\.Windows\\.Cortana_cw5n1h2txyewy",
+        L"SystemSettings_Display_BlueLight_ManualToggleQuickAction.Value",
+        L"SystemSettings_Notifications_AppList.Microsoft\\.WindowsStore_8wekyb3d8bbwe.SystemSettings_Notifications_AppNotificationSoundToggle"
+    };
+
+    return paths;
+}
+
+/// <summary>
+///  Previous implementation of 'split', kept to compare it against the tokenizer.
+/// </summary>
+vector<wstring> legacySplit(const wstring& str, const wstring& delim, const wstring& esc_sec) {
+    vector<wstring> tokens {};
+    size_t s_offset = 0, v_offset = 0, pos = 0, delimSize = delim.size();
+    size_t esc_pos = 0;
+
+    while (pos != wstring::npos) {
+        pos = str.find(delim, s_offset);
+        if (esc_pos != wstring::npos) {
+            esc_pos = str.find(esc_sec, s_offset);
+        }
+        s_offset = pos + delimSize;
+
+        if (esc_pos != (pos - 1)) {
+            tokens.push_back(str.substr(v_offset, pos - v_offset));
+            v_offset = s_offset;
+        }
+    }
+
+    return tokens;
+}
+
+static void BM_LegacySplit(benchmark::State& state) {
+    const wstring delim { L"." };
+    const wstring esc { L"\\" };
+
+    for (auto _ : state) {
+        for (const auto& path : settingPaths()) {
+            vector<wstring> segments { legacySplit(path, delim, esc) };
+            benchmark::DoNotOptimize(segments.data());
+        }
+    }
+}
+BENCHMARK(BM_LegacySplit);
+
+static void BM_TokenizeIntoVector(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const auto& path : settingPaths()) {
+            vector<wstring> segments {};
+            SettingPathTokenizer tokenizer { path };
+            WStringView segment {};
+
+            while (tokenizer.next(segment)) {
+                segments.push_back(segment.str());
+            }
+
+            benchmark::DoNotOptimize(segments.data());
+        }
+    }
+}
+BENCHMARK(BM_TokenizeIntoVector);
+
+static void BM_TokenizeSettingPath(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const auto& path : settingPaths()) {
+            SettingPathSegments<3> segments {};
+            bool valid { tokenizeSettingPath(path, segments) };
+
+            benchmark::DoNotOptimize(valid);
+            benchmark::DoNotOptimize(segments.segments);
+        }
+    }
+}
+BENCHMARK(BM_TokenizeSettingPath);
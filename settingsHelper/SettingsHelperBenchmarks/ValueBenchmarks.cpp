@@ -0,0 +1,140 @@
+/**
+ * Benchmarks for the setting paths splitting and the values conversions.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <IPropertyValueUtils.h>
+#include <SettingUtils.h>
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::vector;
+using std::wstring;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+namespace {
+    const vector<wstring> paths {
+        L"SystemSettings_Accessibility_Magnifier_IsEnabled",
+        L"SystemSettings_Notifications_AppList.Microsoft\\.Windows\\.Cortana_cw5n1h2txyewy",
+        L"SystemSettings_Notifications_AppList.Microsoft\\.WindowsStore_8wekyb3d8bbwe.SystemSettings_Notifications_AppNotificationSoundToggle"
+    };
+
+    /// <summary>
+    ///  String values and the types they are converted into, in the same
+    ///  order as 'valueTypeNames'.
+    /// </summary>
+    const vector<pair<wstring, PropertyType>> typedValues {
+        { L"true", PropertyType::PropertyType_Boolean },
+        { L"1.25", PropertyType::PropertyType_Double },
+        { L"-150", PropertyType::PropertyType_Int64 },
+        { L"Medium sensitivity", PropertyType::PropertyType_String }
+    };
+    const vector<std::string> valueTypeNames { "Boolean", "Double", "Int64", "String" };
+
+    ATL::CComPtr<IPropertyValue> createTypedValue(std::size_t index) {
+        VARIANT variant {};
+        ATL::CComPtr<IPropertyValue> propValue { NULL };
+
+        createValueVariant(typedValues[index].first, typedValues[index].second, variant);
+        createPropertyValue(variant, propValue);
+
+        if (variant.vt == VARENUM::VT_BSTR) {
+            std::free(variant.bstrVal);
+        }
+
+        return propValue;
+    }
+}
+
+static void BM_Split(benchmark::State& state) {
+    const wstring& path { paths[static_cast<std::size_t>(state.range(0))] };
+    const wstring delim { L"." };
+    const wstring esc { L"\\" };
+
+    for (auto _ : state) {
+        vector<wstring> segments { split(path, delim, esc) };
+        benchmark::DoNotOptimize(segments.data());
+    }
+}
+BENCHMARK(BM_Split)->DenseRange(0, 2);
+
+static void BM_SplitSettingPath(benchmark::State& state) {
+    const wstring& path { paths[static_cast<std::size_t>(state.range(0))] };
+
+    for (auto _ : state) {
+        vector<wstring> idsPath {};
+        HRESULT errCode { splitSettingPath(path, idsPath) };
+
+        benchmark::DoNotOptimize(errCode);
+        benchmark::DoNotOptimize(idsPath.data());
+    }
+}
+BENCHMARK(BM_SplitSettingPath)->DenseRange(0, 2);
+
+static void BM_CreateValueVariant(benchmark::State& state) {
+    const std::size_t index { static_cast<std::size_t>(state.range(0)) };
+    const wstring& value { typedValues[index].first };
+    const PropertyType type { typedValues[index].second };
+
+    for (auto _ : state) {
+        VARIANT variant {};
+        HRESULT errCode { createValueVariant(value, type, variant) };
+
+        benchmark::DoNotOptimize(errCode);
+        benchmark::DoNotOptimize(variant);
+
+        if (variant.vt == VARENUM::VT_BSTR) {
+            std::free(variant.bstrVal);
+        }
+    }
+
+    state.SetLabel(valueTypeNames[index]);
+}
+BENCHMARK(BM_CreateValueVariant)->DenseRange(0, 3);
+
+static void BM_ToString(benchmark::State& state) {
+    const std::size_t index { static_cast<std::size_t>(state.range(0)) };
+    const ATL::CComPtr<IPropertyValue> value { createTypedValue(index) };
+
+    for (auto _ : state) {
+        wstring valueStr {};
+        HRESULT errCode { toString(value, valueStr) };
+
+        benchmark::DoNotOptimize(errCode);
+        benchmark::DoNotOptimize(valueStr.data());
+    }
+
+    state.SetLabel(valueTypeNames[index]);
+}
+BENCHMARK(BM_ToString)->DenseRange(0, 3);
+
+static void BM_Equals(benchmark::State& state) {
+    const std::size_t index { static_cast<std::size_t>(state.range(0)) };
+    const ATL::CComPtr<IPropertyValue> fstValue { createTypedValue(index) };
+    const ATL::CComPtr<IPropertyValue> sndValue { createTypedValue(index) };
+
+    for (auto _ : state) {
+        BOOL result { false };
+        HRESULT errCode { equals(fstValue, sndValue, result) };
+
+        benchmark::DoNotOptimize(errCode);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetLabel(valueTypeNames[index]);
+}
+BENCHMARK(BM_Equals)->DenseRange(0, 3);
@@ -0,0 +1,19 @@
+/**
+ * Source file corresponding to pre-compiled header;
+ * necessary for compilation to succeed
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+
+//
+// pch.cpp
+// Include the standard header and generate the precompiled header.
+//
+#include "pch.h"
@@ -0,0 +1,121 @@
+/**
+ * Engine running batches of actions in a dedicated thread.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "ActionEngine.h"
+
+using std::vector;
+using std::wstring;
+
+ActionEngine::ActionEngine(std::unique_ptr<EngineBackend> backend) : backend(std::move(backend)) {}
+
+ActionEngine::~ActionEngine() {
+    stop();
+}
+
+bool ActionEngine::start() {
+    {
+        NativeLockGuard lock { mutex };
+        if (state != State::Idle || backend == nullptr) { return false; }
+
+        state = State::Starting;
+    }
+
+    thread.reset(new NativeThread { [this]() { run(); } });
+
+    NativeLockGuard lock { mutex };
+    if (thread->failed()) {
+        state = State::Stopped;
+    }
+
+    while (state == State::Starting) {
+        stateChanged.wait(mutex);
+    }
+
+    return state == State::Running;
+}
+
+bool ActionEngine::submit(wstring payload, std::uint32_t deadlineMs, Completion onDone) {
+    NativeLockGuard lock { mutex };
+    if (state != State::Running) { return false; }
+
+    jobs.push_back(Job { std::move(payload), deadlineMs, std::move(onDone) });
+    stateChanged.notifyAll();
+
+    return true;
+}
+
+void ActionEngine::stop() {
+    {
+        NativeLockGuard lock { mutex };
+
+        if (state == State::Idle) {
+            state = State::Stopped;
+        } else if (state == State::Running) {
+            state = State::Stopping;
+            stateChanged.notifyAll();
+        }
+    }
+
+    if (thread != nullptr) {
+        thread->join();
+    }
+}
+
+std::size_t ActionEngine::getBatchesRun() {
+    NativeLockGuard lock { mutex };
+    return batchesRun;
+}
+
+void ActionEngine::run() {
+    const bool started { backend->start() };
+
+    {
+        NativeLockGuard lock { mutex };
+        state = started ? State::Running : State::Stopped;
+        stateChanged.notifyAll();
+    }
+
+    if (started == false) { return; }
+
+    while (true) {
+        Job job {};
+
+        {
+            NativeLockGuard lock { mutex };
+
+            while (jobs.empty() && state == State::Running) {
+                stateChanged.wait(mutex);
+            }
+
+            // Batches queued before stopping are still run
+            if (jobs.empty()) { break; }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        vector<EngineResult> results { backend->runBatch(job.payload, job.deadlineMs) };
+
+        {
+            NativeLockGuard lock { mutex };
+            batchesRun++;
+        }
+
+        job.onDone(std::move(results));
+    }
+
+    backend->stop();
+
+    NativeLockGuard lock { mutex };
+    state = State::Stopped;
+}
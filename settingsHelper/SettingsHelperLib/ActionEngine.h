@@ -0,0 +1,131 @@
+/**
+ * Engine running batches of actions in a dedicated thread.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  The result of an action run by the engine, same as the 'Result' of the
+///  payload but independent from the Windows types.
+/// </summary>
+struct EngineResult {
+    /// <summary>
+    ///  The id of the setting targeted by the action, empty for the actions
+    ///  that couldn't be parsed.
+    /// </summary>
+    std::wstring settingId {};
+    bool isError { false };
+    std::wstring errorMessage {};
+    /// <summary>
+    ///  The JSON serialization of the returned value, empty for none.
+    /// </summary>
+    std::wstring returnValue {};
+};
+
+/// <summary>
+///  Runs the batches of the engine. Every method is called from the engine
+///  thread, so the backend can hold state tied to that thread, like the COM
+///  apartment and the loaded settings.
+/// </summary>
+class EngineBackend {
+public:
+    virtual ~EngineBackend() {}
+
+    /// <summary>
+    ///  Prepares the backend, before any batch is run.
+    /// </summary>
+    /// <returns>True if the backend is ready to run batches.</returns>
+    virtual bool start() = 0;
+    /// <summary>
+    ///  Runs the actions of a payload.
+    /// </summary>
+    /// <param name="payload">The payload holding the actions.</param>
+    /// <param name="deadlineMs">
+    ///  Time in which the batch should be answered in milliseconds, counted from
+    ///  when it starts running. Zero for the default of the backend.
+    /// </param>
+    /// <returns>One result per action of the payload, in order.</returns>
+    virtual std::vector<EngineResult> runBatch(const std::wstring& payload, std::uint32_t deadlineMs) = 0;
+    /// <summary>
+    ///  Releases the backend, after the last batch is run.
+    /// </summary>
+    virtual void stop() = 0;
+};
+
+/// <summary>
+///  Keeps a backend warm in a dedicated thread and runs the batches submitted
+///  from any other thread on it, one at a time in submission order.
+/// </summary>
+class ActionEngine {
+public:
+    /// <summary>
+    ///  Receives the results of a batch, it's called from the engine thread.
+    /// </summary>
+    using Completion = std::function<void(std::vector<EngineResult>)>;
+
+private:
+    enum class State { Idle, Starting, Running, Stopping, Stopped };
+
+    struct Job {
+        std::wstring payload {};
+        std::uint32_t deadlineMs { 0 };
+        Completion onDone {};
+    };
+
+    std::unique_ptr<EngineBackend> backend {};
+    std::unique_ptr<NativeThread> thread {};
+    NativeMutex mutex {};
+    NativeConditionVariable stateChanged {};
+    std::deque<Job> jobs {};
+    State state { State::Idle };
+    std::size_t batchesRun { 0 };
+
+    void run();
+
+public:
+    explicit ActionEngine(std::unique_ptr<EngineBackend> backend);
+    ~ActionEngine();
+
+    ActionEngine(const ActionEngine&) = delete;
+    ActionEngine& operator=(const ActionEngine&) = delete;
+
+    /// <summary>
+    ///  Starts the engine thread and the backend in it, waiting for it.
+    /// </summary>
+    /// <returns>True if the backend started, an engine can only be started once.</returns>
+    bool start();
+    /// <summary>
+    ///  Queues a payload to be run after the ones already submitted.
+    /// </summary>
+    /// <param name="deadlineMs">The deadline of the batch, see 'EngineBackend::runBatch'.</param>
+    /// <returns>False if the engine isn't running, then 'onDone' isn't called.</returns>
+    bool submit(std::wstring payload, std::uint32_t deadlineMs, Completion onDone);
+    /// <summary>
+    ///  Stops accepting payloads, runs the ones already queued, stops the
+    ///  backend and waits for the engine thread to exit. It must not be called
+    ///  from a completion.
+    /// </summary>
+    void stop();
+    /// <summary>
+    ///  Number of batches run by the engine.
+    /// </summary>
+    std::size_t getBatchesRun();
+};
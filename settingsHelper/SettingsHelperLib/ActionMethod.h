@@ -0,0 +1,122 @@
+/**
+ * Methods that can be requested over a setting.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstddef>
+
+/// <summary>
+///  Methods that can be requested in the actions of a payload. Values are used
+///  as indexes of the method tables, so they must be consecutive.
+/// </summary>
+enum class ActionMethod {
+    Unknown = 0,
+    GetValue,
+    SetValue,
+    GetMetadata,
+    Invoke,
+    GetStats,
+    Snapshot,
+    Restore
+};
+
+/// <summary>
+///  Number of values of ActionMethod, including 'Unknown'.
+/// </summary>
+constexpr std::size_t actionMethodsNum { 8 };
+
+/// <summary>
+///  Static description of an ActionMethod.
+/// </summary>
+struct ActionMethodInfo {
+    /// <summary>
+    ///  The described method.
+    /// </summary>
+    ActionMethod method;
+    /// <summary>
+    ///  The name used for the method in the payloads.
+    /// </summary>
+    const wchar_t* name;
+    /// <summary>
+    ///  The action is invalid if the 'parameters' field isn't present.
+    /// </summary>
+    bool requiresParams;
+    /// <summary>
+    ///  The parameters carry values to be applied to the settings, otherwise
+    ///  they can only be used to select elements of a collection.
+    /// </summary>
+    bool setsValues;
+    /// <summary>
+    ///  The parameters are the ids of the settings the method runs over, the
+    ///  'settingID' of the action only labels its result.
+    /// </summary>
+    bool listsSettings;
+    /// <summary>
+    ///  The method may observe or change any setting, so the actions of a
+    ///  batch aren't coalesced or reordered across it.
+    /// </summary>
+    bool isBarrier;
+    /// <summary>
+    ///  The 'settingID' of the action can be a selector, which is run as one
+    ///  action per selected setting.
+    /// </summary>
+    bool acceptsSelectors;
+    /// <summary>
+    ///  The action can list 'fields' of the setting metadata to be reported
+    ///  along with its result.
+    /// </summary>
+    bool projectsFields;
+};
+
+/// <summary>
+///  Table describing every ActionMethod, indexed by the method value.
+/// </summary>
+inline const ActionMethodInfo* actionMethodsTable() {
+    static const ActionMethodInfo table[actionMethodsNum] {
+        { ActionMethod::Unknown,     L"",            false, false, false, false, false, false },
+        { ActionMethod::GetValue,    L"GetValue",    false, false, false, false, true,  true  },
+        { ActionMethod::SetValue,    L"SetValue",    true,  true,  false, false, false, false },
+        { ActionMethod::GetMetadata, L"GetMetadata", false, false, false, false, true,  false },
+        { ActionMethod::Invoke,      L"Invoke",      false, false, false, true,  false, false },
+        { ActionMethod::GetStats,    L"GetStats",    false, false, false, false, false, false },
+        { ActionMethod::Snapshot,    L"Snapshot",    true,  false, true,  true,  false, false },
+        { ActionMethod::Restore,     L"Restore",     true,  false, false, true,  false, false }
+    };
+
+    return table;
+}
+
+/// <summary>
+///  Gets the description of the supplied method.
+/// </summary>
+inline const ActionMethodInfo& actionMethodInfo(ActionMethod method) {
+    return actionMethodsTable()[static_cast<std::size_t>(method)];
+}
+
+/// <summary>
+///  Gets the method with the supplied name, names are case sensitive.
+/// </summary>
+/// <returns>The method, or ActionMethod::Unknown if the name isn't known.</returns>
+inline ActionMethod parseActionMethod(WStringView name) {
+    const ActionMethodInfo* table { actionMethodsTable() };
+
+    // Skip 'Unknown', its empty name shouldn't match empty methods
+    for (std::size_t i = 1; i < actionMethodsNum; i++) {
+        if (name == table[i].name) {
+            return table[i].method;
+        }
+    }
+
+    return ActionMethod::Unknown;
+}
@@ -14,6 +14,10 @@
 #include "BaseSettingItem.h"
 #include "ISettingsCollection.h"
 #include "DynamicSettingsDatabase.h"
+#include "SettingUtils.h"
+#include "BatchDeadline.h"
+#include "SettingsStats.h"
+#include "Tracer.h"
 
 #include <memory>
 #include <atlbase.h>
@@ -39,7 +43,7 @@ using std::pair;
 
 BaseSettingItem::BaseSettingItem() {}
 
-BaseSettingItem::BaseSettingItem(wstring settingId, ATL::CComPtr<ISettingItem> BaseSettingItem) {
+BaseSettingItem::BaseSettingItem(SettingAtom settingId, ATL::CComPtr<ISettingItem> BaseSettingItem) {
     this->settingId = settingId;
     this->setting = BaseSettingItem;
 }
@@ -47,11 +51,29 @@ BaseSettingItem::BaseSettingItem(wstring settingId, ATL::CComPtr<ISettingItem> B
 BaseSettingItem::BaseSettingItem(const BaseSettingItem & other) {
     this->setting = other.setting;
     this->settingId = other.settingId;
+    this->elementId = other.elementId;
 }
 
 BaseSettingItem& BaseSettingItem::operator=(const BaseSettingItem& other) {
     this->setting = other.setting;
     this->settingId = other.settingId;
+    this->elementId = other.elementId;
+
+    return *this;
+}
+
+BaseSettingItem::BaseSettingItem(BaseSettingItem&& other) {
+    this->setting.Attach(other.setting.Detach());
+    this->settingId = other.settingId;
+    this->elementId = std::move(other.elementId);
+}
+
+BaseSettingItem& BaseSettingItem::operator=(BaseSettingItem&& other) {
+    if (this != &other) {
+        this->setting.Attach(other.setting.Detach());
+        this->settingId = other.settingId;
+        this->elementId = std::move(other.elementId);
+    }
 
     return *this;
 }
@@ -132,6 +154,9 @@ UINT BaseSettingItem::GetValue(wstring id, ATL::CComPtr<IInspectable>& item) {
     if (this->setting == NULL) { return ERROR_INVALID_HANDLE_STATE; };
     if (id.empty()) { return E_INVALIDARG; };
 
+    TraceScope trace { "GetValue", "valueID", id };
+    StatsScope stats { StatsPhase::Get, this->idView() };
+
     HRESULT res = ERROR_SUCCESS;
     BOOL isUpdating = false;
 
@@ -141,13 +166,34 @@ UINT BaseSettingItem::GetValue(wstring id, ATL::CComPtr<IInspectable>& item) {
     IInspectable* curValue = NULL;
     if (res == ERROR_SUCCESS) {
         // Access the simple value from the setting
-        res = this->setting->GetValue(hId, &curValue);
+        {
+            RecordScope record { "GetValue", this->idView(), id };
+            res = this->setting->GetValue(hId, &curValue);
+
+            record.setResult(res);
+            recordValue(record, this->setting, res == ERROR_SUCCESS ? curValue : NULL);
+        }
 
         if (res == ERROR_SUCCESS) {
+            TraceScope updatingTrace { "IsUpdating" };
             res = this->setting->get_IsUpdating(&isUpdating);
 
+            // Only bounded by the deadline of the batch, if there is one
+            const UINT maxPolls { boundPolls(UINT32_MAX, 10) };
+            UINT polls { 0 };
+
             while (isUpdating == TRUE && res == ERROR_SUCCESS) {
+                if (polls == maxPolls) {
+                    // The value read may not be the settled one
+                    SettingsStats::instance().increment(StatsCounter::Timeouts);
+                    curValue->Release();
+                    WindowsDeleteString(hId);
+
+                    return ERROR_TIMEOUT;
+                }
+
                 System::Threading::Thread::Sleep(10);
+                polls++;
                 res = this->setting->get_IsUpdating(&isUpdating);
 
                 if (res != ERROR_SUCCESS) {
@@ -159,19 +205,31 @@ UINT BaseSettingItem::GetValue(wstring id, ATL::CComPtr<IInspectable>& item) {
             res = WindowsCreateString(id.c_str(), static_cast<UINT32>(id.size()), &otherStr);
 
             curValue->Release();
+            curValue = NULL;
 
             // TODO: This second get is necessary for some settings, like
             // "Collection" settings. For this ones the second get guarantees
             // that the real value is the one received.
-            res = this->setting->GetValue(otherStr, &curValue);
+            {
+                RecordScope record { "GetValue", this->idView(), id };
+                res = this->setting->GetValue(otherStr, &curValue);
+
+                record.setResult(res);
+                recordValue(record, this->setting, res == ERROR_SUCCESS ? curValue : NULL);
+            }
+
             if (res == ERROR_SUCCESS) {
                 item.Attach(curValue);
-            } else {
+            } else if (curValue != NULL) {
                 curValue->Release();
             }
+
+            WindowsDeleteString(otherStr);
         }
     }
 
+    WindowsDeleteString(hId);
+
     return res;
 }
 
@@ -183,7 +241,12 @@ HRESULT BaseSettingItem::SetValue(const wstring& id, ATL::CComPtr<IPropertyValue
     res = WindowsCreateString(id.c_str(), static_cast<UINT32>(id.size()), &hId);
 
     if (res == ERROR_SUCCESS) {
+        StatsScope stats { StatsPhase::Set, this->idView() };
+        RecordScope record { "SetValue", this->idView(), id };
         res = this->setting->SetValue(hId, static_cast<IInspectable*>(item));
+
+        record.setResult(res);
+        recordValue(record, this->setting, static_cast<IInspectable*>(item));
     }
 
     WindowsDeleteString(hId);
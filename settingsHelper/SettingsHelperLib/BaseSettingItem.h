@@ -13,6 +13,7 @@
 #pragma once
 
 #include "ISettingItem.h"
+#include "SettingAtom.h"
 
 #include <atlbase.h>
 #include <windows.foundation.h>
@@ -39,7 +40,14 @@ public:
     /// <summary>
     ///  The id of the setting being hold.
     /// </summary>
-    wstring settingId {};
+    SettingAtom settingId {};
+    /// <summary>
+    ///  The id of the setting when it's an element of a collection, in which
+    ///  case 'settingId' is empty. Element ids come from the OS, like the ids
+    ///  of the installed apps, so they aren't interned, as the atom table is
+    ///  never freed.
+    /// </summary>
+    std::wstring elementId {};
     /// <summary>
     ///  Pointer to the inner setting.
     /// </summary>
@@ -53,7 +61,12 @@ public:
     ///  Constructs the BaseSettingItem using a pointer to IBaseSettingItem.
     /// </summary>
     /// <param name="setting"></param>
-    BaseSettingItem(wstring settingId, ATL::CComPtr<ISettingItem> BaseSettingItem);
+    BaseSettingItem(SettingAtom settingId, ATL::CComPtr<ISettingItem> BaseSettingItem);
+    /// <summary>
+    ///  The id of the setting being hold, whether it's interned or the id of
+    ///  a collection element.
+    /// </summary>
+    WStringView idView() const { return settingId.empty() ? WStringView { elementId } : settingId.view(); }
     /// <summary>
     ///  Copy constructor.
     /// </summary>
@@ -64,9 +77,14 @@ public:
     /// </summary>
     BaseSettingItem& operator=(const BaseSettingItem& other);
     /// <summary>
-    ///  Copy constructor.
+    ///  Move constructor, takes the inner setting without touching its reference count.
     /// </summary>
-    /// <param name="other">The setting item to be copied.</param>
+    /// <param name="other">The setting item to be moved.</param>
+    BaseSettingItem(BaseSettingItem&& other);
+    /// <summary>
+    ///  Move assignment operator.
+    /// </summary>
+    BaseSettingItem& operator=(BaseSettingItem&& other);
     /// <summary>
     ///  Destructor that frees the encapsulated IBaseSettingItem.
     /// </summary>
@@ -130,6 +148,8 @@ public:
     ///     - E_NOTIMPL: The setting doesn't have implemented the method; this can be
     ///       caused because the setting doesn't support this method, and doesn't contains
     ///       any value.
+    ///     - ERROR_TIMEOUT: The deadline of the batch expired while the setting was
+    ///       still updating.
     /// </returns>
     UINT GetValue(wstring id, ATL::CComPtr<IInspectable>& item);
     /// <summary>
@@ -0,0 +1,215 @@
+/**
+ * Monotonic arena used for the objects created while processing a batch.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+///  Monotonic memory arena. Memory is handed out from a list of blocks by
+///  bumping an offset and it's never released individually, instead, the
+///  whole arena is rewound with 'reset' once the batch that was using it has
+///  been processed. Blocks are kept between resets, so a process handling
+///  several batches only grows up to the size required by the biggest one.
+///
+///  NOTE: The arena doesn't run destructors, objects placed in it must be
+///  destroyed before calling 'reset'.
+/// </summary>
+class BatchArena {
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Block> blocks {};
+    std::size_t curBlock { 0 };
+    std::size_t offset { 0 };
+    std::size_t blockSize { 0 };
+    std::size_t allocCount { 0 };
+    std::size_t bytesUsed { 0 };
+
+    static ThreadLocalPtr<BatchArena>& currentArena() {
+        static ThreadLocalPtr<BatchArena> arena {};
+        return arena;
+    }
+
+    void* allocateFrom(Block& block, std::size_t bytes, std::size_t alignment) {
+        std::uintptr_t base { reinterpret_cast<std::uintptr_t>(block.data.get()) };
+        std::uintptr_t start { (base + offset + alignment - 1) & ~(alignment - 1) };
+
+        if (start + bytes > base + block.size) {
+            return nullptr;
+        }
+
+        offset = static_cast<std::size_t>(start + bytes - base);
+
+        return reinterpret_cast<void*>(start);
+    }
+
+public:
+    /// <summary>
+    ///  Constructs an empty arena, blocks are only allocated when required.
+    /// </summary>
+    /// <param name="blockSize">The default size for the arena blocks.</param>
+    explicit BatchArena(std::size_t blockSize = 16 * 1024) : blockSize(blockSize) {}
+
+    BatchArena(const BatchArena&) = delete;
+    BatchArena& operator=(const BatchArena&) = delete;
+
+    /// <summary>
+    ///  Allocates memory from the arena.
+    /// </summary>
+    /// <param name="bytes">The number of bytes to be allocated.</param>
+    /// <param name="alignment">The required alignment, it must be a power of two.</param>
+    /// <returns>A pointer to the allocated memory.</returns>
+    void* allocate(std::size_t bytes, std::size_t alignment) {
+        if (bytes == 0) { bytes = 1; }
+
+        allocCount++;
+        bytesUsed += bytes;
+
+        while (curBlock < blocks.size()) {
+            void* mem { allocateFrom(blocks[curBlock], bytes, alignment) };
+            if (mem != nullptr) { return mem; }
+
+            curBlock++;
+            offset = 0;
+        }
+
+        const std::size_t size { bytes + alignment > blockSize ? bytes + alignment : blockSize };
+        blocks.push_back(Block { std::unique_ptr<unsigned char[]> { new unsigned char[size] }, size });
+        curBlock = blocks.size() - 1;
+        offset = 0;
+
+        return allocateFrom(blocks.back(), bytes, alignment);
+    }
+
+    /// <summary>
+    ///  Rewinds the arena, all the memory previously handed out is considered
+    ///  free. The already allocated blocks are kept for later use.
+    /// </summary>
+    void reset() {
+        curBlock = 0;
+        offset = 0;
+        allocCount = 0;
+        bytesUsed = 0;
+    }
+
+    /// <summary>
+    ///  Number of allocations served since the last reset.
+    /// </summary>
+    std::size_t allocations() const { return allocCount; }
+    /// <summary>
+    ///  Number of bytes requested since the last reset.
+    /// </summary>
+    std::size_t used() const { return bytesUsed; }
+    /// <summary>
+    ///  Total size of the blocks owned by the arena.
+    /// </summary>
+    std::size_t capacity() const {
+        std::size_t total { 0 };
+        for (const auto& block : blocks) { total += block.size; }
+
+        return total;
+    }
+
+    /// <summary>
+    ///  Gets the arena installed for the current thread by a 'BatchScope'.
+    /// </summary>
+    /// <returns>The current arena, or nullptr if there is none.</returns>
+    static BatchArena* current() { return currentArena().get(); }
+
+    friend class BatchScope;
+};
+
+/// <summary>
+///  Installs an arena as the current one for the calling thread during the
+///  lifetime of the scope, restoring the previous one on destruction.
+/// </summary>
+class BatchScope {
+private:
+    BatchArena* prevArena { nullptr };
+
+public:
+    explicit BatchScope(BatchArena& arena) : prevArena(BatchArena::current()) {
+        BatchArena::currentArena().set(&arena);
+    }
+    ~BatchScope() { BatchArena::currentArena().set(prevArena); }
+
+    BatchScope(const BatchScope&) = delete;
+    BatchScope& operator=(const BatchScope&) = delete;
+};
+
+/// <summary>
+///  Allocator serving memory from the arena that was current for the thread
+///  when the allocator was constructed. When there is no current arena it
+///  falls back to the regular heap, so containers using it can be safely
+///  created outside a batch.
+/// </summary>
+template <typename T>
+class BatchAllocator {
+private:
+    BatchArena* _arena { nullptr };
+
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    BatchAllocator() : _arena(BatchArena::current()) {}
+    explicit BatchAllocator(BatchArena* arena) : _arena(arena) {}
+    template <typename U>
+    BatchAllocator(const BatchAllocator<U>& other) : _arena(other.arena()) {}
+
+    BatchArena* arena() const { return _arena; }
+
+    T* allocate(std::size_t n) {
+        if (_arena != nullptr) {
+            return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+        } else {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T* p, std::size_t) {
+        if (_arena == nullptr) {
+            ::operator delete(p);
+        }
+    }
+
+    /// <summary>
+    ///  Copies of containers are placed in the arena current at the time of
+    ///  the copy, not in the arena of the copied container.
+    /// </summary>
+    BatchAllocator select_on_container_copy_construction() const {
+        return BatchAllocator {};
+    }
+
+    template <typename U>
+    bool operator==(const BatchAllocator<U>& other) const { return _arena == other.arena(); }
+    template <typename U>
+    bool operator!=(const BatchAllocator<U>& other) const { return _arena != other.arena(); }
+};
+
+/// <summary>
+///  Type alias for a vector allocated in the current batch arena.
+/// </summary>
+template <typename T>
+using BatchVector = std::vector<T, BatchAllocator<T>>;
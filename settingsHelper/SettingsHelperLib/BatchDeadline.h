@@ -0,0 +1,109 @@
+/**
+ * Latency budget of the batch being processed, bounding its waits.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+
+#include <chrono>
+#include <cstdint>
+
+/// <summary>
+///  Point in time by which a batch should be answered. While a deadline is
+///  installed with a 'DeadlineScope', the waits done for the settings are cut
+///  short to the time left, and the actions not run yet once it expires are
+///  reported as timed out.
+/// </summary>
+class BatchDeadline {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point expiry;
+
+    static ThreadLocalPtr<BatchDeadline>& currentDeadline() {
+        static ThreadLocalPtr<BatchDeadline> deadline {};
+        return deadline;
+    }
+
+public:
+    /// <summary>
+    ///  Constructs a deadline expiring after the supplied budget.
+    /// </summary>
+    /// <param name="budgetMs">The time left for the batch, in milliseconds.</param>
+    explicit BatchDeadline(std::uint32_t budgetMs) :
+        expiry(Clock::now() + std::chrono::milliseconds { budgetMs }) {}
+
+    /// <summary>
+    ///  Checks if there is no time left.
+    /// </summary>
+    bool expired() const { return Clock::now() >= expiry; }
+    /// <summary>
+    ///  Time left before the deadline expires in milliseconds, 0 once expired.
+    /// </summary>
+    std::uint32_t remainingMs() const {
+        const Clock::time_point now { Clock::now() };
+        if (now >= expiry) { return 0; }
+
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(expiry - now).count();
+        return remaining > UINT32_MAX ? UINT32_MAX : static_cast<std::uint32_t>(remaining);
+    }
+
+    /// <summary>
+    ///  Gets the deadline of the batch being processed by the calling thread,
+    ///  nullptr if the batch has none.
+    /// </summary>
+    static BatchDeadline* current() { return currentDeadline().get(); }
+
+    friend class DeadlineScope;
+};
+
+/// <summary>
+///  Installs a deadline as the current one for the calling thread during the
+///  lifetime of the scope, restoring the previous one on destruction. Installing
+///  nullptr leaves the batch without deadline.
+/// </summary>
+class DeadlineScope {
+private:
+    BatchDeadline* prevDeadline { nullptr };
+
+public:
+    explicit DeadlineScope(BatchDeadline* pDeadline) : prevDeadline(BatchDeadline::current()) {
+        BatchDeadline::currentDeadline().set(pDeadline);
+    }
+    ~DeadlineScope() { BatchDeadline::currentDeadline().set(prevDeadline); }
+
+    DeadlineScope(const DeadlineScope&) = delete;
+    DeadlineScope& operator=(const DeadlineScope&) = delete;
+};
+
+/// <summary>
+///  Checks if the deadline of the current batch, if any, has expired.
+/// </summary>
+inline bool batchDeadlineExpired() {
+    const BatchDeadline* pDeadline { BatchDeadline::current() };
+    return pDeadline != nullptr && pDeadline->expired();
+}
+
+/// <summary>
+///  Bounds the number of polls of a wait to the ones fitting in the time left
+///  by the deadline of the current batch. Without a deadline the number of
+///  polls is left as is.
+/// </summary>
+/// <param name="polls">The number of polls the wait would do.</param>
+/// <param name="pollMs">The time slept between two polls, in milliseconds.</param>
+inline std::uint32_t boundPolls(std::uint32_t polls, std::uint32_t pollMs) {
+    const BatchDeadline* pDeadline { BatchDeadline::current() };
+    if (pDeadline == nullptr || pollMs == 0) { return polls; }
+
+    const std::uint32_t fittingPolls { pDeadline->remainingMs() / pollMs };
+    return fittingPolls < polls ? fittingPolls : polls;
+}
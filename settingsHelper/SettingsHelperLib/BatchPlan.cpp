@@ -0,0 +1,193 @@
+/**
+ * Coalescing of the actions of a batch.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "BatchPlan.h"
+#include "SettingPathTokenizer.h"
+
+#include <string>
+#include <unordered_map>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Actions over the values of a base setting whose results can still be
+    ///  used by the following ones, keyed by the value id.
+    /// </summary>
+    struct SettingState {
+        /// <summary>
+        ///  GetValue actions run since the setting was last set.
+        /// </summary>
+        std::unordered_map<wstring, std::size_t> gets {};
+        /// <summary>
+        ///  SetValue actions whose value is still the one of the setting.
+        /// </summary>
+        std::unordered_map<wstring, std::size_t> sets {};
+        /// <summary>
+        ///  SetValue actions nothing observed yet, which can be superseded.
+        /// </summary>
+        std::unordered_map<wstring, std::size_t> pendingSets {};
+        /// <summary>
+        ///  The library implementing the setting, empty if it isn't known.
+        /// </summary>
+        WStringView library {};
+    };
+
+    /// <summary>
+    ///  Drops what's known about the settings of the library of a setting being
+    ///  set, except for the setting itself.
+    /// </summary>
+    void forgetLibrary(std::unordered_map<wstring, SettingState>& states, const SettingState& setState) {
+        if (setState.library.empty()) { return; }
+
+        for (auto& entry : states) {
+            SettingState& state { entry.second };
+
+            if (&state != &setState && state.library == setState.library) {
+                state = SettingState { {}, {}, {}, state.library };
+            }
+        }
+    }
+
+    /// <summary>
+    ///  Drops the pending sets of a setting being observed, and of the other
+    ///  settings of its library, as the library may read them to answer.
+    /// </summary>
+    void observeLibrary(std::unordered_map<wstring, SettingState>& states, SettingState& observedState) {
+        observedState.pendingSets.clear();
+        if (observedState.library.empty()) { return; }
+
+        for (auto& entry : states) {
+            if (entry.second.library == observedState.library) {
+                entry.second.pendingSets.clear();
+            }
+        }
+    }
+}
+
+std::size_t planBatch(const vector<PlanAction>& actions, vector<PlannedAction>& rPlan) {
+    std::unordered_map<wstring, SettingState> states {};
+    std::size_t coalesced { 0 };
+
+    rPlan.assign(actions.size(), PlannedAction {});
+
+    for (std::size_t i = 0; i < actions.size(); i++) {
+        const PlanAction& action { actions[i] };
+
+        if (action.valid == false || action.method == ActionMethod::GetStats) {
+            continue;
+        }
+
+        if (actionMethodInfo(action.method).isBarrier) {
+            // Invoking a setting may change any other, and restoring a
+            // snapshot does, while taking one observes the pending values
+            states.clear();
+            continue;
+        }
+
+        SettingPathSegments<2> segments {};
+        if (tokenizeSettingPath(action.settingPath, segments) == false || segments.empty()) {
+            continue;
+        }
+
+        SettingState& state { states[segments[0].str()] };
+        if (action.library.empty() == false) {
+            state.library = action.library;
+        }
+
+        const wstring valueId { segments.size() == 2 ? segments[1].str() : wstring { L"Value" } };
+
+        const bool runsAsIs { action.selectsElements || action.projectsFields };
+
+        if (action.method == ActionMethod::GetValue && runsAsIs == false) {
+            const auto set = state.sets.find(valueId);
+            const auto get = state.gets.find(valueId);
+
+            if (set != state.sets.end()) {
+                rPlan[i] = PlannedAction { PlanStep::ReadSetValue, set->second };
+                coalesced++;
+            } else if (get != state.gets.end()) {
+                rPlan[i] = PlannedAction { PlanStep::ReuseResult, get->second };
+                coalesced++;
+            } else {
+                state.gets[valueId] = i;
+            }
+
+            observeLibrary(states, state);
+        } else if (action.method == ActionMethod::SetValue && runsAsIs == false) {
+            const auto pendingSet = state.pendingSets.find(valueId);
+
+            if (pendingSet != state.pendingSets.end()) {
+                rPlan[pendingSet->second] = PlannedAction { PlanStep::Superseded, i };
+                coalesced++;
+            }
+
+            // Setting a value may change the other values of the setting
+            state.gets.clear();
+            state.sets.clear();
+            state.sets[valueId] = i;
+            state.pendingSets[valueId] = i;
+            forgetLibrary(states, state);
+        } else {
+            // Metadata, projected and collection actions are always run, and they
+            // observe the setting, as setting its elements changes it
+            if (action.method == ActionMethod::SetValue) {
+                state.gets.clear();
+                state.sets.clear();
+                forgetLibrary(states, state);
+            }
+
+            observeLibrary(states, state);
+        }
+    }
+
+    return coalesced;
+}
+
+void groupByLibrary(const vector<PlanAction>& actions, const vector<wstring>& libraries, vector<std::size_t>& rOrder) {
+    rOrder.clear();
+    rOrder.reserve(actions.size());
+
+    std::size_t start { 0 };
+
+    while (start < actions.size()) {
+        std::size_t end { start };
+        while (end < actions.size() && actionMethodInfo(actions[end].method).isBarrier == false) {
+            end++;
+        }
+
+        // Actions of each library between two barriers, by first appearance
+        std::unordered_map<wstring, std::size_t> groupIndexes {};
+        vector<vector<std::size_t>> groups {};
+
+        for (std::size_t i = start; i < end; i++) {
+            const auto inserted = groupIndexes.emplace(libraries[i], groups.size());
+            if (inserted.second) {
+                groups.emplace_back();
+            }
+
+            groups[inserted.first->second].push_back(i);
+        }
+
+        for (const auto& group : groups) {
+            rOrder.insert(rOrder.end(), group.begin(), group.end());
+        }
+
+        if (end < actions.size()) {
+            rOrder.push_back(end);
+        }
+
+        start = end + 1;
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * Coalescing of the actions of a batch.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "ActionMethod.h"
+#include "WStringView.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  What the planner needs to know about each action of a batch.
+/// </summary>
+struct PlanAction {
+    /// <summary>
+    ///  The setting path targeted by the action, 'BaseSettingId' being the
+    ///  same as 'BaseSettingId.Value'.
+    /// </summary>
+    WStringView settingPath {};
+    ActionMethod method { ActionMethod::Unknown };
+    /// <summary>
+    ///  The action was parsed, invalid actions are run to report their error.
+    /// </summary>
+    bool valid { false };
+    /// <summary>
+    ///  The parameters select elements of a collection, such actions are
+    ///  always run.
+    /// </summary>
+    bool selectsElements { false };
+    /// <summary>
+    ///  The result holds metadata fields along with the value, such actions
+    ///  are always run.
+    /// </summary>
+    bool projectsFields { false };
+    /// <summary>
+    ///  The library implementing the setting, empty if it isn't known. Setting
+    ///  a value may change the other settings of the same library, so nothing
+    ///  known about them is used after it.
+    /// </summary>
+    WStringView library {};
+};
+
+/// <summary>
+///  How the result of an action is obtained.
+/// </summary>
+enum class PlanStep {
+    /// <summary>
+    ///  The action is run.
+    /// </summary>
+    Run,
+    /// <summary>
+    ///  A GetValue answered with the result of the same earlier GetValue.
+    /// </summary>
+    ReuseResult,
+    /// <summary>
+    ///  A GetValue answered with the value applied by an earlier SetValue over
+    ///  the same setting, it's run if that SetValue failed.
+    /// </summary>
+    ReadSetValue,
+    /// <summary>
+    ///  A SetValue replaced by a later SetValue over the same setting before
+    ///  anything observed it. It's answered with the result of the later one,
+    ///  which holds the value of the setting before both of them. If the later
+    ///  one fails, it's run right after it, before any other action.
+    /// </summary>
+    Superseded
+};
+
+/// <summary>
+///  The step planned for an action.
+/// </summary>
+struct PlannedAction {
+    PlanStep step { PlanStep::Run };
+    /// <summary>
+    ///  Index of the action whose result answers this one, for every step
+    ///  but 'Run'. It's earlier in the batch, except for 'Superseded'.
+    /// </summary>
+    std::size_t source { 0 };
+};
+
+/// <summary>
+///  Plans how to obtain the result of each action of a batch, running as few
+///  of them as possible while producing the same results:
+///     - Repeated GetValue actions over a setting reuse the first result, as
+///       long as the setting wasn't set in between.
+///     - A GetValue after a SetValue over the same setting is answered with the
+///       value that was set.
+///     - A SetValue followed by another one over the same setting isn't run if
+///       nothing read the setting, or another setting of its library, in between.
+///     - A SetValue drops what's known about the other settings of its library,
+///       as they may change along with it.
+///  Any 'Invoke' ends every coalescing, as the side effects of the actions
+///  are unknown, and so do the other barrier methods, like 'Restore'.
+/// </summary>
+/// <param name="actions">The actions of the batch, in order.</param>
+/// <param name="rPlan">Filled with the step planned for each action.</param>
+/// <returns>The number of actions that aren't run.</returns>
+std::size_t planBatch(const std::vector<PlanAction>& actions, std::vector<PlannedAction>& rPlan);
+/// <summary>
+///  Orders the actions of a batch so the ones over settings implemented by the
+///  same library run one after another, libraries being taken in the order
+///  they first appear. Actions keep their relative order within a library, so
+///  the ones over the same setting, and the steps planned by 'planBatch', stay
+///  valid. Any 'Invoke', or other barrier method, stays in place, the actions
+///  before and after it are grouped separately.
+/// </summary>
+/// <param name="actions">The actions of the batch, in order.</param>
+/// <param name="libraries">
+///  The library of the setting of each action, actions whose library isn't
+///  known having an empty one, which groups them together.
+/// </param>
+/// <param name="rOrder">Filled with the indexes of the actions in the order to run them.</param>
+void groupByLibrary(
+    const std::vector<PlanAction>& actions,
+    const std::vector<std::wstring>& libraries,
+    std::vector<std::size_t>& rOrder
+);
@@ -0,0 +1,101 @@
+/**
+ * Probing of the settings for the SettingsCatalog tool.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "CatalogProbe.h"
+
+#include <chrono>
+
+using std::string;
+using std::wstring;
+
+void probeSetting(SettingAPI& sAPI, const SettingAtom& settingId, CatalogEntry& rEntry) {
+    CatalogEntry entry {};
+    entry.settingId = settingId.str();
+
+    // Only the system settings come from a library
+    getSettingDLL(entry.settingId, entry.dll);
+
+    const auto start = std::chrono::steady_clock::now();
+    ISettingItem* setting { NULL };
+    HRESULT res { ERROR_SUCCESS };
+
+    try {
+        res = sAPI.getBackend().getSetting(settingId, &setting);
+
+        if (res == ERROR_SUCCESS && setting != NULL) {
+            ATL::CComPtr<ISettingItem> comSetting { NULL };
+            comSetting.Attach(setting);
+
+            BOOL isUpdating { true };
+            comSetting->get_IsUpdating(&isUpdating);
+
+            while (isUpdating && entry.updatePolls < SettingsCatalog::maxLoadWaitPolls) {
+                System::Threading::Thread::Sleep(10);
+                entry.updatePolls++;
+                comSetting->get_IsUpdating(&isUpdating);
+            }
+
+            entry.loadUs = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+            );
+
+            if (isUpdating) {
+                entry.status = CatalogStatus::TimedOut;
+            } else {
+                SettingItem settingItem { settingId, comSetting };
+                SettingType type { SettingType::Empty };
+                settingItem.GetSettingType(&type);
+                entry.settingType = static_cast<std::int32_t>(type);
+
+                const BOOL hasValue {
+                    type == SettingType::Boolean || type == SettingType::Range ||
+                    type == SettingType::String || type == SettingType::List
+                };
+
+                ATL::CComPtr<IInspectable> value { NULL };
+                if (hasValue && settingItem.GetValue(L"Value", value) == ERROR_SUCCESS && value != NULL) {
+                    ATL::CComPtr<IPropertyValue> propValue { NULL };
+                    PropertyType propType { PropertyType::PropertyType_Empty };
+
+                    if (value->QueryInterface(__uuidof(IPropertyValue), reinterpret_cast<void**>(&propValue)) == S_OK &&
+                        propValue->get_Type(&propType) == S_OK) {
+                        entry.valueType = static_cast<std::int32_t>(propType);
+                    }
+                }
+            }
+        } else {
+            entry.status = CatalogStatus::Failed;
+            entry.errorCode = static_cast<std::uint32_t>(res == ERROR_SUCCESS ? E_INVALIDARG : res);
+        }
+    } catch (...) {
+        entry.status = CatalogStatus::Crashed;
+    }
+
+    rEntry = std::move(entry);
+}
+
+void CatalogWorkerSession::loadPayload(const wstring& payload) {
+    settingIds = splitCatalogPayload(payload);
+}
+
+wstring CatalogWorkerSession::runAction(std::uint32_t index) {
+    if (index >= settingIds.size()) { return wstring {}; }
+
+    CatalogEntry entry {};
+    probeSetting(sAPI, SettingAtom { settingIds[index] }, entry);
+
+    string line {};
+    formatCatalogLine(entry, line);
+
+    return wstring { line.begin(), line.end() };
+}
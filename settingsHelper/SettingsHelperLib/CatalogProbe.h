@@ -0,0 +1,50 @@
+/**
+ * Probing of the settings for the SettingsCatalog tool.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "SettingUtils.h"
+#include "SettingsCatalog.h"
+#include "WorkerPool.h"
+
+#include <string>
+#include <vector>
+
+/// <summary>
+///  Loads a setting straight from the backend, bypassing the faulty lists,
+///  the quarantine and any catalog, and records what was seen while doing it.
+///  The setting is polled while updating up to 'maxLoadWaitPolls' times.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI.</param>
+/// <param name="settingId">The setting to be probed.</param>
+/// <param name="rEntry">The entry to be filled, its status holds the outcome.</param>
+void probeSetting(SettingAPI& sAPI, const SettingAtom& settingId, CatalogEntry& rEntry);
+
+/// <summary>
+///  What a SettingsCatalog worker process does with the settings sent by the
+///  supervisor, see 'buildCatalog'.
+/// </summary>
+class CatalogWorkerSession : public WorkerSession {
+private:
+    SettingAPI& sAPI;
+    std::vector<std::wstring> settingIds {};
+
+public:
+    explicit CatalogWorkerSession(SettingAPI& sAPI) : sAPI(sAPI) {}
+
+    void loadPayload(const std::wstring& payload) override;
+    /// <summary>
+    ///  Probes one of the settings of the payload.
+    /// </summary>
+    /// <returns>The catalog line of the setting, empty if the index is out of range.</returns>
+    std::wstring runAction(std::uint32_t index) override;
+};
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <map>
@@ -53,4 +54,61 @@ namespace constants {
     ///  proper operation and later unloading.
     /// </summary>
     const map<wstring, vector<wstring>>& CoupledLibs();
+    /// <summary>
+    ///  Environment variable holding the path in which to write the trace of
+    ///  the payload phases, the same as the '-trace' switch.
+    /// </summary>
+    const static wchar_t* const TRACE_ENV_VAR { L"SETTINGS_HELPER_TRACE" };
+    /// <summary>
+    ///  Environment variable holding the path in which to append the recording
+    ///  of the session, the same as the '-record' switch.
+    /// </summary>
+    const static wchar_t* const RECORD_ENV_VAR { L"SETTINGS_HELPER_RECORD" };
+    /// <summary>
+    ///  Environment variable holding the path in which to write the latency
+    ///  histograms and counters on shutdown, the same as the '-stats' switch.
+    /// </summary>
+    const static wchar_t* const STATS_ENV_VAR { L"SETTINGS_HELPER_STATS" };
+    /// <summary>
+    ///  Environment variable holding the path of the file persisting the
+    ///  quarantine of the settings failing to load, the same as the
+    ///  '-quarantine' switch.
+    /// </summary>
+    const static wchar_t* const QUARANTINE_ENV_VAR { L"SETTINGS_HELPER_QUARANTINE" };
+    /// <summary>
+    ///  Environment variable holding the number of worker processes in which
+    ///  the actions are run, the same as the '-workers' switch.
+    /// </summary>
+    const static wchar_t* const WORKERS_ENV_VAR { L"SETTINGS_HELPER_WORKERS" };
+    /// <summary>
+    ///  Environment variable holding the path of the catalog written by the
+    ///  SettingsCatalog tool, the same as the '-catalog' switch.
+    /// </summary>
+    const static wchar_t* const CATALOG_ENV_VAR { L"SETTINGS_HELPER_CATALOG" };
+    /// <summary>
+    ///  Maximum number of worker processes that can be requested.
+    /// </summary>
+    const static std::size_t MAX_WORKERS { 64 };
+    /// <summary>
+    ///  Environment variable holding the time in which a batch should be
+    ///  answered in milliseconds, the same as the '-deadline' switch.
+    /// </summary>
+    const static wchar_t* const DEADLINE_ENV_VAR { L"SETTINGS_HELPER_DEADLINE" };
+    /// <summary>
+    ///  Maximum deadline that can be requested for a batch, in milliseconds.
+    /// </summary>
+    const static unsigned long MAX_DEADLINE_MS { 10 * 60 * 1000 };
+    /// <summary>
+    ///  Environment variable holding the number of compiled plans kept by the
+    ///  engine of the Node addon, zero disabling the cache.
+    /// </summary>
+    const static wchar_t* const PLAN_CACHE_ENV_VAR { L"SETTINGS_HELPER_PLAN_CACHE" };
+    /// <summary>
+    ///  Number of compiled plans kept when it isn't set in the environment.
+    /// </summary>
+    const static std::size_t DEFAULT_PLAN_CACHE_SIZE { 16 };
+    /// <summary>
+    ///  Maximum number of compiled plans that can be kept.
+    /// </summary>
+    const static std::size_t MAX_PLAN_CACHE_SIZE { 256 };
 }
@@ -108,14 +108,38 @@ const vector<pair<wstring, vector<wstring>>> supportedDynamicSettings {
     }
 };
 
-DynamicSettingDatabase::DynamicSettingDatabase(wstring dbSettingsName, ATL::CComPtr<IDynamicSettingsDatabase> settingDatabase)
+vector<pair<SettingAtom, vector<SettingAtom>>> internSupportedDynamicSettings() {
+    vector<pair<SettingAtom, vector<SettingAtom>>> atoms {};
+
+    for (const auto& supportedDb : supportedDynamicSettings) {
+        vector<SettingAtom> dbSettingIds {};
+
+        for (const auto& dbSettingId : supportedDb.second) {
+            dbSettingIds.push_back(SettingAtom { dbSettingId });
+        }
+
+        atoms.push_back({ SettingAtom { supportedDb.first }, dbSettingIds });
+    }
+
+    return atoms;
+}
+
+/// <summary>
+///  Interned version of 'supportedDynamicSettings'.
+/// </summary>
+const vector<pair<SettingAtom, vector<SettingAtom>>>& supportedDynamicSettingAtoms() {
+    static const vector<pair<SettingAtom, vector<SettingAtom>>> atoms = internSupportedDynamicSettings();
+    return atoms;
+}
+
+DynamicSettingDatabase::DynamicSettingDatabase(SettingAtom dbSettingsName, ATL::CComPtr<IDynamicSettingsDatabase> settingDatabase)
     : _settingDatabase(settingDatabase), dbSettingsName(dbSettingsName) {}
 
 
-BOOL isSupportedDb(const wstring& settingId) {
+BOOL isSupportedDb(const SettingAtom& settingId) {
     BOOL result { false };
 
-    for (const auto& supportedDb : supportedDynamicSettings) {
+    for (const auto& supportedDb : supportedDynamicSettingAtoms()) {
         if (supportedDb.first == settingId) {
             result = true;
         }
@@ -124,10 +148,10 @@ BOOL isSupportedDb(const wstring& settingId) {
     return result;
 }
 
-HRESULT getSupportedDbSettings(const DynamicSettingDatabase& database, vector<wstring>& settingIds) {
+HRESULT getSupportedDbSettings(const DynamicSettingDatabase& database, vector<SettingAtom>& settingIds) {
     HRESULT result { ERROR_NOT_SUPPORTED };
 
-    for (const auto& elem : supportedDynamicSettings) {
+    for (const auto& elem : supportedDynamicSettingAtoms()) {
         if (elem.first == database.dbSettingsName) {
             settingIds = elem.second;
             result = ERROR_SUCCESS;
@@ -137,7 +161,7 @@ HRESULT getSupportedDbSettings(const DynamicSettingDatabase& database, vector<ws
     return result;
 }
 
-HRESULT loadSettingDatabase(const wstring& settingId, SettingItem& settingItem, DynamicSettingDatabase& _dynSettingDatabase) {
+HRESULT loadSettingDatabase(const SettingAtom& settingId, SettingItem& settingItem, DynamicSettingDatabase& _dynSettingDatabase) {
     HRESULT res { ERROR_SUCCESS };
     wstring propId { L"DynamicSettingsDatabaseValue" };
 
@@ -174,22 +198,23 @@ HRESULT loadSettingDatabase(const wstring& settingId, SettingItem& settingItem,
 
 HRESULT DynamicSettingDatabase::GetDatabaseSettings(vector<DbSettingItem>& dbSettings) const {
     HRESULT res { ERROR_SUCCESS };
-    vector<wstring> dbSettingsIds {};
+    vector<SettingAtom> dbSettingsIds {};
     vector<DbSettingItem> _dbSettings {};
 
     res = getSupportedDbSettings(*this, dbSettingsIds);
 
     if (res == ERROR_SUCCESS) {
+        _dbSettings.reserve(dbSettingsIds.size());
+
         for (const auto& settingId : dbSettingsIds) {
             ATL::CComPtr<ISettingItem> pSettingItem = NULL;
             HSTRING hSettingId = NULL;
 
-            WindowsCreateString(settingId.c_str(), static_cast<UINT32>(settingId.size()), &hSettingId);
+            WindowsCreateString(settingId.str().c_str(), static_cast<UINT32>(settingId.str().size()), &hSettingId);
             res = this->_settingDatabase->GetSetting(hSettingId, &pSettingItem);
 
             if (res == ERROR_SUCCESS) {
-                DbSettingItem setting { settingId, pSettingItem };
-                _dbSettings.push_back(setting);
+                _dbSettings.emplace_back(settingId, pSettingItem);
             }
 
             WindowsDeleteString(hSettingId);
@@ -197,7 +222,7 @@ HRESULT DynamicSettingDatabase::GetDatabaseSettings(vector<DbSettingItem>& dbSet
     }
 
     if (res == ERROR_SUCCESS) {
-        dbSettings = _dbSettings;
+        dbSettings = std::move(_dbSettings);
     }
 
     return res;
@@ -27,14 +27,14 @@ private:
     ATL::CComPtr<IDynamicSettingsDatabase> _settingDatabase;
 
 public:
-    wstring dbSettingsName {};
+    SettingAtom dbSettingsName {};
 
     DynamicSettingDatabase() {}
-    DynamicSettingDatabase(wstring dbSettingsName, ATL::CComPtr<IDynamicSettingsDatabase> settingDatabase);
+    DynamicSettingDatabase(SettingAtom dbSettingsName, ATL::CComPtr<IDynamicSettingsDatabase> settingDatabase);
 
     HRESULT GetDatabaseSettings(vector<DbSettingItem>& settings) const;
 };
 
-BOOL isSupportedDb(const wstring& settingId);
-HRESULT loadSettingDatabase(const wstring& settingId, SettingItem& settingItem, DynamicSettingDatabase& dynSettingDatabase);
-HRESULT getSupportedDbSettings(const DynamicSettingDatabase& database, vector<wstring>& settingIds);
+BOOL isSupportedDb(const SettingAtom& settingId);
+HRESULT loadSettingDatabase(const SettingAtom& settingId, SettingItem& settingItem, DynamicSettingDatabase& dynSettingDatabase);
+HRESULT getSupportedDbSettings(const DynamicSettingDatabase& database, vector<SettingAtom>& settingIds);
@@ -17,6 +17,9 @@
 
 #include <roapi.h>
 
+#include <cstring>
+#include <utility>
+
 #pragma comment (lib, "WindowsApp.lib")
 
 using std::wstring;
@@ -144,6 +147,32 @@ const map<PropertyType, PropParserPtr>& propParsers() {
     return propParsers;
 }
 
+HRESULT convertToPropertyType(const CComPtr<IPropertyValue>& value, PropertyType type, ATL::CComPtr<IPropertyValue>& rValue) {
+    if (value == NULL) { return E_INVALIDARG; }
+
+    PropertyType valueType { PropertyType::PropertyType_Empty };
+    HRESULT errCode { value->get_Type(&valueType) };
+    if (errCode != ERROR_SUCCESS) { return errCode; }
+
+    if (valueType == type) {
+        rValue = value;
+        return ERROR_SUCCESS;
+    }
+
+    auto parserKey = propParsers().find(type);
+    if (parserKey != propParsers().end()) {
+        errCode = parserKey->second(value, rValue);
+    } else if (type == PropertyType::PropertyType_Boolean || type == PropertyType::PropertyType_String) {
+        // Payload values are never converted into these types
+        errCode = E_INVALIDARG;
+    } else {
+        // Numbers are left as they are, IPropertyValue converts between them
+        rValue = value;
+    }
+
+    return errCode;
+}
+
 HRESULT createPropertyValue(const VARIANT& value, ATL::CComPtr<IPropertyValue>& rValue) {
     HRESULT res = { ERROR_SUCCESS };
     IPropertyValueStatics* propValueFactory = NULL;
@@ -424,3 +453,141 @@ HRESULT equals(ATL::CComPtr<IPropertyValue> fstProp, ATL::CComPtr<IPropertyValue
 
     return errCode;
 }
+
+HRESULT toSnapshotValue(const CComPtr<IPropertyValue>& value, SnapshotEntry& rEntry) {
+    if (value == NULL) { return E_INVALIDARG; }
+
+    PropertyType type { PropertyType::PropertyType_Empty };
+    HRESULT errCode { value->get_Type(&type) };
+    if (errCode != ERROR_SUCCESS) { return errCode; }
+
+    std::string bytes {};
+
+    if (type == PropertyType::PropertyType_Boolean) {
+        boolean boolValue { false };
+        errCode = value->GetBoolean(&boolValue);
+        bytes = encodeSnapshotNumber(boolValue ? 1 : 0, 1);
+    } else if (type == PropertyType::PropertyType_Double) {
+        DOUBLE doubleValue { 0 };
+        UINT64 bits { 0 };
+        errCode = value->GetDouble(&doubleValue);
+        std::memcpy(&bits, &doubleValue, sizeof(bits));
+        bytes = encodeSnapshotNumber(bits, sizeof(bits));
+    } else if (type == PropertyType::PropertyType_Int32) {
+        INT32 intValue { 0 };
+        errCode = value->GetInt32(&intValue);
+        bytes = encodeSnapshotNumber(static_cast<UINT32>(intValue), sizeof(intValue));
+    } else if (type == PropertyType::PropertyType_UInt32) {
+        UINT32 intValue { 0 };
+        errCode = value->GetUInt32(&intValue);
+        bytes = encodeSnapshotNumber(intValue, sizeof(intValue));
+    } else if (type == PropertyType::PropertyType_Int64) {
+        INT64 intValue { 0 };
+        errCode = value->GetInt64(&intValue);
+        bytes = encodeSnapshotNumber(static_cast<UINT64>(intValue), sizeof(intValue));
+    } else if (type == PropertyType::PropertyType_UInt64) {
+        UINT64 intValue { 0 };
+        errCode = value->GetUInt64(&intValue);
+        bytes = encodeSnapshotNumber(intValue, sizeof(intValue));
+    } else if (type == PropertyType::PropertyType_DateTime) {
+        DateTime dateTime {};
+        errCode = value->GetDateTime(&dateTime);
+        bytes = encodeSnapshotNumber(static_cast<UINT64>(dateTime.UniversalTime), sizeof(dateTime.UniversalTime));
+    } else if (type == PropertyType::PropertyType_TimeSpan) {
+        TimeSpan timeSpan {};
+        errCode = value->GetTimeSpan(&timeSpan);
+        bytes = encodeSnapshotNumber(static_cast<UINT64>(timeSpan.Duration), sizeof(timeSpan.Duration));
+    } else if (type == PropertyType::PropertyType_String) {
+        HSTRING strValue { NULL };
+        errCode = value->GetString(&strValue);
+
+        if (errCode == ERROR_SUCCESS) {
+            UINT32 bufSize { 0 };
+            PCWSTR bufWSTR { WindowsGetStringRawBuffer(strValue, &bufSize) };
+            bytes = encodeSnapshotString(WStringView { bufWSTR, bufSize });
+            WindowsDeleteString(strValue);
+        }
+    } else {
+        errCode = E_INVALIDARG;
+    }
+
+    if (errCode == ERROR_SUCCESS) {
+        rEntry.valueType = static_cast<std::int32_t>(type);
+        rEntry.value = std::move(bytes);
+    }
+
+    return errCode;
+}
+
+HRESULT fromSnapshotValue(const SnapshotEntry& entry, ATL::CComPtr<IPropertyValue>& rValue) {
+    ATL::CComPtr<IPropertyValueStatics> pValueFactory { NULL };
+    HSTRING rTimeClass { NULL };
+    HRESULT errCode {
+        WindowsCreateString(
+            RuntimeClass_Windows_Foundation_PropertyValue,
+            static_cast<UINT32>(wcslen(RuntimeClass_Windows_Foundation_PropertyValue)),
+            &rTimeClass
+        )
+    };
+
+    if (errCode == ERROR_SUCCESS) {
+        errCode = GetActivationFactory(rTimeClass, &pValueFactory);
+        WindowsDeleteString(rTimeClass);
+    }
+    if (errCode != ERROR_SUCCESS) { return errCode; }
+
+    const PropertyType type { static_cast<PropertyType>(entry.valueType) };
+    IInspectable* pValue { NULL };
+    UINT64 bits { 0 };
+
+    if (type == PropertyType::PropertyType_Boolean) {
+        if (decodeSnapshotNumber(entry.value, 1, bits) == false || bits > 1) { return E_INVALIDARG; }
+        errCode = pValueFactory->CreateBoolean(bits == 1, &pValue);
+    } else if (type == PropertyType::PropertyType_Double) {
+        DOUBLE doubleValue { 0 };
+        if (decodeSnapshotNumber(entry.value, sizeof(doubleValue), bits) == false) { return E_INVALIDARG; }
+        std::memcpy(&doubleValue, &bits, sizeof(doubleValue));
+        errCode = pValueFactory->CreateDouble(doubleValue, &pValue);
+    } else if (type == PropertyType::PropertyType_Int32) {
+        if (decodeSnapshotNumber(entry.value, sizeof(INT32), bits) == false) { return E_INVALIDARG; }
+        errCode = pValueFactory->CreateInt32(static_cast<INT32>(static_cast<UINT32>(bits)), &pValue);
+    } else if (type == PropertyType::PropertyType_UInt32) {
+        if (decodeSnapshotNumber(entry.value, sizeof(UINT32), bits) == false) { return E_INVALIDARG; }
+        errCode = pValueFactory->CreateUInt32(static_cast<UINT32>(bits), &pValue);
+    } else if (type == PropertyType::PropertyType_Int64) {
+        if (decodeSnapshotNumber(entry.value, sizeof(INT64), bits) == false) { return E_INVALIDARG; }
+        errCode = pValueFactory->CreateInt64(static_cast<INT64>(bits), &pValue);
+    } else if (type == PropertyType::PropertyType_UInt64) {
+        if (decodeSnapshotNumber(entry.value, sizeof(UINT64), bits) == false) { return E_INVALIDARG; }
+        errCode = pValueFactory->CreateUInt64(bits, &pValue);
+    } else if (type == PropertyType::PropertyType_DateTime) {
+        DateTime dateTime {};
+        if (decodeSnapshotNumber(entry.value, sizeof(dateTime.UniversalTime), bits) == false) { return E_INVALIDARG; }
+        dateTime.UniversalTime = static_cast<INT64>(bits);
+        errCode = pValueFactory->CreateDateTime(dateTime, &pValue);
+    } else if (type == PropertyType::PropertyType_TimeSpan) {
+        TimeSpan timeSpan {};
+        if (decodeSnapshotNumber(entry.value, sizeof(timeSpan.Duration), bits) == false) { return E_INVALIDARG; }
+        timeSpan.Duration = static_cast<INT64>(bits);
+        errCode = pValueFactory->CreateTimeSpan(timeSpan, &pValue);
+    } else if (type == PropertyType::PropertyType_String) {
+        wstring strValue {};
+        if (decodeSnapshotString(entry.value, strValue) == false) { return E_INVALIDARG; }
+
+        HSTRING hValue { NULL };
+        errCode = WindowsCreateString(strValue.c_str(), static_cast<UINT32>(strValue.size()), &hValue);
+
+        if (errCode == ERROR_SUCCESS) {
+            errCode = pValueFactory->CreateString(hValue, &pValue);
+            WindowsDeleteString(hValue);
+        }
+    } else {
+        errCode = E_INVALIDARG;
+    }
+
+    if (errCode == ERROR_SUCCESS) {
+        rValue.Attach(static_cast<IPropertyValue*>(pValue));
+    }
+
+    return errCode;
+}
@@ -18,6 +18,8 @@
 #include <string>
 #include <map>
 
+#include "SettingsSnapshot.h"
+
 using namespace ABI::Windows::Foundation;
 using std::wstring;
 using std::map;
@@ -83,3 +85,38 @@ HRESULT convertToTimeSpan(const CComPtr<IPropertyValue>& strProp, ATL::CComPtr<I
 /// <param name="rValue">A reference to be filled with the created DateTime IPropertyValue.</param>
 /// <returns> ERROR_SUCCESS in case of success or E_INVALIDARG in case of failure. </returns>
 HRESULT convertToDate(const CComPtr<IPropertyValue>& strProp, ATL::CComPtr<IPropertyValue>& rValue);
+/// <summary>
+///  Converts a IPropertyValue parsed from the payload into the supplied type,
+///  which is the one of the setting value it's going to be set into.
+/// </summary>
+/// <param name="value">The IPropertyValue to be converted.</param>
+/// <param name="type">The target type of the conversion.</param>
+/// <param name="rValue">
+///  A reference to be filled with the converted IPropertyValue, which is the
+///  same one if no conversion was needed.
+/// </param>
+/// <returns>
+///  ERROR_SUCCESS in case of success or E_INVALIDARG if the value can't be
+///  converted into the target type.
+/// </returns>
+HRESULT convertToPropertyType(const CComPtr<IPropertyValue>& value, PropertyType type, ATL::CComPtr<IPropertyValue>& rValue);
+/// <summary>
+///  Stores a IPropertyValue into the value and type of a snapshot entry.
+/// </summary>
+/// <param name="value">The IPropertyValue to be stored.</param>
+/// <param name="rEntry">The entry whose 'valueType' and 'value' are going to be filled.</param>
+/// <returns>
+///  ERROR_SUCCESS in case of success or E_INVALIDARG if the value is empty or
+///  of a type that can't be stored.
+/// </returns>
+HRESULT toSnapshotValue(const CComPtr<IPropertyValue>& value, SnapshotEntry& rEntry);
+/// <summary>
+///  Creates the IPropertyValue stored in a snapshot entry by 'toSnapshotValue'.
+/// </summary>
+/// <param name="entry">The entry holding the value.</param>
+/// <param name="rValue">A reference to be filled with the created IPropertyValue.</param>
+/// <returns>
+///  ERROR_SUCCESS in case of success or E_INVALIDARG if the entry doesn't hold
+///  a valid value of its type.
+/// </returns>
+HRESULT fromSnapshotValue(const SnapshotEntry& entry, ATL::CComPtr<IPropertyValue>& rValue);
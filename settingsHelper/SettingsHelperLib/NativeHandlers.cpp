@@ -0,0 +1,124 @@
+/**
+ * Settings served by native handlers instead of the system settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "NativeHandlers.h"
+#include "SettingsStats.h"
+#include "Tracer.h"
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  E_INVALIDARG, spelled out as this file doesn't depend on Windows.
+    /// </summary>
+    constexpr std::int32_t invalidArgError { static_cast<std::int32_t>(0x80070057) };
+}
+
+NativeHandlers::~NativeHandlers() {
+    unload();
+}
+
+NativeHandlers::Entry* NativeHandlers::findEntry(WStringView settingId, WStringView& rValueId) {
+    Entry* pFound { nullptr };
+
+    for (auto& entry : entries) {
+        const std::size_t nsSize { entry.ns.size() };
+        const bool matches {
+            settingId.size() >= nsSize && settingId.substr(0, nsSize) == entry.ns &&
+            (settingId.size() == nsSize || (settingId.size() > nsSize + 1 && settingId[nsSize] == L'.'))
+        };
+
+        if (matches && (pFound == nullptr || nsSize > pFound->ns.size())) {
+            pFound = &entry;
+        }
+    }
+
+    if (pFound != nullptr) {
+        const std::size_t nsSize { pFound->ns.size() };
+        rValueId = settingId.size() == nsSize ? WStringView { L"Value" } : settingId.substr(nsSize + 1);
+    }
+
+    return pFound;
+}
+
+bool NativeHandlers::add(const wstring& ns, std::unique_ptr<NativeHandler> handler) {
+    if (ns.empty() || ns.front() == L'.' || ns.back() == L'.' || handler == nullptr) {
+        return false;
+    }
+
+    for (const auto& entry : entries) {
+        if (entry.ns == ns) { return false; }
+    }
+
+    entries.push_back(Entry { ns, std::move(handler), false });
+
+    return true;
+}
+
+bool NativeHandlers::serves(WStringView settingId) {
+    WStringView valueId {};
+    return findEntry(settingId, valueId) != nullptr;
+}
+
+std::int32_t NativeHandlers::handle(
+    WStringView settingId,
+    ActionMethod method,
+    const wstring& value,
+    wstring& rVal,
+    wstring* pAppliedVal
+) {
+    NativeRequest request {};
+    Entry* pEntry { findEntry(settingId, request.valueId) };
+    if (pEntry == nullptr) { return invalidArgError; }
+
+    TraceScope trace { "handleNativeAction", "namespace", pEntry->ns };
+
+    if (pEntry->loaded == false) {
+        StatsScope stats { StatsPhase::Load, pEntry->ns };
+        const std::int32_t errCode { pEntry->handler->load() };
+
+        // Failing to load is reported, and retried by the next request
+        if (errCode != 0) { return errCode; }
+
+        pEntry->loaded = true;
+    }
+
+    request.settingId = settingId;
+    request.method = method;
+    request.value = value;
+
+    SettingsStats::instance().increment(StatsCounter::NativeActions);
+    StatsScope stats { actionMethodInfo(method).setsValues ? StatsPhase::Set : StatsPhase::Get, settingId };
+
+    return pEntry->handler->handle(request, rVal, pAppliedVal);
+}
+
+void NativeHandlers::unload() {
+    for (auto& entry : entries) {
+        if (entry.loaded) {
+            entry.handler->unload();
+            entry.loaded = false;
+        }
+    }
+}
+
+vector<wstring> NativeHandlers::namespaces() const {
+    vector<wstring> result {};
+
+    for (const auto& entry : entries) {
+        result.push_back(entry.ns);
+    }
+
+    return result;
+}
@@ -0,0 +1,152 @@
+/**
+ * Settings served by native handlers instead of the system settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "ActionMethod.h"
+#include "WStringView.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  An action over a setting served by a NativeHandler, independent from the
+///  Windows types so handlers can be tested anywhere.
+/// </summary>
+struct NativeRequest {
+    /// <summary>
+    ///  The whole setting id of the action, like 'Native.Volume.Muted'.
+    /// </summary>
+    WStringView settingId {};
+    /// <summary>
+    ///  The part of the setting id following the namespace of the handler,
+    ///  'Value' when the setting id is the namespace itself.
+    /// </summary>
+    WStringView valueId {};
+    /// <summary>
+    ///  The requested method.
+    /// </summary>
+    ActionMethod method { ActionMethod::Unknown };
+    /// <summary>
+    ///  The JSON serialization of the value supplied to 'SetValue', empty for
+    ///  the other methods.
+    /// </summary>
+    std::wstring value {};
+};
+
+/// <summary>
+///  Serves the settings of a namespace that aren't reachable through the
+///  system settings, like the audio volume. Every method is called from the
+///  thread running the actions, which has already joined a COM apartment.
+///
+///  Error codes are HRESULT values, zero meaning success.
+/// </summary>
+class NativeHandler {
+public:
+    virtual ~NativeHandler() {}
+
+    /// <summary>
+    ///  Acquires the resources kept between requests, called before the first
+    ///  request and again after 'unload'.
+    /// </summary>
+    virtual std::int32_t load() = 0;
+    /// <summary>
+    ///  Runs an action over a setting of the namespace.
+    /// </summary>
+    /// <param name="request">The action to be run.</param>
+    /// <param name="rVal">
+    ///  Filled with the JSON serialization of the value of the setting, which
+    ///  for 'SetValue' is the value it held before being set.
+    /// </param>
+    /// <param name="pAppliedVal">
+    ///  If not null, filled by 'SetValue' with the JSON serialization of the
+    ///  value left in the setting, or left empty if it isn't known.
+    /// </param>
+    virtual std::int32_t handle(const NativeRequest& request, std::wstring& rVal, std::wstring* pAppliedVal) = 0;
+    /// <summary>
+    ///  Releases the resources acquired by 'load', before the thread leaves
+    ///  its COM apartment.
+    /// </summary>
+    virtual void unload() = 0;
+};
+
+/// <summary>
+///  The native handlers known to the SettingAPI, keyed by the namespace of the
+///  setting ids they serve. A namespace matches a setting id equal to it, or
+///  followed by '.' and a value id, and the longest matching namespace wins.
+///
+///  Handlers are added before the actions are run, the registry isn't
+///  synchronized. They are loaded on their first request and stay loaded
+///  until 'unload' is called.
+/// </summary>
+class NativeHandlers {
+private:
+    struct Entry {
+        std::wstring ns {};
+        std::unique_ptr<NativeHandler> handler {};
+        bool loaded { false };
+    };
+
+    std::vector<Entry> entries {};
+
+    Entry* findEntry(WStringView settingId, WStringView& rValueId);
+
+public:
+    NativeHandlers() = default;
+    NativeHandlers(const NativeHandlers&) = delete;
+    NativeHandlers& operator=(const NativeHandlers&) = delete;
+    ~NativeHandlers();
+
+    /// <summary>
+    ///  Adds the handler of a namespace.
+    /// </summary>
+    /// <returns>
+    ///  False if the namespace is empty, starts or ends with '.', or already
+    ///  has a handler.
+    /// </returns>
+    bool add(const std::wstring& ns, std::unique_ptr<NativeHandler> handler);
+    /// <summary>
+    ///  Checks if a setting id is served by one of the handlers.
+    /// </summary>
+    bool serves(WStringView settingId);
+    /// <summary>
+    ///  Runs an action with the handler of its setting id, loading it first
+    ///  if needed. The time spent is recorded in the stats of the setting, and
+    ///  the call is traced.
+    /// </summary>
+    /// <param name="settingId">The setting id of the action.</param>
+    /// <param name="method">The requested method.</param>
+    /// <param name="value">The serialized value supplied to 'SetValue'.</param>
+    /// <param name="rVal">Filled with the serialized value, see 'NativeHandler::handle'.</param>
+    /// <param name="pAppliedVal">See 'NativeHandler::handle'.</param>
+    /// <returns>
+    ///  The error of the handler, or of loading it, E_INVALIDARG if the setting
+    ///  id isn't served by any handler.
+    /// </returns>
+    std::int32_t handle(
+        WStringView settingId,
+        ActionMethod method,
+        const std::wstring& value,
+        std::wstring& rVal,
+        std::wstring* pAppliedVal = nullptr
+    );
+    /// <summary>
+    ///  Unloads the loaded handlers, the next request loads them again.
+    /// </summary>
+    void unload();
+    /// <summary>
+    ///  Gets the namespaces with a handler, in the order they were added.
+    /// </summary>
+    std::vector<std::wstring> namespaces() const;
+};
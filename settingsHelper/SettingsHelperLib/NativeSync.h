@@ -0,0 +1,229 @@
+/**
+ * Synchronization primitives usable from code compiled with /clr.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+// <mutex> and <thread> can't be included in code compiled with /clr, and
+// thread_local isn't supported there either, so in Windows the primitives are
+// implemented over the Win32 API. Other platforms use the standard library.
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#endif
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#ifdef _WIN32
+
+/// <summary>
+///  Non recursive mutex, wrapper over a SRWLOCK.
+/// </summary>
+class NativeMutex {
+private:
+    SRWLOCK srwLock = SRWLOCK_INIT;
+
+public:
+    NativeMutex() {}
+    NativeMutex(const NativeMutex&) = delete;
+    NativeMutex& operator=(const NativeMutex&) = delete;
+
+    void lock() { AcquireSRWLockExclusive(&srwLock); }
+    void unlock() { ReleaseSRWLockExclusive(&srwLock); }
+
+    PSRWLOCK native() { return &srwLock; }
+};
+
+/// <summary>
+///  Condition variable waited with a locked NativeMutex, wrapper over a
+///  CONDITION_VARIABLE.
+/// </summary>
+class NativeConditionVariable {
+private:
+    CONDITION_VARIABLE condVar = CONDITION_VARIABLE_INIT;
+
+public:
+    NativeConditionVariable() {}
+    NativeConditionVariable(const NativeConditionVariable&) = delete;
+    NativeConditionVariable& operator=(const NativeConditionVariable&) = delete;
+
+    /// <summary>
+    ///  Releases the mutex, which must be locked by the calling thread, until
+    ///  the variable is notified. Wakes can be spurious.
+    /// </summary>
+    void wait(NativeMutex& mutex) { SleepConditionVariableSRW(&condVar, mutex.native(), INFINITE, 0); }
+    void notifyOne() { WakeConditionVariable(&condVar); }
+    void notifyAll() { WakeAllConditionVariable(&condVar); }
+};
+
+/// <summary>
+///  Thread running the supplied function, wrapper over CreateThread.
+/// </summary>
+class NativeThread {
+private:
+    HANDLE handle { NULL };
+
+    static DWORD WINAPI threadMain(LPVOID pBody) {
+        std::unique_ptr<std::function<void()>> body { static_cast<std::function<void()>*>(pBody) };
+        (*body)();
+
+        return 0;
+    }
+
+public:
+    explicit NativeThread(std::function<void()> body) {
+        auto pBody = new std::function<void()> { std::move(body) };
+        handle = CreateThread(NULL, 0, threadMain, pBody, 0, NULL);
+
+        if (handle == NULL) { delete pBody; }
+    }
+    ~NativeThread() { join(); }
+    NativeThread(const NativeThread&) = delete;
+    NativeThread& operator=(const NativeThread&) = delete;
+
+    /// <summary>
+    ///  The thread couldn't be created, so the function won't run.
+    /// </summary>
+    bool failed() const { return handle == NULL; }
+
+    /// <summary>
+    ///  Waits for the function to return.
+    /// </summary>
+    void join() {
+        if (handle != NULL) {
+            WaitForSingleObject(handle, INFINITE);
+            CloseHandle(handle);
+            handle = NULL;
+        }
+    }
+};
+
+/// <summary>
+///  Per-thread pointer, wrapper over a TLS slot. Each thread sees nullptr
+///  until it sets its own value.
+/// </summary>
+template <typename T>
+class ThreadLocalPtr {
+private:
+    DWORD index { TlsAlloc() };
+
+public:
+    ThreadLocalPtr() {}
+    ~ThreadLocalPtr() { if (index != TLS_OUT_OF_INDEXES) { TlsFree(index); } }
+    ThreadLocalPtr(const ThreadLocalPtr&) = delete;
+    ThreadLocalPtr& operator=(const ThreadLocalPtr&) = delete;
+
+    T* get() const { return static_cast<T*>(TlsGetValue(index)); }
+    void set(T* value) { TlsSetValue(index, value); }
+};
+
+#else
+
+using NativeMutex = std::mutex;
+
+/// <summary>
+///  Condition variable waited with a locked NativeMutex.
+/// </summary>
+class NativeConditionVariable {
+private:
+    std::condition_variable_any condVar {};
+
+public:
+    NativeConditionVariable() {}
+    NativeConditionVariable(const NativeConditionVariable&) = delete;
+    NativeConditionVariable& operator=(const NativeConditionVariable&) = delete;
+
+    void wait(NativeMutex& mutex) { condVar.wait(mutex); }
+    void notifyOne() { condVar.notify_one(); }
+    void notifyAll() { condVar.notify_all(); }
+};
+
+/// <summary>
+///  Thread running the supplied function.
+/// </summary>
+class NativeThread {
+private:
+    std::thread thread {};
+    bool creationFailed { false };
+
+public:
+    explicit NativeThread(std::function<void()> body) {
+        try {
+            thread = std::thread { std::move(body) };
+        } catch (const std::system_error&) {
+            creationFailed = true;
+        }
+    }
+    ~NativeThread() { join(); }
+    NativeThread(const NativeThread&) = delete;
+    NativeThread& operator=(const NativeThread&) = delete;
+
+    bool failed() const { return creationFailed; }
+
+    void join() {
+        if (thread.joinable()) { thread.join(); }
+    }
+};
+
+/// <summary>
+///  Per-thread pointer. Instances for the same 'T' share the slot, a single
+///  instance per type is expected.
+/// </summary>
+template <typename T>
+class ThreadLocalPtr {
+private:
+    static T*& slot() {
+        static thread_local T* value { nullptr };
+        return value;
+    }
+
+public:
+    ThreadLocalPtr() {}
+    ThreadLocalPtr(const ThreadLocalPtr&) = delete;
+    ThreadLocalPtr& operator=(const ThreadLocalPtr&) = delete;
+
+    T* get() const { return slot(); }
+    void set(T* value) { slot() = value; }
+};
+
+#endif
+
+/// <summary>
+///  Locks a NativeMutex for the lifetime of the guard.
+/// </summary>
+class NativeLockGuard {
+private:
+    NativeMutex& mutex;
+
+public:
+    explicit NativeLockGuard(NativeMutex& mutex) : mutex(mutex) { mutex.lock(); }
+    ~NativeLockGuard() { mutex.unlock(); }
+
+    NativeLockGuard(const NativeLockGuard&) = delete;
+    NativeLockGuard& operator=(const NativeLockGuard&) = delete;
+};
+
+/// <summary>
+///  Gets an identifier for the calling thread.
+/// </summary>
+inline std::uint32_t currentThreadId() {
+#ifdef _WIN32
+    return static_cast<std::uint32_t>(GetCurrentThreadId());
+#else
+    return static_cast<std::uint32_t>(std::hash<std::thread::id> {}(std::this_thread::get_id()));
+#endif
+}
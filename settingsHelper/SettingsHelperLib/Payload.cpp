@@ -13,6 +13,9 @@
 #include "stdafx.h"
 #include "Payload.h"
 #include "IPropertyValueUtils.h"
+#include "SettingPathTokenizer.h"
+#include "SettingsCatalog.h"
+#include "SettingIdIndex.h"
 
 #include <windows.foundation.h>
 #include <windows.foundation.collections.h>
@@ -39,15 +42,18 @@ using std::pair;
 Parameter::Parameter() {}
 
 Parameter::Parameter(pair<wstring, ATL::CComPtr<IPropertyValue>> _objIdVal) :
-    oIdVal(_objIdVal), isObject(true), isEmpty(false) {}
+    oIdVal(std::move(_objIdVal)), isObject(true), isEmpty(false) {}
 
 Parameter::Parameter(ATL::CComPtr<IPropertyValue> _iPropVal) :
-    iPropVal(_iPropVal), isObject(false), isEmpty(false) {}
+    iPropVal(std::move(_iPropVal)), isObject(false), isEmpty(false) {}
 
 // -----------------------------------------------------------------------------
 //                               Action
 // -----------------------------------------------------------------------------
 
+Action::Action(wstring settingID, ActionMethod method, ParameterList params) :
+    settingID(std::move(settingID)), method(method), params(std::move(params)) {}
+
 /// <summary>
 ///  Check that the members with which an action is going to be constructed are
 ///  valid.
@@ -58,19 +64,22 @@ Parameter::Parameter(ATL::CComPtr<IPropertyValue> _iPropVal) :
 ///  ERROR_SUCCESS in case of success or E_INVALIDARG in case of invalid
 ///  action members.
 /// </returns>
-HRESULT checkActionMembers(wstring method, vector<Parameter> params) {
-    if (method != L"GetValue" && method != L"SetValue") {
+HRESULT checkActionMembers(ActionMethod method, const ParameterList& params) {
+    if (method == ActionMethod::Unknown) {
         return E_INVALIDARG;
     }
 
     HRESULT errCode { ERROR_SUCCESS };
+    const bool listsSettings { actionMethodInfo(method).listsSettings };
 
-    if (params.size() > 1) {
+    // Setting ids are listed as plain values, several values otherwise need
+    // to be elements of a collection
+    if (params.size() > 1 || listsSettings) {
         for (const auto& param : params) {
             bool validParam =
                 param.isEmpty == false &&
-                param.isObject == true &&
-                param.oIdVal.first.empty() == false;
+                param.isObject != listsSettings &&
+                (listsSettings || param.oIdVal.first.empty() == false);
 
             if (validParam == false) {
                 errCode = E_INVALIDARG;
@@ -94,16 +103,76 @@ HRESULT checkActionMembers(wstring method, vector<Parameter> params) {
 ///  ERROR_SUCCESS in case of success or E_INVALIDARG in case of parameters
 ///  not passing format checking.
 /// </returns>
-HRESULT createAction(wstring sId, wstring sMethod, vector<Parameter> params, Action& rAction) {
+HRESULT createAction(wstring sId, ActionMethod sMethod, ParameterList params, Action& rAction) {
     HRESULT errCode { checkActionMembers(sMethod, params) };
 
     if (errCode == ERROR_SUCCESS) {
-        rAction = Action { sId, sMethod, params };
+        rAction = Action { std::move(sId), sMethod, std::move(params) };
     }
 
     return errCode;
 }
 
+/// <summary>
+///  Converts the values of an action setting the value of a cataloged setting
+///  into the type of that value, so they are set without further conversion.
+///  Values of inner settings, and of elements of collections, aren't
+///  cataloged and are left as they are.
+/// </summary>
+/// <param name="catalog">The catalog holding the type of the setting values.</param>
+/// <param name="rAction">The action whose parameters are going to be converted.</param>
+/// <returns>
+///  ERROR_SUCCESS in case of success or E_INVALIDARG if one of the values
+///  can't be converted into the type of the setting value.
+/// </returns>
+HRESULT resolveParameterTypes(const SettingsCatalog& catalog, Action& rAction) {
+    SettingPathSegments<2> segments {};
+    if (tokenizeSettingPath(WStringView { rAction.settingID }, segments) == false || segments.empty()) {
+        return ERROR_SUCCESS;
+    }
+    if (segments.size() == 2 && segments[1] != L"Value") { return ERROR_SUCCESS; }
+
+    const CatalogEntry* pEntry { catalog.find(segments[0]) };
+    if (pEntry == nullptr || pEntry->status != CatalogStatus::Ok || pEntry->valueType < 0) {
+        return ERROR_SUCCESS;
+    }
+
+    const PropertyType valueType { static_cast<PropertyType>(pEntry->valueType) };
+    HRESULT errCode { ERROR_SUCCESS };
+
+    for (auto& param : rAction.params) {
+        if (param.isObject) { continue; }
+
+        ATL::CComPtr<IPropertyValue> convValue { NULL };
+        errCode = convertToPropertyType(param.iPropVal, valueType, convValue);
+
+        if (errCode != ERROR_SUCCESS) { break; }
+        param.iPropVal = convValue;
+    }
+
+    return errCode;
+}
+
+// -----------------------------------------------------------------------------
+//                               Result
+// -----------------------------------------------------------------------------
+
+Result::Result(wstring settingID, BOOL isError, wstring errorMessage, wstring returnValue) :
+    settingID(std::move(settingID)), isError(isError),
+    errorMessage(std::move(errorMessage)), returnValue(std::move(returnValue)) {}
+
+// -----------------------------------------------------------------------------
+//                               Batch
+// -----------------------------------------------------------------------------
+
+void Batch::reset() {
+    // Objects placed in the arena need to be destroyed before rewinding it,
+    // 'clear' keeps the capacity of the vectors for the next batch.
+    actions.clear();
+    results.clear();
+    arena.reset();
+}
+
 // -----------------------------------------------------------------------------
 //                  Parsing & Serialization Functions
 // -----------------------------------------------------------------------------
@@ -280,21 +349,21 @@ cleanup:
     return res;
 }
 
-HRESULT parseParameters(OpType type, const ATL::CComPtr<IJsonArray> arrayObj, vector<Parameter>& params) {
+HRESULT parseParameters(OpType type, const ATL::CComPtr<IJsonArray> arrayObj, ParameterList& params) {
     if (arrayObj == NULL) { return E_INVALIDARG; };
 
     HRESULT res = ERROR_SUCCESS;
 
     HRESULT nextElemErr = ERROR_SUCCESS;
     UINT32 jElemIndex = 0;
-    vector<Parameter> _params {};
+    ParameterList _params {};
 
     while (nextElemErr == ERROR_SUCCESS) {
         Parameter curParam {};
         nextElemErr = getMatchingType(type, arrayObj, jElemIndex, curParam);
 
         if (curParam.isEmpty == false && nextElemErr == ERROR_SUCCESS) {
-            _params.push_back(curParam);
+            _params.push_back(std::move(curParam));
         } else if (nextElemErr != E_BOUNDS) {
             res = nextElemErr;
         }
@@ -303,17 +372,63 @@ HRESULT parseParameters(OpType type, const ATL::CComPtr<IJsonArray> arrayObj, ve
     }
 
     if (res == ERROR_SUCCESS) {
-        params = _params;
+        params = std::move(_params);
+    }
+
+    return res;
+}
+
+/// <summary>
+///  Parses the names of the metadata fields requested along with the value.
+/// </summary>
+/// <param name="arrayObj">The JSON array holding the names of the fields.</param>
+/// <param name="rFields">The set of fields to be filled.</param>
+/// <returns>
+///  ERROR_SUCCESS or E_INVALIDARG if an element isn't the name of a field.
+/// </returns>
+HRESULT parseFields(const ATL::CComPtr<IJsonArray> arrayObj, std::uint32_t& rFields) {
+    if (arrayObj == NULL) { return E_INVALIDARG; };
+
+    ATL::CComPtr<IVector<IJsonValue*>> jVectorValue;
+    UINT32 fieldsNum = 0;
+    std::uint32_t fields { 0 };
+
+    HRESULT res = arrayObj->QueryInterface(
+        __uuidof(__FIVector_1_Windows__CData__CJson__CIJsonValue_t), reinterpret_cast<void**>(&jVectorValue)
+    );
+    if (res == ERROR_SUCCESS) { res = jVectorValue->get_Size(&fieldsNum); }
+
+    for (UINT32 i = 0; i < fieldsNum && res == ERROR_SUCCESS; i++) {
+        HSTRING hField = NULL;
+
+        // Elements that aren't strings fail to be read as one
+        if (arrayObj->GetStringAt(i, &hField) != ERROR_SUCCESS) {
+            res = E_INVALIDARG;
+        } else {
+            UINT32 fieldLength = 0;
+            PCWSTR pField = WindowsGetStringRawBuffer(hField, &fieldLength);
+
+            if (parseSettingField(WStringView { pField, fieldLength }, fields) == false) {
+                res = E_INVALIDARG;
+            }
+
+            WindowsDeleteString(hField);
+        }
+    }
+
+    if (res == ERROR_SUCCESS) {
+        rFields = fields;
     }
 
     return res;
 }
 
-HRESULT parseAction(const ATL::CComPtr<IJsonObject> elemObj, Action& action) {
+HRESULT parseAction(const ATL::CComPtr<IJsonObject> elemObj, const SettingsCatalog* pCatalog, Action& action) {
     if (elemObj == NULL) { return E_INVALIDARG; }
 
     HRESULT errCode = ERROR_SUCCESS;
     UINT32 bufLength = 0;
+    UINT32 methodLength = 0;
 
     // Required fields vars
     // ========================================================================
@@ -330,8 +445,9 @@ HRESULT parseAction(const ATL::CComPtr<IJsonObject> elemObj, Action& action) {
     HSTRING hMethodVal = NULL;
 
     wstring sSettingId {};
-    wstring sMethod {};
-    vector<Parameter> params {};
+    ActionMethod sMethod { ActionMethod::Unknown };
+    const ActionMethodInfo* pMethodInfo { nullptr };
+    ParameterList params {};
 
     // Optional fields vars
     // ========================================================================
@@ -341,6 +457,10 @@ HRESULT parseAction(const ATL::CComPtr<IJsonObject> elemObj, Action& action) {
     PCWSTR pParams = L"parameters";
     ATL::CComPtr<IJsonArray> jParamsArray = NULL;
 
+    HSTRING hFields = NULL;
+    PCWSTR pFields = L"fields";
+    ATL::CComPtr<IJsonArray> jFieldsArray = NULL;
+
     // Extract required fields
     // ========================================================================
 
@@ -356,16 +476,25 @@ HRESULT parseAction(const ATL::CComPtr<IJsonObject> elemObj, Action& action) {
     if (errCode != ERROR_SUCCESS) goto cleanup;
 
     pSettingRawBuf = WindowsGetStringRawBuffer(hSettingIdVal, &bufLength);
-    pMethodRawBuf = WindowsGetStringRawBuffer(hMethodVal, &bufLength);
+    pMethodRawBuf = WindowsGetStringRawBuffer(hMethodVal, &methodLength);
 
     if (pSettingRawBuf != NULL && pMethodRawBuf != NULL) {
-        sSettingId = wstring(pSettingRawBuf);
-        sMethod = wstring(pMethodRawBuf);
+        sSettingId = wstring { pSettingRawBuf, bufLength };
+        // The method name is only compared here, the rest of the pipeline uses the enum
+        sMethod = parseActionMethod(WStringView { pMethodRawBuf, methodLength });
     } else {
         errCode = E_INVALIDARG;
         goto cleanup;
     }
 
+    if (sMethod == ActionMethod::Unknown) {
+        // TODO: Change with a more meaningful message
+        errCode = E_INVALIDARG;
+        goto cleanup;
+    }
+
+    pMethodInfo = &actionMethodInfo(sMethod);
+
     // Extract optional fields
     // ========================================================================
 
@@ -374,40 +503,41 @@ HRESULT parseAction(const ATL::CComPtr<IJsonObject> elemObj, Action& action) {
 
     getArrayErr = elemObj->GetNamedArray(hParams, &jParamsArray);
 
-    // Check that the payload ins't of type "SetValue" if "parameters" isn't present.
+    // Check that the method doesn't require "parameters" if they aren't present.
     if (getArrayErr != ERROR_SUCCESS) {
-        if (sMethod == L"SetValue") {
+        if (pMethodInfo->requiresParams) {
             errCode = WEB_E_JSON_VALUE_NOT_FOUND;
             goto cleanup;
-        } else if (sMethod == L"GetValue") {
-            action = Action { sSettingId, sMethod, params };
         } else {
-            // TODO: Change with a more meaningful message
-            errCode = E_INVALIDARG;
+            action = Action { std::move(sSettingId), sMethod, std::move(params) };
         }
     } else {
-        if (sMethod == L"SetValue") {
-            errCode = parseParameters(OpType::Set, jParamsArray, params);
+        const OpType paramsOp { pMethodInfo->setsValues ? OpType::Set : OpType::Get };
+        errCode = parseParameters(paramsOp, jParamsArray, params);
 
-            if (errCode == ERROR_SUCCESS) {
-                Action _action {};
-                errCode = createAction(sSettingId, sMethod, params, _action);
+        if (errCode == ERROR_SUCCESS) {
+            errCode = createAction(std::move(sSettingId), sMethod, std::move(params), action);
+        }
 
-                if (errCode == ERROR_SUCCESS) {
-                   action = _action;
-                }
-            }
-        } else {
-            errCode = parseParameters(OpType::Get, jParamsArray, params);
+        // Malformed values are rejected here, before the setting is loaded
+        if (errCode == ERROR_SUCCESS && pCatalog != nullptr && pMethodInfo->setsValues) {
+            errCode = resolveParameterTypes(*pCatalog, action);
+        }
+    }
 
-            if (errCode == ERROR_SUCCESS) {
-                Action _action {};
-                errCode = createAction(sSettingId, sMethod, params, _action);
+    // Metadata fields reported along with the result
+    if (errCode == ERROR_SUCCESS) {
+        errCode = WindowsCreateString(pFields, static_cast<UINT32>(wcslen(pFields)), &hFields);
 
-                if (errCode == ERROR_SUCCESS) {
-                    action = _action;
-                }
-            }
+        if (errCode == ERROR_SUCCESS && elemObj->GetNamedArray(hFields, &jFieldsArray) == ERROR_SUCCESS) {
+            errCode = pMethodInfo->projectsFields ? parseFields(jFieldsArray, action.fields) : E_INVALIDARG;
+        }
+    }
+
+    // Selectors are only read, and their settings can't be given parameters
+    if (errCode == ERROR_SUCCESS && isSettingSelector(sSettingId.view())) {
+        if (pMethodInfo->acceptsSelectors == false || action.params.empty() == false) {
+            errCode = E_INVALIDARG;
         }
     }
 
@@ -417,13 +547,13 @@ cleanup:
     if (hSettingIdVal != NULL) { WindowsDeleteString(hSettingIdVal); }
     if (hMethodVal != NULL ) { WindowsDeleteString(hMethodVal); }
     if (hParams != NULL) { WindowsDeleteString(hParams); }
+    if (hFields != NULL) { WindowsDeleteString(hFields); }
 
     return errCode;
 }
 
-HRESULT parsePayload(const wstring & payload, vector<pair<Action, HRESULT>>& actions) {
+HRESULT parsePayload(const wstring & payload, vector<pair<Action, HRESULT>>& actions, const SettingsCatalog* pCatalog) {
     HRESULT res = ERROR_SUCCESS;
-    vector<pair<Action, HRESULT>> _actions {};
 
     ATL::CComPtr<IJsonArrayStatics> jsonArrayFactory = NULL;
     HSTRING rJSONClass = NULL;
@@ -445,6 +575,10 @@ HRESULT parsePayload(const wstring & payload, vector<pair<Action, HRESULT>>& act
     res = jsonArrayFactory->Parse(hPayload, &jActionsArray);
     if (res != ERROR_SUCCESS) goto cleanup;
 
+    // Actions are placed directly in the supplied vector, so the capacity
+    // reserved by previous batches is reused.
+    actions.clear();
+
     while (nextElemErr == ERROR_SUCCESS) {
         IJsonObject* curElem = NULL;
         nextElemErr = jActionsArray->GetObjectAt(jElemIndex, &curElem);
@@ -452,19 +586,19 @@ HRESULT parsePayload(const wstring & payload, vector<pair<Action, HRESULT>>& act
         if (curElem != NULL && nextElemErr == ERROR_SUCCESS) {
             Action curAction {};
             ATL::CComPtr<IJsonObject> cCurElem { curElem };
-            HRESULT errCode = parseAction(cCurElem, curAction);
+            HRESULT errCode = parseAction(cCurElem, pCatalog, curAction);
 
             if (errCode == ERROR_SUCCESS) {
-                _actions.push_back({ curAction, ERROR_SUCCESS });
+                actions.emplace_back(std::move(curAction), ERROR_SUCCESS);
             } else {
-                _actions.push_back({ Action {}, errCode });
+                actions.emplace_back(Action {}, errCode);
             }
         };
 
         jElemIndex++;
     }
 
-    for (const auto& action : _actions) {
+    for (const auto& action : actions) {
         if (action.second != ERROR_SUCCESS) {
             res = E_INVALIDARG;
 
@@ -472,8 +606,6 @@ HRESULT parsePayload(const wstring & payload, vector<pair<Action, HRESULT>>& act
         }
     }
 
-    actions = _actions;
-
 cleanup:
     if (rJSONClass) {
         WindowsDeleteString(rJSONClass);
@@ -500,7 +632,7 @@ HRESULT serializeResult(const Result& result, std::wstring& str) {
         if (result.settingID.empty()) {
             resultStr.append(L"null");
         } else {
-            resultStr.append(L"\"" + result.settingID + L"\"");
+            resultStr.append(L"\"").append(result.settingID).append(L"\"");
         }
         resultStr.append(L", ");
 
@@ -518,7 +650,7 @@ HRESULT serializeResult(const Result& result, std::wstring& str) {
         if (result.errorMessage.empty()) {
             resultStr.append(L"null");
         } else {
-            resultStr.append(L"\"" + result.errorMessage + L"\"");
+            resultStr.append(L"\"").append(result.errorMessage).append(L"\"");
         }
         resultStr.append(L", ");
 
@@ -534,7 +666,7 @@ HRESULT serializeResult(const Result& result, std::wstring& str) {
         resultStr.append(L"}");
 
         // Communicate back the result
-        str = resultStr;
+        str = std::move(resultStr);
     } catch(std::bad_alloc&) {
         res = E_OUTOFMEMORY;
     }
@@ -14,10 +14,14 @@
 
 #include "stdafx.h"
 #include "SettingItem.h"
+#include "BatchArena.h"
+#include "ActionMethod.h"
+#include "SettingFields.h"
 
 #include <windows.foundation.h>
 #include <atlbase.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <utility>
@@ -28,6 +32,8 @@ using std::pair;
 
 using namespace ABI::Windows::Foundation;
 
+class SettingsCatalog;
+
 /// <summary>
 ///  Structure holding the values required to perform a particular action over
 ///  a setting. Parameters can represent either a JSON object, which holds a pair
@@ -72,22 +78,46 @@ struct Parameter {
     Parameter(ATL::CComPtr<IPropertyValue> _iPropVal);
 };
 
+/// <summary>
+///  Type alias for the parameters of an action, they are placed in the arena
+///  of the batch being processed.
+/// </summary>
+using ParameterList = BatchVector<Parameter>;
+
 /// <summary>
 ///  Action that is going to be performed over a setting.
+///
+///  Actions are move-only, they are owned by the batch they belong to and
+///  should be passed by reference through the processing pipeline.
 /// </summary>
 struct Action {
     /// <summary>
-    /// The setting id in which the action needs to be performed.
+    /// The setting id in which the action needs to be performed, as found in
+    /// the payload. Payload ids are only looked up in the atom table, so
+    /// unknown ids don't grow it.
     /// </summary>
     wstring settingID;
     /// <summary>
-    /// The setting method to be called.
+    /// The setting method to be called, parsed from the payload method name.
     /// </summary>
-    wstring method;
+    ActionMethod method { ActionMethod::Unknown };
     /// <summary>
     /// The parameters to be passed to the method that is going to be called.
     /// </summary>
-    vector<Parameter> params;
+    ParameterList params;
+    /// <summary>
+    /// The set of SettingFields reported along with the value, empty if the
+    /// action result is only the value.
+    /// </summary>
+    std::uint32_t fields { 0 };
+
+    Action() = default;
+    Action(wstring settingID, ActionMethod method, ParameterList params);
+
+    Action(Action&&) = default;
+    Action& operator=(Action&&) = default;
+    Action(const Action&) = delete;
+    Action& operator=(const Action&) = delete;
 };
 
 /// <summary>
@@ -101,7 +131,7 @@ struct Result {
     /// <summary>
     ///  Flag identifying if the operation was a success or not.
     /// </summary>
-    BOOL isError;
+    BOOL isError { false };
     /// <summary>
     ///  Human readable message describing the problem encountered
     ///  during the operation. Empty in case of success.
@@ -111,6 +141,42 @@ struct Result {
     ///  The value that is returned as a result of the operation.
     /// </summary>
     wstring returnValue;
+
+    Result() = default;
+    Result(wstring settingID, BOOL isError, wstring errorMessage, wstring returnValue);
+
+    Result(Result&&) = default;
+    Result& operator=(Result&&) = default;
+    Result(const Result&) = delete;
+    Result& operator=(const Result&) = delete;
+};
+
+/// <summary>
+///  Holds the actions and results of a batch, along with the arena in which
+///  the objects created while processing it are placed.
+///
+///  A Batch is meant to be reused, calling 'reset' releases the contents of
+///  the batch but keeps the memory already reserved for the next one.
+/// </summary>
+struct Batch {
+    /// <summary>
+    ///  Arena for the objects created during the batch processing, it should be
+    ///  installed using a 'BatchScope' while the batch is being processed.
+    /// </summary>
+    BatchArena arena {};
+    /// <summary>
+    ///  The actions parsed from the batch payload.
+    /// </summary>
+    vector<pair<Action, HRESULT>> actions {};
+    /// <summary>
+    ///  The results for the actions, in the same order.
+    /// </summary>
+    vector<Result> results {};
+
+    /// <summary>
+    ///  Destroys the actions and results of the batch and rewinds its arena.
+    /// </summary>
+    void reset();
 };
 
 /// <summary>
@@ -118,13 +184,24 @@ struct Result {
 /// </summary>
 /// <param name="payload">The payload to be parsed.</param>
 /// <param name="actions">The sequence of actions to be filled with the payload.</param>
+/// <param name="pCatalog">
+///  Optional catalog of the settings, values set into cataloged settings are
+///  converted into the type of the setting value while parsing.
+/// </param>
 /// <returns>
 ///   An HRESULT error if the operation failed or ERROR_SUCCESS. Possible errors:
 ///     - WEB_E_INVALID_JSON_STRING: If the JSON from the payload is invalid.
 ///     - WEB_E_JSON_VALUE_NOT_FOUND: If one of the required JSON fields isn't present in the payload.
 ///     - E_OUTOFMEMORY: If the system runs out of memory and WindowsCreateString fails.
+///     - E_INVALIDARG: If one of the actions is invalid, including values that
+///       can't be converted into the type of the cataloged setting, and setting
+///       selectors given parameters or used by methods that don't accept them.
 /// </returns>
-HRESULT parsePayload(const wstring & payload, vector<pair<Action, HRESULT>>& actions);
+HRESULT parsePayload(
+    const wstring & payload,
+    vector<pair<Action, HRESULT>>& actions,
+    const SettingsCatalog* pCatalog = nullptr
+);
 /// <summary>
 /// Serialize the result of the operation to communicate it back to the caller.
 /// </summary>
@@ -12,81 +12,319 @@
 
 #include "stdafx.h"
 #include "PayloadProc.h"
-
-HRESULT handleSettingAction(
-    const wstring&  valueId,
-    const Action&   action,
-    SettingItem&    setting,
-    wstring&        rVal
-) {
-    HRESULT errCode { ERROR_SUCCESS };
-
+#include "BatchDeadline.h"
+#include "BatchPlan.h"
+#include "Constants.h"
+#include "SessionRecorder.h"
+#include "SettingFields.h"
+#include "SettingIdIndex.h"
+#include "SettingPathTokenizer.h"
+#include "SettingsCatalog.h"
+#include "SettingsQuarantine.h"
+#include "SettingsSnapshot.h"
+#include "SettingsStats.h"
+#include "Tracer.h"
+#include "WorkerProcess.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <ctime>
+#include <memory>
+#include <numeric>
+
+/// <summary>
+///  Gets the current value of the setting that matches the supplied value id.
+/// </summary>
+HRESULT getPropertyValue(const wstring& valueId, SettingItem& setting, ATL::CComPtr<IPropertyValue>& rValue) {
     // Inner settings values should be accessed just after loading the database
     // otherwise, last loaded setting is the one being accessed.
     ATL::CComPtr<IInspectable> iValue { NULL };
-    errCode = setting.GetValue(valueId, iValue);
+    HRESULT errCode { setting.GetValue(valueId, iValue) };
 
     if (errCode == ERROR_SUCCESS) {
-        ATL::CComPtr<IPropertyValue> propValue {
-            static_cast<IPropertyValue*>(iValue.Detach())
-        };
-        wstring resValueStr {};
+        rValue.Attach(static_cast<IPropertyValue*>(iValue.Detach()));
+    }
 
-        if (action.method == L"SetValue") {
-            BOOL equalProps { false };
-            ATL::CComPtr<IPropertyValue> paramValue { NULL };
+    return errCode;
+}
 
-            for (const auto& param : action.params) {
-                if (param.isObject == true) {
-                    if (param.oIdVal.first == setting.settingId) {
-                        paramValue = param.oIdVal.second;
-                    }
-                } else {
-                    paramValue = param.iPropVal;
+HRESULT handleUnknownMethod(const wstring&, const Action&, SettingItem&, wstring&, wstring*) {
+    return E_INVALIDARG;
+}
+
+HRESULT handleSetValue(
+    const wstring& valueId,
+    const Action& action,
+    SettingItem& setting,
+    wstring& rVal,
+    wstring* pAppliedVal
+) {
+    ATL::CComPtr<IPropertyValue> propValue { NULL };
+    HRESULT errCode { getPropertyValue(valueId, setting, propValue) };
+
+    if (errCode == ERROR_SUCCESS) {
+        wstring resValueStr {};
+        BOOL equalProps { false };
+        ATL::CComPtr<IPropertyValue> paramValue { NULL };
+
+        for (const auto& param : action.params) {
+            if (param.isObject == true) {
+                if (param.oIdVal.first == setting.idView()) {
+                    paramValue = param.oIdVal.second;
                 }
+            } else {
+                paramValue = param.iPropVal;
             }
+        }
 
-            // Check if a conversion is needed for IPropertyValue param
-            ATL::CComPtr<IPropertyValue> convParamValue { NULL };
-            PropertyType propType { PropertyType::PropertyType_Empty };
-            propValue->get_Type(&propType);
+        // Check if a conversion is needed for IPropertyValue param, values of
+        // cataloged settings were already converted while parsing the payload
+        ATL::CComPtr<IPropertyValue> convParamValue { NULL };
+        PropertyType propType { PropertyType::PropertyType_Empty };
+        PropertyType paramType { PropertyType::PropertyType_Empty };
+        propValue->get_Type(&propType);
+        if (paramValue != NULL) { paramValue->get_Type(&paramType); }
+
+        auto parserKey = propParsers().end();
+        if (paramType != propType) {
+            parserKey = propParsers().find(propType);
+        }
 
-            auto parserKey = propParsers().find(propType);
-            if (parserKey != propParsers().end()) {
-                errCode = parserKey->second(paramValue, convParamValue);
-            } else {
-                convParamValue = paramValue;
+        if (parserKey != propParsers().end()) {
+            errCode = parserKey->second(paramValue, convParamValue);
+        } else {
+            convParamValue = paramValue;
+        }
+
+        if (errCode == ERROR_SUCCESS) {
+            errCode = equals(propValue, convParamValue, equalProps);
+
+            if (errCode == ERROR_SUCCESS) {
+                if (!equalProps) {
+                    errCode = setting.SetValue(valueId, convParamValue);
+                }
             }
 
             if (errCode == ERROR_SUCCESS) {
-                errCode = equals(propValue, convParamValue, equalProps);
+                errCode = toString(propValue, resValueStr);
 
                 if (errCode == ERROR_SUCCESS) {
-                    if (!equalProps) {
-                        errCode = setting.SetValue(valueId, convParamValue);
-                    }
+                    rVal = resValueStr;
                 }
+            }
 
-                if (errCode == ERROR_SUCCESS) {
-                    errCode = toString(propValue, resValueStr);
+            // The setting may clamp or normalize the value, it's read back as the applied value
+            if (errCode == ERROR_SUCCESS && pAppliedVal != nullptr) {
+                ATL::CComPtr<IPropertyValue> appliedValue { NULL };
 
-                    if (errCode == ERROR_SUCCESS) {
-                        rVal = resValueStr;
-                    }
+                if (getPropertyValue(valueId, setting, appliedValue) != ERROR_SUCCESS ||
+                    toString(appliedValue, *pAppliedVal) != ERROR_SUCCESS) {
+                    pAppliedVal->clear();
                 }
             }
+        }
+    }
+
+    return errCode;
+}
+
+/// <summary>
+///  Name used for each SettingType in the metadata of the settings.
+/// </summary>
+const wchar_t* settingTypeName(SettingType type) {
+    switch (type) {
+        case SettingType::Custom: return L"Custom";
+        case SettingType::DisplayString: return L"DisplayString";
+        case SettingType::LabeledString: return L"LabeledString";
+        case SettingType::Boolean: return L"Boolean";
+        case SettingType::Range: return L"Range";
+        case SettingType::String: return L"String";
+        case SettingType::List: return L"List";
+        case SettingType::Action: return L"Action";
+        case SettingType::SettingCollection: return L"SettingCollection";
+        default: return L"Empty";
+    }
+}
+
+void appendJsonString(const wstring& str, wstring& rStr) {
+    static const wchar_t hexDigits[] { L"0123456789abcdef" };
+
+    rStr.append(L"\"");
+
+    for (const auto c : str) {
+        switch (c) {
+            case L'"': rStr.append(L"\\\""); break;
+            case L'\\': rStr.append(L"\\\\"); break;
+            case L'\b': rStr.append(L"\\b"); break;
+            case L'\f': rStr.append(L"\\f"); break;
+            case L'\n': rStr.append(L"\\n"); break;
+            case L'\r': rStr.append(L"\\r"); break;
+            case L'\t': rStr.append(L"\\t"); break;
+            default:
+                if (static_cast<std::uint32_t>(c) < 0x20) {
+                    rStr.append(L"\\u00");
+                    rStr.push_back(hexDigits[c >> 4]);
+                    rStr.push_back(hexDigits[c & 0xF]);
+                } else {
+                    rStr.push_back(c);
+                }
+        }
+    }
+
+    rStr.append(L"\"");
+}
+
+/// <summary>
+///  Appends the requested metadata fields of a setting to 'rMembers', as the
+///  comma separated members of a JSON object.
+/// </summary>
+/// <param name="setting">The loaded setting.</param>
+/// <param name="fields">The set of SettingFields to be appended.</param>
+/// <param name="rMembers">The members the fields are appended to.</param>
+/// <returns>ERROR_SUCCESS or the error reported while reading a field.</returns>
+HRESULT appendSettingFields(SettingItem& setting, std::uint32_t fields, wstring& rMembers) {
+    HRESULT errCode { ERROR_SUCCESS };
+    const SettingFieldInfo* table { settingFieldsTable() };
+
+    for (std::size_t i = 0; i < settingFieldsNum && errCode == ERROR_SUCCESS; i++) {
+        const SettingField field { table[i].field };
+        if (hasSettingField(fields, field) == false) { continue; }
+
+        wstring value {};
+
+        if (field == SettingField::Type) {
+            SettingType type { SettingType::Empty };
+            errCode = setting.GetSettingType(&type);
+            value.append(L"\"").append(settingTypeName(type)).append(L"\"");
+        } else if (field == SettingField::Description) {
+            // The description isn't provided by every setting
+            wstring description {};
+            setting.GetDescription(description);
+            appendJsonString(description, value);
         } else {
-            errCode = toString(propValue, resValueStr);
+            BOOL flag { false };
 
-            if (errCode == ERROR_SUCCESS) {
-                rVal = resValueStr;
+            if (field == SettingField::IsEnabled) {
+                errCode = setting.GetIsEnabled(&flag);
+            } else if (field == SettingField::IsApplicable) {
+                errCode = setting.GetIsApplicable(&flag);
+            } else {
+                errCode = setting.GetIsSetByGroupPolicy(&flag);
             }
+
+            value = flag ? L"true" : L"false";
+        }
+
+        if (errCode == ERROR_SUCCESS) {
+            if (rMembers.empty() == false) { rMembers.append(L", "); }
+            rMembers.append(L"\"").append(table[i].name).append(L"\": ").append(value);
+        }
+    }
+
+    return errCode;
+}
+
+HRESULT handleGetValue(const wstring& valueId, const Action& action, SettingItem& setting, wstring& rVal, wstring*) {
+    // Metadata is only available for the setting itself, not for its inner settings
+    if (action.fields != 0 && valueId != L"Value") { return E_INVALIDARG; }
+
+    ATL::CComPtr<IPropertyValue> propValue { NULL };
+    HRESULT errCode { getPropertyValue(valueId, setting, propValue) };
+
+    if (errCode == ERROR_SUCCESS) {
+        wstring resValueStr {};
+        errCode = toString(propValue, resValueStr);
+
+        // The requested metadata is read from the same loaded setting
+        if (errCode == ERROR_SUCCESS && action.fields != 0) {
+            wstring members { L"\"value\": " + resValueStr };
+            errCode = appendSettingFields(setting, action.fields, members);
+            resValueStr = L"{ " + members + L" }";
+        }
+
+        if (errCode == ERROR_SUCCESS) {
+            rVal = resValueStr;
+        }
+    }
+
+    return errCode;
+}
+
+HRESULT handleGetMetadata(const wstring& valueId, const Action&, SettingItem& setting, wstring& rVal, wstring*) {
+    // Metadata is only available for the setting itself, not for its inner settings
+    if (valueId != L"Value") { return E_INVALIDARG; }
+
+    wstring members {};
+    HRESULT errCode { appendSettingFields(setting, allSettingFields, members) };
+
+    if (errCode == ERROR_SUCCESS) {
+        rVal = L"{ " + members + L" }";
+    }
+
+    return errCode;
+}
+
+HRESULT handleInvoke(const wstring& valueId, const Action&, SettingItem& setting, wstring&, wstring*) {
+    // Only the setting itself can be invoked, not its inner settings
+    if (valueId != L"Value") { return E_INVALIDARG; }
+
+    SettingType type { SettingType::Empty };
+    HRESULT errCode { setting.GetSettingType(&type) };
+
+    if (errCode == ERROR_SUCCESS) {
+        if (type == SettingType::Action) {
+            // The action doesn't produce any value, so the result 'returnValue' is null
+            errCode = setting.Invoke();
+        } else {
+            errCode = E_INVALIDARG;
         }
     }
 
     return errCode;
 }
 
+/// <summary>
+///  Type of the functions handling an ActionMethod over a setting.
+/// </summary>
+using SettingActionHandler = HRESULT(*)(const wstring&, const Action&, SettingItem&, wstring&, wstring*);
+
+/// <summary>
+///  Handlers for the ActionMethods, indexed by the method value. Adding a new
+///  method only requires adding its entry here and in 'actionMethodsTable'.
+/// </summary>
+const SettingActionHandler settingActionHandlers[] {
+    handleUnknownMethod,
+    handleGetValue,
+    handleSetValue,
+    handleGetMetadata,
+    handleInvoke,
+    // 'GetStats', 'Snapshot' and 'Restore' don't target the action setting,
+    // they're served by 'handleAction'
+    handleUnknownMethod,
+    handleUnknownMethod,
+    handleUnknownMethod
+};
+
+static_assert(
+    sizeof(settingActionHandlers) / sizeof(SettingActionHandler) == actionMethodsNum,
+    "Every ActionMethod requires a handler"
+);
+
+HRESULT handleSettingAction(
+    const wstring&  valueId,
+    const Action&   action,
+    SettingItem&    setting,
+    wstring&        rVal,
+    wstring*        pAppliedVal
+) {
+    const std::size_t methodIndex { static_cast<std::size_t>(action.method) };
+    if (methodIndex >= actionMethodsNum) { return E_INVALIDARG; }
+
+    TraceScope trace { "handleSettingAction", "method", actionMethodsTable()[methodIndex].name };
+
+    return settingActionHandlers[methodIndex](valueId, action, setting, rVal, pAppliedVal);
+}
+
 wstring serializeReturnValues(vector<pair<wstring, wstring>> settingsValues) {
     wstring valueResult {};
 
@@ -119,6 +357,8 @@ HRESULT handleCollectionAction(
     SettingItem&    setting,
     Result&         rResult
 ) {
+    TraceScope trace { "handleCollectionAction" };
+
     SettingType type { SettingType::Empty };
     setting.GetSettingType(&type);
 
@@ -146,7 +386,7 @@ HRESULT handleCollectionAction(
                 errCode = handleSettingAction(valueId, action, setting, rStrVal);
 
                 if (errCode == ERROR_SUCCESS) {
-                    settingsValues.push_back({ setting.settingId, rStrVal });
+                    settingsValues.push_back({ setting.elementId, rStrVal });
                 } else {
                     std::wostringstream errCodeStr {};
                     errCodeStr << std::hex << errCode;
@@ -155,7 +395,7 @@ HRESULT handleCollectionAction(
                         action.settingID,
                         true,
                         L"Action over collection setting '" +
-                        setting.settingId +
+                        setting.elementId +
                         L"' failed with error code '0x" + errCodeStr.str(),
                         L""
                     };
@@ -177,68 +417,89 @@ HRESULT handleCollectionAction(
 
 HRESULT getSettingPath(const Action& action, SettingPath& rPath) {
     HRESULT errCode { ERROR_SUCCESS };
+    SettingPathSegments<2> settingIds {};
 
-    vector<wstring> settingIds {};
-    errCode = splitSettingPath(action.settingID, settingIds);
-
-    const auto& idsSize = settingIds.size();
-    if (idsSize == 1) {
-        rPath = { settingIds.front(), L"Value" };
-    } else if (idsSize == 2) {
-        rPath = { settingIds.front(), settingIds[1] };
-    } else {
+    if (tokenizeSettingPath(WStringView { action.settingID }, settingIds) == false) {
         errCode = E_INVALIDARG;
+    } else if (settingIds.size() == 1) {
+        rPath = { settingIds[0], WStringView { L"Value" } };
+    } else {
+        rPath = { settingIds[0], settingIds[1] };
     }
 
     return errCode;
 }
 
-HRESULT handleAction(SettingAPI& sAPI, Action action, Result& rResult) {
-    HRESULT errCode { ERROR_SUCCESS };
-    wstring errMsg {};
+HRESULT handleGetStats(const Action& action, Result& rResult) {
+    // The serialized stats are plain ASCII, so they can be widened as they are
+    const std::string stats { SettingsStats::instance().toJson(WStringView { action.settingID }) };
+    rResult = Result { action.settingID, false, L"", wstring { stats.begin(), stats.end() } };
 
-    SettingPath settingPath {};
-    errCode = getSettingPath(action, settingPath);
+    return ERROR_SUCCESS;
+}
 
-    if (errCode == ERROR_SUCCESS) {
-        SettingItem baseSetting {};
-        errCode = sAPI.loadBaseSetting(settingPath.first, baseSetting);
+HRESULT validateCatalogedAction(SettingAPI& sAPI, const Action& action, const SettingPath& path) {
+    const SettingsCatalog* pCatalog { sAPI.getCatalog() };
+    if (pCatalog == nullptr) { return ERROR_SUCCESS; }
 
-        if (errCode == ERROR_SUCCESS) {
-            SettingType baseType { SettingType::Empty };
-            baseSetting.GetSettingType(&baseType);
+    const CatalogEntry* pEntry { pCatalog->find(path.first) };
+    if (pEntry == nullptr || pEntry->status != CatalogStatus::Ok) {
+        // Settings failing to load are rejected when loaded, and counted
+        return ERROR_SUCCESS;
+    }
 
-            if (errCode == ERROR_SUCCESS) {
-                if (baseType == SettingType::SettingCollection) {
-                    handleCollectionAction(sAPI, settingPath.second, action, baseSetting, rResult);
-                } else {
-                    wstring rVal {};
-                    errCode = handleSettingAction(settingPath.second, action, baseSetting, rVal);
+    const SettingType type { static_cast<SettingType>(pEntry->settingType) };
+    const BOOL readOnly {
+        type == SettingType::DisplayString || type == SettingType::LabeledString || type == SettingType::Action
+    };
 
-                    if (errCode == ERROR_SUCCESS) {
-                        rResult = Result { action.settingID, false, L"", rVal };
-                    } else {
-                        errMsg = L"Failed to apply setting - ErrorCode: '0x";
-                    }
-                }
-            } else {
-                errMsg = L"Failed to get 'Setting Type' - ErrorCode: '0x";
+    if (readOnly && actionMethodInfo(action.method).setsValues && path.second == L"Value") {
+        return E_NOTIMPL;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/// <summary>
+///  Runs an action over a setting served by a native handler, which receives
+///  the value supplied to 'SetValue' serialized.
+/// </summary>
+HRESULT handleNativeAction(SettingAPI& sAPI, const Action& action, Result& rResult, wstring* pAppliedVal) {
+    HRESULT errCode { ERROR_SUCCESS };
+    wstring value {};
+
+    // Native settings don't expose the metadata of the system settings
+    if (action.fields != 0) {
+        errCode = E_NOTIMPL;
+    } else if (actionMethodInfo(action.method).setsValues) {
+        ATL::CComPtr<IPropertyValue> paramValue { NULL };
+
+        for (const auto& param : action.params) {
+            if (param.isObject == false) {
+                paramValue = param.iPropVal;
             }
-        } else {
-            errMsg = L"Failed to load 'BaseSetting' - ErrorCode: '0x";
         }
-    } else {
-        errMsg = L"Failed to get 'SettingPath' - ErrorCode: '0x";
+
+        errCode = paramValue == NULL ? E_INVALIDARG : toString(paramValue, value);
     }
 
-    if (errCode != ERROR_SUCCESS) {
+    wstring rVal {};
+    if (errCode == ERROR_SUCCESS) {
+        errCode = sAPI.getNativeHandlers().handle(
+            WStringView { action.settingID }, action.method, value, rVal, pAppliedVal
+        );
+    }
+
+    if (errCode == ERROR_SUCCESS) {
+        rResult = Result { action.settingID, false, L"", rVal };
+    } else {
         std::wostringstream errCodeStr {};
         errCodeStr << std::hex << errCode;
 
         rResult = Result {
             action.settingID,
             true,
-            errMsg + errCodeStr.str() + L"'",
+            L"Failed to apply native setting - ErrorCode: '0x" + errCodeStr.str() + L"'",
             L""
         };
     }
@@ -246,148 +507,1486 @@ HRESULT handleAction(SettingAPI& sAPI, Action action, Result& rResult) {
     return errCode;
 }
 
-void readInputStream(wstring* payloadStr) {
-    if (payloadStr == NULL) {
-        ExitThread(E_INVALIDARG);
-    }
+/// <summary>
+///  Builds the error result of an action, holding the supplied message and
+///  error code.
+/// </summary>
+Result errorResult(const Action& action, const wstring& errMsg, HRESULT errCode) {
+    std::wostringstream errCodeStr {};
+    errCodeStr << std::hex << errCode;
 
-    wstring cinData {};
-    std::vector<wchar_t> buffer ( static_cast<size_t>(512) );
+    return Result { action.settingID, true, errMsg + L" - ErrorCode: '0x" + errCodeStr.str() + L"'", L"" };
+}
 
-    auto& inputStream = std::wcin;
+/// <summary>
+///  Builds the result of an action that wasn't run because the deadline of its
+///  batch expired.
+/// </summary>
+Result expiredResult(const Action& action) {
+    SettingsStats::instance().increment(StatsCounter::ExpiredActions);
+    return errorResult(action, L"Batch deadline expired before the action was run", ERROR_TIMEOUT);
+}
 
-    while (true) {
-        inputStream.read(buffer.data(), buffer.size());
-        auto read = inputStream.gcount();
+/// <summary>
+///  Gets the string held by a parameter that isn't an object.
+/// </summary>
+HRESULT getStringParam(const Parameter& param, wstring& rStr) {
+    if (param.isObject || param.iPropVal == NULL) { return E_INVALIDARG; }
 
-        if (read > 0) {
-            cinData.append(buffer.begin(), buffer.begin() + read);
-        }
+    PropertyType type { PropertyType::PropertyType_Empty };
+    param.iPropVal->get_Type(&type);
+    if (type != PropertyType::PropertyType_String) { return E_INVALIDARG; }
 
-        if (!inputStream.good()) { break; }
+    HSTRING hStr { NULL };
+    HRESULT errCode { param.iPropVal->GetString(&hStr) };
+
+    if (errCode == ERROR_SUCCESS) {
+        UINT32 bufSize { 0 };
+        PCWSTR bufWSTR { WindowsGetStringRawBuffer(hStr, &bufSize) };
+        rStr.assign(bufWSTR, bufSize);
+        WindowsDeleteString(hStr);
     }
 
-    *payloadStr = cinData;
+    return errCode;
 }
 
-wstring buildOutputStr(const vector<Result>& results) {
-    wstring output {};
+/// <summary>
+///  Loads the setting holding the value of a snapshot entry. Only the values
+///  of settings that aren't collections, nor served by native handlers, can
+///  be part of a snapshot.
+/// </summary>
+HRESULT loadSnapshotSetting(SettingAPI& sAPI, const wstring& settingId, SettingItem& rSetting, wstring& rValueId) {
+    SettingPathSegments<2> segments {};
+    if (tokenizeSettingPath(WStringView { settingId }, segments) == false || segments.empty()) {
+        return E_INVALIDARG;
+    }
 
-    output.append(L"[");
+    // Native handlers exchange serialized values, which aren't typed
+    if (sAPI.getNativeHandlers().serves(WStringView { settingId })) { return E_NOTIMPL; }
 
-    for (auto& result : results) {
-        wstring resultStr {};
-        HRESULT serRes = serializeResult(result, resultStr);
-        output.append(resultStr);
+    HRESULT errCode { sAPI.loadBaseSetting(segments[0], rSetting) };
 
-        if (&result != &results.back()) {
-            output.append(L",");
-        }
+    if (errCode == ERROR_SUCCESS) {
+        SettingType type { SettingType::Empty };
+        rSetting.GetSettingType(&type);
+
+        if (type == SettingType::SettingCollection) { errCode = E_NOTIMPL; }
     }
 
-    output.append(L"]");
+    rValueId = segments.size() == 2 ? segments[1].str() : wstring { L"Value" };
 
-    return output;
+    return errCode;
 }
 
-wstring invalidPayloadMsg(HRESULT errCode) {
-    std::wstring errMsg { L"Invalid payload - Parsing failed with error code: '0x" };
-    std::wostringstream errCodeStr {};
-    errCodeStr << std::hex << errCode;
+/// <summary>
+///  Reads the value of a setting into a snapshot entry.
+/// </summary>
+HRESULT snapshotSetting(SettingAPI& sAPI, const wstring& settingId, SnapshotEntry& rEntry) {
+    TraceScope trace { "snapshotSetting", "settingID", settingId };
 
-    errMsg.append(errCodeStr.str());
-    errMsg.append(L"'.");
+    SettingItem setting {};
+    wstring valueId {};
+    HRESULT errCode { loadSnapshotSetting(sAPI, settingId, setting, valueId) };
 
-    return errMsg;
+    ATL::CComPtr<IPropertyValue> value { NULL };
+    if (errCode == ERROR_SUCCESS) { errCode = getPropertyValue(valueId, setting, value); }
+    if (errCode == ERROR_SUCCESS) { errCode = toSnapshotValue(value, rEntry); }
+
+    rEntry.settingId = settingId;
+
+    return errCode;
+}
+
+/// <summary>
+///  Sets the value held in a snapshot entry into its setting, unless the
+///  setting already holds it.
+/// </summary>
+/// <param name="rChanged">Set to TRUE if the value of the setting was set.</param>
+HRESULT restoreSetting(SettingAPI& sAPI, const SnapshotEntry& entry, BOOL& rChanged) {
+    TraceScope trace { "restoreSetting", "settingID", entry.settingId };
+    rChanged = FALSE;
+
+    SettingItem setting {};
+    wstring valueId {};
+    HRESULT errCode { loadSnapshotSetting(sAPI, entry.settingId, setting, valueId) };
+
+    ATL::CComPtr<IPropertyValue> curValue { NULL };
+    if (errCode == ERROR_SUCCESS) { errCode = getPropertyValue(valueId, setting, curValue); }
+
+    if (errCode == ERROR_SUCCESS) {
+        // The value is compared in its stored form, a value that can't be
+        // stored is never the one in the snapshot
+        SnapshotEntry curEntry {};
+        if (toSnapshotValue(curValue, curEntry) == ERROR_SUCCESS && curEntry.sameValue(entry)) {
+            return ERROR_SUCCESS;
+        }
+
+        ATL::CComPtr<IPropertyValue> value { NULL };
+        errCode = fromSnapshotValue(entry, value);
+
+        if (errCode == ERROR_SUCCESS) {
+            errCode = setting.SetValue(valueId, value);
+            rChanged = errCode == ERROR_SUCCESS;
+        }
+    }
+
+    return errCode;
 }
 
-HRESULT getInputPayload(pair<int, wchar_t**>* pInput, wstring& rPayloadStr) {
+HRESULT handleSnapshot(SettingAPI& sAPI, const Action& action, Result& rResult) {
+    TraceScope trace { "handleSnapshot" };
+
     HRESULT errCode { ERROR_SUCCESS };
+    vector<wstring> settingIds {};
 
-    int argc { pInput->first };
-    wchar_t** argv { pInput->second };
+    for (const auto& param : action.params) {
+        wstring settingId {};
+        errCode = getStringParam(param, settingId);
+
+        if (errCode != ERROR_SUCCESS) {
+            rResult = errorResult(action, L"Failed to get the setting ids of the snapshot", errCode);
+            return errCode;
+        }
 
-    if (argc == 3) {
-        wstring payloadType { argv[1] };
-        wstring filePath { argv[2] };
+        settingIds.push_back(std::move(settingId));
+    }
 
-        if (payloadType == L"-file") {
-            std::wifstream fileStream { filePath };
+    // The settings of each library are read one after another
+    vector<PlanAction> planActions(settingIds.size());
+    vector<wstring> libraries(settingIds.size());
 
-            if (fileStream) {
-                rPayloadStr = wstring {
-                    std::istreambuf_iterator<wchar_t>(fileStream),
-                    std::istreambuf_iterator<wchar_t>()
-                };
-            }
-        } else {
-            errCode = E_INVALIDARG;
+    for (std::size_t i = 0; i < settingIds.size(); i++) {
+        planActions[i].settingPath = WStringView { settingIds[i] };
+        planActions[i].method = ActionMethod::GetValue;
+        planActions[i].valid = true;
+
+        SettingPathSegments<2> segments {};
+        SettingAtom library {};
+
+        if (tokenizeSettingPath(planActions[i].settingPath, segments) && segments.empty() == false &&
+            sAPI.getBackend().getSettingLibrary(SettingAtom::lookup(segments[0]), library) == ERROR_SUCCESS) {
+            libraries[i] = library.str();
         }
-    } else {
-        HANDLE hInputReader { NULL };
-        DWORD threadID { 0 };
-        wstring inputStream {};
+    }
 
-        hInputReader = CreateThread(
-            NULL,
-            0,
-            (LPTHREAD_START_ROUTINE)readInputStream,
-            (LPVOID)&inputStream,
-            0,
-            &threadID
-        );
+    vector<std::size_t> order {};
+    groupByLibrary(planActions, libraries, order);
 
-        WaitForSingleObject(hInputReader, 1000);
+    // Entries are kept in the order they were read, so they are restored in it
+    SettingsSnapshot snapshot {};
 
-        if (!inputStream.empty()) {
-            rPayloadStr = inputStream;
+    for (const std::size_t i : order) {
+        SnapshotEntry entry {};
+        errCode = snapshotSetting(sAPI, settingIds[i], entry);
+
+        if (errCode != ERROR_SUCCESS) {
+            rResult = errorResult(action, L"Failed to snapshot setting '" + settingIds[i] + L"'", errCode);
+            return errCode;
         }
+
+        snapshot.add(std::move(entry));
     }
 
-    return errCode;
+    // Base64 text doesn't need to be escaped
+    rResult = Result { action.settingID, false, L"", L"\"" + snapshot.encode() + L"\"" };
+
+    return ERROR_SUCCESS;
 }
 
-HRESULT handlePayload(pair<int, wchar_t**>* pInput) {
-    HRESULT res { ERROR_SUCCESS };
-    vector<Result> results {};
-    wstring payloadStr {};
+HRESULT handleRestore(SettingAPI& sAPI, const Action& action, Result& rResult) {
+    TraceScope trace { "handleRestore" };
 
-    res = getInputPayload(pInput, payloadStr);
+    wstring snapshotText {};
+    SettingsSnapshot snapshot {};
+    HRESULT errCode { action.params.size() == 1 ? getStringParam(action.params.front(), snapshotText) : E_INVALIDARG };
 
-    if (res == ERROR_SUCCESS) {
-        vector<pair<Action, HRESULT>> operations {};
-        parsePayload(payloadStr, operations);
+    if (errCode == ERROR_SUCCESS && snapshot.decode(WStringView { snapshotText }) == false) {
+        errCode = E_INVALIDARG;
+    }
 
-        SettingAPI& sAPI { LoadSettingAPI(res) };
+    if (errCode != ERROR_SUCCESS) {
+        rResult = errorResult(action, L"Failed to read the snapshot", errCode);
+        return errCode;
+    }
 
-        if (res == ERROR_SUCCESS) {
-            for (const auto& action : operations) {
-                if (action.second == ERROR_SUCCESS) {
-                    Result actionResult {};
-                    res = handleAction(sAPI, action.first, actionResult);
+    wstring changedIds { L"[" };
+    wstring failedId {};
 
-                    // Result should contain the error in case of failure
-                    results.push_back(actionResult);
-                } else {
-                    wstring errMsg { invalidPayloadMsg(action.second) };
-
-                    results.push_back(
-                        Result {
-                            L"",
-                            true,
-                            errMsg,
-                            L""
-                        }
-                    );
-                }
-            }
+    // A setting failing to be restored doesn't prevent restoring the rest
+    for (const auto& entry : snapshot.getEntries()) {
+        BOOL changed { FALSE };
+        const HRESULT entryErrCode { restoreSetting(sAPI, entry, changed) };
+
+        if (entryErrCode != ERROR_SUCCESS && errCode == ERROR_SUCCESS) {
+            errCode = entryErrCode;
+            failedId = entry.settingId;
         }
 
-        res = UnloadSettingsAPI(sAPI);
+        if (changed) {
+            if (changedIds.size() > 1) { changedIds.append(L", "); }
+            appendJsonString(entry.settingId, changedIds);
+        }
     }
 
-    auto output = buildOutputStr(results);
-    std::wcout << output << std::endl;
+    changedIds.append(L"]");
+
+    if (errCode == ERROR_SUCCESS) {
+        rResult = Result { action.settingID, false, L"", changedIds };
+    } else {
+        rResult = errorResult(action, L"Failed to restore setting '" + failedId + L"'", errCode);
+    }
+
+    return errCode;
+}
+
+HRESULT handleAction(SettingAPI& sAPI, const Action& action, Result& rResult, wstring* pAppliedVal) {
+    TraceScope trace { "handleAction", "settingID", WStringView { action.settingID } };
+
+    if (action.method == ActionMethod::GetStats) {
+        return handleGetStats(action, rResult);
+    }
+
+    if (action.method == ActionMethod::Snapshot) {
+        return handleSnapshot(sAPI, action, rResult);
+    }
+
+    if (action.method == ActionMethod::Restore) {
+        return handleRestore(sAPI, action, rResult);
+    }
+
+    // Selectors are expanded before the batch runs, the ones left selected nothing
+    if (isSettingSelector(WStringView { action.settingID })) {
+        rResult = errorResult(action, L"No setting matches the selector", ERROR_NOT_FOUND);
+        return ERROR_NOT_FOUND;
+    }
+
+    if (sAPI.getNativeHandlers().serves(WStringView { action.settingID })) {
+        return handleNativeAction(sAPI, action, rResult, pAppliedVal);
+    }
+
+    HRESULT errCode { ERROR_SUCCESS };
+    wstring errMsg {};
+
+    SettingPath settingPath {};
+    errCode = getSettingPath(action, settingPath);
+
+    if (errCode == ERROR_SUCCESS) {
+        SettingItem baseSetting {};
+        errCode = validateCatalogedAction(sAPI, action, settingPath);
+
+        if (errCode == ERROR_SUCCESS) {
+            errCode = sAPI.loadBaseSetting(settingPath.first, baseSetting);
+
+            if (errCode != ERROR_SUCCESS) {
+                errMsg = L"Failed to load 'BaseSetting' - ErrorCode: '0x";
+            }
+        } else {
+            errMsg = L"Action not supported by the cataloged setting - ErrorCode: '0x";
+        }
+
+        if (errCode == ERROR_SUCCESS) {
+            SettingType baseType { SettingType::Empty };
+            baseSetting.GetSettingType(&baseType);
+
+            if (errCode == ERROR_SUCCESS) {
+                const wstring valueId { settingPath.second.str() };
+
+                if (baseType == SettingType::SettingCollection) {
+                    handleCollectionAction(sAPI, valueId, action, baseSetting, rResult);
+                } else {
+                    wstring rVal {};
+                    errCode = handleSettingAction(valueId, action, baseSetting, rVal, pAppliedVal);
+
+                    if (errCode == ERROR_SUCCESS) {
+                        rResult = Result { action.settingID, false, L"", rVal };
+                    } else {
+                        errMsg = L"Failed to apply setting - ErrorCode: '0x";
+                    }
+                }
+            } else {
+                errMsg = L"Failed to get 'Setting Type' - ErrorCode: '0x";
+            }
+        }
+    } else {
+        errMsg = L"Failed to get 'SettingPath' - ErrorCode: '0x";
+    }
+
+    if (errCode != ERROR_SUCCESS) {
+        std::wostringstream errCodeStr {};
+        errCodeStr << std::hex << errCode;
+
+        rResult = Result {
+            action.settingID,
+            true,
+            errMsg + errCodeStr.str() + L"'",
+            L""
+        };
+    }
+
+    return errCode;
+}
+
+void readInputStream(wstring* payloadStr) {
+    if (payloadStr == NULL) {
+        ExitThread(E_INVALIDARG);
+    }
+
+    wstring cinData {};
+    std::vector<wchar_t> buffer ( static_cast<size_t>(512) );
+
+    auto& inputStream = std::wcin;
+
+    while (true) {
+        inputStream.read(buffer.data(), buffer.size());
+        auto read = inputStream.gcount();
+
+        if (read > 0) {
+            cinData.append(buffer.begin(), buffer.begin() + read);
+        }
+
+        if (!inputStream.good()) { break; }
+    }
+
+    *payloadStr = cinData;
+}
+
+wstring buildOutputStr(const vector<Result>& results) {
+    vector<wstring> serializedResults {};
+    serializedResults.reserve(results.size());
+
+    for (const auto& result : results) {
+        wstring resultStr {};
+        serializeResult(result, resultStr);
+        serializedResults.push_back(std::move(resultStr));
+    }
+
+    return buildOutputStr(serializedResults);
+}
+
+wstring buildOutputStr(const vector<wstring>& serializedResults) {
+    wstring output {};
+
+    output.append(L"[");
+
+    for (std::size_t i = 0; i < serializedResults.size(); i++) {
+        if (i != 0) {
+            output.append(L",");
+        }
+
+        output.append(serializedResults[i]);
+    }
+
+    output.append(L"]");
+
+    return output;
+}
+
+wstring invalidPayloadMsg(HRESULT errCode) {
+    std::wstring errMsg { L"Invalid payload - Parsing failed with error code: '0x" };
+    std::wostringstream errCodeStr {};
+    errCodeStr << std::hex << errCode;
+
+    errMsg.append(errCodeStr.str());
+    errMsg.append(L"'.");
+
+    return errMsg;
+}
+
+/// <summary>
+///  Parses the number of worker processes, which can't exceed MAX_WORKERS.
+/// </summary>
+HRESULT parseWorkersNum(const wstring& str, std::size_t& rWorkersNum) {
+    if (str.empty() || str.find_first_not_of(L"0123456789") != wstring::npos) {
+        return E_INVALIDARG;
+    }
+
+    const unsigned long workersNum { std::wcstoul(str.c_str(), NULL, 10) };
+    if (workersNum > constants::MAX_WORKERS) {
+        return E_INVALIDARG;
+    }
+
+    rWorkersNum = workersNum;
+
+    return ERROR_SUCCESS;
+}
+
+/// <summary>
+///  Parses the latency budget of a batch, which can't exceed MAX_DEADLINE_MS.
+/// </summary>
+HRESULT parseDeadlineMs(const wstring& str, std::uint32_t& rDeadlineMs) {
+    if (str.empty() || str.find_first_not_of(L"0123456789") != wstring::npos) {
+        return E_INVALIDARG;
+    }
+
+    const unsigned long deadlineMs { std::wcstoul(str.c_str(), NULL, 10) };
+    if (deadlineMs > constants::MAX_DEADLINE_MS) {
+        return E_INVALIDARG;
+    }
+
+    rDeadlineMs = static_cast<std::uint32_t>(deadlineMs);
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT getInputOptions(pair<int, wchar_t**>* pInput, InputOptions& rOptions) {
+    HRESULT errCode { ERROR_SUCCESS };
+
+    int argc { pInput->first };
+    wchar_t** argv { pInput->second };
+    InputOptions options {};
+
+    // Every switch is followed by its value
+    for (int i = 1; i < argc && errCode == ERROR_SUCCESS; i += 2) {
+        const wstring optSwitch { argv[i] };
+
+        if (i + 1 >= argc) {
+            errCode = E_INVALIDARG;
+        } else if (optSwitch == L"-file") {
+            options.filePath = argv[i + 1];
+        } else if (optSwitch == L"-trace") {
+            options.tracePath = argv[i + 1];
+        } else if (optSwitch == L"-record") {
+            options.recordingPath = argv[i + 1];
+        } else if (optSwitch == L"-stats") {
+            options.statsPath = argv[i + 1];
+        } else if (optSwitch == L"-quarantine") {
+            options.quarantinePath = argv[i + 1];
+        } else if (optSwitch == L"-catalog") {
+            options.catalogPath = argv[i + 1];
+        } else if (optSwitch == L"-workers") {
+            errCode = parseWorkersNum(argv[i + 1], options.workersNum);
+        } else if (optSwitch == L"-worker") {
+            options.workerId = argv[i + 1];
+        } else if (optSwitch == L"-deadline") {
+            errCode = parseDeadlineMs(argv[i + 1], options.deadlineMs);
+        } else {
+            errCode = E_INVALIDARG;
+        }
+    }
+
+    if (errCode == ERROR_SUCCESS) {
+        rOptions = options;
+    }
+
+    return errCode;
+}
+
+HRESULT getInputPayload(const InputOptions& options, wstring& rPayloadStr) {
+    HRESULT errCode { ERROR_SUCCESS };
+
+    if (options.filePath.empty() == false) {
+        std::wifstream fileStream { options.filePath };
+
+        if (fileStream) {
+            rPayloadStr = wstring {
+                std::istreambuf_iterator<wchar_t>(fileStream),
+                std::istreambuf_iterator<wchar_t>()
+            };
+        }
+    } else {
+        HANDLE hInputReader { NULL };
+        DWORD threadID { 0 };
+        wstring inputStream {};
+
+        hInputReader = CreateThread(
+            NULL,
+            0,
+            (LPTHREAD_START_ROUTINE)readInputStream,
+            (LPVOID)&inputStream,
+            0,
+            &threadID
+        );
+
+        WaitForSingleObject(hInputReader, 1000);
+
+        if (!inputStream.empty()) {
+            rPayloadStr = inputStream;
+        }
+    }
+
+    return errCode;
+}
+
+/// <summary>
+///  Gets the value of an environment variable, empty if it isn't set.
+/// </summary>
+wstring getEnvironmentPath(LPCWSTR envVar) {
+    wstring path {};
+    const DWORD pathSize { GetEnvironmentVariableW(envVar, NULL, 0) };
+
+    if (pathSize > 0) {
+        vector<wchar_t> pathBuf(pathSize);
+        GetEnvironmentVariableW(envVar, pathBuf.data(), pathSize);
+        path = pathBuf.data();
+    }
+
+    return path;
+}
+
+void addEnvironmentOptions(InputOptions& rOptions) {
+    const std::pair<wstring*, LPCWSTR> paths[] {
+        { &rOptions.tracePath, constants::TRACE_ENV_VAR },
+        { &rOptions.recordingPath, constants::RECORD_ENV_VAR },
+        { &rOptions.statsPath, constants::STATS_ENV_VAR },
+        { &rOptions.quarantinePath, constants::QUARANTINE_ENV_VAR },
+        { &rOptions.catalogPath, constants::CATALOG_ENV_VAR }
+    };
+
+    for (const auto& path : paths) {
+        if (path.first->empty()) {
+            *path.first = getEnvironmentPath(path.second);
+        }
+    }
+
+    // Invalid values in the environment leave the actions in process, and the
+    // batch without deadline
+    if (rOptions.workersNum == 0) {
+        parseWorkersNum(getEnvironmentPath(constants::WORKERS_ENV_VAR), rOptions.workersNum);
+    }
+    if (rOptions.deadlineMs == 0) {
+        parseDeadlineMs(getEnvironmentPath(constants::DEADLINE_ENV_VAR), rOptions.deadlineMs);
+    }
+}
+
+wstring getWorkerSwitches(const InputOptions& options) {
+    const std::pair<LPCWSTR, const wstring*> paths[] {
+        { L"-catalog", &options.catalogPath },
+        { L"-quarantine", &options.quarantinePath },
+        { L"-trace", &options.tracePath },
+        { L"-record", &options.recordingPath },
+        { L"-stats", &options.statsPath }
+    };
+    wstring switches {};
+
+    for (const auto& path : paths) {
+        if (path.second->empty()) { continue; }
+
+        if (switches.empty() == false) { switches.append(L" "); }
+        switches.append(path.first).append(L" \"").append(*path.second).append(L"\"");
+    }
+
+    return switches;
+}
+
+HRESULT writeTrace(const wstring& tracePath) {
+    std::ofstream traceStream { tracePath, std::ios::binary };
+
+    if (!traceStream) {
+        return E_ACCESSDENIED;
+    }
+
+    Tracer::instance().writeJson(traceStream);
+    Tracer::instance().clear();
+
+    return traceStream ? ERROR_SUCCESS : E_FAIL;
+}
+
+HRESULT appendRecording(const wstring& recordingPath) {
+    std::ofstream recordingStream { recordingPath, std::ios::binary | std::ios::app };
+
+    if (!recordingStream) {
+        return E_ACCESSDENIED;
+    }
+
+    SessionRecorder::instance().appendJsonLine(recordingStream);
+    SessionRecorder::instance().clear();
+
+    return recordingStream ? ERROR_SUCCESS : E_FAIL;
+}
+
+HRESULT writeStats(const wstring& statsPath) {
+    std::ofstream statsStream { statsPath, std::ios::binary };
+
+    if (!statsStream) {
+        return E_ACCESSDENIED;
+    }
+
+    SettingsStats::instance().writeJson(statsStream);
+
+    return statsStream ? ERROR_SUCCESS : E_FAIL;
+}
+
+/// <summary>
+///  Marker of the setting being probed by this process, next to the quarantine
+///  file. It's held open while the quarantine is used, and rewritten in place
+///  for each probe, an empty marker meaning that no probe is running. It's
+///  removed once closed, and a crash leaves it behind for the next run.
+/// </summary>
+class ProbeMarker {
+private:
+    wstring path;
+    HANDLE hFile { INVALID_HANDLE_VALUE };
+
+public:
+    explicit ProbeMarker(wstring path) : path(std::move(path)) {
+        // Not shared, so it can't be taken as left behind while it's held
+        hFile = CreateFileW(this->path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+    ~ProbeMarker() {
+        if (hFile != INVALID_HANDLE_VALUE) {
+            CloseHandle(hFile);
+            DeleteFileW(path.c_str());
+        }
+    }
+
+    ProbeMarker(const ProbeMarker&) = delete;
+    ProbeMarker& operator=(const ProbeMarker&) = delete;
+
+    bool isOpen() const { return hFile != INVALID_HANDLE_VALUE; }
+
+    void rewrite(const std::string& content) {
+        DWORD written { 0 };
+
+        SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
+        WriteFile(hFile, content.data(), static_cast<DWORD>(content.size()), &written, NULL);
+        SetEndOfFile(hFile);
+    }
+};
+
+HRESULT readQuarantine(const wstring& quarantinePath, SettingsQuarantine& rQuarantine) {
+    if (rQuarantine.getOsBuild().empty()) { return E_INVALIDARG; }
+
+    {
+        std::ifstream quarantineStream { quarantinePath, std::ios::binary };
+
+        // The file doesn't exist until a setting fails for the first time
+        if (quarantineStream) {
+            rQuarantine.read(quarantineStream);
+        }
+    }
+
+    const wstring probePrefix { quarantinePath + L".probe." };
+    std::shared_ptr<ProbeMarker> pMarker {
+        std::make_shared<ProbeMarker>(probePrefix + std::to_wstring(GetCurrentProcessId()))
+    };
+
+    if (pMarker->isOpen()) {
+        const SettingsQuarantine* pQuarantine { &rQuarantine };
+
+        rQuarantine.setProbeListener([pMarker, pQuarantine](const wstring& settingId) {
+            std::ostringstream probeStream {};
+
+            if (settingId.empty() == false) {
+                pQuarantine->writeProbe(probeStream, settingId);
+            }
+
+            pMarker->rewrite(probeStream.str());
+        });
+    }
+
+    return ERROR_SUCCESS;
+}
+
+std::size_t recoverProbeMarkers(const wstring& quarantinePath, SettingsQuarantine& rQuarantine) {
+    // Markers left by every process that crashed while probing, the ones
+    // still held open belong to running processes and can't be opened
+    const wstring probePrefix { quarantinePath + L".probe." };
+    std::size_t recovered { 0 };
+    WIN32_FIND_DATAW findData {};
+    HANDLE hFind { FindFirstFileW((probePrefix + L"*").c_str(), &findData) };
+
+    if (hFind != INVALID_HANDLE_VALUE) {
+        const std::size_t dirLength { quarantinePath.find_last_of(L"\\/") + 1 };
+        const wstring dirPath { quarantinePath.substr(0, dirLength) };
+
+        do {
+            const wstring probePath { dirPath + findData.cFileName };
+            HANDLE hProbe {
+                CreateFileW(probePath.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)
+            };
+
+            if (hProbe != INVALID_HANDLE_VALUE) {
+                char buffer[1024] {};
+                DWORD read { 0 };
+                ReadFile(hProbe, buffer, sizeof(buffer), &read, NULL);
+                CloseHandle(hProbe);
+
+                // The process crashed while probing this setting
+                std::istringstream probeStream { std::string { buffer, read } };
+                if (rQuarantine.recoverProbe(probeStream, static_cast<std::int64_t>(std::time(nullptr)))) {
+                    recovered++;
+                }
+                DeleteFileW(probePath.c_str());
+            }
+        } while (FindNextFileW(hFind, &findData));
+
+        FindClose(hFind);
+    }
+
+    return recovered;
+}
+
+HRESULT writeQuarantine(const wstring& quarantinePath, SettingsQuarantine& quarantine) {
+    if (quarantine.isModified() == false) { return ERROR_SUCCESS; }
+
+    const wstring tmpPath { quarantinePath + L".tmp" };
+    {
+        std::ofstream quarantineStream { tmpPath, std::ios::binary | std::ios::trunc };
+
+        if (!quarantineStream) {
+            return E_ACCESSDENIED;
+        }
+
+        if (quarantine.write(quarantineStream) == false) {
+            return E_FAIL;
+        }
+    }
+
+    // Replace the file at once, so a crash never leaves it half written
+    if (MoveFileExW(tmpPath.c_str(), quarantinePath.c_str(), MOVEFILE_REPLACE_EXISTING) == FALSE) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT readCatalog(const wstring& catalogPath, const wstring& osBuild, SettingsCatalog& rCatalog) {
+    std::ifstream catalogStream { catalogPath, std::ios::binary };
+
+    if (!catalogStream) {
+        return E_ACCESSDENIED;
+    }
+
+    // A catalog of another build would reject settings that may work now
+    if (rCatalog.read(catalogStream) == false || osBuild.empty() || rCatalog.getOsBuild() != osBuild) {
+        return E_INVALIDARG;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+std::size_t getPlanCacheSize() {
+    const wstring sizeStr { getEnvironmentPath(constants::PLAN_CACHE_ENV_VAR) };
+
+    if (sizeStr.empty() || sizeStr.find_first_not_of(L"0123456789") != wstring::npos) {
+        return constants::DEFAULT_PLAN_CACHE_SIZE;
+    }
+
+    const unsigned long cacheSize { std::wcstoul(sizeStr.c_str(), NULL, 10) };
+
+    return cacheSize > constants::MAX_PLAN_CACHE_SIZE ? constants::DEFAULT_PLAN_CACHE_SIZE : cacheSize;
+}
+
+namespace {
+    /// <summary>
+    ///  Kinds of the events sent by the workers, preceding the event data.
+    /// </summary>
+    const char* const quarantineEvent { "quarantine" };
+    const char* const recordEvent { "record" };
+
+    /// <summary>
+    ///  Gets the path of an output file of a worker, next to the one of the
+    ///  supervisor.
+    /// </summary>
+    wstring workerOutputPath(const wstring& path, const wstring& workerId) {
+        return path + L".worker" + workerId;
+    }
+}
+
+void PayloadWorkerSession::loadPayload(const wstring& payload) {
+    batch.reset();
+
+    BatchScope batchScope { batch.arena };
+    parsePayload(payload, batch.actions, pCatalog);
+}
+
+wstring PayloadWorkerSession::runAction(std::uint32_t index) {
+    BatchScope batchScope { batch.arena };
+    SessionRecorder& recorder { SessionRecorder::instance() };
+    vector<pair<Action, HRESULT>> selected {};
+    Result result {};
+
+    if (recorder.isEnabled()) {
+        recorder.begin(wstring {});
+    }
+
+    if (index >= batch.actions.size()) {
+        result = Result { wstring {}, true, invalidPayloadMsg(E_BOUNDS), L"" };
+    } else if (batch.actions[index].second != ERROR_SUCCESS) {
+        result = Result { wstring {}, true, invalidPayloadMsg(batch.actions[index].second), L"" };
+    } else if (isSettingSelector(WStringView { batch.actions[index].first.settingID })) {
+        const Action& action { batch.actions[index].first };
+
+        selected.emplace_back(Action { action.settingID, action.method, ParameterList {} }, ERROR_SUCCESS);
+        selected.back().first.fields = action.fields;
+        expandSelectorActions(sAPI, selected);
+    } else {
+        handleAction(sAPI, batch.actions[index].first, result);
+    }
+
+    wstring resultStr {};
+
+    if (selected.empty()) {
+        serializeResult(result, resultStr);
+    } else {
+        for (const auto& action : selected) {
+            Result selectedResult {};
+            handleAction(sAPI, action.first, selectedResult);
+
+            wstring selectedStr {};
+            serializeResult(selectedResult, selectedStr);
+
+            if (resultStr.empty() == false) { resultStr.append(L","); }
+            resultStr.append(selectedStr);
+        }
+    }
+
+    if (recorder.isEnabled()) {
+        recorder.end(wstring {});
+        const RecordedSession session { recorder.getSession() };
+
+        // The supervisor adds the calls to the session it records
+        if (session.calls.empty() == false) {
+            addEvent(std::string { recordEvent } + '\t' + sessionToJson(session));
+        }
+
+        recorder.clear();
+    }
+
+    return resultStr;
+}
+
+void PayloadWorkerSession::takeEvents(vector<std::string>& rEvents) {
+    rEvents = std::move(events);
+    events.clear();
+}
+
+HRESULT runPayloadWorker(const InputOptions& options) {
+    HRESULT res { ERROR_SUCCESS };
+
+    if (options.tracePath.empty() == false) {
+        Tracer::instance().enable();
+    }
+
+    SessionRecorder& recorder { SessionRecorder::instance() };
+    if (options.recordingPath.empty() == false) {
+        recorder.enable();
+    }
+
+    SettingAPI& sAPI { LoadSettingAPI(res) };
+
+    if (res != ERROR_SUCCESS) {
+        // The supervisor sees the worker closing, and fails the action
+        return res;
+    }
+
+    {
+        SettingsCatalog catalog {};
+        const BOOL cataloged {
+            options.catalogPath.empty() == false &&
+            readCatalog(options.catalogPath, getOsBuild(), catalog) == ERROR_SUCCESS
+        };
+        SettingsQuarantine quarantine { getOsBuild() };
+        const BOOL quarantined {
+            options.quarantinePath.empty() == false &&
+            readQuarantine(options.quarantinePath, quarantine) == ERROR_SUCCESS
+        };
+
+        PayloadWorkerSession session { sAPI, cataloged ? &catalog : nullptr };
+        std::unique_ptr<WorkerChannel> supervisor { openSupervisorChannel() };
+
+        if (cataloged) {
+            sAPI.setCatalog(&catalog);
+        }
+
+        if (quarantined) {
+            // Only the supervisor writes the quarantine, the worker reports what it learns
+            quarantine.setChangeListener([&session](const std::string& change) {
+                session.addEvent(std::string { quarantineEvent } + '\t' + change);
+            });
+            sAPI.setQuarantine(&quarantine);
+        }
+
+        runWorker(*supervisor, session);
+
+        if (quarantined) {
+            sAPI.setQuarantine(nullptr);
+        }
+
+        if (cataloged) {
+            sAPI.setCatalog(nullptr);
+        }
+    }
+
+    res = UnloadSettingsAPI(sAPI);
+
+    recorder.disable();
+
+    if (options.tracePath.empty() == false) {
+        Tracer::instance().disable();
+        writeTrace(workerOutputPath(options.tracePath, options.workerId));
+    }
+
+    if (options.statsPath.empty() == false) {
+        writeStats(workerOutputPath(options.statsPath, options.workerId));
+    }
+
+    return res;
+}
+
+void handleWorkerEvent(const std::string& event, SettingsQuarantine* pQuarantine) {
+    const std::size_t separator { event.find('\t') };
+    if (separator == std::string::npos) { return; }
+
+    const std::string kind { event.substr(0, separator) };
+    const std::string data { event.substr(separator + 1) };
+    SessionRecorder& recorder { SessionRecorder::instance() };
+
+    if (kind == quarantineEvent && pQuarantine != nullptr) {
+        pQuarantine->applyChange(data, static_cast<std::int64_t>(std::time(nullptr)));
+    } else if (kind == recordEvent && recorder.isEnabled()) {
+        RecordedSession session {};
+
+        if (parseRecordedSession(data, session)) {
+            // The worker session spans the action, which just finished
+            const std::int64_t sessionStartUs { recorder.nowUs() - session.durationUs };
+
+            for (auto& call : session.calls) {
+                call.startUs += sessionStartUs;
+                recorder.addCall(std::move(call));
+            }
+        }
+    }
+}
+
+wstring workerFailureMsg(WorkerStatus status) {
+    switch (status) {
+        case WorkerStatus::Crashed:
+            return L"Worker process crashed while handling the action";
+        case WorkerStatus::TimedOut:
+            return L"Worker process didn't complete the action in time, and was terminated";
+        default:
+            return L"No worker process could be started to handle the action";
+    }
+}
+
+namespace {
+    /// <summary>
+    ///  Gets the base setting of the action, the part of its id before the
+    ///  first '.'.
+    /// </summary>
+    WStringView baseSettingOf(const Action& action) {
+        const WStringView settingId { action.settingID };
+        const wchar_t* pDot { std::find(settingId.begin(), settingId.end(), L'.') };
+
+        return WStringView { settingId.begin(), static_cast<std::size_t>(pDot - settingId.begin()) };
+    }
+
+    /// <summary>
+    ///  Gets the library implementing the base setting of each action, from the
+    ///  catalog or the registry, as the supervisor doesn't load the SettingAPI.
+    ///  Settings whose library isn't known, like the ones served by native
+    ///  handlers, are keyed by their base setting instead.
+    /// </summary>
+    vector<wstring> libraryKeysOf(const Batch& batch, const SettingsCatalog* pCatalog) {
+        vector<wstring> keys(batch.actions.size());
+
+        for (std::size_t i = 0; i < batch.actions.size(); i++) {
+            if (batch.actions[i].second != ERROR_SUCCESS) { continue; }
+
+            const WStringView baseSetting { baseSettingOf(batch.actions[i].first) };
+            const CatalogEntry* pEntry { pCatalog != nullptr ? pCatalog->find(baseSetting) : nullptr };
+
+            if (pEntry != nullptr && pEntry->dll.empty() == false) {
+                keys[i] = pEntry->dll;
+            } else if (getSettingDLL(baseSetting.str(), keys[i]) != ERROR_SUCCESS || keys[i].empty()) {
+                keys[i] = baseSetting.str();
+            }
+        }
+
+        return keys;
+    }
+
+    /// <summary>
+    ///  Checks if the action has to run alone, without other actions of the
+    ///  batch running at the same time.
+    /// </summary>
+    bool runsAlone(const Action& action) {
+        return actionMethodInfo(action.method).isBarrier || isSettingSelector(WStringView { action.settingID });
+    }
+}
+
+vector<wstring> handleIsolatedBatchActions(
+    WorkerPool&             pool,
+    const wstring&          payloadStr,
+    Batch&                  batch,
+    const SettingsCatalog*  pCatalog
+) {
+    vector<wstring> serializedResults(batch.actions.size());
+    const vector<wstring> libraries { libraryKeysOf(batch, pCatalog) };
+
+    pool.setPayload(payloadStr);
+
+    std::size_t next { 0 };
+    while (next < batch.actions.size()) {
+        // Next wave of actions run at once, over settings of different libraries
+        vector<std::uint32_t> wave {};
+        vector<WStringView> waveLibraries {};
+
+        for (; next < batch.actions.size(); next++) {
+            const auto& action = batch.actions[next];
+
+            if (action.second != ERROR_SUCCESS) {
+                const Result actionResult { wstring {}, true, invalidPayloadMsg(action.second), L"" };
+                serializeResult(actionResult, serializedResults[next]);
+                continue;
+            }
+
+            const WStringView library { libraries[next] };
+            const bool alone { runsAlone(action.first) };
+            const bool running {
+                std::find(waveLibraries.begin(), waveLibraries.end(), library) != waveLibraries.end()
+            };
+
+            if (wave.empty() == false && (alone || running || wave.size() == pool.size())) { break; }
+
+            wave.push_back(static_cast<std::uint32_t>(next));
+            waveLibraries.push_back(library);
+
+            if (alone) {
+                next++;
+                break;
+            }
+        }
+
+        if (wave.empty()) { continue; }
+
+        if (batchDeadlineExpired()) {
+            for (const std::uint32_t index : wave) {
+                serializeResult(expiredResult(batch.actions[index].first), serializedResults[index]);
+            }
+            continue;
+        }
+
+        vector<WorkerStatus> statuses {};
+        vector<wstring> results {};
+        pool.runActions(wave, statuses, results);
+
+        for (std::size_t i = 0; i < wave.size(); i++) {
+            const std::uint32_t index { wave[i] };
+
+            if (statuses[i] == WorkerStatus::Completed) {
+                serializedResults[index] = std::move(results[i]);
+            } else {
+                const Action& action { batch.actions[index].first };
+                const Result actionResult { action.settingID, true, workerFailureMsg(statuses[i]), L"" };
+                serializeResult(actionResult, serializedResults[index]);
+            }
+        }
+    }
+
+    return serializedResults;
+}
+
+/// <summary>
+///  Gets the path of the running executable, which is started again for the
+///  worker processes.
+/// </summary>
+wstring getExecutablePath() {
+    vector<wchar_t> pathBuf(MAX_PATH);
+
+    while (true) {
+        const DWORD pathSize { GetModuleFileNameW(NULL, pathBuf.data(), static_cast<DWORD>(pathBuf.size())) };
+
+        if (pathSize == 0) { return wstring {}; }
+        if (pathSize < pathBuf.size()) { return wstring { pathBuf.data(), pathSize }; }
+
+        pathBuf.resize(pathBuf.size() * 2);
+    }
+}
+
+/// <summary>
+///  Resolves the library implementing the setting of each action of the batch,
+///  leaving it empty for the ones whose library can't be resolved, which report
+///  their errors when run, and for the ones served by native handlers.
+/// </summary>
+vector<SettingAtom> resolveLibraries(SettingAPI& sAPI, const Batch& batch) {
+    vector<SettingAtom> libraries(batch.actions.size());
+
+    for (std::size_t i = 0; i < batch.actions.size(); i++) {
+        const auto& action = batch.actions[i];
+        const BOOL resolvable {
+            action.second == ERROR_SUCCESS && action.first.method != ActionMethod::GetStats &&
+            sAPI.getNativeHandlers().serves(WStringView { action.first.settingID }) == false
+        };
+
+        SettingPath settingPath {};
+        SettingAtom library {};
+
+        if (resolvable && getSettingPath(action.first, settingPath) == ERROR_SUCCESS &&
+            sAPI.getBackend().getSettingLibrary(SettingAtom::lookup(settingPath.first), library) == ERROR_SUCCESS) {
+            libraries[i] = library;
+        }
+    }
+
+    return libraries;
+}
+
+/// <summary>
+///  Describes the actions of the batch for 'planBatch', along with the library
+///  of their settings, which has to outlive the descriptions.
+/// </summary>
+vector<PlanAction> getPlanActions(const Batch& batch, const vector<SettingAtom>& libraries) {
+    vector<PlanAction> planActions(batch.actions.size());
+
+    for (std::size_t i = 0; i < batch.actions.size(); i++) {
+        const Action& action { batch.actions[i].first };
+        PlanAction& planAction { planActions[i] };
+
+        planAction.settingPath = WStringView { action.settingID };
+        planAction.method = action.method;
+        planAction.valid = batch.actions[i].second == ERROR_SUCCESS;
+
+        for (const auto& param : action.params) {
+            planAction.selectsElements = planAction.selectsElements || param.isObject;
+        }
+
+        planAction.projectsFields = action.fields != 0;
+        planAction.library = libraries[i].empty() ? WStringView {} : libraries[i].view();
+    }
+
+    return planActions;
+}
+
+/// <summary>
+///  Builds the result of an action from the result of the one answering it.
+/// </summary>
+Result copyResult(const Action& action, const Result& source) {
+    return Result { action.settingID, source.isError, source.errorMessage, source.returnValue };
+}
+
+/// <summary>
+///  Runs an action, unless the deadline of the batch has expired, in which
+///  case it's reported as timed out without touching the setting.
+/// </summary>
+void runUnlessExpired(SettingAPI& sAPI, const Action& action, Result& rResult, wstring* pAppliedVal = nullptr) {
+    if (batchDeadlineExpired()) {
+        rResult = expiredResult(action);
+    } else {
+        handleAction(sAPI, action, rResult, pAppliedVal);
+    }
+}
+
+/// <summary>
+///  Runs the actions as planned by 'planBatch', in the supplied order, filling
+///  one result per action in the order of the actions. Once the deadline of the
+///  batch expires, only the actions answered by the ones already run are served.
+/// </summary>
+void runPlannedActions(
+    SettingAPI&                             sAPI,
+    const vector<pair<Action, HRESULT>>&    actions,
+    const vector<PlannedAction>&            plan,
+    const vector<std::size_t>&              order,
+    vector<Result>&                         rResults
+) {
+    const std::size_t none { static_cast<std::size_t>(-1) };
+
+    // Values left in the settings by the SetValue actions, for the reads after them.
+    // They are empty when the SetValue failed or its value isn't known.
+    vector<wstring> appliedValues(actions.size());
+    // The SetValue replaced by each one, as planned by 'planBatch'
+    vector<std::size_t> superseded(actions.size(), none);
+
+    for (std::size_t i = 0; i < actions.size(); i++) {
+        if (actions[i].second == ERROR_SUCCESS && plan[i].step == PlanStep::Superseded) {
+            superseded[plan[i].source] = i;
+        }
+    }
+
+    rResults.clear();
+    rResults.resize(actions.size());
+
+    for (const std::size_t i : order) {
+        const auto& action = actions[i];
+        const PlannedAction& step { plan[i] };
+        Result& actionResult { rResults[i] };
+
+        if (action.second != ERROR_SUCCESS) {
+            actionResult = Result { wstring {}, true, invalidPayloadMsg(action.second), L"" };
+        } else if (step.step == PlanStep::ReuseResult) {
+            actionResult = copyResult(action.first, rResults[step.source]);
+        } else if (step.step == PlanStep::ReadSetValue && appliedValues[step.source].empty() == false) {
+            actionResult = Result { action.first.settingID, false, L"", appliedValues[step.source] };
+        } else if (step.step != PlanStep::Superseded) {
+            // Result should contain the error in case of failure
+            runUnlessExpired(sAPI, action.first, actionResult, &appliedValues[i]);
+
+            // The sets it replaced are answered by it, or run right away if it
+            // failed, so the reads after them find the value they left
+            std::size_t answering { i };
+
+            for (std::size_t j = superseded[i]; j != none; j = superseded[j]) {
+                const Result& source { rResults[answering] };
+
+                if (source.isError == false) {
+                    rResults[j] = copyResult(actions[j].first, source);
+                } else {
+                    runUnlessExpired(sAPI, actions[j].first, rResults[j], &appliedValues[j]);
+                    answering = j;
+                }
+            }
+        }
+    }
+}
+
+void expandSelectorActions(SettingAPI& sAPI, vector<pair<Action, HRESULT>>& actions) {
+    const bool hasSelectors {
+        std::any_of(actions.begin(), actions.end(), [](const pair<Action, HRESULT>& action) {
+            return action.second == ERROR_SUCCESS && isSettingSelector(WStringView { action.first.settingID });
+        })
+    };
+
+    if (hasSelectors == false) { return; }
+
+    TraceScope trace { "expandSelectorActions" };
+    vector<pair<Action, HRESULT>> expanded {};
+    expanded.reserve(actions.size());
+
+    for (auto& action : actions) {
+        vector<wstring> settingIds {};
+
+        if (action.second == ERROR_SUCCESS && isSettingSelector(WStringView { action.first.settingID })) {
+            // Backends that can't list their settings leave the selector to fail
+            sAPI.expandSelector(WStringView { action.first.settingID }, settingIds);
+        }
+
+        if (settingIds.empty()) {
+            expanded.push_back(std::move(action));
+        } else {
+            for (const auto& settingId : settingIds) {
+                expanded.emplace_back(Action { settingId, action.first.method, ParameterList {} }, ERROR_SUCCESS);
+                expanded.back().first.fields = action.first.fields;
+            }
+        }
+    }
+
+    actions = std::move(expanded);
+}
+
+void handleBatchActions(SettingAPI& sAPI, Batch& batch) {
+    expandSelectorActions(sAPI, batch.actions);
+
+    const vector<SettingAtom> libraries { resolveLibraries(sAPI, batch) };
+    vector<PlannedAction> plan {};
+    const std::size_t coalesced { planBatch(getPlanActions(batch, libraries), plan) };
+
+    vector<std::size_t> order(batch.actions.size());
+    std::iota(order.begin(), order.end(), static_cast<std::size_t>(0));
+
+    runPlannedActions(sAPI, batch.actions, plan, order, batch.results);
+
+    SettingsStats::instance().increment(StatsCounter::CoalescedActions, coalesced);
+}
+
+HRESULT compilePayload(
+    SettingAPI&             sAPI,
+    const wstring&          payload,
+    const SettingsCatalog*  pCatalog,
+    CompiledPlan&           rPlan
+) {
+    TraceScope trace { "compilePayload" };
+    HRESULT res { ERROR_SUCCESS };
+
+    {
+        // The actions outlive this batch, so they are placed in the arena of the plan
+        BatchScope batchScope { rPlan.batch.arena };
+        res = parsePayload(payload, rPlan.batch.actions, pCatalog);
+
+        rPlan.selectsSettings = std::any_of(
+            rPlan.batch.actions.begin(), rPlan.batch.actions.end(), [](const pair<Action, HRESULT>& action) {
+                return action.second == ERROR_SUCCESS && isSettingSelector(WStringView { action.first.settingID });
+            }
+        );
+        expandSelectorActions(sAPI, rPlan.batch.actions);
+    }
+
+    rPlan.libraries = resolveLibraries(sAPI, rPlan.batch);
+
+    const vector<PlanAction> planActions { getPlanActions(rPlan.batch, rPlan.libraries) };
+    rPlan.coalesced = planBatch(planActions, rPlan.steps);
+
+    vector<wstring> libraries(planActions.size());
+    for (std::size_t i = 0; i < planActions.size(); i++) {
+        libraries[i] = planActions[i].library.str();
+    }
+
+    groupByLibrary(planActions, libraries, rPlan.order);
+
+    return res;
+}
+
+void runCompiledPlan(SettingAPI& sAPI, const CompiledPlan& plan, vector<Result>& rResults) {
+    TraceScope trace { "runCompiledPlan" };
+
+    runPlannedActions(sAPI, plan.batch.actions, plan.steps, plan.order, rResults);
+
+    SettingsStats::instance().increment(StatsCounter::CoalescedActions, plan.coalesced);
+}
+
+HRESULT handlePayload(pair<int, wchar_t**>* pInput) {
+    HRESULT res { ERROR_SUCCESS };
+    Batch batch {};
+    wstring payloadStr {};
+
+    // Options are parsed once, switches taking precedence over the environment
+    InputOptions options {};
+    res = getInputOptions(pInput, options);
+
+    if (res == ERROR_SUCCESS && options.workerId.empty() == false) {
+        return runPayloadWorker(options);
+    }
+
+    addEnvironmentOptions(options);
+
+    // The budget covers the whole batch, reading the payload included
+    BatchDeadline deadline { options.deadlineMs };
+    DeadlineScope deadlineScope { options.deadlineMs > 0 ? &deadline : nullptr };
+
+    vector<wstring> isolatedResults {};
+
+    if (options.tracePath.empty() == false) {
+        Tracer::instance().enable();
+    }
+
+    SessionRecorder& recorder { SessionRecorder::instance() };
+    if (options.recordingPath.empty() == false) {
+        recorder.enable();
+    }
+
+    // Workers start loading the settings library while the payload is read
+    const wstring exePath { options.workersNum > 0 ? getExecutablePath() : wstring {} };
+    const wstring workerSwitches { getWorkerSwitches(options) };
+    WorkerPool pool {
+        [&exePath, &workerSwitches, spawned = std::size_t { 0 }]() mutable {
+            return spawnWorkerProcess(exePath, spawned++, workerSwitches);
+        },
+        options.workersNum
+    };
+
+    if (res == ERROR_SUCCESS && options.workersNum > 0) {
+        TraceScope trace { "startWorkers" };
+        pool.start();
+    }
+
+    {
+        TraceScope trace { "getInputPayload" };
+        if (res == ERROR_SUCCESS) {
+            res = getInputPayload(options, payloadStr);
+        }
+    }
+
+    if (recorder.isEnabled()) {
+        recorder.begin(payloadStr);
+    }
+
+    // The catalog is read before parsing, as the payload values are converted
+    // into the types of the cataloged settings while being parsed
+    SettingsCatalog catalog {};
+    const BOOL cataloged {
+        res == ERROR_SUCCESS && options.catalogPath.empty() == false &&
+        readCatalog(options.catalogPath, getOsBuild(), catalog) == ERROR_SUCCESS
+    };
+
+    SettingsQuarantine quarantine { getOsBuild() };
+    const BOOL quarantined {
+        res == ERROR_SUCCESS && options.quarantinePath.empty() == false &&
+        readQuarantine(options.quarantinePath, quarantine) == ERROR_SUCCESS
+    };
+
+    if (quarantined) {
+        // Settings that crashed a previous run, or one still running, are quarantined
+        recoverProbeMarkers(options.quarantinePath, quarantine);
+    }
+
+    if (res == ERROR_SUCCESS) {
+        BatchScope batchScope { batch.arena };
+
+        {
+            TraceScope trace { "parsePayload" };
+            parsePayload(payloadStr, batch.actions, cataloged ? &catalog : nullptr);
+        }
+
+        if (options.workersNum > 0) {
+            TraceScope trace { "handleIsolatedBatchActions" };
+
+            // Workers report what they learn, only the supervisor persists it
+            pool.setEventListener([&quarantine, quarantined](const std::string& event) {
+                handleWorkerEvent(event, quarantined ? &quarantine : nullptr);
+            });
+
+            isolatedResults = handleIsolatedBatchActions(pool, payloadStr, batch, cataloged ? &catalog : nullptr);
+            pool.stop();
+
+            if (quarantined) {
+                // Markers left by the workers that crashed or were terminated
+                recoverProbeMarkers(options.quarantinePath, quarantine);
+            }
+        } else {
+            SettingAPI* pSAPI { nullptr };
+            {
+                TraceScope trace { "LoadSettingAPI" };
+                pSAPI = &LoadSettingAPI(res);
+            }
+            SettingAPI& sAPI { *pSAPI };
+
+            if (res == ERROR_SUCCESS) {
+                if (quarantined) {
+                    sAPI.setQuarantine(&quarantine);
+                }
+
+                if (cataloged) {
+                    sAPI.setCatalog(&catalog);
+                }
+
+                handleBatchActions(sAPI, batch);
+
+                if (cataloged) {
+                    sAPI.setCatalog(nullptr);
+                }
+
+                if (quarantined) {
+                    sAPI.setQuarantine(nullptr);
+                }
+            }
+
+            TraceScope trace { "UnloadSettingsAPI" };
+            res = UnloadSettingsAPI(sAPI);
+        }
+    }
+
+    if (quarantined) {
+        // Failing to persist the quarantine only loses what was learned
+        writeQuarantine(options.quarantinePath, quarantine);
+    }
+
+    {
+        TraceScope trace { "buildOutputStr" };
+        auto output = options.workersNum > 0 ? buildOutputStr(isolatedResults) : buildOutputStr(batch.results);
+        std::wcout << output << std::endl;
+
+        if (recorder.isEnabled()) {
+            recorder.end(output);
+        }
+    }
+
+    batch.reset();
+
+    if (options.tracePath.empty() == false) {
+        Tracer::instance().disable();
+        // Failing to write the trace shouldn't change the payload result
+        writeTrace(options.tracePath);
+    }
+
+    if (options.recordingPath.empty() == false) {
+        recorder.disable();
+        // Same as the trace, failing to record the session isn't reported
+        appendRecording(options.recordingPath);
+    }
+
+    if (options.statsPath.empty() == false) {
+        // The stats cover the whole process, they are dumped once it's done
+        writeStats(options.statsPath);
+    }
 
     return res;
 }
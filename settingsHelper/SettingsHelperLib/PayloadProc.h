@@ -27,7 +27,10 @@
 #include "IPropertyValueUtils.h"
 #include "SettingItemEventHandler.h"
 #include "StringConversion.h"
+#include "BatchPlan.h"
 #include "Payload.h"
+#include "WStringView.h"
+#include "WorkerPool.h"
 
 using std::wstring;
 using std::vector;
@@ -42,6 +45,10 @@ using std::pair;
 /// <param name="action">The action to be performed over the setting.</param>
 /// <param name="setting">The setting that is going to receive the action.</param>
 /// <param name="rVal">A string containing the result of the operation.</param>
+/// <param name="pAppliedVal">
+///  Optional string to be filled with the value left in the setting by a
+///  successful 'SetValue', as read back from the setting after setting it.
+/// </param>
 /// <returns>
 ///   ERROR_SUCCESS in case of success or one of the following error codes:
 ///     - E_NOTIMPL:
@@ -52,7 +59,13 @@ using std::pair;
 ///         + If the supplied 'valueId' isn't supported.
 ///         + If the supplied IPropertyValue withing the action can't be converted into a string.
 /// </returns>
-HRESULT handleSettingAction(const wstring& valueId, const Action& action, SettingItem& setting, wstring& rVal);
+HRESULT handleSettingAction(
+    const wstring& valueId,
+    const Action& action,
+    SettingItem& setting,
+    wstring& rVal,
+    wstring* pAppliedVal = nullptr
+);
 /// <summary>
 ///  Serializes a vector of pairs of setting '<id, value>'.
 /// </summary>
@@ -65,6 +78,13 @@ HRESULT handleSettingAction(const wstring& valueId, const Action& action, Settin
 /// </returns>
 wstring serializeReturnValues(vector<pair<wstring, wstring>> settingsValues);
 /// <summary>
+///  Appends the supplied string to 'rStr' as a JSON string, escaping the quotes,
+///  backslashes and the control characters not allowed in JSON strings.
+/// </summary>
+/// <param name="str">The string to be appended.</param>
+/// <param name="rStr">The string the JSON string is appended to.</param>
+void appendJsonString(const wstring& str, wstring& rStr);
+/// <summary>
 ///  Handle an action over a SettingCollection.
 /// </summary>
 /// <param name="lib">Reference to the already loaded settings library.</param>
@@ -91,13 +111,15 @@ HRESULT handleCollectionAction(
 );
 
 /// <summary>
-///  Type alias for the base setting identifier.
+///  Type alias for the base setting identifier, a view into the 'settingID'
+///  of the action it was obtained from.
 /// </summary>
-using BaseSettingId = wstring;
+using BaseSettingId = WStringView;
 /// <summary>
-///  Type alias for the inner setting identifier.
+///  Type alias for the inner setting identifier, a view into the 'settingID'
+///  of the action it was obtained from.
 /// </summary>
-using InnerSettingId = wstring;
+using InnerSettingId = WStringView;
 /// <summary>
 ///  Type alias for the SettingPath.
 /// </summary>
@@ -105,6 +127,9 @@ using SettingPath = pair<BaseSettingId, InnerSettingId>;
 
 /// <summary>
 ///  Get the setting path holded in the Action request.
+///
+///  NOTE: The returned path doesn't own its contents, it refers to the action
+///  'settingID', so the action must outlive the path.
 /// </summary>
 /// <param name="action">The action that holds the setting id.</param>
 /// <param name="rPath">The path to the setting to be filled.</param>
@@ -114,6 +139,52 @@ using SettingPath = pair<BaseSettingId, InnerSettingId>;
 /// </returns>
 HRESULT getSettingPath(const Action& action, SettingPath& rPath);
 /// <summary>
+///  Checks an action against the catalog in use by the SettingAPI, before the
+///  setting is loaded. Actions setting values of settings cataloged as read
+///  only are rejected.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS if the action can be handled, or there isn't a catalog, or
+///  E_NOTIMPL if the cataloged setting doesn't support it.
+/// </returns>
+HRESULT validateCatalogedAction(SettingAPI& sAPI, const Action& action, const SettingPath& path);
+/// <summary>
+///  Handles a 'GetStats' action, which doesn't load any setting. The result
+///  holds the JSON serialization of the process 'SettingsStats', restricted to
+///  the action 'settingID' unless it's empty.
+/// </summary>
+/// <param name="action">The 'GetStats' action.</param>
+/// <param name="rResult">The result to be filled with the stats.</param>
+/// <returns>ERROR_SUCCESS, collecting the stats can't fail.</returns>
+HRESULT handleGetStats(const Action& action, Result& rResult);
+/// <summary>
+///  Handles a 'Snapshot' action, reading the value of each setting listed in
+///  its parameters, grouped by library. The result holds the base64 text of
+///  the 'SettingsSnapshot', to be passed to 'Restore'.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI to be used.</param>
+/// <param name="action">The 'Snapshot' action.</param>
+/// <param name="rResult">The result to be filled with the snapshot.</param>
+/// <returns>
+///  ERROR_SUCCESS in case of success or the error of the first setting that
+///  couldn't be read, E_NOTIMPL for collections and native settings.
+/// </returns>
+HRESULT handleSnapshot(SettingAPI& sAPI, const Action& action, Result& rResult);
+/// <summary>
+///  Handles a 'Restore' action, setting back the values held in the snapshot
+///  passed as its parameter. Only the settings whose value changed since the
+///  snapshot was taken are set, and the result holds their ids.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI to be used.</param>
+/// <param name="action">The 'Restore' action.</param>
+/// <param name="rResult">The result to be filled with the ids of the restored settings.</param>
+/// <returns>
+///  ERROR_SUCCESS in case of success, E_INVALIDARG if the snapshot is
+///  malformed, or the error of the first setting that couldn't be restored,
+///  the rest of them being restored anyway.
+/// </returns>
+HRESULT handleRestore(SettingAPI& sAPI, const Action& action, Result& rResult);
+/// <summary>
 ///	 Handles a action over a setting of collection kind.
 /// </summary>
 /// <param name="lib">Reference to the already loaded settings library.</param>
@@ -121,6 +192,10 @@ HRESULT getSettingPath(const Action& action, SettingPath& rPath);
 /// <param name="rResult">
 ///  The result of applying the action.
 /// </param>
+/// <param name="pAppliedVal">
+///  Optional string to be filled with the value left in the setting by a
+///  successful 'SetValue' over a setting that isn't a collection.
+/// </param>
 /// <returns>
 ///  ERROR_SUCCESS in case of success or one of the following error codes:
 ///     - E_INVALIDARG if the setting isn't supported or failed to load.
@@ -129,7 +204,7 @@ HRESULT getSettingPath(const Action& action, SettingPath& rPath);
 ///     - 'handleCollectinoAction' error code if the action supplied is of
 ///       SettingCollection type.
 /// </returns>
-HRESULT handleAction(SettingAPI& sAPI, Action action, Result& rResult);
+HRESULT handleAction(SettingAPI& sAPI, const Action& action, Result& rResult, wstring* pAppliedVal = nullptr);
 /// <summary>
 ///  Read the data in the input stream.
 ///
@@ -153,6 +228,11 @@ void readInputStream(wstring* payloadStr);
 /// </returns>
 wstring buildOutputStr(const vector<Result>& results);
 /// <summary>
+///  Creates an ouput string from already serialized results, as returned by
+///  the worker processes.
+/// </summary>
+wstring buildOutputStr(const vector<wstring>& serializedResults);
+/// <summary>
 ///  Creates an error message with the supplied error code. The error code
 ///  will appear in HEX format in the message, so no information about it is
 ///  lost.
@@ -161,22 +241,335 @@ wstring buildOutputStr(const vector<Result>& results);
 /// <returns>An error message.</returns>
 wstring invalidPayloadMsg(HRESULT errCode);
 /// <summary>
+///  Command line switches accepted by the application.
+/// </summary>
+struct InputOptions {
+    /// <summary>
+    ///  Path of the file holding the payload, set with '-file'. Empty if the
+    ///  payload should be read from the standard input.
+    /// </summary>
+    wstring filePath;
+    /// <summary>
+    ///  Path of the file in which to write the trace of the payload phases, set
+    ///  with '-trace'. Empty if tracing wasn't requested.
+    /// </summary>
+    wstring tracePath;
+    /// <summary>
+    ///  Path of the file in which to append the recording of the session, set
+    ///  with '-record'. Empty if recording wasn't requested.
+    /// </summary>
+    wstring recordingPath;
+    /// <summary>
+    ///  Path of the file in which to write the latency histograms and counters
+    ///  when the payload is done, set with '-stats'. Empty if they weren't
+    ///  requested.
+    /// </summary>
+    wstring statsPath;
+    /// <summary>
+    ///  Path of the file persisting the quarantine of the settings failing to
+    ///  load, set with '-quarantine'. Empty if the quarantine isn't used.
+    /// </summary>
+    wstring quarantinePath;
+    /// <summary>
+    ///  Path of the catalog written by the SettingsCatalog tool, set with
+    ///  '-catalog'. Empty if no catalog is used.
+    /// </summary>
+    wstring catalogPath;
+    /// <summary>
+    ///  Number of worker processes in which the actions are run, set with
+    ///  '-workers'. Zero if the actions are run in this process.
+    /// </summary>
+    std::size_t workersNum { 0 };
+    /// <summary>
+    ///  Number identifying this process as a worker of the pool, set with
+    ///  '-worker' by the supervisor. Empty unless the process is a worker.
+    /// </summary>
+    wstring workerId;
+    /// <summary>
+    ///  Time in which the batch should be answered in milliseconds, set with
+    ///  '-deadline'. Zero if the batch has no deadline.
+    /// </summary>
+    std::uint32_t deadlineMs { 0 };
+};
+/// <summary>
+///  Parses the command line switches of the application. Each switch should be
+///  followed by its value, and they can be supplied in any order.
+/// </summary>
+/// <param name="pInput">
+///  The program input encapsulated into a pointer to a pair.
+/// </param>
+/// <param name="rOptions">
+///  A reference to the options to be filled with the supplied switches.
+/// </param>
+/// <returns>
+///  ERROR_SUCCESS if everything went fine, otherwise E_INVALIDARG if an unknown
+///  switch, a switch without value, an invalid number of workers, or an invalid
+///  deadline is supplied.
+/// </returns>
+HRESULT getInputOptions(pair<int, wchar_t**>* pInput, InputOptions& rOptions);
+/// <summary>
+///  Fills the options that weren't supplied as switches from their environment
+///  variables: SETTINGS_HELPER_TRACE, SETTINGS_HELPER_RECORD,
+///  SETTINGS_HELPER_STATS, SETTINGS_HELPER_QUARANTINE, SETTINGS_HELPER_CATALOG,
+///  SETTINGS_HELPER_WORKERS and SETTINGS_HELPER_DEADLINE. Invalid numbers in
+///  the environment are ignored.
+/// </summary>
+/// <param name="rOptions">The options parsed from the switches.</param>
+void addEnvironmentOptions(InputOptions& rOptions);
+/// <summary>
+///  Builds the switches passing the supplied options on to the worker
+///  processes: the catalog, quarantine, trace, recording and stats ones.
+/// </summary>
+wstring getWorkerSwitches(const InputOptions& options);
+/// <summary>
 ///  Get the input payload for the application, if the file switch is specified,
 ///  the input payload is get from the file specified in the command line input.
 ///  In other case, the input is taking from the standard input, if the input
 ///  isn't received within 1 second of the function call, no input is assumed.
 /// </summary>
-/// <param name="pInput">
-///  The program input encapsulated into a pointer to a pair.
+/// <param name="options">
+///  The options parsed from the command line switches.
 /// </param>
 /// <param name="rPayloadStr">
 ///  A reference to a string to be filled with the input payload.
 /// </param>
 /// <returns>
-///   ERROR_SUCCESS if everything went fine, otherwise one of this errors is returned:
-///     -
+///   ERROR_SUCCESS if everything went fine.
+/// </returns>
+HRESULT getInputPayload(const InputOptions& options, wstring& rPayloadStr);
+/// <summary>
+///  Writes the recorded trace into the supplied path as a Chrome trace event
+///  JSON file, and discards the recorded events.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS if the trace was written, E_ACCESSDENIED if the file couldn't
+///  be opened, or E_FAIL if writing failed.
 /// </returns>
-HRESULT getInputPayload(pair<int, wchar_t**>* pInput, wstring& rPayloadStr);
+HRESULT writeTrace(const wstring& tracePath);
+/// <summary>
+///  Appends the recorded session as a new line of the supplied file, and
+///  discards it. Each line can be replayed using 'replaySession'.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS if the session was written, E_ACCESSDENIED if the file
+///  couldn't be opened, or E_FAIL if writing failed.
+/// </returns>
+HRESULT appendRecording(const wstring& recordingPath);
+/// <summary>
+///  Writes the process 'SettingsStats' into the supplied path as JSON, the
+///  same serialization returned by the 'GetStats' method.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS if the stats were written, E_ACCESSDENIED if the file
+///  couldn't be opened, or E_FAIL if writing failed.
+/// </returns>
+HRESULT writeStats(const wstring& statsPath);
+/// <summary>
+///  Reads the quarantine file, if it exists, into the supplied quarantine. The
+///  quarantine is set up to write the probe marker of this process next to it
+///  ('<path>.probe.<pid>') while each setting is loaded, keeping it open until
+///  the quarantine is destroyed.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS, or E_INVALIDARG if the quarantine OS build is unknown.
+/// </returns>
+HRESULT readQuarantine(const wstring& quarantinePath, SettingsQuarantine& rQuarantine);
+/// <summary>
+///  Quarantines the settings being probed in the markers left next to the
+///  quarantine file by processes that crashed, and removes those markers. The
+///  markers held by running processes are left alone.
+/// </summary>
+/// <returns>The number of markers recovered.</returns>
+std::size_t recoverProbeMarkers(const wstring& quarantinePath, SettingsQuarantine& rQuarantine);
+/// <summary>
+///  Writes the quarantine into the supplied path, if it changed since it was
+///  read, replacing the previous file at once.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS if the quarantine was written or didn't change,
+///  E_ACCESSDENIED if the file couldn't be opened, E_FAIL if writing failed, or
+///  the error replacing the previous file.
+/// </returns>
+HRESULT writeQuarantine(const wstring& quarantinePath, SettingsQuarantine& quarantine);
+/// <summary>
+///  Reads the catalog file into the supplied catalog.
+/// </summary>
+/// <param name="catalogPath">The path of the catalog file.</param>
+/// <param name="osBuild">The running OS build, the catalog should belong to it.</param>
+/// <param name="rCatalog">The catalog to be filled.</param>
+/// <returns>
+///  ERROR_SUCCESS if the catalog was read, E_ACCESSDENIED if the file couldn't
+///  be opened, or E_INVALIDARG if it's malformed or belongs to another OS build.
+/// </returns>
+HRESULT readCatalog(const wstring& catalogPath, const wstring& osBuild, SettingsCatalog& rCatalog);
+/// <summary>
+///  Gets the number of compiled plans kept by the engine of the Node addon,
+///  from the SETTINGS_HELPER_PLAN_CACHE environment variable, or the default
+///  one if it isn't set or invalid. Zero disables the cache.
+/// </summary>
+std::size_t getPlanCacheSize();
+/// <summary>
+///  What a worker process does with the payloads sent by the supervisor. The
+///  SettingAPI is loaded once when the worker starts, so it's already warm when
+///  the actions arrive.
+/// </summary>
+class PayloadWorkerSession : public WorkerSession {
+private:
+    SettingAPI& sAPI;
+    const SettingsCatalog* pCatalog { nullptr };
+    Batch batch {};
+    vector<std::string> events {};
+
+public:
+    PayloadWorkerSession(SettingAPI& sAPI, const SettingsCatalog* pCatalog = nullptr) :
+        sAPI(sAPI), pCatalog(pCatalog) {}
+
+    /// <summary>
+    ///  Parses the payload, replacing the actions of the previous one. The
+    ///  values are converted with the catalog, if any, as the supervisor does.
+    /// </summary>
+    void loadPayload(const wstring& payload) override;
+    /// <summary>
+    ///  Handles one of the parsed actions, an index out of range or an action
+    ///  that failed to be parsed gets an error result. A selector is run as one
+    ///  action per selected setting, their serialized results being separated
+    ///  by commas.
+    /// </summary>
+    wstring runAction(std::uint32_t index) override;
+    void takeEvents(vector<std::string>& rEvents) override;
+    /// <summary>
+    ///  Reports an event to the supervisor along with the result of the action
+    ///  being run, see 'handleWorkerEvent'.
+    /// </summary>
+    void addEvent(std::string event) { events.push_back(std::move(event)); }
+};
+/// <summary>
+///  Runs this process as a worker of the pool, serving the actions requested
+///  by the supervisor through the standard input and output until it closes
+///  them. The worker uses the catalog and the quarantine of the options, and
+///  reports the settings it learns to quarantine, and the calls it records, to
+///  the supervisor. The trace and the stats of the worker are written next to
+///  the ones of the supervisor, adding '.worker<id>' to their paths.
+/// </summary>
+/// <param name="options">The options of the worker, see 'getWorkerSwitches'.</param>
+/// <returns>
+///  ERROR_SUCCESS once the supervisor is gone, or the error loading or
+///  unloading the SettingAPI.
+/// </returns>
+HRESULT runPayloadWorker(const InputOptions& options);
+/// <summary>
+///  Applies an event sent by a worker in the supervisor: quarantine changes
+///  are replayed on the supplied quarantine, if any, and recorded calls are
+///  added to the session being recorded.
+/// </summary>
+/// <param name="event">The body of the event.</param>
+/// <param name="pQuarantine">The quarantine of the supervisor, or nullptr.</param>
+void handleWorkerEvent(const std::string& event, SettingsQuarantine* pQuarantine);
+/// <summary>
+///  Creates the error message for an action that couldn't be completed by a
+///  worker process.
+/// </summary>
+wstring workerFailureMsg(WorkerStatus status);
+/// <summary>
+///  Handles the parsed actions of the batch in the workers of the supplied
+///  pool. Consecutive actions over settings of different libraries are run at
+///  once, in different workers, while actions over a library already being
+///  run, selectors, and barrier methods wait for the previous ones to finish. An
+///  action that crashes or hangs its worker gets an error result, and the rest
+///  of the batch continues in the replaced worker.
+/// </summary>
+/// <param name="pool">The pool running the actions.</param>
+/// <param name="payloadStr">The payload the batch actions were parsed from.</param>
+/// <param name="batch">The batch holding the parsed actions.</param>
+/// <param name="pCatalog">
+///  The catalog holding the libraries of the settings, or nullptr to read them
+///  from the registry.
+/// </param>
+/// <returns>One serialized result per action.</returns>
+vector<wstring> handleIsolatedBatchActions(
+    WorkerPool&             pool,
+    const wstring&          payloadStr,
+    Batch&                  batch,
+    const SettingsCatalog*  pCatalog
+);
+/// <summary>
+///  Replaces each action whose 'settingID' is a selector by one action per
+///  setting of the backend it selects, in the order of their ids. Selectors
+///  that select nothing are left in place, and fail when run.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI, listing the settings.</param>
+/// <param name="actions">The parsed actions, placed in the current batch arena.</param>
+void expandSelectorActions(SettingAPI& sAPI, vector<pair<Action, HRESULT>>& actions);
+/// <summary>
+///  Handles the parsed actions of the batch, adding one result per action to
+///  the batch results. Actions that failed to be parsed get an error result.
+///  Selectors are expanded first, so each selected setting gets its result.
+///  Actions are coalesced as planned by 'planBatch', so repeated reads and
+///  overwritten values don't reach the settings. Once the current
+///  BatchDeadline expires, the actions left are reported as timed out unless
+///  they are answered by the ones already run.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI to be used.</param>
+/// <param name="batch">The batch holding the parsed actions.</param>
+void handleBatchActions(SettingAPI& sAPI, Batch& batch);
+/// <summary>
+///  A payload compiled to be run several times, without being parsed again.
+///  Its actions live in the arena of its own batch, and hold their values
+///  already converted into the types of the cataloged settings.
+/// </summary>
+struct CompiledPlan {
+    /// <summary>
+    ///  The parsed actions, the batch results aren't used.
+    /// </summary>
+    Batch batch {};
+    /// <summary>
+    ///  The step planned for each action by 'planBatch'.
+    /// </summary>
+    vector<PlannedAction> steps {};
+    /// <summary>
+    ///  Number of actions that aren't run, as returned by 'planBatch'.
+    /// </summary>
+    std::size_t coalesced { 0 };
+    /// <summary>
+    ///  The library implementing the setting of each action, empty if it isn't
+    ///  known, like for the ones served by native handlers.
+    /// </summary>
+    vector<SettingAtom> libraries {};
+    /// <summary>
+    ///  The indexes of the actions in the order they're run, grouped by their
+    ///  library as done by 'groupByLibrary'.
+    /// </summary>
+    vector<std::size_t> order {};
+    /// <summary>
+    ///  Whether the payload holds selectors, expanded into the settings the
+    ///  backend had when the plan was compiled.
+    /// </summary>
+    bool selectsSettings { false };
+};
+/// <summary>
+///  Compiles a payload: parses it, plans the coalescing of its actions, and
+///  resolves the library of each setting to group the actions by library.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI whose backend resolves the libraries.</param>
+/// <param name="payload">The payload to be compiled.</param>
+/// <param name="pCatalog">Optional catalog of the settings, see 'parsePayload'.</param>
+/// <param name="rPlan">An empty plan to be filled.</param>
+/// <returns>The result of parsing the payload, see 'parsePayload'.</returns>
+HRESULT compilePayload(
+    SettingAPI& sAPI,
+    const wstring& payload,
+    const SettingsCatalog* pCatalog,
+    CompiledPlan& rPlan
+);
+/// <summary>
+///  Runs the actions of a compiled plan, the same way 'handleBatchActions'
+///  runs them, but in the order of the plan. The results are still in the
+///  order of the payload.
+/// </summary>
+/// <param name="sAPI">The already loaded SettingAPI to be used.</param>
+/// <param name="plan">The plan to be run.</param>
+/// <param name="rResults">Filled with one result per action.</param>
+void runCompiledPlan(SettingAPI& sAPI, const CompiledPlan& plan, vector<Result>& rResults);
 /// <summary>
 ///  Handle the complete input payload from the program and return a result.
 /// </summary>
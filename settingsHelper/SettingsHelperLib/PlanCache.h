@@ -0,0 +1,127 @@
+/**
+ * Cache of the plans compiled from the payloads, keyed by their content.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/// <summary>
+///  Hashes the text of a payload, FNV-1a over its characters.
+/// </summary>
+inline std::uint64_t hashPayload(WStringView payload) {
+    std::uint64_t hash { 14695981039346656037ull };
+
+    for (const wchar_t c : payload) {
+        hash ^= static_cast<std::uint64_t>(static_cast<std::uint32_t>(c));
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+/// <summary>
+///  Keeps the plans compiled for the most recently used payloads, keyed by the
+///  hash of their text. The text is kept too, so a hash collision is a miss
+///  rather than the plan of another payload.
+///
+///  The cache isn't synchronized, it belongs to the thread running the plans.
+/// </summary>
+/// <typeparam name="Plan">The type of the compiled plans.</typeparam>
+template <typename Plan>
+class PlanCache {
+private:
+    struct Entry {
+        std::wstring payload {};
+        std::unique_ptr<Plan> plan {};
+        std::uint64_t lastUse { 0 };
+    };
+
+    std::unordered_map<std::uint64_t, Entry> entries {};
+    std::size_t maxPlans { 0 };
+    std::uint64_t useClock { 0 };
+
+    void evictLeastRecent() {
+        auto oldest = entries.begin();
+
+        for (auto entry = entries.begin(); entry != entries.end(); entry++) {
+            if (entry->second.lastUse < oldest->second.lastUse) {
+                oldest = entry;
+            }
+        }
+
+        entries.erase(oldest);
+    }
+
+public:
+    /// <summary>
+    ///  Constructs a cache keeping up to 'maxPlans' plans, zero disables it.
+    /// </summary>
+    explicit PlanCache(std::size_t maxPlans) : maxPlans(maxPlans) {}
+
+    /// <summary>
+    ///  Gets the plan compiled for a payload.
+    /// </summary>
+    /// <returns>
+    ///  The plan, valid until the next call to 'insert' or 'clear', or nullptr
+    ///  if it isn't cached.
+    /// </returns>
+    Plan* find(WStringView payload) {
+        const auto entry = entries.find(hashPayload(payload));
+
+        if (entry == entries.end() || entry->second.payload != payload) {
+            return nullptr;
+        }
+
+        entry->second.lastUse = ++useClock;
+
+        return entry->second.plan.get();
+    }
+
+    /// <summary>
+    ///  Caches the plan compiled for a payload, evicting the least recently
+    ///  used plan if the cache is full, or a plan whose payload has the same
+    ///  hash.
+    /// </summary>
+    /// <returns>The cached plan, or nullptr if the cache is disabled.</returns>
+    Plan* insert(std::wstring payload, std::unique_ptr<Plan> plan) {
+        if (maxPlans == 0) { return nullptr; }
+
+        const std::uint64_t hash { hashPayload(payload) };
+        entries.erase(hash);
+
+        if (entries.size() == maxPlans) {
+            evictLeastRecent();
+        }
+
+        Entry& entry { entries[hash] };
+        entry.payload = std::move(payload);
+        entry.plan = std::move(plan);
+        entry.lastUse = ++useClock;
+
+        return entry.plan.get();
+    }
+
+    /// <summary>
+    ///  Drops every plan.
+    /// </summary>
+    void clear() { entries.clear(); }
+
+    std::size_t size() const { return entries.size(); }
+    std::size_t capacity() const { return maxPlans; }
+};
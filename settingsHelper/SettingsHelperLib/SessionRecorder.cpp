@@ -0,0 +1,424 @@
+/**
+ * Recording of the sessions processed by the helper, for their later replay.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SessionRecorder.h"
+#include "Tracer.h"
+
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+    void appendJsonString(const wstring& str, string& rOut) {
+        rOut.push_back('"');
+        appendJsonUtf8(WStringView { str }, rOut);
+        rOut.push_back('"');
+    }
+
+    /// <summary>
+    ///  Minimal JSON value, holding the subset of JSON produced by 'sessionToJson'.
+    /// </summary>
+    struct JsonNode {
+        enum class Kind { Null, Bool, Number, String, Array, Object };
+
+        Kind kind { Kind::Null };
+        bool boolean { false };
+        double number { 0 };
+        wstring str {};
+        vector<JsonNode> items {};
+        std::map<string, JsonNode> members {};
+
+        const JsonNode* member(const string& name) const {
+            auto found = members.find(name);
+            return found != members.end() ? &found->second : nullptr;
+        }
+    };
+
+    /// <summary>
+    ///  Recursive descent parser of UTF-8 encoded JSON.
+    /// </summary>
+    class JsonParser {
+    private:
+        const string& text;
+        std::size_t pos { 0 };
+
+        void skipSpaces() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+                pos++;
+            }
+        }
+
+        bool consume(char c) {
+            skipSpaces();
+
+            if (pos < text.size() && text[pos] == c) {
+                pos++;
+                return true;
+            }
+
+            return false;
+        }
+
+        bool consumeLiteral(const char* literal) {
+            const string expected { literal };
+
+            if (text.compare(pos, expected.size(), expected) == 0) {
+                pos += expected.size();
+                return true;
+            }
+
+            return false;
+        }
+
+        void appendCodePoint(std::uint32_t c, wstring& rOut) {
+            if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+                c -= 0x10000;
+                rOut.push_back(static_cast<wchar_t>(0xD800 + (c >> 10)));
+                rOut.push_back(static_cast<wchar_t>(0xDC00 + (c & 0x3FF)));
+            } else {
+                rOut.push_back(static_cast<wchar_t>(c));
+            }
+        }
+
+        bool parseHex4(std::uint32_t& rValue) {
+            if (pos + 4 > text.size()) { return false; }
+
+            rValue = 0;
+
+            for (std::size_t i = 0; i < 4; i++) {
+                const char c { text[pos++] };
+                rValue <<= 4;
+
+                if (c >= '0' && c <= '9') {
+                    rValue |= static_cast<std::uint32_t>(c - '0');
+                } else if (c >= 'a' && c <= 'f') {
+                    rValue |= static_cast<std::uint32_t>(c - 'a' + 10);
+                } else if (c >= 'A' && c <= 'F') {
+                    rValue |= static_cast<std::uint32_t>(c - 'A' + 10);
+                } else {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool parseString(wstring& rStr) {
+            if (consume('"') == false) { return false; }
+
+            while (pos < text.size()) {
+                const unsigned char c { static_cast<unsigned char>(text[pos++]) };
+
+                if (c == '"') {
+                    return true;
+                } else if (c == '\\') {
+                    if (pos >= text.size()) { return false; }
+
+                    const char esc { text[pos++] };
+
+                    switch (esc) {
+                        case '"': rStr.push_back(L'"'); break;
+                        case '\\': rStr.push_back(L'\\'); break;
+                        case '/': rStr.push_back(L'/'); break;
+                        case 'b': rStr.push_back(L'\b'); break;
+                        case 'f': rStr.push_back(L'\f'); break;
+                        case 'n': rStr.push_back(L'\n'); break;
+                        case 'r': rStr.push_back(L'\r'); break;
+                        case 't': rStr.push_back(L'\t'); break;
+                        case 'u': {
+                            std::uint32_t codePoint { 0 };
+                            if (parseHex4(codePoint) == false) { return false; }
+
+                            // Escaped surrogate pairs
+                            if (codePoint >= 0xD800 && codePoint <= 0xDBFF && text.compare(pos, 2, "\\u") == 0) {
+                                std::uint32_t low { 0 };
+                                pos += 2;
+                                if (parseHex4(low) == false) { return false; }
+
+                                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                            }
+
+                            appendCodePoint(codePoint, rStr);
+                            break;
+                        }
+                        default:
+                            return false;
+                    }
+                } else if (c < 0x80) {
+                    rStr.push_back(static_cast<wchar_t>(c));
+                } else {
+                    std::size_t extra { 0 };
+                    std::uint32_t codePoint { 0 };
+
+                    if ((c & 0xE0) == 0xC0) {
+                        extra = 1;
+                        codePoint = c & 0x1F;
+                    } else if ((c & 0xF0) == 0xE0) {
+                        extra = 2;
+                        codePoint = c & 0x0F;
+                    } else if ((c & 0xF8) == 0xF0) {
+                        extra = 3;
+                        codePoint = c & 0x07;
+                    } else {
+                        return false;
+                    }
+
+                    if (pos + extra > text.size()) { return false; }
+
+                    for (std::size_t i = 0; i < extra; i++) {
+                        codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[pos++]) & 0x3F);
+                    }
+
+                    appendCodePoint(codePoint, rStr);
+                }
+            }
+
+            return false;
+        }
+
+        bool parseNumber(double& rNumber) {
+            const char* start { text.c_str() + pos };
+            char* end { nullptr };
+
+            rNumber = std::strtod(start, &end);
+
+            if (end == start) { return false; }
+
+            pos += static_cast<std::size_t>(end - start);
+            return true;
+        }
+
+    public:
+        explicit JsonParser(const string& text) : text(text) {}
+
+        bool parseValue(JsonNode& rNode) {
+            skipSpaces();
+            if (pos >= text.size()) { return false; }
+
+            const char c { text[pos] };
+
+            if (c == '{') {
+                pos++;
+                rNode.kind = JsonNode::Kind::Object;
+
+                if (consume('}')) { return true; }
+
+                do {
+                    wstring name {};
+                    JsonNode value {};
+
+                    if (parseString(name) == false || consume(':') == false || parseValue(value) == false) {
+                        return false;
+                    }
+
+                    string asciiName {};
+                    for (const auto nameChar : name) { asciiName.push_back(static_cast<char>(nameChar)); }
+
+                    rNode.members[asciiName] = std::move(value);
+                } while (consume(','));
+
+                return consume('}');
+            } else if (c == '[') {
+                pos++;
+                rNode.kind = JsonNode::Kind::Array;
+
+                if (consume(']')) { return true; }
+
+                do {
+                    JsonNode item {};
+                    if (parseValue(item) == false) { return false; }
+
+                    rNode.items.push_back(std::move(item));
+                } while (consume(','));
+
+                return consume(']');
+            } else if (c == '"') {
+                rNode.kind = JsonNode::Kind::String;
+                return parseString(rNode.str);
+            } else if (consumeLiteral("true")) {
+                rNode.kind = JsonNode::Kind::Bool;
+                rNode.boolean = true;
+                return true;
+            } else if (consumeLiteral("false")) {
+                rNode.kind = JsonNode::Kind::Bool;
+                return true;
+            } else if (consumeLiteral("null")) {
+                rNode.kind = JsonNode::Kind::Null;
+                return true;
+            } else {
+                rNode.kind = JsonNode::Kind::Number;
+                return parseNumber(rNode.number);
+            }
+        }
+
+        bool atEnd() {
+            skipSpaces();
+            return pos == text.size();
+        }
+    };
+
+    bool getString(const JsonNode& node, const string& name, wstring& rStr) {
+        const JsonNode* member { node.member(name) };
+        if (member == nullptr || member->kind != JsonNode::Kind::String) { return false; }
+
+        rStr = member->str;
+        return true;
+    }
+
+    template <typename T>
+    bool getNumber(const JsonNode& node, const string& name, T& rNumber) {
+        const JsonNode* member { node.member(name) };
+        if (member == nullptr || member->kind != JsonNode::Kind::Number) { return false; }
+
+        rNumber = static_cast<T>(member->number);
+        return true;
+    }
+
+    bool parseRecordedCall(const JsonNode& node, RecordedCall& rCall) {
+        if (node.kind != JsonNode::Kind::Object) { return false; }
+
+        wstring op {};
+        bool valid {
+            getString(node, "op", op) &&
+            getString(node, "settingID", rCall.settingId) &&
+            getString(node, "valueID", rCall.valueId) &&
+            getNumber(node, "startUs", rCall.startUs) &&
+            getNumber(node, "durationUs", rCall.durationUs) &&
+            getNumber(node, "result", rCall.result) &&
+            getNumber(node, "settingType", rCall.settingType) &&
+            getNumber(node, "valueType", rCall.valueType) &&
+            getString(node, "value", rCall.value)
+        };
+
+        const JsonNode* elements { node.member("elements") };
+
+        if (valid && elements != nullptr && elements->kind == JsonNode::Kind::Array) {
+            for (const auto& element : elements->items) {
+                if (element.kind != JsonNode::Kind::String) { return false; }
+                rCall.elements.push_back(element.str);
+            }
+        } else {
+            valid = false;
+        }
+
+        rCall.op.clear();
+        for (const auto opChar : op) { rCall.op.push_back(static_cast<char>(opChar)); }
+
+        return valid;
+    }
+}
+
+string sessionToJson(const RecordedSession& session) {
+    string json {};
+
+    json.append("{\"version\":1");
+    json.append(",\"startUs\":").append(std::to_string(session.startUs));
+    json.append(",\"durationUs\":").append(std::to_string(session.durationUs));
+    json.append(",\"payload\":");
+    appendJsonString(session.payload, json);
+    json.append(",\"output\":");
+    appendJsonString(session.output, json);
+    json.append(",\"calls\":[");
+
+    for (std::size_t i = 0; i < session.calls.size(); i++) {
+        const RecordedCall& call { session.calls[i] };
+
+        if (i != 0) { json.append(","); }
+
+        json.append("{\"op\":\"").append(call.op).append("\"");
+        json.append(",\"settingID\":");
+        appendJsonString(call.settingId, json);
+        json.append(",\"valueID\":");
+        appendJsonString(call.valueId, json);
+        json.append(",\"startUs\":").append(std::to_string(call.startUs));
+        json.append(",\"durationUs\":").append(std::to_string(call.durationUs));
+        json.append(",\"result\":").append(std::to_string(call.result));
+        json.append(",\"settingType\":").append(std::to_string(call.settingType));
+        json.append(",\"valueType\":").append(std::to_string(call.valueType));
+        json.append(",\"value\":");
+        appendJsonString(call.value, json);
+        json.append(",\"elements\":[");
+
+        for (std::size_t j = 0; j < call.elements.size(); j++) {
+            if (j != 0) { json.append(","); }
+            appendJsonString(call.elements[j], json);
+        }
+
+        json.append("]}");
+    }
+
+    json.append("]}");
+
+    return json;
+}
+
+bool parseRecordedSession(const string& line, RecordedSession& rSession) {
+    JsonParser parser { line };
+    JsonNode root {};
+
+    if (parser.parseValue(root) == false || parser.atEnd() == false || root.kind != JsonNode::Kind::Object) {
+        return false;
+    }
+
+    RecordedSession session {};
+    int version { 0 };
+
+    bool valid {
+        getNumber(root, "version", version) && version == 1 &&
+        getNumber(root, "startUs", session.startUs) &&
+        getNumber(root, "durationUs", session.durationUs) &&
+        getString(root, "payload", session.payload) &&
+        getString(root, "output", session.output)
+    };
+
+    const JsonNode* calls { root.member("calls") };
+
+    if (valid && calls != nullptr && calls->kind == JsonNode::Kind::Array) {
+        for (const auto& callNode : calls->items) {
+            RecordedCall call {};
+
+            if (parseRecordedCall(callNode, call) == false) { return false; }
+            session.calls.push_back(std::move(call));
+        }
+    } else {
+        valid = false;
+    }
+
+    if (valid) {
+        rSession = std::move(session);
+    }
+
+    return valid;
+}
+
+bool readRecordedSessions(std::istream& in, vector<RecordedSession>& rSessions) {
+    vector<RecordedSession> sessions {};
+    string line {};
+
+    while (std::getline(in, line)) {
+        if (line.empty() || line == "\r") { continue; }
+
+        RecordedSession session {};
+        if (parseRecordedSession(line, session) == false) { return false; }
+
+        sessions.push_back(std::move(session));
+    }
+
+    rSessions = std::move(sessions);
+
+    return true;
+}
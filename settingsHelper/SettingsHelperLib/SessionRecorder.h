@@ -0,0 +1,259 @@
+/**
+ * Recording of the sessions processed by the helper, for their later replay.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+#include "WStringView.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  A call made to a setting of the backend, serialized as one of the "calls"
+///  of the recorded session.
+/// </summary>
+struct RecordedCall {
+    /// <summary>
+    ///  The performed operation: "GetSetting", "GetValue" or "SetValue".
+    /// </summary>
+    std::string op;
+    /// <summary>
+    ///  The id of the target setting.
+    /// </summary>
+    std::wstring settingId;
+    /// <summary>
+    ///  The id of the target value, empty for "GetSetting".
+    /// </summary>
+    std::wstring valueId;
+    /// <summary>
+    ///  Start of the call, in microseconds since the session start.
+    /// </summary>
+    std::int64_t startUs { 0 };
+    /// <summary>
+    ///  Duration of the call, in microseconds.
+    /// </summary>
+    std::int64_t durationUs { 0 };
+    /// <summary>
+    ///  The HRESULT returned by the call.
+    /// </summary>
+    std::int32_t result { 0 };
+    /// <summary>
+    ///  The SettingType of the setting returned by "GetSetting", -1 if unknown.
+    /// </summary>
+    std::int32_t settingType { -1 };
+    /// <summary>
+    ///  The PropertyType of 'value', -1 if the call has no value.
+    /// </summary>
+    std::int32_t valueType { -1 };
+    /// <summary>
+    ///  The value read or written, in the representation used for the results
+    ///  of the payload actions.
+    /// </summary>
+    std::wstring value;
+    /// <summary>
+    ///  The ids of the elements of the collection read by "GetValue".
+    /// </summary>
+    std::vector<std::wstring> elements;
+};
+
+/// <summary>
+///  A payload processed by the helper, along with the calls it performed and
+///  the output it produced. Serialized as a single line of JSON.
+/// </summary>
+struct RecordedSession {
+    /// <summary>
+    ///  Start of the session, in microseconds since the recorder creation.
+    /// </summary>
+    std::int64_t startUs { 0 };
+    /// <summary>
+    ///  Duration of the session, in microseconds.
+    /// </summary>
+    std::int64_t durationUs { 0 };
+    std::wstring payload;
+    std::wstring output;
+    std::vector<RecordedCall> calls;
+};
+
+/// <summary>
+///  Serializes a session as a single line of JSON, without the line terminator.
+/// </summary>
+std::string sessionToJson(const RecordedSession& session);
+/// <summary>
+///  Parses a session serialized with 'sessionToJson'.
+/// </summary>
+/// <returns>
+///  True in case of success, false if the line isn't a valid session.
+/// </returns>
+bool parseRecordedSession(const std::string& line, RecordedSession& rSession);
+/// <summary>
+///  Reads all the sessions contained in a recording, one per line. Empty lines
+///  are ignored.
+/// </summary>
+/// <returns>
+///  True in case of success, false if one of the lines isn't a valid session.
+/// </returns>
+bool readRecordedSessions(std::istream& in, std::vector<RecordedSession>& rSessions);
+
+/// <summary>
+///  Process-wide recorder of the session being processed. While disabled, the
+///  only cost of a 'RecordScope' is checking the enabled flag.
+/// </summary>
+class SessionRecorder {
+private:
+    std::atomic<bool> enabled { false };
+    NativeMutex sessionMutex {};
+    RecordedSession session {};
+    const std::chrono::steady_clock::time_point origin { std::chrono::steady_clock::now() };
+
+public:
+    SessionRecorder() {}
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    /// <summary>
+    ///  Gets the process-wide recorder.
+    /// </summary>
+    static SessionRecorder& instance() {
+        static SessionRecorder recorder {};
+        return recorder;
+    }
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void enable() { enabled.store(true, std::memory_order_relaxed); }
+    void disable() { enabled.store(false, std::memory_order_relaxed); }
+
+    /// <summary>
+    ///  Microseconds elapsed since the recorder creation.
+    /// </summary>
+    std::int64_t nowUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin
+        ).count();
+    }
+
+    /// <summary>
+    ///  Starts recording a new session, discarding the previous one.
+    /// </summary>
+    void begin(const std::wstring& payload) {
+        NativeLockGuard lock { sessionMutex };
+
+        session = RecordedSession {};
+        session.startUs = nowUs();
+        session.payload = payload;
+    }
+
+    /// <summary>
+    ///  Records a call, its 'startUs' is expected to be relative to the
+    ///  recorder creation and it's stored relative to the session start.
+    /// </summary>
+    void addCall(RecordedCall call) {
+        NativeLockGuard lock { sessionMutex };
+
+        call.startUs -= session.startUs;
+        session.calls.push_back(std::move(call));
+    }
+
+    /// <summary>
+    ///  Finishes the current session, recording its output.
+    /// </summary>
+    void end(const std::wstring& output) {
+        NativeLockGuard lock { sessionMutex };
+
+        session.durationUs = nowUs() - session.startUs;
+        session.output = output;
+    }
+
+    /// <summary>
+    ///  Gets a copy of the current session.
+    /// </summary>
+    RecordedSession getSession() {
+        NativeLockGuard lock { sessionMutex };
+        return session;
+    }
+
+    /// <summary>
+    ///  Discards the current session.
+    /// </summary>
+    void clear() {
+        NativeLockGuard lock { sessionMutex };
+        session = RecordedSession {};
+    }
+
+    /// <summary>
+    ///  Appends the current session as a new line of the supplied stream.
+    /// </summary>
+    void appendJsonLine(std::ostream& out) {
+        NativeLockGuard lock { sessionMutex };
+        out << sessionToJson(session) << '\n';
+    }
+};
+
+/// <summary>
+///  Records the call spanning the lifetime of the scope, if the recorder is
+///  enabled when the scope is created. The outcome of the call is supplied
+///  through the setters before the scope ends, 'setResult' ends the timing of
+///  the call so the conversion of its value isn't accounted.
+/// </summary>
+class RecordScope {
+private:
+    SessionRecorder* recorder { nullptr };
+    RecordedCall call {};
+    bool stopped { false };
+
+public:
+    RecordScope(const char* op, WStringView settingId, WStringView valueId) {
+        SessionRecorder& instance { SessionRecorder::instance() };
+
+        if (instance.isEnabled()) {
+            this->recorder = &instance;
+            this->call.op = op;
+            this->call.settingId = settingId.str();
+            this->call.valueId = valueId.str();
+            this->call.startUs = instance.nowUs();
+        }
+    }
+    ~RecordScope() {
+        if (recorder != nullptr) {
+            if (stopped == false) {
+                call.durationUs = recorder->nowUs() - call.startUs;
+            }
+
+            recorder->addCall(std::move(call));
+        }
+    }
+
+    RecordScope(const RecordScope&) = delete;
+    RecordScope& operator=(const RecordScope&) = delete;
+
+    bool isRecording() const { return recorder != nullptr; }
+
+    void setResult(std::int32_t result) {
+        if (recorder != nullptr && stopped == false) {
+            call.durationUs = recorder->nowUs() - call.startUs;
+            stopped = true;
+        }
+
+        call.result = result;
+    }
+    void setSettingType(std::int32_t settingType) { call.settingType = settingType; }
+    void setValue(std::int32_t valueType, std::wstring value) {
+        call.valueType = valueType;
+        call.value = std::move(value);
+    }
+    void setElements(std::vector<std::wstring> elements) { call.elements = std::move(elements); }
+};
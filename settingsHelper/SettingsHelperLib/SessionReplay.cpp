@@ -0,0 +1,247 @@
+/**
+ * Replay of recorded sessions over the simulated settings backend.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SessionReplay.h"
+#include "IPropertyValueUtils.h"
+#include "Payload.h"
+#include "PayloadProc.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <utility>
+
+#pragma comment (lib, "WindowsApp.lib")
+
+using std::map;
+using std::pair;
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  What was observed of a setting during the recorded session.
+    /// </summary>
+    struct ReplayedSetting {
+        std::int32_t settingType { -1 };
+        map<wstring, pair<std::int32_t, wstring>> values {};
+        vector<wstring> elements {};
+        std::array<std::int64_t, simulatedOperationsNum> latencySums {};
+        std::array<std::uint32_t, simulatedOperationsNum> callsNum {};
+        SimulatedBehavior behavior {};
+    };
+
+    bool getSimulatedOperation(const std::string& op, SimulatedOperation& rOp) {
+        if (op == "GetSetting") {
+            rOp = SimulatedOperation::GetSetting;
+        } else if (op == "GetValue") {
+            rOp = SimulatedOperation::GetValue;
+        } else if (op == "SetValue") {
+            rOp = SimulatedOperation::SetValue;
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    ///  Creates an IPropertyValue from a value recorded with 'recordValue'.
+    /// </summary>
+    HRESULT createRecordedValue(std::int32_t valueType, const wstring& value, ATL::CComPtr<IInspectable>& rValue) {
+        const PropertyType type { static_cast<PropertyType>(valueType) };
+        VARIANT variant {};
+        wstring unquoted {};
+
+        if (type == PropertyType::PropertyType_Boolean) {
+            variant.vt = VARENUM::VT_BOOL;
+            variant.boolVal = value == L"true" ? VARIANT_TRUE : VARIANT_FALSE;
+        } else if (type == PropertyType::PropertyType_Double) {
+            variant.vt = VARENUM::VT_R8;
+            variant.dblVal = wcstod(value.c_str(), NULL);
+        } else if (
+            type == PropertyType::PropertyType_UInt8 ||
+            type == PropertyType::PropertyType_UInt16 ||
+            type == PropertyType::PropertyType_UInt32
+        ) {
+            variant.vt = VARENUM::VT_UINT;
+            variant.uintVal = wcstoul(value.c_str(), NULL, 10);
+        } else if (
+            type == PropertyType::PropertyType_Int16 ||
+            type == PropertyType::PropertyType_Int32 ||
+            type == PropertyType::PropertyType_Int64 ||
+            type == PropertyType::PropertyType_UInt64
+        ) {
+            variant.vt = VARENUM::VT_I8;
+            variant.llVal = _wcstoi64(value.c_str(), NULL, 10);
+        } else if (
+            type == PropertyType::PropertyType_String ||
+            type == PropertyType::PropertyType_DateTime ||
+            type == PropertyType::PropertyType_TimeSpan
+        ) {
+            // Strings are recorded quoted, dates and time spans are replayed as strings
+            if (value.size() >= 2 && value.front() == L'"' && value.back() == L'"') {
+                unquoted = value.substr(1, value.size() - 2);
+            } else {
+                unquoted = value;
+            }
+
+            variant.vt = VARENUM::VT_BSTR;
+            variant.bstrVal = const_cast<BSTR>(unquoted.c_str());
+        } else {
+            return E_INVALIDARG;
+        }
+
+        ATL::CComPtr<IPropertyValue> propValue { NULL };
+        HRESULT errCode { createPropertyValue(variant, propValue) };
+
+        if (errCode == ERROR_SUCCESS) {
+            rValue = static_cast<IInspectable*>(propValue);
+        }
+
+        return errCode;
+    }
+
+    std::uint32_t replayedLatency(std::int64_t latencySum, std::uint32_t callsNum, double speed) {
+        if (callsNum == 0 || speed == 0 || latencySum <= 0) { return 0; }
+
+        const double latency { static_cast<double>(latencySum) / callsNum / speed };
+        const double maxLatency { static_cast<double>((std::numeric_limits<std::uint32_t>::max)()) };
+
+        return static_cast<std::uint32_t>(latency < maxLatency ? latency : maxLatency);
+    }
+}
+
+HRESULT readRecording(const wstring& recordingPath, vector<RecordedSession>& rSessions) {
+    std::ifstream recordingStream { recordingPath, std::ios::binary };
+
+    if (!recordingStream) {
+        return E_ACCESSDENIED;
+    }
+
+    return readRecordedSessions(recordingStream, rSessions) ? ERROR_SUCCESS : E_INVALIDARG;
+}
+
+HRESULT buildReplayBackend(const RecordedSession& session, double speed, SimulatedSettingsBackend& rBackend) {
+    if (speed < 0) { return E_INVALIDARG; }
+
+    map<wstring, ReplayedSetting> settings {};
+
+    for (const auto& call : session.calls) {
+        SimulatedOperation op { SimulatedOperation::GetSetting };
+        if (getSimulatedOperation(call.op, op) == false) { continue; }
+
+        const std::size_t opIndex { static_cast<std::size_t>(op) };
+        ReplayedSetting& setting { settings[call.settingId] };
+        const std::uint32_t callIndex { setting.callsNum[opIndex]++ };
+
+        setting.latencySums[opIndex] += call.durationUs;
+
+        if (call.result != ERROR_SUCCESS) {
+            if (setting.behavior.failures[opIndex].errorCode == 0) {
+                // Fail only at the recorded call
+                setting.behavior.fail(op, call.result, callIndex, (std::numeric_limits<std::uint32_t>::max)());
+            }
+        } else if (op == SimulatedOperation::GetSetting) {
+            setting.settingType = call.settingType;
+        } else if (op == SimulatedOperation::GetValue) {
+            if (call.valueType != -1 && setting.values.count(call.valueId) == 0) {
+                setting.values[call.valueId] = pair<std::int32_t, wstring> { call.valueType, call.value };
+            }
+            if (call.elements.empty() == false && setting.elements.empty()) {
+                setting.elements = call.elements;
+            }
+        }
+    }
+
+    for (auto& entry : settings) {
+        const wstring& settingId { entry.first };
+        ReplayedSetting& setting { entry.second };
+        const std::size_t getSettingIndex { static_cast<std::size_t>(SimulatedOperation::GetSetting) };
+
+        // Only the settings loaded through the backend are added to it, the
+        // rest are elements of collections or inner settings of them
+        if (setting.callsNum[getSettingIndex] == 0) { continue; }
+
+        for (std::size_t i = 0; i < simulatedOperationsNum; i++) {
+            setting.behavior.latenciesUs[i] = replayedLatency(setting.latencySums[i], setting.callsNum[i], speed);
+        }
+
+        ATL::CComPtr<SimulatedSettingItem> simSetting { NULL };
+
+        if (setting.settingType == -1) {
+            // Never loaded successfully, every load fails with the recorded error
+            SimulatedFailure& failure { setting.behavior.failures[getSettingIndex] };
+            failure.skipCalls = 0;
+            failure.failEvery = 1;
+
+            simSetting = createSimulatedSetting(settingId, SettingType::Empty, NULL, setting.behavior);
+        } else if (static_cast<SettingType>(setting.settingType) == SettingType::SettingCollection) {
+            simSetting = createSimulatedCollection(settingId, setting.elements);
+            simSetting->getState().setBehavior(setting.behavior);
+        } else {
+            simSetting = createSimulatedSetting(
+                settingId, static_cast<SettingType>(setting.settingType), NULL, setting.behavior
+            );
+
+            for (const auto& value : setting.values) {
+                ATL::CComPtr<IInspectable> recordedValue { NULL };
+
+                if (createRecordedValue(value.second.first, value.second.second, recordedValue) == ERROR_SUCCESS) {
+                    simSetting->putValue(value.first, recordedValue);
+                }
+            }
+        }
+
+        rBackend.addSetting(simSetting);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT replaySession(const RecordedSession& session, double speed, ReplayResult& rResult) {
+    SimulatedSettingsBackend backend {};
+    HRESULT errCode { buildReplayBackend(session, speed, backend) };
+
+    if (errCode != ERROR_SUCCESS) {
+        return errCode;
+    }
+
+    backend.load();
+
+    SettingAPI sAPI { backend };
+    Batch batch {};
+    ReplayResult result {};
+    const auto start = std::chrono::steady_clock::now();
+
+    {
+        BatchScope scope { batch.arena };
+
+        parsePayload(session.payload, batch.actions);
+        handleBatchActions(sAPI, batch);
+        result.output = buildOutputStr(batch.results);
+    }
+
+    batch.reset();
+
+    result.durationUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    result.outputMatches = result.output == session.output;
+
+    rResult = std::move(result);
+
+    return errCode;
+}
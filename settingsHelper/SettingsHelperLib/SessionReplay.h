@@ -0,0 +1,81 @@
+/**
+ * Replay of recorded sessions over the simulated settings backend.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "SessionRecorder.h"
+#include "SimulatedSettings.h"
+
+#include <Windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  Outcome of replaying a recorded session.
+/// </summary>
+struct ReplayResult {
+    /// <summary>
+    ///  Time spent processing the payload of the session, in microseconds.
+    /// </summary>
+    std::int64_t durationUs { 0 };
+    /// <summary>
+    ///  The output produced by the replay.
+    /// </summary>
+    std::wstring output {};
+    /// <summary>
+    ///  True if the replay produced the same output as the recorded session.
+    /// </summary>
+    bool outputMatches { false };
+};
+
+/// <summary>
+///  Reads the sessions contained in a recording file, as written by 'appendRecording'.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS in case of success or one of the following error codes:
+///     - E_ACCESSDENIED if the file couldn't be opened.
+///     - E_INVALIDARG if one of the lines of the file isn't a valid session.
+/// </returns>
+HRESULT readRecording(const std::wstring& recordingPath, std::vector<RecordedSession>& rSessions);
+/// <summary>
+///  Fills a simulated backend with the settings accessed during a recorded
+///  session. For each setting:
+///     - Its type and the first value read for each value id are used as the
+///       initial state, collections hold the elements that were read.
+///     - Each operation takes the average latency recorded for it, divided by
+///       'speed'. A 'speed' of 0 removes the latencies.
+///     - The first failure recorded for each operation is injected at the same
+///       call in which it happened.
+///  Settings that were never loaded successfully fail to load with the
+///  recorded error. The inner settings of collection elements are simulated
+///  with their default values.
+/// </summary>
+/// <returns>
+///  ERROR_SUCCESS in case of success or E_INVALIDARG if 'speed' is negative.
+/// </returns>
+HRESULT buildReplayBackend(const RecordedSession& session, double speed, SimulatedSettingsBackend& rBackend);
+/// <summary>
+///  Processes the payload of a recorded session against a backend built with
+///  'buildReplayBackend', the same way 'handlePayload' does.
+/// </summary>
+/// <param name="session">The session to be replayed.</param>
+/// <param name="speed">
+///  Speed of the replay, 1 replays the recorded latencies, 2 halves them, and
+///  0 replays the session without latencies.
+/// </param>
+/// <param name="rResult">A reference to be filled with the outcome of the replay.</param>
+/// <returns>
+///  ERROR_SUCCESS in case of success or the 'buildReplayBackend' error codes.
+/// </returns>
+HRESULT replaySession(const RecordedSession& session, double speed, ReplayResult& rResult);
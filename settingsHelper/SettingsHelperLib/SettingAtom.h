@@ -0,0 +1,224 @@
+/**
+ * Interned setting identifiers.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+#include "WStringView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  Entry of the atom table, entries are never released so atoms can hold
+///  plain pointers to them.
+/// </summary>
+struct SettingAtomEntry {
+    std::wstring str;
+    std::size_t hash;
+    std::uint32_t id;
+};
+
+/// <summary>
+///  Process-wide table holding the interned setting identifiers. Lookups are
+///  performed over views, so checking if an identifier is already interned
+///  doesn't require any allocation.
+/// </summary>
+class SettingAtomTable {
+private:
+    NativeMutex tableMutex {};
+    std::vector<std::unique_ptr<SettingAtomEntry>> entries {};
+    /// <summary>
+    ///  Open addressing index over 'entries', its size is always a power of two.
+    /// </summary>
+    std::vector<const SettingAtomEntry*> index {};
+
+    static std::size_t hashOf(WStringView str) {
+        // FNV-1a
+        std::uint64_t hash { 14695981039346656037ULL };
+
+        for (wchar_t c : str) {
+            hash ^= static_cast<std::uint64_t>(c);
+            hash *= 1099511628211ULL;
+        }
+
+        return static_cast<std::size_t>(hash);
+    }
+
+    const SettingAtomEntry* findEntry(WStringView str, std::size_t hash) const {
+        if (index.empty()) { return nullptr; }
+
+        const std::size_t mask { index.size() - 1 };
+
+        for (std::size_t i = hash & mask; index[i] != nullptr; i = (i + 1) & mask) {
+            if (index[i]->hash == hash && index[i]->str == str) {
+                return index[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+    void insertIndex(const SettingAtomEntry* entry) {
+        const std::size_t mask { index.size() - 1 };
+        std::size_t i { entry->hash & mask };
+
+        while (index[i] != nullptr) {
+            i = (i + 1) & mask;
+        }
+
+        index[i] = entry;
+    }
+
+    void growIndex(std::size_t minEntries) {
+        std::size_t size { index.empty() ? 64 : index.size() };
+        while (size < minEntries * 2) { size *= 2; }
+
+        if (size == index.size()) { return; }
+
+        index.assign(size, nullptr);
+        for (const auto& entry : entries) {
+            insertIndex(entry.get());
+        }
+    }
+
+public:
+    SettingAtomTable() {}
+    SettingAtomTable(const SettingAtomTable&) = delete;
+    SettingAtomTable& operator=(const SettingAtomTable&) = delete;
+
+    /// <summary>
+    ///  Gets the process-wide atom table.
+    /// </summary>
+    static SettingAtomTable& instance() {
+        static SettingAtomTable table {};
+        return table;
+    }
+
+    /// <summary>
+    ///  Gets the entry for the supplied identifier, creating it if required.
+    /// </summary>
+    const SettingAtomEntry* intern(WStringView str) {
+        const std::size_t hash { hashOf(str) };
+        NativeLockGuard lock { tableMutex };
+
+        const SettingAtomEntry* entry { findEntry(str, hash) };
+
+        if (entry == nullptr) {
+            growIndex(entries.size() + 1);
+
+            entries.emplace_back(
+                new SettingAtomEntry { str.str(), hash, static_cast<std::uint32_t>(entries.size() + 1) }
+            );
+            entry = entries.back().get();
+            insertIndex(entry);
+        }
+
+        return entry;
+    }
+
+    /// <summary>
+    ///  Gets the entry for the supplied identifier without creating it.
+    /// </summary>
+    /// <returns>The entry, or nullptr if the identifier isn't interned.</returns>
+    const SettingAtomEntry* find(WStringView str) {
+        const std::size_t hash { hashOf(str) };
+        NativeLockGuard lock { tableMutex };
+
+        return findEntry(str, hash);
+    }
+
+    /// <summary>
+    ///  Reserves space for the supplied number of identifiers.
+    /// </summary>
+    void reserve(std::size_t count) {
+        NativeLockGuard lock { tableMutex };
+
+        entries.reserve(count);
+        growIndex(count);
+    }
+
+    /// <summary>
+    ///  Number of interned identifiers.
+    /// </summary>
+    std::size_t size() {
+        NativeLockGuard lock { tableMutex };
+        return entries.size();
+    }
+};
+
+/// <summary>
+///  Interned setting identifier. Atoms are as cheap to copy as a pointer, and
+///  they are compared and hashed in constant time. Two atoms are equal if and
+///  only if they were created from the same identifier.
+///
+///  The default constructed atom represents the empty identifier.
+/// </summary>
+class SettingAtom {
+private:
+    const SettingAtomEntry* _entry { nullptr };
+
+    explicit SettingAtom(const SettingAtomEntry* entry) : _entry(entry) {}
+
+public:
+    SettingAtom() {}
+    /// <summary>
+    ///  Interns the supplied identifier.
+    /// </summary>
+    explicit SettingAtom(WStringView str) :
+        _entry(str.empty() ? nullptr : SettingAtomTable::instance().intern(str)) {}
+    explicit SettingAtom(const std::wstring& str) : SettingAtom(WStringView { str }) {}
+    explicit SettingAtom(const wchar_t* str) : SettingAtom(WStringView { str }) {}
+
+    /// <summary>
+    ///  Gets the atom for an identifier only if it was already interned, this
+    ///  avoids growing the table with identifiers that can't match any of the
+    ///  already known ones.
+    /// </summary>
+    /// <returns>The atom, or the empty atom if the identifier isn't interned.</returns>
+    static SettingAtom lookup(WStringView str) {
+        return SettingAtom { str.empty() ? nullptr : SettingAtomTable::instance().find(str) };
+    }
+
+    /// <summary>
+    ///  The interned identifier.
+    /// </summary>
+    const std::wstring& str() const {
+        static const std::wstring emptyStr {};
+        return _entry == nullptr ? emptyStr : _entry->str;
+    }
+    /// <summary>
+    ///  A view over the interned identifier, valid for the process lifetime.
+    /// </summary>
+    WStringView view() const { return WStringView { str() }; }
+    /// <summary>
+    ///  Small integer identifying the atom, 0 for the empty atom.
+    /// </summary>
+    std::uint32_t id() const { return _entry == nullptr ? 0 : _entry->id; }
+    bool empty() const { return _entry == nullptr; }
+    std::size_t hash() const { return _entry == nullptr ? 0 : _entry->hash; }
+
+    bool operator==(const SettingAtom& other) const { return _entry == other._entry; }
+    bool operator!=(const SettingAtom& other) const { return _entry != other._entry; }
+    bool operator<(const SettingAtom& other) const { return id() < other.id(); }
+};
+
+namespace std {
+    template <>
+    struct hash<SettingAtom> {
+        std::size_t operator()(const SettingAtom& atom) const { return atom.hash(); }
+    };
+}
@@ -0,0 +1,90 @@
+/**
+ * Metadata fields of a setting that can be requested along with its value.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+///  Metadata fields of a setting, used as flags of a field set. Fields are
+///  reported in the order of their values.
+/// </summary>
+enum class SettingField : std::uint32_t {
+    Type                = 1 << 0,
+    IsEnabled           = 1 << 1,
+    IsApplicable        = 1 << 2,
+    IsSetByGroupPolicy  = 1 << 3,
+    Description         = 1 << 4
+};
+
+/// <summary>
+///  Number of values of SettingField.
+/// </summary>
+constexpr std::size_t settingFieldsNum { 5 };
+/// <summary>
+///  Set holding every SettingField, as reported by 'GetMetadata'.
+/// </summary>
+constexpr std::uint32_t allSettingFields { (1u << settingFieldsNum) - 1 };
+
+/// <summary>
+///  Static description of a SettingField.
+/// </summary>
+struct SettingFieldInfo {
+    SettingField field;
+    /// <summary>
+    ///  The name used for the field in the payloads and in the results.
+    /// </summary>
+    const wchar_t* name;
+};
+
+/// <summary>
+///  Table describing every SettingField, in the order they are reported.
+/// </summary>
+inline const SettingFieldInfo* settingFieldsTable() {
+    static const SettingFieldInfo table[settingFieldsNum] {
+        { SettingField::Type,               L"type" },
+        { SettingField::IsEnabled,          L"isEnabled" },
+        { SettingField::IsApplicable,       L"isApplicable" },
+        { SettingField::IsSetByGroupPolicy, L"isSetByGroupPolicy" },
+        { SettingField::Description,        L"description" }
+    };
+
+    return table;
+}
+
+/// <summary>
+///  Checks if a field set holds the supplied field.
+/// </summary>
+inline bool hasSettingField(std::uint32_t fields, SettingField field) {
+    return (fields & static_cast<std::uint32_t>(field)) != 0;
+}
+
+/// <summary>
+///  Adds the field with the supplied name to a field set, names are case
+///  sensitive.
+/// </summary>
+/// <returns>True if the name is known, false otherwise.</returns>
+inline bool parseSettingField(WStringView name, std::uint32_t& rFields) {
+    const SettingFieldInfo* table { settingFieldsTable() };
+
+    for (std::size_t i = 0; i < settingFieldsNum; i++) {
+        if (name == table[i].name) {
+            rFields |= static_cast<std::uint32_t>(table[i].field);
+            return true;
+        }
+    }
+
+    return false;
+}
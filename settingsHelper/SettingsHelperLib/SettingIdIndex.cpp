@@ -0,0 +1,182 @@
+/**
+ * Radix index over the registered setting ids, expanding setting selectors.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SettingIdIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+using std::unique_ptr;
+using std::vector;
+using std::wstring;
+
+namespace {
+    std::size_t commonPrefix(WStringView a, WStringView b) {
+        const std::size_t size { (std::min)(a.size(), b.size()) };
+        std::size_t i { 0 };
+
+        while (i < size && a[i] == b[i]) { i++; }
+
+        return i;
+    }
+
+    std::size_t firstWildcard(WStringView str) {
+        for (std::size_t i = 0; i < str.size(); i++) {
+            if (str[i] == L'*' || str[i] == L'?') { return i; }
+        }
+
+        return str.size();
+    }
+}
+
+bool isSettingSelector(WStringView settingId) {
+    return firstWildcard(settingId) != settingId.size();
+}
+
+bool matchesSelector(WStringView selector, WStringView settingId) {
+    std::size_t s { 0 };
+    std::size_t i { 0 };
+    // Where the last '*' was found, and the id position it's matching up to
+    std::size_t starPos { selector.size() };
+    std::size_t starMatch { 0 };
+
+    while (i < settingId.size()) {
+        if (s < selector.size() && (selector[s] == L'?' || selector[s] == settingId[i])) {
+            s++;
+            i++;
+        } else if (s < selector.size() && selector[s] == L'*') {
+            starPos = s++;
+            starMatch = i;
+        } else if (starPos != selector.size()) {
+            // Let the last '*' take one more character
+            s = starPos + 1;
+            i = ++starMatch;
+        } else {
+            return false;
+        }
+    }
+
+    while (s < selector.size() && selector[s] == L'*') { s++; }
+
+    return s == selector.size();
+}
+
+std::size_t SettingIdIndex::childPos(const Node& node, wchar_t c) {
+    const auto pos = std::lower_bound(
+        node.children.begin(), node.children.end(), c,
+        [](const unique_ptr<Node>& child, wchar_t first) { return child->label.front() < first; }
+    );
+
+    return static_cast<std::size_t>(pos - node.children.begin());
+}
+
+void SettingIdIndex::collect(const Node& node, wstring& rPath, vector<wstring>& rIds) {
+    if (node.terminal) {
+        rIds.push_back(rPath);
+    }
+
+    for (const auto& child : node.children) {
+        const std::size_t pathSize { rPath.size() };
+
+        rPath.append(child->label);
+        collect(*child, rPath, rIds);
+        rPath.resize(pathSize);
+    }
+}
+
+void SettingIdIndex::add(WStringView settingId) {
+    Node* node { &root };
+    WStringView rest { settingId };
+
+    if (rest.empty()) { return; }
+
+    while (rest.empty() == false) {
+        const std::size_t pos { childPos(*node, rest[0]) };
+
+        if (pos == node->children.size() || node->children[pos]->label.front() != rest[0]) {
+            unique_ptr<Node> leaf { new Node {} };
+            leaf->label = rest.str();
+            leaf->terminal = true;
+            node->children.insert(node->children.begin() + pos, std::move(leaf));
+            idsNum++;
+
+            return;
+        }
+
+        Node* child { node->children[pos].get() };
+        const std::size_t common { commonPrefix(WStringView { child->label }, rest) };
+
+        // The id diverges inside the edge, which is split at that point
+        if (common < child->label.size()) {
+            unique_ptr<Node> split { new Node {} };
+            split->label = child->label.substr(0, common);
+            child->label.erase(0, common);
+            split->children.push_back(std::move(node->children[pos]));
+            node->children[pos] = std::move(split);
+            child = node->children[pos].get();
+        }
+
+        node = child;
+        rest = rest.substr(common);
+    }
+
+    if (node->terminal == false) {
+        node->terminal = true;
+        idsNum++;
+    }
+}
+
+void SettingIdIndex::clear() {
+    root.children.clear();
+    idsNum = 0;
+}
+
+void SettingIdIndex::findPrefix(WStringView prefix, vector<wstring>& rIds) const {
+    const Node* node { &root };
+    WStringView rest { prefix };
+    wstring path {};
+
+    while (rest.empty() == false) {
+        const std::size_t pos { childPos(*node, rest[0]) };
+        if (pos == node->children.size() || node->children[pos]->label.front() != rest[0]) { return; }
+
+        const Node* child { node->children[pos].get() };
+        const std::size_t common { commonPrefix(WStringView { child->label }, rest) };
+
+        // The prefix either ends inside the edge, or has to follow it entirely
+        if (common < rest.size() && common < child->label.size()) { return; }
+
+        path.append(child->label);
+        node = child;
+        rest = rest.substr(common);
+    }
+
+    collect(*node, path, rIds);
+}
+
+void SettingIdIndex::expand(WStringView selector, vector<wstring>& rIds) const {
+    const std::size_t wildcard { firstWildcard(selector) };
+    const WStringView prefix { selector.substr(0, wildcard) };
+
+    vector<wstring> candidates {};
+    findPrefix(prefix, candidates);
+
+    // A trailing '*' selects every id below the prefix
+    const bool prefixOnly { wildcard + 1 == selector.size() && selector[wildcard] == L'*' };
+
+    for (auto& candidate : candidates) {
+        if (prefixOnly || matchesSelector(selector, WStringView { candidate })) {
+            rIds.push_back(std::move(candidate));
+        }
+    }
+}
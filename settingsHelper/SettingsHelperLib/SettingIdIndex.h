@@ -0,0 +1,83 @@
+/**
+ * Radix index over the registered setting ids, expanding setting selectors.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  Checks if a setting id is a selector, holding a '*' matching any run of
+///  characters or a '?' matching a single one.
+/// </summary>
+bool isSettingSelector(WStringView settingId);
+/// <summary>
+///  Checks if a setting id matches a selector, the whole id must match.
+/// </summary>
+bool matchesSelector(WStringView selector, WStringView settingId);
+
+/// <summary>
+///  Radix tree over setting ids, used to expand the selectors of a payload
+///  without comparing them against every registered id. Edges hold the runs
+///  of characters shared by the ids below them, and the children of a node are
+///  sorted by their first character, so the ids are found in order.
+/// </summary>
+class SettingIdIndex {
+private:
+    struct Node {
+        std::wstring label {};
+        bool terminal { false };
+        std::vector<std::unique_ptr<Node>> children {};
+    };
+
+    Node root {};
+    std::size_t idsNum { 0 };
+
+    /// <summary>
+    ///  Gets the position of the child of a node whose label starts with the
+    ///  supplied character, or where it should be inserted.
+    /// </summary>
+    static std::size_t childPos(const Node& node, wchar_t c);
+    /// <summary>
+    ///  Appends the ids held below a node, whose path is 'rPath', in order.
+    /// </summary>
+    static void collect(const Node& node, std::wstring& rPath, std::vector<std::wstring>& rIds);
+
+public:
+    SettingIdIndex() {}
+    SettingIdIndex(const SettingIdIndex&) = delete;
+    SettingIdIndex& operator=(const SettingIdIndex&) = delete;
+
+    std::size_t size() const { return idsNum; }
+
+    /// <summary>
+    ///  Adds a setting id, ids already present and empty ids are ignored.
+    /// </summary>
+    void add(WStringView settingId);
+    /// <summary>
+    ///  Removes every id.
+    /// </summary>
+    void clear();
+    /// <summary>
+    ///  Appends the ids starting with the supplied prefix, in order.
+    /// </summary>
+    void findPrefix(WStringView prefix, std::vector<std::wstring>& rIds) const;
+    /// <summary>
+    ///  Appends the ids matching a selector, in order. Only the ids below the
+    ///  characters preceding its first wildcard are compared with it.
+    /// </summary>
+    void expand(WStringView selector, std::vector<std::wstring>& rIds) const;
+};
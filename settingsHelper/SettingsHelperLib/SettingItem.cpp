@@ -15,6 +15,9 @@
 #include "ISettingsCollection.h"
 #include "SettingItemEventHandler.h"
 #include "DynamicSettingsDatabase.h"
+#include "BatchDeadline.h"
+#include "SettingsStats.h"
+#include "Tracer.h"
 
 #include <memory>
 #include <atlbase.h>
@@ -41,29 +44,74 @@ using std::pair;
 SettingItem::SettingItem() : BaseSettingItem::BaseSettingItem() {};
 
 SettingItem::SettingItem(
-    wstring settingId, ATL::CComPtr<ISettingItem> settingItem, vector<SettingItem> assocSettings
-) : BaseSettingItem::BaseSettingItem(settingId, settingItem), assocSettings(assocSettings) {}
+    SettingAtom settingId, ATL::CComPtr<ISettingItem> settingItem, vector<SettingItem> assocSettings
+) : BaseSettingItem::BaseSettingItem(settingId, settingItem) {
+    if (!assocSettings.empty()) {
+        this->sharedState().assocSettings = std::move(assocSettings);
+    }
+}
 
 SettingItem::SettingItem(
-    wstring parentId, wstring settingId, ATL::CComPtr<ISettingItem> settingItem
-) : BaseSettingItem::BaseSettingItem(settingId, settingItem), parentId(parentId) {}
+    SettingAtom parentId, std::wstring elementId, ATL::CComPtr<ISettingItem> settingItem
+) : BaseSettingItem::BaseSettingItem(SettingAtom {}, settingItem), parentId(parentId) {
+    this->elementId = std::move(elementId);
+}
+
+SettingItem::SettingItem(const SettingItem & other) : BaseSettingItem::BaseSettingItem(other) {
+    this->parentId = other.parentId;
+    this->state = other.state;
+}
 
-SettingItem::SettingItem(const SettingItem & other) {
+SettingItem::SettingItem(SettingItem&& other) : BaseSettingItem::BaseSettingItem(std::move(other)) {
     this->parentId = other.parentId;
-    this->setting = other.setting;
-    this->settingId = other.settingId;
-    this->assocSettings = other.assocSettings;
+    this->state = std::move(other.state);
 }
 
 SettingItem& SettingItem::operator=(const SettingItem& other) {
+    BaseSettingItem::operator=(other);
+    this->parentId = other.parentId;
+    this->state = other.state;
+
+    return *this;
+}
+
+SettingItem& SettingItem::operator=(SettingItem&& other) {
+    BaseSettingItem::operator=(std::move(other));
     this->parentId = other.parentId;
-    this->setting = other.setting;
-    this->settingId = other.settingId;
-    this->assocSettings = other.assocSettings;
+    this->state = std::move(other.state);
 
     return *this;
 }
 
+SettingItem::SharedState& SettingItem::sharedState() {
+    if (this->state == nullptr) {
+        this->state = std::make_shared<SharedState>();
+    }
+
+    return *this->state;
+}
+
+const vector<SettingItem>& SettingItem::assocSettings() const {
+    static const vector<SettingItem> emptySettings {};
+    return this->state == nullptr ? emptySettings : this->state->assocSettings;
+}
+
+HRESULT SettingItem::loadDbSettings(const SettingAtom& dbId) {
+    HRESULT errCode { ERROR_SUCCESS };
+    vector<DbSettingItem>& dbSettings { this->sharedState().dbSettings };
+
+    if (dbSettings.empty()) {
+        DynamicSettingDatabase dynSettingDb {};
+        errCode = loadSettingDatabase(dbId, *this, dynSettingDb);
+
+        if (errCode == ERROR_SUCCESS) {
+            errCode = dynSettingDb.GetDatabaseSettings(dbSettings);
+        }
+    }
+
+    return errCode;
+}
+
 UINT SettingItem::GetValue(wstring id, ATL::CComPtr<IInspectable>& item) {
     if (this->setting == NULL) { return ERROR_INVALID_HANDLE_STATE; };
     if (id.empty()) { return E_INVALIDARG; };
@@ -85,7 +133,7 @@ UINT SettingItem::GetValue(wstring id, ATL::CComPtr<IInspectable>& item) {
     } else {
         // Access one of the inner Settings inside the
         // DynamicSettingDatabase hold inside the setting.
-        wstring settingId {};
+        SettingAtom settingId {};
         if (isSupportedDb(this->parentId)) {
             settingId = this->parentId;
         } else {
@@ -93,18 +141,14 @@ UINT SettingItem::GetValue(wstring id, ATL::CComPtr<IInspectable>& item) {
         }
 
         if (isSupportedDb(settingId)) {
-            if (this->dbSettings.empty()) {
-                DynamicSettingDatabase dynSettingDb {};
-                errCode = loadSettingDatabase(settingId, *this, dynSettingDb);
-
-                if (errCode == ERROR_SUCCESS) {
-                    errCode = dynSettingDb.GetDatabaseSettings(this->dbSettings);
-                }
-            }
+            errCode = loadDbSettings(settingId);
 
             if (errCode == ERROR_SUCCESS) {
-                for (auto& setting : this->dbSettings) {
-                    if (id == setting.settingId) {
+                // Inner settings ids are interned when the database is loaded
+                const SettingAtom idAtom { SettingAtom::lookup(id) };
+
+                for (auto& setting : this->state->dbSettings) {
+                    if (idAtom == setting.settingId) {
                         errCode = setting.GetValue(L"Value", _item);
                         break;
                     }
@@ -130,6 +174,8 @@ cleanup:
 }
 
 HRESULT SettingItem::_SetValue(DbSettingItem& dbSetting, ATL::CComPtr<IPropertyValue>& item) {
+    TraceScope trace { "_SetValue", "settingID", this->idView() };
+
     HRESULT errCode { ERROR_SUCCESS };
     BOOL completed { false };
     BOOL isUpdating { true };
@@ -147,16 +193,24 @@ HRESULT SettingItem::_SetValue(DbSettingItem& dbSetting, ATL::CComPtr<IPropertyV
     errCode = this->setting->add_SettingChanged(handler, &token);
 
     if (errCode == ERROR_SUCCESS) {
-        if (setInnerSetting) {
-            errCode = dbSetting.SetValue(L"Value", item);
-        } else {
-            errCode = BaseSettingItem::SetValue(L"Value", item);
+        {
+            TraceScope setTrace { "SetValue" };
+
+            if (setInnerSetting) {
+                errCode = dbSetting.SetValue(L"Value", item);
+            } else {
+                errCode = BaseSettingItem::SetValue(L"Value", item);
+            }
         }
 
         if (errCode == ERROR_SUCCESS) {
+            TraceScope waitTrace { "SetValueWait" };
+            StatsScope waitStats { StatsPhase::Wait, this->idView() };
+            // The wait is cut short to what's left of the batch deadline
+            const UINT maxIt { boundPolls(this->maxIt, 100) };
             UINT it = 0;
             while (completed != TRUE && isUpdating || innerUpdating) {
-                if (it < this->maxIt) {
+                if (it < maxIt) {
                     this->setting->get_IsUpdating(&isUpdating);
                     if (setInnerSetting) {
                         dbSetting.GetIsUpdating(&innerUpdating);
@@ -167,6 +221,7 @@ HRESULT SettingItem::_SetValue(DbSettingItem& dbSetting, ATL::CComPtr<IPropertyV
                 } else {
                     completed = true;
                     errCode = ERROR_TIMEOUT;
+                    SettingsStats::instance().increment(StatsCounter::Timeouts);
                 }
             }
         }
@@ -187,7 +242,7 @@ HRESULT SettingItem::SetValue(const wstring& id, ATL::CComPtr<IPropertyValue>& i
     } else {
         // Access one of the inner Settings inside the DynamicSettingDatabase
         // holded inside the setting.
-        wstring settingId {};
+        SettingAtom settingId {};
         if (isSupportedDb(this->parentId)) {
             settingId = this->parentId;
         } else {
@@ -197,18 +252,13 @@ HRESULT SettingItem::SetValue(const wstring& id, ATL::CComPtr<IPropertyValue>& i
         if (isSupportedDb(settingId)) {
             BOOL applied { false };
 
-            if (this->dbSettings.empty()) {
-                DynamicSettingDatabase dynSettingDb {};
-                errCode = loadSettingDatabase(settingId, *this, dynSettingDb);
-
-                if (errCode == ERROR_SUCCESS) {
-                    errCode = dynSettingDb.GetDatabaseSettings(this->dbSettings);
-                }
-            }
+            errCode = loadDbSettings(settingId);
 
             if (errCode == ERROR_SUCCESS) {
-                for (auto& setting : this->dbSettings) {
-                    if (id == setting.settingId) {
+                const SettingAtom idAtom { SettingAtom::lookup(id) };
+
+                for (auto& setting : this->state->dbSettings) {
+                    if (idAtom == setting.settingId) {
                         errCode = SettingItem::_SetValue(setting, item);
                         applied = TRUE;
                         break;
@@ -19,6 +19,7 @@
 #include <windows.foundation.h>
 #include <windows.foundation.collections.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
@@ -30,63 +31,106 @@ using std::pair;
 using namespace ABI::Windows::Foundation;
 using namespace ABI::Windows::Foundation::Collections;
 
+/// <summary>
+///  Handle to a setting. Copying a SettingItem is cheap, the id is an atom, the
+///  inner setting is reference counted by COM, and the lazily loaded resources
+///  are shared between all the copies of the same handle.
+/// </summary>
 struct SettingItem : BaseSettingItem {
 private:
+    /// <summary>
+    ///  State shared between the copies of a SettingItem.
+    /// </summary>
+    struct SharedState {
+        /// <summary>
+        ///  Lazy vector with DBSettingItems supported by the
+        ///  setting. This vector will be filled the first time this
+        ///  settings are requested.
+        /// </summary>
+        vector<DbSettingItem> dbSettings {};
+        /// <summary>
+        ///  Resources that needs to be loaded for the setting to be accessed.
+        /// </summary>
+        vector<SettingItem> assocSettings {};
+    };
+
     /// <summary>
     ///  Maximum number of times the delay for Getting/Setting
     ///  a setting value is waited.
     /// </summary>
     UINT maxIt { 10 };
     /// <summary>
-    ///  Lazy vector with DBSettingItems supported by the
-    ///  setting. This vector will be filled the first time this
-    ///  settings are requested.
-    /// </summary>
-    vector<DbSettingItem> dbSettings {};
-    /// <summary>
     ///  This id specifies the parent setting of the current setting.
     ///  This id is specially useful in situations where the setting
     ///  is a setting from a Collection, in this case, we want
     ///  to specify this Id as a way to know if we support accesing
     ///  the inner db settings of this particular setting.
     /// </summary>
-    wstring parentId {};
+    SettingAtom parentId {};
+    /// <summary>
+    ///  Shared state, it's only allocated when the setting needs it, so
+    ///  plain settings, like the elements of a collection, don't allocate.
+    /// </summary>
+    std::shared_ptr<SharedState> state { nullptr };
+    /// <summary>
+    ///  Gets the shared state, allocating it if required.
+    /// </summary>
+    SharedState& sharedState();
     /// <summary>
     ///  Private helper method encapsulating the waiting logic
     ///  necessary for properly set a new setting a new value.
     /// </summary>
     HRESULT _SetValue(DbSettingItem& dbSetting, ATL::CComPtr<IPropertyValue>& item);
+    /// <summary>
+    ///  Loads the inner settings of the DynamicSettingDatabase holded by the
+    ///  setting, if they aren't already loaded.
+    /// </summary>
+    HRESULT loadDbSettings(const SettingAtom& dbId);
 
 public:
     using BaseSettingItem::BaseSettingItem;
 
-    /// <summary>
-    ///  Resources that needs to be loaded for the setting to be accessed.
-    /// </summary>
-    vector<SettingItem> assocSettings {};
-
     /// <summary>
     /// Default constructor
     /// </summary>
     SettingItem();
 
-    SettingItem(wstring parentId, wstring settingId, ATL::CComPtr<ISettingItem> settingItem);
+    /// <summary>
+    ///  Constructs a SettingItem for an element of a collection.
+    /// </summary>
+    /// <param name="parentId">The id of the collection holding the element.</param>
+    /// <param name="elementId">The id of the element.</param>
+    /// <param name="settingItem">The element.</param>
+    SettingItem(SettingAtom parentId, std::wstring elementId, ATL::CComPtr<ISettingItem> settingItem);
     /// <summary>
     ///  Constructs a SettingItem with the loaded required settings that it needs to work.
     /// </summary>
     /// <param name="settingId"></param>
     /// <param name="settingItem"></param>
     /// <param name="assocSettings"></param>
-    SettingItem(wstring settingId, ATL::CComPtr<ISettingItem> settingItem, vector<SettingItem> assocSettings);
+    SettingItem(SettingAtom settingId, ATL::CComPtr<ISettingItem> settingItem, vector<SettingItem> assocSettings);
     /// <summary>
-    ///  Copy constructor.
+    ///  Copy constructor, the copy shares the state of 'other'.
     /// </summary>
     /// <param name="other">The setting item to be copied.</param>
     SettingItem(const SettingItem& other);
     /// <summary>
+    ///  Move constructor.
+    /// </summary>
+    SettingItem(SettingItem&& other);
+    /// <summary>
     ///  Copy assignment operator.
     /// </summary>
     SettingItem& operator=(const SettingItem& other);
+    /// <summary>
+    ///  Move assignment operator.
+    /// </summary>
+    SettingItem& operator=(SettingItem&& other);
+
+    /// <summary>
+    ///  Resources that needs to be loaded for the setting to be accessed.
+    /// </summary>
+    const vector<SettingItem>& assocSettings() const;
 
     /// <summary>
     ///  Gets the value of the current stored setting that matches with the supplied
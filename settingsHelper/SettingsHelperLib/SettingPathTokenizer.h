@@ -0,0 +1,131 @@
+/**
+ * Tokenizer for setting paths.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstddef>
+
+/// <summary>
+///  Splits a setting path like 'BaseSettingId.InnerSettingId' into its segments
+///  without allocating any memory. The returned segments are views into the
+///  supplied path, so escape sequences are kept as they appear in it.
+///
+///  A delimiter is considered escaped when it's preceded by an odd number of
+///  consecutive escape characters, so in 'A\\.B' the delimiter splits the path,
+///  while in 'A\.B' it doesn't.
+///
+///  The number of segments returned for a path is always the number of
+///  unescaped delimiters plus one, i.e: an empty path yields one empty segment,
+///  and leading or trailing delimiters yield empty segments.
+/// </summary>
+class SettingPathTokenizer {
+private:
+    WStringView path {};
+    wchar_t delim { L'.' };
+    wchar_t esc { L'\\' };
+    std::size_t pos { 0 };
+    bool finished { false };
+
+public:
+    /// <summary>
+    ///  Constructs a tokenizer over the supplied path.
+    /// </summary>
+    /// <param name="path">The path to be tokenized, it must outlive the tokenizer.</param>
+    /// <param name="delim">The character separating the segments.</param>
+    /// <param name="esc">The character used to escape the delimiter.</param>
+    SettingPathTokenizer(WStringView path, wchar_t delim = L'.', wchar_t esc = L'\\') :
+        path(path), delim(delim), esc(esc) {}
+
+    /// <summary>
+    ///  Gets the next segment of the path.
+    /// </summary>
+    /// <param name="rSegment">A reference to the view to be filled with the next segment.</param>
+    /// <returns>True if a segment was returned, false if the path was exhausted.</returns>
+    bool next(WStringView& rSegment) {
+        if (finished) { return false; }
+
+        const std::size_t start { pos };
+        bool escaped { false };
+
+        for (std::size_t i = start; i < path.size(); i++) {
+            const wchar_t c { path[i] };
+
+            if (escaped) {
+                escaped = false;
+            } else if (c == esc) {
+                escaped = true;
+            } else if (c == delim) {
+                rSegment = path.substr(start, i - start);
+                pos = i + 1;
+
+                return true;
+            }
+        }
+
+        rSegment = path.substr(start);
+        pos = path.size();
+        finished = true;
+
+        return true;
+    }
+
+    /// <summary>
+    ///  Checks if all the segments of the path have been returned.
+    /// </summary>
+    bool done() const { return finished; }
+};
+
+/// <summary>
+///  Fixed capacity sequence of segments of a setting path.
+/// </summary>
+/// <typeparam name="N">The maximum number of segments that can be held.</typeparam>
+template <std::size_t N>
+struct SettingPathSegments {
+    WStringView segments[N] {};
+    std::size_t count { 0 };
+
+    const WStringView& operator[](std::size_t i) const { return segments[i]; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const WStringView* begin() const { return segments; }
+    const WStringView* end() const { return segments + count; }
+};
+
+/// <summary>
+///  Tokenizes a setting path into a fixed capacity sequence of segments.
+/// </summary>
+/// <param name="path">The path to be tokenized.</param>
+/// <param name="rSegments">The sequence to be filled with the path segments.</param>
+/// <returns>
+///  False if the path holds more segments than the sequence capacity, or if
+///  any of the segments is empty, true otherwise.
+/// </returns>
+template <std::size_t N>
+bool tokenizeSettingPath(WStringView path, SettingPathSegments<N>& rSegments) {
+    SettingPathTokenizer tokenizer { path };
+    SettingPathSegments<N> segments {};
+    WStringView segment {};
+
+    while (tokenizer.next(segment)) {
+        if (segments.count == N || segment.empty()) {
+            return false;
+        }
+
+        segments.segments[segments.count++] = segment;
+    }
+
+    rSegments = segments;
+
+    return true;
+}
@@ -16,10 +16,17 @@
 #include "SettingUtils.h"
 #include "StringConversion.h"
 #include "DynamicSettingsDatabase.h"
+#include "SettingPathTokenizer.h"
+#include "BatchDeadline.h"
+#include "SettingsStats.h"
+#include "Tracer.h"
+#include "VolumeNativeHandler.h"
 
+#include <ctime>
 #include <iterator>
 #include <errno.h>
 #include <string>
+#include <unordered_set>
 
 #include <CoreWindow.h>
 
@@ -38,26 +45,28 @@ typedef int(*GetSettingFunc)(HSTRING, ISettingItem**, UINT32);
 //      SettingAPI Helper Functions
 // -----------------------------------------
 
-BOOL isFaultySetting(const wstring& settingId) {
-    const auto& pos =
-        std::find(
-            std::begin(constants::KnownFaultySettings()),
-            std::end(constants::KnownFaultySettings()),
-            settingId
-        );
+std::unordered_set<SettingAtom> internAll(const vector<wstring>& ids) {
+    std::unordered_set<SettingAtom> atoms {};
+
+    for (const auto& id : ids) {
+        atoms.insert(SettingAtom { id });
+    }
 
-    return pos != std::end(constants::KnownFaultySettings());
+    return atoms;
 }
 
-BOOL isFaultyLib(const wstring& libPath) {
-    const auto& pos =
-        std::find(
-            std::begin(constants::KnownFaultyLibs()),
-            std::end(constants::KnownFaultyLibs()),
-            libPath
-        );
+BOOL isFaultySetting(const SettingAtom& settingId) {
+    static const std::unordered_set<SettingAtom> faultySettings =
+        internAll(constants::KnownFaultySettings());
+
+    return faultySettings.find(settingId) != faultySettings.end();
+}
+
+BOOL isFaultyLib(const SettingAtom& libPath) {
+    static const std::unordered_set<SettingAtom> faultyLibs =
+        internAll(constants::KnownFaultyLibs());
 
-    return pos != std::end(constants::KnownFaultyLibs());
+    return faultyLibs.find(libPath) != faultyLibs.end();
 }
 
 HRESULT getRegSubKeys(const HKEY& hKey, vector<wstring>& rKeys) {
@@ -226,6 +235,48 @@ HRESULT toString(const ATL::CComPtr<IPropertyValue>& propValue, wstring& rValueS
     return res;
 }
 
+void recordValue(RecordScope& record, ISettingItem* setting, IInspectable* value) {
+    if (record.isRecording() == false || value == NULL) { return; }
+
+    SettingType type { SettingType::Empty };
+    if (setting != NULL) {
+        setting->get_SettingType(&type);
+    }
+
+    if (type == SettingType::SettingCollection) {
+        IVector<IInspectable*>* pVector { static_cast<IVector<IInspectable*>*>(value) };
+        vector<wstring> elements {};
+        UINT32 vectorSize { 0 };
+
+        if (pVector->get_Size(&vectorSize) == ERROR_SUCCESS) {
+            for (UINT32 i = 0; i < vectorSize; i++) {
+                ATL::CComPtr<ISettingItem> pElem { NULL };
+                HSTRING hElemId { NULL };
+
+                if (pVector->GetAt(i, reinterpret_cast<IInspectable**>(&pElem)) == ERROR_SUCCESS &&
+                    pElem->get_Id(&hElemId) == ERROR_SUCCESS) {
+                    UINT32 length { 0 };
+                    elements.emplace_back(WindowsGetStringRawBuffer(hElemId, &length), length);
+                }
+
+                WindowsDeleteString(hElemId);
+            }
+        }
+
+        record.setElements(std::move(elements));
+    } else {
+        ATL::CComPtr<IPropertyValue> propValue { NULL };
+        PropertyType valueType { PropertyType::PropertyType_Empty };
+        wstring valueStr {};
+
+        if (value->QueryInterface(__uuidof(IPropertyValue), reinterpret_cast<void**>(&propValue)) == S_OK &&
+            propValue->get_Type(&valueType) == ERROR_SUCCESS &&
+            toString(propValue, valueStr) == ERROR_SUCCESS) {
+            record.setValue(static_cast<std::int32_t>(valueType), std::move(valueStr));
+        }
+    }
+}
+
 LONG getStringRegKey(HKEY hKey, const std::wstring &strValueName, std::wstring &strValue) {
     WCHAR szBuffer[512];
     DWORD dwBufferSize = sizeof(szBuffer);
@@ -239,21 +290,15 @@ LONG getStringRegKey(HKEY hKey, const std::wstring &strValueName, std::wstring &
 }
 
 vector<wstring> split(const wstring& str, const wstring& delim, const wstring& esc_sec) {
-    vector<wstring> tokens {};
-    size_t s_offset = 0, v_offset = 0, pos = 0, delimSize = delim.size();
-    size_t esc_pos = 0;
+    if (delim.empty()) { return { str }; }
 
-    while (pos != wstring::npos) {
-        pos = str.find(delim, s_offset);
-        if (esc_pos != wstring::npos) {
-            esc_pos = str.find(esc_sec, s_offset);
-        }
-        s_offset = pos + delimSize;
+    vector<wstring> tokens {};
+    wchar_t esc { esc_sec.empty() ? L'\0' : esc_sec.front() };
+    SettingPathTokenizer tokenizer { str, delim.front(), esc };
+    WStringView token {};
 
-        if (esc_pos != (pos - 1)) {
-            tokens.push_back(str.substr(v_offset, pos - v_offset));
-            v_offset = s_offset;
-        }
+    while (tokenizer.next(token)) {
+        tokens.push_back(token.str());
     }
 
     return tokens;
@@ -262,21 +307,19 @@ vector<wstring> split(const wstring& str, const wstring& delim, const wstring& e
 HRESULT splitSettingPath(const wstring& settingPath, vector<wstring>& rIdsPath) {
     if (settingPath.empty()) { return E_INVALIDARG; }
 
-    HRESULT res = ERROR_SUCCESS;
-
-    vector<wstring> idsPath = split(settingPath, wstring{ L'.' }, wstring{ L'\\' });
+    vector<wstring> idsPath {};
+    SettingPathTokenizer tokenizer { settingPath };
+    WStringView id {};
 
-    auto frontEmpty = idsPath.front().empty();
-    auto backEmpty = idsPath.back().empty();
+    while (tokenizer.next(id)) {
+        if (id.empty()) { return E_INVALIDARG; }
 
-    if (idsPath.empty() || frontEmpty || backEmpty) {
-        res = E_INVALIDARG;
-    } else {
-        res = ERROR_SUCCESS;
-        rIdsPath = idsPath;
+        idsPath.push_back(id.str());
     }
 
-    return res;
+    rIdsPath = std::move(idsPath);
+
+    return ERROR_SUCCESS;
 }
 
 HRESULT getSettingDLL(const std::wstring& settingId, std::wstring& settingDLL) {
@@ -291,6 +334,7 @@ HRESULT getSettingDLL(const std::wstring& settingId, std::wstring& settingDLL) {
 
         if (lRes == ERROR_SUCCESS) {
             result = getStringRegKey(hKey, L"DllPath", settingDLL);
+            RegCloseKey(hKey);
         } else {
             result = ERROR_OPEN_FAILED;
         }
@@ -299,6 +343,64 @@ HRESULT getSettingDLL(const std::wstring& settingId, std::wstring& settingDLL) {
     return result;
 }
 
+HRESULT getRegisteredSettingIds(vector<wstring>& rSettingIds) {
+    HKEY hKey { NULL };
+    LONG lRes = RegOpenKeyExW(HKEY_LOCAL_MACHINE, constants::BaseRegPath().c_str(), 0, KEY_READ, &hKey);
+
+    if (lRes != ERROR_SUCCESS) {
+        return ERROR_OPEN_FAILED;
+    }
+
+    getRegSubKeys(hKey, rSettingIds);
+    RegCloseKey(hKey);
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT seedSettingAtoms() {
+    vector<wstring> settingIds {};
+    const HRESULT res { getRegisteredSettingIds(settingIds) };
+
+    if (res != ERROR_SUCCESS) {
+        return res;
+    }
+
+    SettingAtomTable& atomTable { SettingAtomTable::instance() };
+    atomTable.reserve(settingIds.size());
+
+    for (const auto& settingId : settingIds) {
+        atomTable.intern(settingId);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+wstring getOsBuild() {
+    HKEY hKey { NULL };
+    LONG lRes = RegOpenKeyExW(
+        HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion", 0, KEY_READ, &hKey
+    );
+
+    if (lRes != ERROR_SUCCESS) {
+        return wstring {};
+    }
+
+    wstring build {};
+    getStringRegKey(hKey, L"CurrentBuildNumber", build);
+
+    // The update revision changes the settings libraries too
+    DWORD revision { 0 };
+    DWORD revisionSize { sizeof(revision) };
+    lRes = RegQueryValueExW(hKey, L"UBR", NULL, NULL, reinterpret_cast<LPBYTE>(&revision), &revisionSize);
+    RegCloseKey(hKey);
+
+    if (build.empty() == false && lRes == ERROR_SUCCESS) {
+        build.append(L".").append(std::to_wstring(revision));
+    }
+
+    return build;
+}
+
 BOOL checkEmptyIds(const vector<wstring>& ids) {
     BOOL empty { false };
 
@@ -313,93 +415,76 @@ BOOL checkEmptyIds(const vector<wstring>& ids) {
 }
 
 // -----------------------------------------------------------------------------
-//                        SettingAPI Functions
+//                        SystemSettingsBackend Functions
 // -----------------------------------------------------------------------------
 
 //  ---------------------------  Private  --------------------------------------
 
-SettingAPI& LoadSettingAPI(HRESULT& rErrCode) {
-    static SettingAPI sAPI {};
-    HRESULT errCode { ERROR_SUCCESS };
+BOOL SystemSettingsBackend::isLibraryLoaded(const SettingAtom& libraryPath) {
+    return this->loadLibraries.find(libraryPath) != this->loadLibraries.end();
+}
 
-    if (sAPI.baseLibrary == NULL) {
-        CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
-        HMODULE baseLibrary { LoadLibrary(L"C:\\Windows\\System32\\SettingsHandlers_nt.dll") };
+HRESULT SystemSettingsBackend::getLoadedLibrary(const SettingAtom& libPath, HMODULE& rLib) {
+    HRESULT errCode { ERROR_SUCCESS };
+    const auto& libEntry = this->loadLibraries.find(libPath);
 
-        if (baseLibrary != NULL) {
-            sAPI.baseLibrary = baseLibrary;
-        } else {
-            errCode = ERROR_ASSERTION_FAILURE;
-        }
+    if (libEntry != this->loadLibraries.end()) {
+        rLib = libEntry->second;
     } else {
+        errCode = ERROR_NOT_FOUND;
     }
 
-    rErrCode = errCode;
-
-    return sAPI;
+    return errCode;
 }
 
-HRESULT UnloadSettingsAPI(SettingAPI& sAPI) {
-    CoFreeUnusedLibrariesEx(0, NULL);
-    CoUninitialize();
+HRESULT SystemSettingsBackend::getSettingLibrary(const SettingAtom& settingId, SettingAtom& rLibPath) {
+    // Ids missing from the atom table aren't registered, there's no library to query
+    if (settingId.empty()) { return ERROR_OPEN_FAILED; }
 
-    return ERROR_SUCCESS;
-}
+    HRESULT res { ERROR_SUCCESS };
+    const auto& cachedLib = this->settingLibs.find(settingId);
 
-SettingAPI::SettingAPI() {}
+    if (cachedLib != this->settingLibs.end()) {
+        rLibPath = cachedLib->second;
+    } else {
+        TraceScope trace { "getSettingDLL", "settingID", settingId.view() };
 
-BOOL SettingAPI::isLibraryLoaded(wstring libraryPath) {
-    BOOL res { false };
+        wstring settingDLL { L"" };
+        res = getSettingDLL(settingId.str(), settingDLL);
 
-    for (const auto& library : this->loadLibraries) {
-        if (library.first == libraryPath) {
-            res = true;
-            break;
+        if (res == ERROR_SUCCESS) {
+            rLibPath = SettingAtom { settingDLL };
+            this->settingLibs.insert({ settingId, rLibPath });
         }
     }
 
     return res;
 }
 
-HRESULT SettingAPI::getLoadedLibrary(const wstring& libPath, HMODULE& rLib) {
-    HRESULT errCode { ERROR_SUCCESS };
-    BOOL found { false };
-    HMODULE lib { NULL };
-
-    for (const auto& libEntry : this->loadLibraries) {
-        if (libEntry.first == libPath) {
-            lib = libEntry.second;
-            found = true;
-
-            break;
-        }
-    }
-
-    if (found) {
-        rLib = lib;
-    } else {
-        errCode = ERROR_NOT_FOUND;
-    }
+HRESULT SystemSettingsBackend::getSettingIds(vector<wstring>& rSettingIds) {
+    TraceScope trace { "getRegisteredSettingIds" };
 
-    return errCode;
+    return getRegisteredSettingIds(rSettingIds);
 }
 
-HRESULT SettingAPI::loadSettingLibrary(const wstring& settingId, HMODULE& hLib) {
+HRESULT SystemSettingsBackend::loadSettingLibrary(const SettingAtom& settingId, HMODULE& hLib) {
     if (this->baseLibrary == NULL) { return ERROR_INVALID_HANDLE_STATE; };
     if (settingId.empty() || isFaultySetting(settingId)) { return E_INVALIDARG; };
 
     HRESULT res { ERROR_SUCCESS };
-    wstring settingDLL { L"" };
+    SettingAtom settingDLL {};
     BOOL loaded { false };
 
-    res = getSettingDLL(settingId, settingDLL);
+    res = getSettingLibrary(settingId, settingDLL);
 
     if (res == ERROR_SUCCESS) {
         if (!isFaultyLib(settingDLL)) {
-            BOOL isBaseLib { settingDLL == constants::BaseLibPath() };
+            BOOL isBaseLib { settingDLL.str() == constants::BaseLibPath() };
             loaded = isLibraryLoaded(settingDLL);
 
             if (loaded || isBaseLib) {
+                SettingsStats::instance().increment(StatsCounter::CacheHits);
+
                 if (isBaseLib) {
                     hLib = this->baseLibrary;
                 } else {
@@ -411,19 +496,19 @@ HRESULT SettingAPI::loadSettingLibrary(const wstring& settingId, HMODULE& hLib)
                     }
                 }
             } else {
-                res = SettingAPI::loadLibrary(settingDLL, hLib);
+                res = SystemSettingsBackend::loadLibrary(settingDLL, hLib);
 
                 if (res == ERROR_SUCCESS) {
-                    for (const auto& lib : constants::CoupledLibs()) {
-                        if (lib.first == settingDLL) {
-                            for (const auto& coupledLib : lib.second) {
-                                HMODULE _tmp {};
-                                res = SettingAPI::loadLibrary(coupledLib, _tmp);
-
-                                if (res != ERROR_SUCCESS) {
-                                    // TODO: Add meaningful error message
-                                    break;
-                                }
+                    const auto& coupledLibs = constants::CoupledLibs().find(settingDLL.str());
+
+                    if (coupledLibs != constants::CoupledLibs().end()) {
+                        for (const auto& coupledLib : coupledLibs->second) {
+                            HMODULE _tmp {};
+                            res = SystemSettingsBackend::loadLibrary(SettingAtom { coupledLib }, _tmp);
+
+                            if (res != ERROR_SUCCESS) {
+                                // TODO: Add meaningful error message
+                                break;
                             }
                         }
                     }
@@ -438,15 +523,17 @@ HRESULT SettingAPI::loadSettingLibrary(const wstring& settingId, HMODULE& hLib)
     return res;
 }
 
-HRESULT SettingAPI::loadLibrary(const wstring& libPath, HMODULE& rHLib) {
+HRESULT SystemSettingsBackend::loadLibrary(const SettingAtom& libPath, HMODULE& rHLib) {
+    TraceScope trace { "LoadLibrary", "path", libPath.view() };
     HRESULT errCode { ERROR_SUCCESS };
 
-    rHLib = LoadLibrary(libPath.c_str());
+    rHLib = LoadLibrary(libPath.str().c_str());
 
     if (rHLib == NULL) {
         errCode = GetLastError();
     } else {
-        this->loadLibraries.push_back({ libPath, rHLib });
+        this->loadLibraries.insert({ libPath, rHLib });
+        SettingsStats::instance().increment(StatsCounter::DllLoads);
     }
 
     return errCode;
@@ -454,13 +541,29 @@ HRESULT SettingAPI::loadLibrary(const wstring& libPath, HMODULE& rHLib) {
 
 //  ---------------------------  Public  ---------------------------------------
 
-HRESULT SettingAPI::loadBaseSetting(const std::wstring& settingId, SettingItem& settingItem) {
-    if (this->baseLibrary == NULL) { return ERROR_INVALID_HANDLE_STATE; };
-    if (settingId.empty() || isFaultySetting(settingId)) { return E_INVALIDARG; }
+HRESULT SystemSettingsBackend::load() {
+    HRESULT errCode { ERROR_SUCCESS };
+
+    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    HMODULE baseLibrary { LoadLibrary(L"C:\\Windows\\System32\\SettingsHandlers_nt.dll") };
+
+    if (baseLibrary != NULL) {
+        this->baseLibrary = baseLibrary;
+        seedSettingAtoms();
+    } else {
+        errCode = ERROR_ASSERTION_FAILURE;
+    }
+
+    return errCode;
+}
+
+BOOL SystemSettingsBackend::isLoaded() const {
+    return this->baseLibrary != NULL;
+}
 
+HRESULT SystemSettingsBackend::getSetting(const SettingAtom& settingId, ISettingItem** rSetting) {
     HRESULT res { ERROR_SUCCESS };
     HMODULE lib { NULL };
-    ISettingItem* setting { NULL };
 
     res = loadSettingLibrary(settingId, lib);
 
@@ -468,22 +571,225 @@ HRESULT SettingAPI::loadBaseSetting(const std::wstring& settingId, SettingItem&
         return res;
     }
 
-    try {
-        // TODO: Recheck the condition of failing loaded DLL.
-        DWORD lastError = ERROR_SUCCESS;
-        DWORD preGetLastError = GetLastError();
-        GetSettingFunc getSetting = (GetSettingFunc)GetProcAddress(lib, "GetSetting");
-        DWORD postGetLastError = GetLastError();
-
-        if (preGetLastError != postGetLastError) {
-            lastError = postGetLastError;
+    // TODO: Recheck the condition of failing loaded DLL.
+    DWORD lastError = ERROR_SUCCESS;
+    DWORD preGetLastError = GetLastError();
+    GetSettingFunc getSetting = (GetSettingFunc)GetProcAddress(lib, "GetSetting");
+    DWORD postGetLastError = GetLastError();
+
+    if (preGetLastError != postGetLastError) {
+        lastError = postGetLastError;
+    }
+
+    HSTRING hSettingId = NULL;
+    res = WindowsCreateString(settingId.str().c_str(), static_cast<UINT32>(settingId.str().size()), &hSettingId);
+
+    if (res == ERROR_SUCCESS && lastError == ERROR_SUCCESS && getSetting != NULL) {
+        TraceScope trace { "GetSetting" };
+        res = getSetting(hSettingId, rSetting, 0);
+    } else if (res == ERROR_SUCCESS) {
+        res = lastError;
+    }
+
+    WindowsDeleteString(hSettingId);
+
+    return res;
+}
+
+HRESULT SystemSettingsBackend::unload() {
+    CoFreeUnusedLibrariesEx(0, NULL);
+    CoUninitialize();
+
+    // The next 'load' may happen in another thread, which has to enter its own
+    // apartment and get the libraries again. They stay mapped, as objects they
+    // created may still be released after this.
+    this->baseLibrary = NULL;
+    this->loadLibraries.clear();
+    this->settingLibs.clear();
+
+    return ERROR_SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+//                        SettingAPI Functions
+// -----------------------------------------------------------------------------
+
+//  ---------------------------  Private  --------------------------------------
+
+SettingsBackend& systemSettingsBackend() {
+    static SystemSettingsBackend backend {};
+    return backend;
+}
+
+NativeHandlers& systemNativeHandlers() {
+    static NativeHandlers handlers {};
+    static const bool registered { handlers.add(volumeNamespace, createVolumeNativeHandler()) };
+    (void)registered;
+
+    return handlers;
+}
+
+/// <summary>
+///  Loads the backend of the supplied SettingAPI, if it isn't already loaded.
+/// </summary>
+HRESULT loadSettingsBackend(SettingAPI& sAPI) {
+    HRESULT errCode { ERROR_SUCCESS };
+    SettingsBackend& backend { sAPI.getBackend() };
+
+    if (backend.isLoaded() == FALSE) {
+        errCode = backend.load();
+    }
+
+    return errCode;
+}
+
+SettingAPI& LoadSettingAPI(HRESULT& rErrCode) {
+    static SettingAPI sAPI {};
+
+    rErrCode = loadSettingsBackend(sAPI);
+
+    return sAPI;
+}
+
+SettingAPI& LoadSettingAPI(SettingsBackend& backend, HRESULT& rErrCode) {
+    HRESULT errCode { ERROR_SUCCESS };
+    SettingAPI& sAPI { LoadSettingAPI(errCode) };
+
+    if (sAPI.backend != &backend) {
+        sAPI.settingIdIndex.clear();
+        sAPI.settingIdsIndexed = false;
+    }
+
+    sAPI.backend = &backend;
+    rErrCode = loadSettingsBackend(sAPI);
+
+    return sAPI;
+}
+
+HRESULT UnloadSettingsAPI(SettingAPI& sAPI) {
+    // Handlers hold COM objects, released before the backend leaves the apartment
+    sAPI.getNativeHandlers().unload();
+
+    // The settings of the backend may change until it's loaded again
+    sAPI.settingIdIndex.clear();
+    sAPI.settingIdsIndexed = false;
+
+    return sAPI.getBackend().unload();
+}
+
+SettingAPI::SettingAPI() : backend(&systemSettingsBackend()), nativeHandlers(&systemNativeHandlers()) {}
+
+SettingAPI::SettingAPI(SettingsBackend& backend) : backend(&backend), nativeHandlers(&systemNativeHandlers()) {}
+
+//  ---------------------------  Public  ---------------------------------------
+
+SettingsBackend& SettingAPI::getBackend() {
+    return *this->backend;
+}
+
+void SettingAPI::setQuarantine(SettingsQuarantine* quarantine) {
+    this->quarantine = quarantine;
+}
+
+void SettingAPI::setCatalog(const SettingsCatalog* catalog) {
+    this->catalog = catalog;
+}
+
+const SettingsCatalog* SettingAPI::getCatalog() const {
+    return this->catalog;
+}
+
+void SettingAPI::setNativeHandlers(NativeHandlers& handlers) {
+    this->nativeHandlers = &handlers;
+}
+
+NativeHandlers& SettingAPI::getNativeHandlers() {
+    return *this->nativeHandlers;
+}
+
+HRESULT SettingAPI::expandSelector(WStringView selector, vector<wstring>& rSettingIds) {
+    if (this->settingIdsIndexed == FALSE) {
+        TraceScope trace { "indexSettingIds" };
+        vector<wstring> settingIds {};
+        const HRESULT res { this->backend->getSettingIds(settingIds) };
+
+        if (res != ERROR_SUCCESS) {
+            return res;
         }
 
-        HSTRING hSettingId = NULL;
-        res = WindowsCreateString(settingId.c_str(), static_cast<UINT32>(settingId.size()), &hSettingId);
+        for (const auto& settingId : settingIds) {
+            this->settingIdIndex.add(WStringView { settingId });
+        }
+
+        this->settingIdsIndexed = true;
+    }
 
-        if (res == ERROR_SUCCESS && lastError == ERROR_SUCCESS && getSetting != NULL) {
-            res = getSetting(hSettingId, &setting, 0);
+    this->settingIdIndex.expand(selector, rSettingIds);
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT SettingAPI::loadBaseSetting(WStringView settingId, SettingItem& settingItem) {
+    // The backends intern the ids of the settings they hold when loaded, ids that
+    // aren't interned can't be loaded and are kept out of the atom table
+    const SettingAtom settingAtom { SettingAtom::lookup(settingId) };
+
+    if (settingAtom.empty() && settingId.empty() == false && this->backend->isLoaded()) {
+        return ERROR_OPEN_FAILED;
+    }
+
+    return loadBaseSetting(settingAtom, settingItem);
+}
+
+HRESULT SettingAPI::loadBaseSetting(const SettingAtom& settingId, SettingItem& settingItem) {
+    if (this->backend->isLoaded() == FALSE) { return ERROR_INVALID_HANDLE_STATE; };
+    if (settingId.empty()) { return E_INVALIDARG; }
+    if (isFaultySetting(settingId)) {
+        SettingsStats::instance().increment(StatsCounter::FaultyRejections);
+        return E_INVALIDARG;
+    }
+
+    const std::int64_t nowSec { static_cast<std::int64_t>(std::time(nullptr)) };
+    if (this->quarantine != nullptr && this->quarantine->isQuarantined(settingId.view(), nowSec)) {
+        SettingsStats::instance().increment(StatsCounter::QuarantineRejections);
+        return E_INVALIDARG;
+    }
+
+    const CatalogEntry* pCatalogEntry { this->catalog != nullptr ? this->catalog->find(settingId.view()) : nullptr };
+    if (pCatalogEntry != nullptr && pCatalogEntry->status != CatalogStatus::Ok) {
+        SettingsStats::instance().increment(StatsCounter::CatalogRejections);
+        return E_INVALIDARG;
+    }
+
+    TraceScope trace { "loadBaseSetting", "settingID", settingId.view() };
+    StatsScope stats { StatsPhase::Load, settingId.view() };
+
+    HRESULT res { ERROR_SUCCESS };
+    ISettingItem* setting { NULL };
+    BOOL crashed { false };
+    BOOL timedOut { false };
+
+    if (this->quarantine != nullptr) {
+        this->quarantine->beginProbe(settingId.str());
+    }
+
+    try {
+        {
+            RecordScope record { "GetSetting", settingId.view(), WStringView {} };
+            res = this->backend->getSetting(settingId, &setting);
+
+            if (record.isRecording()) {
+                record.setResult(res);
+
+                SettingType type { SettingType::Empty };
+                if (res == ERROR_SUCCESS && setting != NULL && setting->get_SettingType(&type) == ERROR_SUCCESS) {
+                    record.setSettingType(static_cast<std::int32_t>(type));
+                }
+            }
+        }
+
+        if (res == ERROR_SUCCESS && setting != NULL) {
+            TraceScope updatingTrace { "IsUpdating" };
 
             BOOL isUpdating { true };
             // ColorFilter setting doesn't update this field when ready.
@@ -491,11 +797,19 @@ HRESULT SettingAPI::loadBaseSetting(const std::wstring& settingId, SettingItem&
             // IsApplicable' may cause segfault in certain settings.
             BOOL isApplicable { true };
 
+            const UINT loadPolls { SettingsCatalog::loadWaitPolls(pCatalogEntry) };
+            // The wait is cut short to what's left of the batch deadline
+            const UINT maxPolls { boundPolls(loadPolls, 10) };
+            if (pCatalogEntry != nullptr && pCatalogEntry->updatePolls == 0) {
+                // Cataloged as ready once loaded, so it isn't waited for up front
+                setting->get_IsUpdating(&isUpdating);
+            }
+
             UINT counter = 0;
             while (isUpdating) {//  || (isEnabled == false )) { // && isApplicable == false)) {
                 // Timer
                 // ==========
-                if (counter > 10) {
+                if (counter > maxPolls) {
                     break;
                 } else {
                     System::Threading::Thread::Sleep(10);
@@ -507,32 +821,61 @@ HRESULT SettingAPI::loadBaseSetting(const std::wstring& settingId, SettingItem&
                 // setting->get_IsEnabled(&isEnabled);
             }
 
-            if (res == ERROR_SUCCESS && isApplicable == TRUE && isEnabled == TRUE && isUpdating == FALSE) {
+            if (isApplicable == TRUE && isEnabled == TRUE && isUpdating == FALSE) {
                 ATL::CComPtr<ISettingItem> comSetting { NULL };
                 comSetting.Attach(setting);
                 settingItem = SettingItem { settingId, comSetting };
             } else {
-                setting->Release();
                 res = E_INVALIDARG;
+
+                if (isUpdating == TRUE && maxPolls < loadPolls) {
+                    // Not the setting's fault, so it isn't quarantined for it
+                    res = ERROR_TIMEOUT;
+                } else if (isUpdating == TRUE) {
+                    SettingsStats::instance().increment(StatsCounter::Timeouts);
+                    timedOut = true;
+                }
+
+                setting->Release();
             }
         } else {
-            res = lastError;
-        }
-
-        WindowsDeleteString(hSettingId);
+            if (setting != NULL) {
+                setting->Release();
+                setting = NULL;
+            }
 
+            if (res == ERROR_SUCCESS) {
+                res = E_INVALIDARG;
+            }
+        }
     } catch(...) {
         if (setting != NULL) {
             setting->Release();
         }
         res = E_NOTIMPL;
+        crashed = true;
+    }
+
+    if (this->quarantine != nullptr) {
+        this->quarantine->endProbe();
+
+        if (crashed) {
+            this->quarantine->add(settingId.view(), QuarantineReason::Crash, nowSec);
+        } else if (timedOut) {
+            this->quarantine->add(settingId.view(), QuarantineReason::Timeout, nowSec);
+        } else if (res == E_NOTIMPL) {
+            this->quarantine->add(settingId.view(), QuarantineReason::NotImplemented, nowSec);
+        } else if (res == ERROR_SUCCESS) {
+            // Settings whose quarantine expired are released once probed again
+            this->quarantine->release(settingId.view());
+        }
     }
 
     return res;
 }
 
 HRESULT SettingAPI::getCollectionSettings(const vector<wstring>& ids, SettingItem& collSetting, vector<SettingItem>& rSettings) {
-    if (this->baseLibrary == NULL) { return ERROR_INVALID_HANDLE_STATE; };
+    if (this->backend->isLoaded() == FALSE) { return ERROR_INVALID_HANDLE_STATE; };
     if (ids.empty() || checkEmptyIds(ids)) { return E_INVALIDARG; }
 
     SettingType type { SettingType::Empty };
@@ -565,22 +908,34 @@ HRESULT SettingAPI::getCollectionSettings(const vector<wstring>& ids, SettingIte
         errCode = pSettingVector->get_Size(&vectorSize);
 
         if (errCode == ERROR_SUCCESS) {
-            for (UINT32 i = 0; i < vectorSize; i++) {
+            settingItems.reserve(_ids.size());
+
+            // Stop as soon as all the requested elements have been found
+            for (UINT32 i = 0; i < vectorSize && !_ids.empty(); i++) {
                 ATL::CComPtr<ISettingItem> pCurSetting = NULL;
                 errCode = pSettingVector->GetAt(i, reinterpret_cast<IInspectable**>(&pCurSetting));
 
                 if (errCode == ERROR_SUCCESS) {
-                    for (auto& id = _ids.begin(); id != _ids.end();) {
-                        SettingItem setting { collSetting.settingId, *id, pCurSetting };
-                        std::wstring curSettingDesc {};
-                        std::wstring curSettingId {};
-
-                        // TODO: We may want to check the return of this operations.
-                        setting.GetDescription(curSettingDesc);
-                        setting.GetId(curSettingId);
-
-                        if (*id == curSettingId || *id == curSettingDesc) {
-                            settingItems.push_back(setting);
+                    HSTRING hCurSettingId { NULL };
+                    HSTRING hCurSettingDesc { NULL };
+                    UINT32 idLength { 0 };
+                    UINT32 descLength { 0 };
+
+                    // TODO: We may want to check the return of this operations.
+                    pCurSetting->get_Id(&hCurSettingId);
+                    pCurSetting->get_Description(&hCurSettingDesc);
+
+                    // Compare against the HSTRING buffers, no copy of the strings is made
+                    const WStringView curSettingId {
+                        WindowsGetStringRawBuffer(hCurSettingId, &idLength), idLength
+                    };
+                    const WStringView curSettingDesc {
+                        WindowsGetStringRawBuffer(hCurSettingDesc, &descLength), descLength
+                    };
+
+                    for (auto id = _ids.begin(); id != _ids.end();) {
+                        if (curSettingId == *id || curSettingDesc == *id) {
+                            settingItems.emplace_back(collSetting.settingId, *id, pCurSetting);
 
                             // Remove the already found id
                             id = _ids.erase(id);
@@ -588,6 +943,9 @@ HRESULT SettingAPI::getCollectionSettings(const vector<wstring>& ids, SettingIte
                             ++id;
                         }
                     }
+
+                    WindowsDeleteString(hCurSettingId);
+                    WindowsDeleteString(hCurSettingDesc);
                 } else {
                     break;
                 }
@@ -597,7 +955,7 @@ HRESULT SettingAPI::getCollectionSettings(const vector<wstring>& ids, SettingIte
         if (settingItems.empty()) {
             errCode = E_INVALIDARG;
         } else {
-            rSettings = settingItems;
+            rSettings = std::move(settingItems);
         }
     }
 
@@ -605,7 +963,7 @@ HRESULT SettingAPI::getCollectionSettings(const vector<wstring>& ids, SettingIte
 }
 
 HRESULT SettingAPI::getCollectionSettings(SettingItem& collSetting, vector<SettingItem>& rSettings) {
-    if (this->baseLibrary == NULL) { return ERROR_INVALID_HANDLE_STATE; };
+    if (this->backend->isLoaded() == FALSE) { return ERROR_INVALID_HANDLE_STATE; };
 
     HRESULT errCode { ERROR_SUCCESS };
     UINT32 vectorSize { 0 };
@@ -636,6 +994,8 @@ HRESULT SettingAPI::getCollectionSettings(SettingItem& collSetting, vector<Setti
         errCode = pSettingVector->get_Size(&vectorSize);
 
         if (errCode == ERROR_SUCCESS) {
+            settingItems.reserve(vectorSize);
+
             for (UINT32 i = 0; i < vectorSize; i++) {
                 ATL::CComPtr<ISettingItem> pCurSetting = NULL;
                 errCode = pSettingVector->GetAt(i, reinterpret_cast<IInspectable**>(&pCurSetting));
@@ -644,14 +1004,16 @@ HRESULT SettingAPI::getCollectionSettings(SettingItem& collSetting, vector<Setti
                     HSTRING hCurSettingId { NULL };
                     errCode = pCurSetting->get_Id(&hCurSettingId);
 
-                    if (errCode) {
+                    if (errCode == ERROR_SUCCESS) {
                         UINT32 length { 0 };
                         LPCWSTR pStrBuffer { WindowsGetStringRawBuffer(hCurSettingId, &length) };
-                        std::wstring id { pStrBuffer };
-                        SettingItem setting { collSetting.settingId, id, pCurSetting };
 
-                        settingItems.push_back(setting);
+                        settingItems.emplace_back(
+                            collSetting.settingId, wstring { pStrBuffer, length }, pCurSetting
+                        );
                     }
+
+                    WindowsDeleteString(hCurSettingId);
                 } else {
                     break;
                 }
@@ -661,7 +1023,7 @@ HRESULT SettingAPI::getCollectionSettings(SettingItem& collSetting, vector<Setti
         if (settingItems.empty()) {
             errCode = E_INVALIDARG;
         } else {
-            rSettings = settingItems;
+            rSettings = std::move(settingItems);
         }
     }
 
@@ -669,7 +1031,7 @@ HRESULT SettingAPI::getCollectionSettings(SettingItem& collSetting, vector<Setti
 }
 
 HRESULT SettingAPI::getCollectionSetting(const wstring& id, SettingItem& settingCollection, SettingItem& rSetting) {
-    if (this->baseLibrary == NULL) { return ERROR_INVALID_HANDLE_STATE; };
+    if (this->backend->isLoaded() == FALSE) { return ERROR_INVALID_HANDLE_STATE; };
     if (id.empty()) { return E_INVALIDARG; }
 
     SettingType type { SettingType::Empty };
@@ -685,7 +1047,7 @@ HRESULT SettingAPI::getCollectionSetting(const wstring& id, SettingItem& setting
     errCode = getCollectionSettings({ id }, settingCollection, settings);
 
     if (errCode == ERROR_SUCCESS && !settings.empty()) {
-        rSetting = settings.front();
+        rSetting = std::move(settings.front());
     } else {
         errCode = E_INVALIDARG;
     }
@@ -13,9 +13,18 @@
 #pragma once
 
 #include "SettingItem.h"
+#include "SettingAtom.h"
+#include "SettingsBackend.h"
+#include "NativeHandlers.h"
+#include "SessionRecorder.h"
+#include "SettingsCatalog.h"
+#include "SettingIdIndex.h"
+#include "SettingsQuarantine.h"
 
 #include <windows.foundation.h>
 
+#include <unordered_map>
+
 using namespace ABI::Windows::Foundation;
 
 /// <summary>
@@ -31,7 +40,18 @@ HRESULT setSettingValue(const VARIANT& value, SettingItem& settingItem);
 /// </summary>
 HRESULT toString(const ATL::CComPtr<IPropertyValue>& propValue, wstring& rValueStr);
 /// <summary>
+///   Records a value read from or written to a setting in the supplied scope, using
+///   the same representation as 'toString'. The value of a collection is recorded
+///   as the ids of its elements. Does nothing if the scope isn't recording.
+/// </summary>
+void recordValue(RecordScope& record, ISettingItem* setting, IInspectable* value);
+/// <summary>
+///   Splits a string using the supplied delimiter, ignoring the delimiters escaped
+///   with the supplied escape sequence. Only the first character of 'delim' and
+///   'esc_sec' is taken into account. Escape sequences are kept in the returned tokens.
 ///
+///   NOTE: This function returns copies of the tokens, for a non-allocating alternative
+///   see 'SettingPathTokenizer'.
 /// </summary>
 vector<wstring> split(const wstring& str, const wstring& delim, const wstring& esc_sec);
 /// <summary>
@@ -40,6 +60,10 @@ vector<wstring> split(const wstring& str, const wstring& delim, const wstring& e
 /// </summary>
 /// <param name="settingPath">The complete path to the setting.</param>
 /// <param name="settings">The vector with the secuence of settings to be obtained.</param>
+/// <returns>
+///   ERROR_SUCCESS in case of success or E_INVALIDARG if the path is empty or
+///   holds empty segments.
+/// </returns>
 HRESULT splitSettingPath(const wstring& settingPath, vector<wstring>& idsPath);
 /// <summary>
 ///   Gets the corresponding DLL to the supplied setting identifier.
@@ -51,24 +75,55 @@ HRESULT splitSettingPath(const wstring& settingPath, vector<wstring>& idsPath);
 ///     -ERROR_OPEN_FAILED: If the registry key containing the Id can't be openned.
 /// </returns>
 HRESULT getSettingDLL(const std::wstring& settingId, std::wstring& settingDLL);
+/// <summary>
+///   Gets the ids of the settings present in the registry SettingId index.
+/// </summary>
+/// <returns>
+///   ERROR_SUCCESS or ERROR_OPEN_FAILED if the index registry key can't be opened.
+/// </returns>
+HRESULT getRegisteredSettingIds(vector<wstring>& rSettingIds);
+/// <summary>
+///   Interns all the setting ids present in the registry SettingId index, so
+///   the atom table doesn't need to grow while the settings are being accessed.
+/// </summary>
+/// <returns>
+///   ERROR_SUCCESS or the error returned when opening the index registry key.
+/// </returns>
+HRESULT seedSettingAtoms();
+/// <summary>
+///   Gets the build of the running OS, as '<CurrentBuildNumber>.<UBR>', used
+///   to key the settings quarantine.
+/// </summary>
+/// <returns>
+///   The build, or an empty string if it can't be read from the registry.
+/// </returns>
+wstring getOsBuild();
 
-class SettingAPI {
+/// <summary>
+///  Backend accessing the settings of the system, loading the libraries that
+///  implement them.
+/// </summary>
+class SystemSettingsBackend : public SettingsBackend {
 private:
     /// <summary>
     ///  The base library that need to be loaded before any other lib.
     /// </summary>
     HMODULE baseLibrary { NULL };
     /// <summary>
-    ///  A list of the already loaded libraries.
+    ///  The already loaded libraries, keyed by their path.
     /// </summary>
-    vector<pair<wstring, HMODULE>> loadLibraries {};
+    std::unordered_map<SettingAtom, HMODULE> loadLibraries {};
+    /// <summary>
+    ///  Cache of the libraries paths for the already queried settings ids.
+    /// </summary>
+    std::unordered_map<SettingAtom, SettingAtom> settingLibs {};
 
     /// <summary>
     ///  Checks if a library is already loaded.
     /// </summary>
     /// <param name="libraryPath"></param>
     /// <returns></returns>
-    BOOL isLibraryLoaded(wstring libraryPath);
+    BOOL isLibraryLoaded(const SettingAtom& libraryPath);
     /// <summary>
     ///  Gets an already loaded library.
     /// </summary>
@@ -79,7 +134,7 @@ private:
     ///  one of the following error codes:
     ///     - ERROR_NOT_FOUND: If the library isn't already loaded.
     /// </returns>
-    HRESULT getLoadedLibrary(const wstring& libPath, HMODULE& rLib);
+    HRESULT getLoadedLibrary(const SettingAtom& libPath, HMODULE& rLib);
     /// <summary>
     ///  Loads the specified library and register it in the 'loadedLibraries' map.
     /// </summary>
@@ -88,18 +143,87 @@ private:
     ///  An error code specifying ERROR_SUCCESS if the operation was successful or
     ///  one of the following error codes:
     /// </returns>
-    HRESULT loadLibrary(const wstring& libPath, HMODULE& rHLib);
+    HRESULT loadLibrary(const SettingAtom& libPath, HMODULE& rHLib);
     /// <summary>
     ///  Loads the library associated with a particular setting Id.
     /// </summary>
-    HRESULT loadSettingLibrary(const wstring& settingId, HMODULE& lib);
+    HRESULT loadSettingLibrary(const SettingAtom& settingId, HMODULE& lib);
 
 public:
+    SystemSettingsBackend() {}
+    SystemSettingsBackend(const SystemSettingsBackend&) = delete;
+    SystemSettingsBackend& operator=(const SystemSettingsBackend&) = delete;
+
     /// <summary>
-    ///  Empty constructor.
+    ///  Initializes COM and loads the base settings library.
+    /// </summary>
+    /// <returns>
+    ///  ERROR_SUCCESS or ERROR_ASSERTION_FAILURE if the base library can't be loaded.
+    /// </returns>
+    HRESULT load() override;
+    BOOL isLoaded() const override;
+    /// <summary>
+    ///  Loads the library implementing the setting, and gets the setting from it.
+    /// </summary>
+    /// <returns>
+    ///  ERROR_SUCCESS or one of the following error codes:
+    ///     - ERROR_OPEN_FAILED: If the inner GetSettingDLL operation fails.
+    ///     - E_OUTOFMEMORY: If the system runs out of memory and WindowsCreateString fails.
+    ///     - ERROR_MOD_NOT_FOUND: If the LoadLibrary function fails.
+    /// </returns>
+    HRESULT getSetting(const SettingAtom& settingId, ISettingItem** rSetting) override;
+    /// <summary>
+    ///  Gets the path of the library associated with a particular setting Id,
+    ///  caching the result of the registry query.
+    /// </summary>
+    HRESULT getSettingLibrary(const SettingAtom& settingId, SettingAtom& rLibPath) override;
+    /// <summary>
+    ///  Gets the ids of the settings present in the registry SettingId index.
+    /// </summary>
+    HRESULT getSettingIds(vector<wstring>& rSettingIds) override;
+    /// <summary>
+    ///  Frees the unused COM libraries and deinitializes COM. What was cached
+    ///  about the libraries is dropped, so the backend is loaded again, from
+    ///  any thread, before being used.
+    /// </summary>
+    HRESULT unload() override;
+};
+
+class SettingAPI {
+private:
+    /// <summary>
+    ///  The backend providing the settings.
+    /// </summary>
+    SettingsBackend* backend { nullptr };
+    /// <summary>
+    ///  The quarantine of the settings failing to load, if any.
+    /// </summary>
+    SettingsQuarantine* quarantine { nullptr };
+    /// <summary>
+    ///  The catalog of the settings of the OS build, if any.
+    /// </summary>
+    const SettingsCatalog* catalog { nullptr };
+    /// <summary>
+    ///  The handlers of the settings served outside the system settings.
+    /// </summary>
+    NativeHandlers* nativeHandlers { nullptr };
+    /// <summary>
+    ///  Index over the ids of the settings of the backend, built the first time
+    ///  a selector is expanded and dropped when the backend is unloaded.
+    /// </summary>
+    SettingIdIndex settingIdIndex {};
+    BOOL settingIdsIndexed { false };
+
+public:
+    /// <summary>
+    ///  Constructs a SettingAPI over the system settings.
     /// </summary>
     SettingAPI();
     /// <summary>
+    ///  Constructs a SettingAPI over the supplied backend, which should outlive it.
+    /// </summary>
+    explicit SettingAPI(SettingsBackend& backend);
+    /// <summary>
     ///  Desctructor, it deinitialize loaded libraries in the proper order.
     /// </summary>
     /// ~SettingAPI();
@@ -116,11 +240,26 @@ public:
     /// <param name="baseSetting">A reference to the SettingItem to be filled.</param>
     /// <returns>
     ///   An HRESULT error if the operation failed or ERROR_SUCCESS. Possible errors:
-    ///     - ERROR_OPEN_FAILED: If the inner GetSettingDLL operation fails.
+    ///     - ERROR_OPEN_FAILED: If the inner GetSettingDLL operation fails, or
+    ///       the id isn't one of the settings of the loaded backend.
     ///     - E_OUTOFMEMORY: If the system runs out of memory and WindowsCreateString fails.
     ///     - ERROR_MOD_NOT_FOUND: If the LoadLibrary function fails.
+    ///     - The error reported by the backend, for other backends.
+    ///     - E_INVALIDARG: If the setting is known to be faulty, it's in
+    ///       quarantine, or it's cataloged as failing to load.
+    ///     - ERROR_TIMEOUT: If the deadline of the batch expires while waiting
+    ///       for the setting to finish updating.
     /// </returns>
-    HRESULT loadBaseSetting(const std::wstring& settingId, SettingItem& settingItem);
+    HRESULT loadBaseSetting(WStringView settingId, SettingItem& settingItem);
+    /// <summary>
+    ///   Loads the base setting exposed through the DLL.
+    /// </summary>
+    /// <param name="settingId">The interned id of the setting to be loaded.</param>
+    /// <param name="baseSetting">A reference to the SettingItem to be filled.</param>
+    /// <returns>
+    ///   The same error codes as the overload taking a view.
+    /// </returns>
+    HRESULT loadBaseSetting(const SettingAtom& settingId, SettingItem& settingItem);
     /// <summary>
     ///  Gets the settings inside a collection.
     /// </summary>
@@ -146,12 +285,76 @@ public:
     HRESULT getCollectionSetting(const wstring& id, SettingItem& settingCollection, SettingItem& rSetting);
 
     /// <summary>
-    ///  Initializes the SettingAPI.
+    ///  Gets the backend providing the settings.
+    /// </summary>
+    SettingsBackend& getBackend();
+    /// <summary>
+    ///  Sets the quarantine used when loading settings, which should outlive its
+    ///  use, or nullptr to stop using it. Quarantined settings are rejected
+    ///  before their library is loaded, and settings whose load crashes, never
+    ///  finishes updating, or returns E_NOTIMPL are added to it.
+    /// </summary>
+    void setQuarantine(SettingsQuarantine* quarantine);
+    /// <summary>
+    ///  Sets the catalog used when loading settings, which should outlive its
+    ///  use, or nullptr to stop using it. Settings cataloged as failing to load
+    ///  are rejected before their library is loaded, and the time each setting
+    ///  is waited for while updating after being loaded depends on what was
+    ///  seen while probing it.
+    /// </summary>
+    void setCatalog(const SettingsCatalog* catalog);
+    /// <summary>
+    ///  Gets the catalog in use, nullptr if none.
+    /// </summary>
+    const SettingsCatalog* getCatalog() const;
+    /// <summary>
+    ///  Sets the handlers of the settings served outside the system settings,
+    ///  which should outlive their use. They are the system ones unless
+    ///  different ones have been supplied, and are unloaded together with the
+    ///  backend by 'UnloadSettingsAPI'.
+    /// </summary>
+    void setNativeHandlers(NativeHandlers& handlers);
+    /// <summary>
+    ///  Gets the handlers of the settings served outside the system settings.
+    /// </summary>
+    NativeHandlers& getNativeHandlers();
+    /// <summary>
+    ///  Gets the ids of the settings of the backend matching a selector, see
+    ///  'SettingIdIndex::expand'.
+    /// </summary>
+    /// <returns>
+    ///  ERROR_SUCCESS or the error reported by the backend while listing its
+    ///  settings, E_NOTIMPL if it can't list them.
+    /// </returns>
+    HRESULT expandSelector(WStringView selector, vector<wstring>& rSettingIds);
+
+    /// <summary>
+    ///  Initializes the SettingAPI, over the backend in use, which is the system
+    ///  settings one unless a different one has been supplied.
     /// </summary>
     friend SettingAPI& LoadSettingAPI(HRESULT& rErrCode);
     /// <summary>
+    ///  Initializes the SettingAPI over the supplied backend, which is used by
+    ///  the later calls to 'LoadSettingAPI'. The backend should outlive its use.
+    /// </summary>
+    friend SettingAPI& LoadSettingAPI(SettingsBackend& backend, HRESULT& rErrCode);
+    /// <summary>
     ///  Deinitializes the SettingAPI.
     /// </summary>
     /// <returns></returns>
     friend HRESULT UnloadSettingsAPI(SettingAPI& rSAPI);
 };
+
+/// <summary>
+///  The backend accessing the settings of the system, the default backend of
+///  the SettingAPI.
+/// </summary>
+SettingsBackend& systemSettingsBackend();
+/// <summary>
+///  The native handlers of the SettingAPI by default, currently the volume
+///  one under the 'Native.Volume' namespace.
+/// </summary>
+NativeHandlers& systemNativeHandlers();
+SettingAPI& LoadSettingAPI(HRESULT& rErrCode);
+SettingAPI& LoadSettingAPI(SettingsBackend& backend, HRESULT& rErrCode);
+HRESULT UnloadSettingsAPI(SettingAPI& rSAPI);
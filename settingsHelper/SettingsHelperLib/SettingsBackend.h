@@ -0,0 +1,75 @@
+/**
+ * Source of the settings accessed through the SettingAPI.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "ISettingItem.h"
+#include "SettingAtom.h"
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+
+/// <summary>
+///  Provides the raw ISettingItem for each setting id. The SettingAPI performs
+///  the rest of the work over the returned settings, like waiting for them to
+///  finish updating, so every backend goes through the same code paths.
+/// </summary>
+class SettingsBackend {
+public:
+    virtual ~SettingsBackend() {}
+
+    /// <summary>
+    ///  Prepares the backend to be used, called by 'LoadSettingAPI' while the
+    ///  backend isn't loaded.
+    /// </summary>
+    virtual HRESULT load() = 0;
+    /// <summary>
+    ///  Checks if the backend is ready to be used.
+    /// </summary>
+    virtual BOOL isLoaded() const = 0;
+    /// <summary>
+    ///  Gets the setting with the supplied id.
+    /// </summary>
+    /// <param name="settingId">The id of the setting to get.</param>
+    /// <param name="rSetting">
+    ///  Filled with a new reference to the setting if the call succeeds.
+    /// </param>
+    /// <returns>
+    ///  ERROR_SUCCESS or the error reported while getting the setting.
+    /// </returns>
+    virtual HRESULT getSetting(const SettingAtom& settingId, ISettingItem** rSetting) = 0;
+    /// <summary>
+    ///  Gets the path of the library implementing a setting, without loading
+    ///  it. Backends that don't load settings from libraries don't know it.
+    /// </summary>
+    /// <returns>
+    ///  ERROR_SUCCESS, E_NOTIMPL if the backend doesn't know the libraries, or
+    ///  the error reported while looking for it.
+    /// </returns>
+    virtual HRESULT getSettingLibrary(const SettingAtom&, SettingAtom&) { return E_NOTIMPL; }
+    /// <summary>
+    ///  Gets the ids of every setting the backend provides, used to expand the
+    ///  setting selectors of the payloads.
+    /// </summary>
+    /// <returns>
+    ///  ERROR_SUCCESS, E_NOTIMPL if the backend can't list its settings, or the
+    ///  error reported while listing them.
+    /// </returns>
+    virtual HRESULT getSettingIds(std::vector<std::wstring>&) { return E_NOTIMPL; }
+    /// <summary>
+    ///  Releases the resources acquired while accessing the settings, called
+    ///  by 'UnloadSettingsAPI'.
+    /// </summary>
+    virtual HRESULT unload() = 0;
+};
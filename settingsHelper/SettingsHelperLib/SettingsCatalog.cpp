@@ -0,0 +1,253 @@
+/**
+ * Catalog of the settings available on an OS build, built by probing them.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SettingsCatalog.h"
+#include "TextFields.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+    const char* const catalogHeader {
+        "# SettingsHelper catalog v1: settingID, dll, settingType, valueType, loadUs, updatePolls, status, errorCode"
+    };
+    const char* const buildKey { "build" };
+    const char* const statusNames[] { "ok", "failed", "crashed", "timedOut" };
+
+    /// <summary>
+    ///  Parses a type field, where -1 stands for an unknown type.
+    /// </summary>
+    bool parseTypeField(const string& field, std::int32_t& rType) {
+        std::int64_t type { 0 };
+
+        if (field == "-1") {
+            rType = -1;
+        } else if (parseTextInteger(field, type) && type <= INT32_MAX) {
+            rType = static_cast<std::int32_t>(type);
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+}
+
+const char* catalogStatusName(CatalogStatus status) {
+    return statusNames[static_cast<std::size_t>(status)];
+}
+
+bool parseCatalogStatus(const string& name, CatalogStatus& rStatus) {
+    for (std::size_t i = 0; i < sizeof(statusNames) / sizeof(statusNames[0]); i++) {
+        if (name == statusNames[i]) {
+            rStatus = static_cast<CatalogStatus>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool formatCatalogLine(const CatalogEntry& entry, string& rLine) {
+    string settingId {};
+    string dll {};
+
+    if (toTextField(entry.settingId, settingId) == false || settingId.empty()) { return false; }
+    // Libraries under a path that isn't ASCII are just left unknown
+    if (toTextField(entry.dll, dll) == false) { dll.clear(); }
+
+    char errorCode[16] {};
+    std::snprintf(errorCode, sizeof(errorCode), "0x%08X", entry.errorCode);
+
+    rLine = settingId + '\t' + dll + '\t' +
+        std::to_string(entry.settingType) + '\t' + std::to_string(entry.valueType) + '\t' +
+        std::to_string(entry.loadUs) + '\t' + std::to_string(entry.updatePolls) + '\t' +
+        catalogStatusName(entry.status) + '\t' + errorCode;
+
+    return true;
+}
+
+bool parseCatalogLine(const string& line, CatalogEntry& rEntry) {
+    const vector<string> fields { splitTextFields(line) };
+    if (fields.size() != 8 || fields[0].empty()) { return false; }
+
+    CatalogEntry entry {};
+    std::int64_t loadUs { 0 };
+    std::int64_t updatePolls { 0 };
+    std::int64_t errorCode { 0 };
+
+    const bool validLine {
+        parseTypeField(fields[2], entry.settingType) &&
+        parseTypeField(fields[3], entry.valueType) &&
+        parseTextInteger(fields[4], loadUs) &&
+        parseTextInteger(fields[5], updatePolls) &&
+        updatePolls <= UINT32_MAX &&
+        parseCatalogStatus(fields[6], entry.status) &&
+        fields[7].compare(0, 2, "0x") == 0 &&
+        parseTextInteger(fields[7].substr(2), errorCode, 16) &&
+        errorCode <= UINT32_MAX
+    };
+
+    if (validLine == false) { return false; }
+
+    entry.settingId = wstring { fields[0].begin(), fields[0].end() };
+    entry.dll = wstring { fields[1].begin(), fields[1].end() };
+    entry.loadUs = static_cast<std::uint64_t>(loadUs);
+    entry.updatePolls = static_cast<std::uint32_t>(updatePolls);
+    entry.errorCode = static_cast<std::uint32_t>(errorCode);
+
+    rEntry = std::move(entry);
+
+    return true;
+}
+
+SettingsCatalog::SettingsCatalog(wstring osBuild) : osBuild(std::move(osBuild)) {}
+
+void SettingsCatalog::add(const CatalogEntry& entry) {
+    entries[entry.settingId] = entry;
+}
+
+const CatalogEntry* SettingsCatalog::find(WStringView settingId) const {
+    if (entries.empty()) { return nullptr; }
+
+    const auto entry = entries.find(settingId.str());
+    return entry != entries.end() ? &entry->second : nullptr;
+}
+
+std::uint32_t SettingsCatalog::loadWaitPolls(const CatalogEntry* pEntry) {
+    if (pEntry == nullptr) { return defaultLoadWaitPolls; }
+
+    // Settings that needed polling are given twice the time it took
+    const std::uint32_t polls { pEntry->updatePolls > maxLoadWaitPolls / 2 ? maxLoadWaitPolls : pEntry->updatePolls * 2 };
+    return polls > defaultLoadWaitPolls ? polls : defaultLoadWaitPolls;
+}
+
+bool SettingsCatalog::read(std::istream& in) {
+    string line {};
+    bool foundBuild { false };
+
+    entries.clear();
+
+    while (std::getline(in, line)) {
+        if (line.empty() == false && line.back() == '\r') { line.pop_back(); }
+        if (line.empty() || line.front() == '#') { continue; }
+
+        if (foundBuild == false) {
+            const vector<string> fields { splitTextFields(line) };
+            if (fields.size() != 2 || fields[0] != buildKey || fields[1].empty()) { return false; }
+
+            osBuild = wstring { fields[1].begin(), fields[1].end() };
+            foundBuild = true;
+            continue;
+        }
+
+        CatalogEntry entry {};
+        if (parseCatalogLine(line, entry)) {
+            entries[entry.settingId] = std::move(entry);
+        }
+    }
+
+    return foundBuild;
+}
+
+bool SettingsCatalog::write(std::ostream& out) const {
+    string build {};
+    if (toTextField(osBuild, build) == false || build.empty()) { return false; }
+
+    out << catalogHeader << '\n' << buildKey << '\t' << build << '\n';
+
+    vector<const CatalogEntry*> sorted {};
+    sorted.reserve(entries.size());
+    for (const auto& entry : entries) {
+        sorted.push_back(&entry.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const CatalogEntry* a, const CatalogEntry* b) {
+        return a->settingId < b->settingId;
+    });
+
+    for (const auto pEntry : sorted) {
+        string line {};
+        if (formatCatalogLine(*pEntry, line)) {
+            out << line << '\n';
+        }
+    }
+
+    return static_cast<bool>(out);
+}
+
+std::size_t buildCatalog(WorkerPool& pool, const vector<wstring>& settingIds, SettingsCatalog& rCatalog) {
+    wstring payload {};
+    vector<std::uint32_t> indices {};
+    indices.reserve(settingIds.size());
+
+    for (std::size_t i = 0; i < settingIds.size(); i++) {
+        payload.append(settingIds[i]).push_back(L'\n');
+        indices.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    vector<WorkerStatus> statuses {};
+    vector<wstring> results {};
+    pool.setPayload(payload);
+    pool.runActions(indices, statuses, results);
+
+    std::size_t cataloged { 0 };
+
+    for (std::size_t i = 0; i < settingIds.size(); i++) {
+        CatalogEntry entry {};
+        entry.settingId = settingIds[i];
+
+        if (statuses[i] == WorkerStatus::Completed) {
+            // The worker answers with an ASCII catalog line
+            string line {};
+            line.reserve(results[i].size());
+            for (const auto c : results[i]) {
+                line.push_back(c < 0x80 ? static_cast<char>(c) : '?');
+            }
+
+            if (parseCatalogLine(line, entry) == false) {
+                continue;
+            }
+        } else if (statuses[i] == WorkerStatus::Crashed) {
+            entry.status = CatalogStatus::Crashed;
+        } else if (statuses[i] == WorkerStatus::TimedOut) {
+            entry.status = CatalogStatus::TimedOut;
+        } else {
+            continue;
+        }
+
+        rCatalog.add(entry);
+        cataloged++;
+    }
+
+    return cataloged;
+}
+
+vector<wstring> splitCatalogPayload(const wstring& payload) {
+    vector<wstring> settingIds {};
+    std::size_t start { 0 };
+
+    while (start < payload.size()) {
+        std::size_t end { payload.find(L'\n', start) };
+        if (end == wstring::npos) { end = payload.size(); }
+
+        if (end > start) {
+            settingIds.push_back(payload.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+
+    return settingIds;
+}
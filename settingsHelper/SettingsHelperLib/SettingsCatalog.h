@@ -0,0 +1,170 @@
+/**
+ * Catalog of the settings available on an OS build, built by probing them.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+#include "WorkerPool.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+///  Outcome of probing a setting.
+/// </summary>
+enum class CatalogStatus {
+    /// <summary>
+    ///  The setting loaded and finished updating.
+    /// </summary>
+    Ok = 0,
+    /// <summary>
+    ///  Loading the setting failed, the error code is recorded.
+    /// </summary>
+    Failed,
+    /// <summary>
+    ///  Loading the setting took down the worker probing it.
+    /// </summary>
+    Crashed,
+    /// <summary>
+    ///  The setting never finished updating, or the worker probing it hanged.
+    /// </summary>
+    TimedOut
+};
+
+/// <summary>
+///  Name used for each CatalogStatus in the catalog file.
+/// </summary>
+const char* catalogStatusName(CatalogStatus status);
+/// <summary>
+///  Gets the status with the supplied name.
+/// </summary>
+/// <returns>True if the name is known, false otherwise.</returns>
+bool parseCatalogStatus(const std::string& name, CatalogStatus& rStatus);
+
+/// <summary>
+///  What was learned about a setting by probing it.
+/// </summary>
+struct CatalogEntry {
+    std::wstring settingId {};
+    /// <summary>
+    ///  The library implementing the setting, empty if unknown.
+    /// </summary>
+    std::wstring dll {};
+    /// <summary>
+    ///  The SettingType of the setting, -1 if it couldn't be loaded.
+    /// </summary>
+    std::int32_t settingType { -1 };
+    /// <summary>
+    ///  The PropertyType of the setting value, -1 if it has no readable value.
+    /// </summary>
+    std::int32_t valueType { -1 };
+    /// <summary>
+    ///  Time spent loading the setting, until it finished updating.
+    /// </summary>
+    std::uint64_t loadUs { 0 };
+    /// <summary>
+    ///  Number of times the setting was polled until it stopped updating
+    ///  after being loaded, zero if it was ready right away.
+    /// </summary>
+    std::uint32_t updatePolls { 0 };
+    CatalogStatus status { CatalogStatus::Ok };
+    /// <summary>
+    ///  The error loading the setting, for the Failed status.
+    /// </summary>
+    std::uint32_t errorCode { 0 };
+};
+
+/// <summary>
+///  Serializes an entry as a line of the catalog file, without the newline.
+/// </summary>
+/// <returns>False if the setting id can't be written, which is ASCII only.</returns>
+bool formatCatalogLine(const CatalogEntry& entry, std::string& rLine);
+/// <summary>
+///  Parses a line written by 'formatCatalogLine'.
+/// </summary>
+/// <returns>True if the line is valid.</returns>
+bool parseCatalogLine(const std::string& line, CatalogEntry& rEntry);
+
+/// <summary>
+///  Settings available on an OS build, written by the SettingsCatalog tool
+///  and loaded by the helper to reject the settings known to fail before
+///  loading them, and to adapt how long each setting is waited for.
+/// </summary>
+class SettingsCatalog {
+public:
+    /// <summary>
+    ///  Number of times a setting without entry is polled while updating
+    ///  after being loaded, 10ms apart.
+    /// </summary>
+    static constexpr std::uint32_t defaultLoadWaitPolls { 10 };
+    /// <summary>
+    ///  Maximum number of polls for the settings known to be slow.
+    /// </summary>
+    static constexpr std::uint32_t maxLoadWaitPolls { 100 };
+
+private:
+    std::wstring osBuild {};
+    std::unordered_map<std::wstring, CatalogEntry> entries {};
+
+public:
+    explicit SettingsCatalog(std::wstring osBuild = std::wstring {});
+
+    const std::wstring& getOsBuild() const { return osBuild; }
+    std::size_t size() const { return entries.size(); }
+
+    /// <summary>
+    ///  Adds an entry, replacing the previous one of the same setting.
+    /// </summary>
+    void add(const CatalogEntry& entry);
+    /// <summary>
+    ///  Gets the entry of a setting.
+    /// </summary>
+    /// <returns>A pointer to the entry, or nullptr if the setting isn't cataloged.</returns>
+    const CatalogEntry* find(WStringView settingId) const;
+    /// <summary>
+    ///  Gets the number of times a setting should be polled while updating
+    ///  after being loaded: twice the polls seen while probing it, bounded by
+    ///  'defaultLoadWaitPolls' and 'maxLoadWaitPolls'.
+    /// </summary>
+    /// <param name="pEntry">The entry of the setting, or nullptr if it isn't cataloged.</param>
+    static std::uint32_t loadWaitPolls(const CatalogEntry* pEntry);
+
+    /// <summary>
+    ///  Reads a catalog file, replacing the OS build and the entries.
+    ///  Malformed lines are ignored.
+    /// </summary>
+    /// <returns>False if the file doesn't start with the OS build line.</returns>
+    bool read(std::istream& in);
+    /// <summary>
+    ///  Writes the catalog, sorted by setting id so it can be diffed.
+    /// </summary>
+    /// <returns>True if the catalog was written.</returns>
+    bool write(std::ostream& out) const;
+};
+
+/// <summary>
+///  Probes the supplied settings in the workers of the pool, all at once, and
+///  adds an entry for each of them to the catalog. Each worker gets the ids
+///  one per line as the payload, and answers with the catalog line of the
+///  setting. Settings that crash or hang their worker get an entry with that
+///  status.
+/// </summary>
+/// <returns>The number of settings cataloged.</returns>
+std::size_t buildCatalog(WorkerPool& pool, const std::vector<std::wstring>& settingIds, SettingsCatalog& rCatalog);
+/// <summary>
+///  Splits the payload sent by 'buildCatalog' to the workers into setting ids.
+/// </summary>
+std::vector<std::wstring> splitCatalogPayload(const std::wstring& payload);
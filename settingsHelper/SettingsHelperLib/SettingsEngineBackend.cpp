@@ -0,0 +1,188 @@
+/**
+ * Backend running the payloads of the engine over the system settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SettingsEngineBackend.h"
+#include "BatchDeadline.h"
+#include "PayloadProc.h"
+#include "PlanCache.h"
+#include "SettingsCatalog.h"
+#include "SettingsStats.h"
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Gets the last write time of a file, telling apart its versions, or 0 if
+    ///  the file can't be found.
+    /// </summary>
+    std::uint64_t getFileGeneration(const wstring& path) {
+        WIN32_FILE_ATTRIBUTE_DATA attributes {};
+
+        if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes) == FALSE) {
+            return 0;
+        }
+
+        return (static_cast<std::uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+            attributes.ftLastWriteTime.dwLowDateTime;
+    }
+
+    /// <summary>
+    ///  Runs the payloads with the same steps as 'handlePayload' does for a
+    ///  single process, but keeping the SettingAPI loaded between them. Loading
+    ///  it joins the engine thread to a single-threaded apartment.
+    ///
+    ///  Payloads are compiled into plans which are kept for the payloads applied
+    ///  again, like the same preferences at every login, so a repeated payload
+    ///  isn't parsed nor resolved again. The plans depend on the catalog, which
+    ///  is read again when its file changes, dropping them. Payloads that fail
+    ///  to parse, or hold selectors, are compiled every time they're run. The
+    ///  deadline of the batches that don't set their own is read once, when
+    ///  the engine starts.
+    /// </summary>
+    class SettingsEngineBackend : public EngineBackend {
+    private:
+        SettingAPI* pSAPI { nullptr };
+        SettingsCatalog catalog {};
+        BOOL cataloged { false };
+        wstring catalogPath {};
+        std::uint64_t catalogGeneration { 0 };
+        std::uint32_t defaultDeadlineMs { 0 };
+        Batch batch {};
+        PlanCache<CompiledPlan> plans { getPlanCacheSize() };
+
+        /// <summary>
+        ///  Gets the plan of a payload, compiling it if it isn't cached. The plan
+        ///  is owned by the cache, or by 'rUncached' if the cache is disabled.
+        /// </summary>
+        const CompiledPlan& getPlan(const wstring& payload, std::unique_ptr<CompiledPlan>& rUncached) {
+            const CompiledPlan* pPlan { plans.find(payload) };
+
+            if (pPlan != nullptr) {
+                SettingsStats::instance().increment(StatsCounter::CachedPlanRuns);
+                return *pPlan;
+            }
+
+            std::unique_ptr<CompiledPlan> plan { new CompiledPlan {} };
+            const HRESULT res { compilePayload(*pSAPI, payload, cataloged ? &catalog : nullptr, *plan) };
+            SettingsStats::instance().increment(StatsCounter::CompiledPlans);
+
+            // Failed parses hold no usable plan, and selectors may select other settings later
+            if (res != ERROR_SUCCESS || plan->selectsSettings || plans.capacity() == 0) {
+                rUncached = std::move(plan);
+                return *rUncached;
+            }
+
+            return *plans.insert(payload, std::move(plan));
+        }
+
+        /// <summary>
+        ///  Reads the catalog again if its file changed since it was last read,
+        ///  dropping the plans compiled with the previous one.
+        /// </summary>
+        void refreshCatalog() {
+            if (catalogPath.empty()) { return; }
+
+            const std::uint64_t generation { getFileGeneration(catalogPath) };
+            if (generation == catalogGeneration) { return; }
+
+            plans.clear();
+            pSAPI->setCatalog(nullptr);
+
+            catalog = SettingsCatalog {};
+            cataloged = generation != 0 && readCatalog(catalogPath, getOsBuild(), catalog) == ERROR_SUCCESS;
+            catalogGeneration = generation;
+
+            if (cataloged) {
+                pSAPI->setCatalog(&catalog);
+            }
+        }
+
+    public:
+        bool start() override {
+            HRESULT res { ERROR_SUCCESS };
+            SettingAPI& sAPI { LoadSettingAPI(res) };
+            if (res != ERROR_SUCCESS) {
+                UnloadSettingsAPI(sAPI);
+                return false;
+            }
+            pSAPI = &sAPI;
+
+            // Same sources as the command line, without the switches
+            InputOptions options {};
+            addEnvironmentOptions(options);
+
+            catalogPath = options.catalogPath;
+            defaultDeadlineMs = options.deadlineMs;
+            refreshCatalog();
+
+            return true;
+        }
+
+        vector<EngineResult> runBatch(const wstring& payload, std::uint32_t deadlineMs) override {
+            vector<EngineResult> results {};
+
+            if (deadlineMs == 0) {
+                deadlineMs = defaultDeadlineMs;
+            }
+
+            {
+                // The arena of the batch takes what's allocated while running the plan
+                BatchScope batchScope { batch.arena };
+                BatchDeadline deadline { deadlineMs };
+                DeadlineScope deadlineScope { deadlineMs > 0 ? &deadline : nullptr };
+                std::unique_ptr<CompiledPlan> uncached {};
+
+                refreshCatalog();
+                runCompiledPlan(*pSAPI, getPlan(payload, uncached), batch.results);
+
+                results.reserve(batch.results.size());
+                for (const auto& result : batch.results) {
+                    EngineResult engineResult {};
+                    engineResult.settingId = result.settingID;
+                    engineResult.isError = result.isError != FALSE;
+                    engineResult.errorMessage = result.errorMessage;
+                    engineResult.returnValue = result.returnValue;
+
+                    results.push_back(std::move(engineResult));
+                }
+            }
+
+            batch.reset();
+
+            return results;
+        }
+
+        void stop() override {
+            // The plans hold the values of the actions, released before leaving the apartment
+            plans.clear();
+
+            if (pSAPI != nullptr) {
+                if (cataloged) {
+                    pSAPI->setCatalog(nullptr);
+                }
+
+                UnloadSettingsAPI(*pSAPI);
+                pSAPI = nullptr;
+            }
+
+            // The catalog is read again when the engine starts again
+            cataloged = false;
+            catalogGeneration = 0;
+        }
+    };
+}
+
+std::unique_ptr<EngineBackend> createSettingsEngineBackend() {
+    return std::unique_ptr<EngineBackend> { new SettingsEngineBackend {} };
+}
@@ -0,0 +1,26 @@
+/**
+ * Backend running the payloads of the engine over the system settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "ActionEngine.h"
+
+#include <memory>
+
+/// <summary>
+///  Creates the backend used by the action engine. The one in the library
+///  initializes COM as a single-threaded apartment and loads the SettingAPI
+///  when the engine starts, so every batch runs over warm settings. The Node
+///  addon links a mocked one instead, as the library is built with the common
+///  language runtime support, which a native module can't load.
+/// </summary>
+std::unique_ptr<EngineBackend> createSettingsEngineBackend();
@@ -0,0 +1,223 @@
+/**
+ * Learned quarantine of the settings that crash, hang or aren't implemented.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SettingsQuarantine.h"
+#include "TextFields.h"
+
+#include <utility>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+    const char* const quarantineHeader { "# SettingsHelper quarantine v1: build, settingID, reason, since, failures" };
+    const char* const reasonNames[] { "crash", "timeout", "notImplemented" };
+    const char* const releaseChange { "release" };
+}
+
+const char* quarantineReasonName(QuarantineReason reason) {
+    return reasonNames[static_cast<std::size_t>(reason)];
+}
+
+bool parseQuarantineReason(const string& name, QuarantineReason& rReason) {
+    for (std::size_t i = 0; i < sizeof(reasonNames) / sizeof(reasonNames[0]); i++) {
+        if (name == reasonNames[i]) {
+            rReason = static_cast<QuarantineReason>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SettingsQuarantine::SettingsQuarantine(wstring osBuild, std::int64_t ttlSec) :
+    osBuild(std::move(osBuild)), ttlSec(ttlSec) {}
+
+bool SettingsQuarantine::isQuarantined(WStringView settingId, std::int64_t nowSec) const {
+    const QuarantineEntry* pEntry { find(settingId) };
+    return pEntry != nullptr && nowSec < expiresAt(*pEntry);
+}
+
+const QuarantineEntry* SettingsQuarantine::find(WStringView settingId) const {
+    if (entries.empty()) { return nullptr; }
+
+    const auto entry = entries.find(settingId.str());
+    return entry != entries.end() ? &entry->second : nullptr;
+}
+
+std::int64_t SettingsQuarantine::expiresAt(const QuarantineEntry& entry) const {
+    const std::uint32_t doublings { entry.failures > maxTtlDoublings ? maxTtlDoublings : entry.failures - 1 };
+    return entry.sinceSec + (ttlSec << doublings);
+}
+
+void SettingsQuarantine::add(WStringView settingId, QuarantineReason reason, std::int64_t nowSec) {
+    const auto inserted = entries.insert({ settingId.str(), QuarantineEntry {} });
+    QuarantineEntry& entry { inserted.first->second };
+
+    if (inserted.second == false) {
+        entry.failures++;
+    }
+
+    entry.reason = reason;
+    entry.sinceSec = nowSec;
+    modified = true;
+
+    string id {};
+    if (changeListener && toTextField(inserted.first->first, id)) {
+        changeListener(string { quarantineReasonName(reason) } + '\t' + id);
+    }
+}
+
+void SettingsQuarantine::release(WStringView settingId) {
+    if (entries.empty()) { return; }
+
+    const wstring releasedId { settingId.str() };
+
+    if (entries.erase(releasedId) != 0) {
+        modified = true;
+
+        string id {};
+        if (changeListener && toTextField(releasedId, id)) {
+            changeListener(string { releaseChange } + '\t' + id);
+        }
+    }
+}
+
+void SettingsQuarantine::setProbeListener(ProbeListener listener) {
+    probeListener = std::move(listener);
+}
+
+void SettingsQuarantine::setChangeListener(ChangeListener listener) {
+    changeListener = std::move(listener);
+}
+
+bool SettingsQuarantine::applyChange(const string& change, std::int64_t nowSec) {
+    const vector<string> fields { splitTextFields(change) };
+    if (fields.size() != 2 || fields[1].empty()) { return false; }
+
+    const wstring settingId { fields[1].begin(), fields[1].end() };
+    QuarantineReason reason { QuarantineReason::Crash };
+
+    if (fields[0] == releaseChange) {
+        release(WStringView { settingId });
+    } else if (parseQuarantineReason(fields[0], reason)) {
+        add(WStringView { settingId }, reason, nowSec);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void SettingsQuarantine::beginProbe(const wstring& settingId) {
+    if (probeListener) { probeListener(settingId); }
+}
+
+void SettingsQuarantine::endProbe() {
+    if (probeListener) { probeListener(wstring {}); }
+}
+
+void SettingsQuarantine::writeProbe(std::ostream& out, const wstring& settingId) const {
+    string build {};
+    string id {};
+
+    if (toTextField(osBuild, build) && toTextField(settingId, id)) {
+        out << build << '\t' << id << '\n';
+    }
+}
+
+bool SettingsQuarantine::recoverProbe(std::istream& in, std::int64_t nowSec) {
+    string build {};
+    string line {};
+
+    if (toTextField(osBuild, build) == false || std::getline(in, line).fail()) { return false; }
+    if (line.empty() == false && line.back() == '\r') { line.pop_back(); }
+
+    const vector<string> fields { splitTextFields(line) };
+    if (fields.size() != 2 || fields[0] != build || fields[1].empty()) { return false; }
+
+    add(WStringView { wstring { fields[1].begin(), fields[1].end() } }, QuarantineReason::Crash, nowSec);
+
+    return true;
+}
+
+void SettingsQuarantine::read(std::istream& in) {
+    string build {};
+    const bool validBuild { toTextField(osBuild, build) };
+    string line {};
+
+    entries.clear();
+    otherBuildsLines.clear();
+
+    while (std::getline(in, line)) {
+        if (line.empty() == false && line.back() == '\r') { line.pop_back(); }
+        if (line.empty() || line.front() == '#') { continue; }
+
+        const vector<string> fields { splitTextFields(line) };
+        QuarantineReason reason { QuarantineReason::Crash };
+        std::int64_t sinceSec { 0 };
+        std::int64_t failures { 0 };
+
+        const bool validLine {
+            fields.size() == 5 &&
+            fields[0].empty() == false &&
+            fields[1].empty() == false &&
+            parseQuarantineReason(fields[2], reason) &&
+            parseTextInteger(fields[3], sinceSec) &&
+            parseTextInteger(fields[4], failures) &&
+            failures > 0
+        };
+
+        if (validLine == false) { continue; }
+
+        if (validBuild && fields[0] == build) {
+            QuarantineEntry entry {};
+            entry.reason = reason;
+            entry.sinceSec = sinceSec;
+            entry.failures = static_cast<std::uint32_t>(failures);
+
+            entries[wstring { fields[1].begin(), fields[1].end() }] = entry;
+        } else {
+            otherBuildsLines.push_back(line);
+        }
+    }
+
+    modified = false;
+}
+
+bool SettingsQuarantine::write(std::ostream& out) {
+    string build {};
+    if (toTextField(osBuild, build) == false || build.empty()) { return false; }
+
+    out << quarantineHeader << '\n';
+
+    for (const auto& line : otherBuildsLines) {
+        out << line << '\n';
+    }
+
+    for (const auto& entry : entries) {
+        string settingId {};
+        // Settings ids are ASCII, anything else can't come from the registry
+        if (toTextField(entry.first, settingId) == false) { continue; }
+
+        out << build << '\t' << settingId << '\t' << quarantineReasonName(entry.second.reason) << '\t'
+            << entry.second.sinceSec << '\t' << entry.second.failures << '\n';
+    }
+
+    if (out) {
+        modified = false;
+    }
+
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,203 @@
+/**
+ * Learned quarantine of the settings that crash, hang or aren't implemented.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+///  Why a setting was quarantined.
+/// </summary>
+enum class QuarantineReason {
+    /// <summary>
+    ///  Loading the setting crashed, either raising an exception or taking the
+    ///  whole process down.
+    /// </summary>
+    Crash = 0,
+    /// <summary>
+    ///  The setting never finished updating after being loaded.
+    /// </summary>
+    Timeout,
+    /// <summary>
+    ///  The setting library reported E_NOTIMPL for the setting.
+    /// </summary>
+    NotImplemented
+};
+
+/// <summary>
+///  Name used for each QuarantineReason in the quarantine file.
+/// </summary>
+const char* quarantineReasonName(QuarantineReason reason);
+/// <summary>
+///  Gets the reason with the supplied name.
+/// </summary>
+/// <returns>True if the name is known, false otherwise.</returns>
+bool parseQuarantineReason(const std::string& name, QuarantineReason& rReason);
+
+/// <summary>
+///  A quarantined setting.
+/// </summary>
+struct QuarantineEntry {
+    /// <summary>
+    ///  The reason of the last failure.
+    /// </summary>
+    QuarantineReason reason { QuarantineReason::Crash };
+    /// <summary>
+    ///  When the last failure happened, in seconds since the epoch.
+    /// </summary>
+    std::int64_t sinceSec { 0 };
+    /// <summary>
+    ///  Number of consecutive failures, each re-probe that fails doubles the
+    ///  time the setting stays in quarantine.
+    /// </summary>
+    std::uint32_t failures { 1 };
+};
+
+/// <summary>
+///  Settings of the OS build in use that failed to load and are rejected
+///  without touching their library, until their quarantine expires and they
+///  are probed again.
+///
+///  The quarantine is serialized as text, one setting per line, holding the
+///  entries of every OS build seen. Only the ones of the current build are
+///  applied, the rest are kept as they are so they are still there if that
+///  build is booted again.
+/// </summary>
+class SettingsQuarantine {
+public:
+    /// <summary>
+    ///  Default time a setting stays in quarantine after its first failure.
+    /// </summary>
+    static constexpr std::int64_t defaultTtlSec { 7 * 24 * 60 * 60 };
+    /// <summary>
+    ///  Maximum number of times the TTL is doubled for repeated failures.
+    /// </summary>
+    static constexpr std::uint32_t maxTtlDoublings { 3 };
+    /// <summary>
+    ///  Called with the id of a setting before it's probed, and with an empty
+    ///  id once the probe is done. A probe that never finishes is a crash that
+    ///  took down the process, so it can be persisted to be learned next run.
+    /// </summary>
+    using ProbeListener = std::function<void(const std::wstring&)>;
+    /// <summary>
+    ///  Called with each setting added to or released from the quarantine, as
+    ///  a line that 'applyChange' replays on another quarantine. Workers report
+    ///  what they learn to the supervisor this way.
+    /// </summary>
+    using ChangeListener = std::function<void(const std::string&)>;
+
+private:
+    std::wstring osBuild {};
+    std::int64_t ttlSec { defaultTtlSec };
+    std::unordered_map<std::wstring, QuarantineEntry> entries {};
+    std::vector<std::string> otherBuildsLines {};
+    ProbeListener probeListener {};
+    ChangeListener changeListener {};
+    bool modified { false };
+
+public:
+    SettingsQuarantine(std::wstring osBuild, std::int64_t ttlSec = defaultTtlSec);
+
+    const std::wstring& getOsBuild() const { return osBuild; }
+    std::int64_t getTtlSec() const { return ttlSec; }
+    std::size_t size() const { return entries.size(); }
+    /// <summary>
+    ///  True if the entries changed since they were read or written.
+    /// </summary>
+    bool isModified() const { return modified; }
+
+    /// <summary>
+    ///  Checks if a setting should be rejected without loading it. Settings
+    ///  whose quarantine has expired aren't rejected, so they can be probed
+    ///  again, until the outcome of the probe is reported.
+    /// </summary>
+    /// <param name="settingId">The setting to be checked.</param>
+    /// <param name="nowSec">The current time, in seconds since the epoch.</param>
+    bool isQuarantined(WStringView settingId, std::int64_t nowSec) const;
+    /// <summary>
+    ///  Gets the entry of a quarantined setting, expired or not.
+    /// </summary>
+    /// <returns>A pointer to the entry, or nullptr if the setting isn't quarantined.</returns>
+    const QuarantineEntry* find(WStringView settingId) const;
+    /// <summary>
+    ///  Gets the time at which the quarantine of an entry expires.
+    /// </summary>
+    std::int64_t expiresAt(const QuarantineEntry& entry) const;
+
+    /// <summary>
+    ///  Quarantines a setting that failed to load. If it was already
+    ///  quarantined, its failures count is increased.
+    /// </summary>
+    void add(WStringView settingId, QuarantineReason reason, std::int64_t nowSec);
+    /// <summary>
+    ///  Removes a setting from the quarantine, used once a probe succeeds.
+    /// </summary>
+    void release(WStringView settingId);
+
+    /// <summary>
+    ///  Sets the listener notified of the probes, see 'ProbeListener'.
+    /// </summary>
+    void setProbeListener(ProbeListener listener);
+    /// <summary>
+    ///  Notifies the listener that a setting is going to be probed.
+    /// </summary>
+    void beginProbe(const std::wstring& settingId);
+    /// <summary>
+    ///  Notifies the listener that the last probe finished.
+    /// </summary>
+    void endProbe();
+
+    /// <summary>
+    ///  Sets the listener notified of the changes, see 'ChangeListener'.
+    /// </summary>
+    void setChangeListener(ChangeListener listener);
+    /// <summary>
+    ///  Replays a change reported to the ChangeListener of another quarantine,
+    ///  holding the same entries.
+    /// </summary>
+    /// <param name="change">The line reported to the listener.</param>
+    /// <param name="nowSec">The current time, in seconds since the epoch.</param>
+    /// <returns>True if the change was applied, false if it's malformed.</returns>
+    bool applyChange(const std::string& change, std::int64_t nowSec);
+
+    /// <summary>
+    ///  Writes the marker of a setting being probed, holding the OS build and
+    ///  the setting id.
+    /// </summary>
+    void writeProbe(std::ostream& out, const std::wstring& settingId) const;
+    /// <summary>
+    ///  Reads a marker written by 'writeProbe' that was left behind, meaning
+    ///  that probing the setting crashed the process, and quarantines the
+    ///  setting if the marker belongs to the current OS build.
+    /// </summary>
+    /// <returns>True if a setting was quarantined.</returns>
+    bool recoverProbe(std::istream& in, std::int64_t nowSec);
+
+    /// <summary>
+    ///  Reads the entries of a quarantine file, replacing the current ones.
+    ///  Malformed lines are ignored, so a damaged file only loses its entries.
+    /// </summary>
+    void read(std::istream& in);
+    /// <summary>
+    ///  Writes the entries, including the ones of other OS builds.
+    /// </summary>
+    /// <returns>True if the entries were written.</returns>
+    bool write(std::ostream& out);
+};
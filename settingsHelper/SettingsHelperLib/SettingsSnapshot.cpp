@@ -0,0 +1,274 @@
+/**
+ * Compact binary snapshot of the values of a list of settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SettingsSnapshot.h"
+
+#include <utility>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Leading bytes of every snapshot, the last one being the format version.
+    /// </summary>
+    const char snapshotHeader[] { 'G', 'S', 'S', 1 };
+    const char* const base64Digits { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+
+    void appendVarint(std::uint64_t value, string& rOut) {
+        while (value >= 0x80) {
+            rOut.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+
+        rOut.push_back(static_cast<char>(value));
+    }
+
+    bool readVarint(const string& in, std::size_t& rPos, std::uint64_t& rValue) {
+        std::uint64_t value { 0 };
+
+        for (unsigned shift = 0; shift < 64 && rPos < in.size(); shift += 7) {
+            const std::uint8_t byte { static_cast<std::uint8_t>(in[rPos++]) };
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0) {
+                rValue = value;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool readBytes(const string& in, std::size_t& rPos, string& rBytes) {
+        std::uint64_t size { 0 };
+        if (readVarint(in, rPos, size) == false || size > in.size() - rPos) { return false; }
+
+        rBytes.assign(in, rPos, static_cast<std::size_t>(size));
+        rPos += static_cast<std::size_t>(size);
+
+        return true;
+    }
+
+    int base64Value(wchar_t c) {
+        if (c >= L'A' && c <= L'Z') { return c - L'A'; }
+        if (c >= L'a' && c <= L'z') { return c - L'a' + 26; }
+        if (c >= L'0' && c <= L'9') { return c - L'0' + 52; }
+        if (c == L'+') { return 62; }
+        if (c == L'/') { return 63; }
+
+        return -1;
+    }
+
+    wstring encodeBase64(const string& bytes) {
+        wstring text {};
+        text.reserve((bytes.size() + 2) / 3 * 4);
+
+        for (std::size_t i = 0; i < bytes.size(); i += 3) {
+            const std::size_t left { bytes.size() - i };
+            std::uint32_t group { static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[i])) << 16 };
+            if (left > 1) { group |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[i + 1])) << 8; }
+            if (left > 2) { group |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[i + 2])); }
+
+            text.push_back(static_cast<wchar_t>(base64Digits[(group >> 18) & 0x3F]));
+            text.push_back(static_cast<wchar_t>(base64Digits[(group >> 12) & 0x3F]));
+            text.push_back(left > 1 ? static_cast<wchar_t>(base64Digits[(group >> 6) & 0x3F]) : L'=');
+            text.push_back(left > 2 ? static_cast<wchar_t>(base64Digits[group & 0x3F]) : L'=');
+        }
+
+        return text;
+    }
+
+    bool decodeBase64(WStringView text, string& rBytes) {
+        if (text.size() % 4 != 0) { return false; }
+
+        string bytes {};
+        bytes.reserve(text.size() / 4 * 3);
+
+        for (std::size_t i = 0; i < text.size(); i += 4) {
+            const bool last { i + 4 == text.size() };
+            const std::size_t padding { last ? (text[i + 3] == L'=' ? (text[i + 2] == L'=' ? 2u : 1u) : 0u) : 0u };
+            std::uint32_t group { 0 };
+
+            for (std::size_t j = 0; j < 4 - padding; j++) {
+                const int value { base64Value(text[i + j]) };
+                if (value < 0) { return false; }
+
+                group |= static_cast<std::uint32_t>(value) << (18 - 6 * j);
+            }
+
+            bytes.push_back(static_cast<char>(group >> 16));
+            if (padding < 2) { bytes.push_back(static_cast<char>(group >> 8)); }
+            if (padding < 1) { bytes.push_back(static_cast<char>(group)); }
+        }
+
+        rBytes = std::move(bytes);
+
+        return true;
+    }
+}
+
+string encodeSnapshotNumber(std::uint64_t bits, std::size_t size) {
+    string value {};
+
+    for (std::size_t i = 0; i < size; i++) {
+        value.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+
+    return value;
+}
+
+bool decodeSnapshotNumber(const string& value, std::size_t size, std::uint64_t& rBits) {
+    if (value.size() != size || size > 8) { return false; }
+
+    std::uint64_t bits { 0 };
+    for (std::size_t i = 0; i < size; i++) {
+        bits |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(value[i])) << (8 * i);
+    }
+
+    rBits = bits;
+
+    return true;
+}
+
+string encodeSnapshotString(WStringView str) {
+    string value {};
+    value.reserve(str.size());
+
+    for (std::size_t i = 0; i < str.size(); i++) {
+        std::uint32_t c { static_cast<std::uint32_t>(str[i]) };
+
+        // Combine UTF-16 surrogate pairs, found where wchar_t is 16 bits wide
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < str.size()) {
+            const std::uint32_t low { static_cast<std::uint32_t>(str[i + 1]) };
+
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+
+        if (c < 0x80) {
+            value.push_back(static_cast<char>(c));
+        } else if (c < 0x800) {
+            value.push_back(static_cast<char>(0xC0 | (c >> 6)));
+            value.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            value.push_back(static_cast<char>(0xE0 | (c >> 12)));
+            value.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            value.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else {
+            value.push_back(static_cast<char>(0xF0 | (c >> 18)));
+            value.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+            value.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            value.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+    }
+
+    return value;
+}
+
+bool decodeSnapshotString(const string& value, wstring& rStr) {
+    wstring str {};
+    str.reserve(value.size());
+
+    for (std::size_t i = 0; i < value.size();) {
+        const std::uint8_t lead { static_cast<std::uint8_t>(value[i]) };
+        const std::size_t size { lead < 0x80 ? 1u : lead >= 0xF0 ? 4u : lead >= 0xE0 ? 3u : lead >= 0xC0 ? 2u : 0u };
+        if (size == 0 || size > value.size() - i) { return false; }
+
+        std::uint32_t c { size == 1 ? lead : static_cast<std::uint32_t>(lead & (0x7F >> size)) };
+        for (std::size_t j = 1; j < size; j++) {
+            const std::uint8_t next { static_cast<std::uint8_t>(value[i + j]) };
+            if ((next & 0xC0) != 0x80) { return false; }
+
+            c = (c << 6) | (next & 0x3F);
+        }
+
+        if (c > 0x10FFFF) { return false; }
+
+        if (c >= 0x10000 && sizeof(wchar_t) == 2) {
+            str.push_back(static_cast<wchar_t>(0xD800 + ((c - 0x10000) >> 10)));
+            str.push_back(static_cast<wchar_t>(0xDC00 + ((c - 0x10000) & 0x3FF)));
+        } else {
+            str.push_back(static_cast<wchar_t>(c));
+        }
+
+        i += size;
+    }
+
+    rStr = std::move(str);
+
+    return true;
+}
+
+void SettingsSnapshot::add(SnapshotEntry entry) {
+    entries.push_back(std::move(entry));
+}
+
+wstring SettingsSnapshot::encode() const {
+    string bytes { snapshotHeader, sizeof(snapshotHeader) };
+    appendVarint(entries.size(), bytes);
+
+    for (const auto& entry : entries) {
+        const string settingId { encodeSnapshotString(WStringView { entry.settingId }) };
+
+        appendVarint(settingId.size(), bytes);
+        bytes.append(settingId);
+        appendVarint(static_cast<std::uint32_t>(entry.valueType), bytes);
+        appendVarint(entry.value.size(), bytes);
+        bytes.append(entry.value);
+    }
+
+    return encodeBase64(bytes);
+}
+
+bool SettingsSnapshot::decode(WStringView text) {
+    string bytes {};
+    if (decodeBase64(text, bytes) == false) { return false; }
+    if (bytes.compare(0, sizeof(snapshotHeader), snapshotHeader, sizeof(snapshotHeader)) != 0) { return false; }
+
+    std::size_t pos { sizeof(snapshotHeader) };
+    std::uint64_t count { 0 };
+    if (readVarint(bytes, pos, count) == false) { return false; }
+
+    vector<SnapshotEntry> decoded {};
+
+    // Each entry takes at least three bytes, which bounds the count before reserving
+    if (count > (bytes.size() - pos) / 3) { return false; }
+    decoded.reserve(static_cast<std::size_t>(count));
+
+    for (std::uint64_t i = 0; i < count; i++) {
+        SnapshotEntry entry {};
+        string settingId {};
+        std::uint64_t valueType { 0 };
+
+        const bool valid {
+            readBytes(bytes, pos, settingId) && settingId.empty() == false &&
+            decodeSnapshotString(settingId, entry.settingId) &&
+            readVarint(bytes, pos, valueType) && valueType <= UINT32_MAX &&
+            readBytes(bytes, pos, entry.value)
+        };
+        if (valid == false) { return false; }
+
+        entry.valueType = static_cast<std::int32_t>(static_cast<std::uint32_t>(valueType));
+        decoded.push_back(std::move(entry));
+    }
+
+    if (pos != bytes.size()) { return false; }
+
+    entries = std::move(decoded);
+
+    return true;
+}
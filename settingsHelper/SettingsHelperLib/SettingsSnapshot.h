@@ -0,0 +1,93 @@
+/**
+ * Compact binary snapshot of the values of a list of settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WStringView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  The value of a setting captured in a snapshot.
+/// </summary>
+struct SnapshotEntry {
+    /// <summary>
+    ///  The setting path, 'BaseSettingId' or 'BaseSettingId.ValueId'.
+    /// </summary>
+    std::wstring settingId {};
+    /// <summary>
+    ///  The PropertyType of the value.
+    /// </summary>
+    std::int32_t valueType { 0 };
+    /// <summary>
+    ///  The bytes of the value: numbers little endian in the size of their
+    ///  type, booleans as a single byte, and strings UTF-8 encoded. Two values
+    ///  of the same type are equal when their bytes are.
+    /// </summary>
+    std::string value {};
+
+    bool sameValue(const SnapshotEntry& other) const {
+        return valueType == other.valueType && value == other.value;
+    }
+};
+
+/// <summary>
+///  Encodes the lower 'size' bytes of a number, little endian.
+/// </summary>
+std::string encodeSnapshotNumber(std::uint64_t bits, std::size_t size);
+/// <summary>
+///  Decodes a number encoded by 'encodeSnapshotNumber'.
+/// </summary>
+/// <returns>False if the value doesn't hold exactly 'size' bytes.</returns>
+bool decodeSnapshotNumber(const std::string& value, std::size_t size, std::uint64_t& rBits);
+/// <summary>
+///  Encodes a string as UTF-8.
+/// </summary>
+std::string encodeSnapshotString(WStringView str);
+/// <summary>
+///  Decodes a string encoded by 'encodeSnapshotString'.
+/// </summary>
+/// <returns>False if the value isn't valid UTF-8.</returns>
+bool decodeSnapshotString(const std::string& value, std::wstring& rStr);
+
+/// <summary>
+///  Values of a list of settings, captured by the 'Snapshot' method and put
+///  back by 'Restore'. It's passed around as base64 text, holding a header,
+///  the number of entries, and the setting path, value type and value bytes
+///  of each entry, with their sizes as variable length integers.
+/// </summary>
+class SettingsSnapshot {
+private:
+    std::vector<SnapshotEntry> entries {};
+
+public:
+    const std::vector<SnapshotEntry>& getEntries() const { return entries; }
+    std::size_t size() const { return entries.size(); }
+
+    /// <summary>
+    ///  Adds an entry, entries are restored in the order they're added.
+    /// </summary>
+    void add(SnapshotEntry entry);
+
+    /// <summary>
+    ///  Encodes the snapshot as base64 text.
+    /// </summary>
+    std::wstring encode() const;
+    /// <summary>
+    ///  Decodes the text returned by 'encode', replacing the entries.
+    /// </summary>
+    /// <returns>False if the text isn't a valid snapshot, leaving it unchanged.</returns>
+    bool decode(WStringView text);
+};
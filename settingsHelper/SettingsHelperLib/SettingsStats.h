@@ -0,0 +1,542 @@
+/**
+ * Latency histograms and counters of the operations over the settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+#include "WStringView.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  Latency histogram with logarithmic buckets, each power of two is split in
+///  'subBucketsNum' linear sub-buckets, as done by HdrHistogram. Recorded
+///  values are reported with a relative error below 1 / 'subBucketsNum'.
+///
+///  Buckets are allocated up to the highest value recorded, so histograms that
+///  only saw short latencies stay small.
+/// </summary>
+class LatencyHistogram {
+public:
+    /// <summary>
+    ///  Number of bits used to index the sub-buckets of a power of two.
+    /// </summary>
+    static constexpr std::uint32_t subBucketBits { 4 };
+    /// <summary>
+    ///  Number of linear sub-buckets in which each power of two is split.
+    /// </summary>
+    static constexpr std::uint32_t subBucketsNum { 1u << subBucketBits };
+    /// <summary>
+    ///  Highest value that can be recorded, higher values are clamped to it.
+    ///  It's over 19 hours when recording microseconds.
+    /// </summary>
+    static constexpr std::int64_t maxTrackableValue { (std::int64_t { 1 } << 36) - 1 };
+
+private:
+    std::vector<std::uint64_t> counts {};
+    std::uint64_t totalCount { 0 };
+    std::int64_t lowestValue { 0 };
+    std::int64_t highestValue { 0 };
+    double sum { 0 };
+
+public:
+    /// <summary>
+    ///  Gets the bucket in which a value is counted.
+    /// </summary>
+    static std::size_t bucketIndex(std::int64_t value) {
+        if (value < 0) { value = 0; }
+        if (value > maxTrackableValue) { value = maxTrackableValue; }
+
+        const std::uint64_t uValue { static_cast<std::uint64_t>(value) };
+        if (uValue < subBucketsNum) { return static_cast<std::size_t>(uValue); }
+
+        std::uint32_t msb { 0 };
+        while ((uValue >> (msb + 1)) != 0) { msb++; }
+
+        const std::uint32_t shift { msb - subBucketBits };
+        const std::uint64_t subBucket { (uValue >> shift) - subBucketsNum };
+
+        return static_cast<std::size_t>((shift + 1) * subBucketsNum + subBucket);
+    }
+
+    /// <summary>
+    ///  Gets the lowest value counted in the supplied bucket.
+    /// </summary>
+    static std::int64_t bucketLowestValue(std::size_t index) {
+        if (index < subBucketsNum) { return static_cast<std::int64_t>(index); }
+
+        const std::uint64_t shift { index / subBucketsNum - 1 };
+        const std::uint64_t subBucket { index % subBucketsNum };
+
+        return static_cast<std::int64_t>((subBucketsNum + subBucket) << shift);
+    }
+
+    /// <summary>
+    ///  Gets the highest value counted in the supplied bucket.
+    /// </summary>
+    static std::int64_t bucketHighestValue(std::size_t index) {
+        return bucketLowestValue(index + 1) - 1;
+    }
+
+    /// <summary>
+    ///  Counts a value, negative values are counted as 0.
+    /// </summary>
+    void record(std::int64_t value) {
+        if (value < 0) { value = 0; }
+        if (value > maxTrackableValue) { value = maxTrackableValue; }
+
+        const std::size_t index { bucketIndex(value) };
+        if (index >= counts.size()) {
+            counts.resize(index + 1, 0);
+        }
+
+        counts[index]++;
+
+        if (totalCount == 0 || value < lowestValue) { lowestValue = value; }
+        if (totalCount == 0 || value > highestValue) { highestValue = value; }
+
+        totalCount++;
+        sum += static_cast<double>(value);
+    }
+
+    /// <summary>
+    ///  Adds the values counted by other histogram to this one.
+    /// </summary>
+    void merge(const LatencyHistogram& other) {
+        if (other.totalCount == 0) { return; }
+
+        if (other.counts.size() > counts.size()) {
+            counts.resize(other.counts.size(), 0);
+        }
+        for (std::size_t i = 0; i < other.counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+
+        if (totalCount == 0 || other.lowestValue < lowestValue) { lowestValue = other.lowestValue; }
+        if (totalCount == 0 || other.highestValue > highestValue) { highestValue = other.highestValue; }
+
+        totalCount += other.totalCount;
+        sum += other.sum;
+    }
+
+    std::uint64_t count() const { return totalCount; }
+    std::int64_t minimum() const { return lowestValue; }
+    std::int64_t maximum() const { return highestValue; }
+    double mean() const { return totalCount == 0 ? 0 : sum / static_cast<double>(totalCount); }
+
+    /// <summary>
+    ///  Gets the value below which the supplied percentage of the recorded
+    ///  values fall. As with HdrHistogram, the highest value of the bucket is
+    ///  reported, never exceeding the highest recorded value.
+    /// </summary>
+    /// <param name="percentile">The percentile, between 0 and 100.</param>
+    /// <returns>The value at the percentile, or 0 if nothing was recorded.</returns>
+    std::int64_t valueAtPercentile(double percentile) const {
+        if (totalCount == 0) { return 0; }
+        if (percentile < 0) { percentile = 0; }
+        if (percentile > 100) { percentile = 100; }
+
+        std::uint64_t targetCount {
+            static_cast<std::uint64_t>(percentile / 100 * static_cast<double>(totalCount) + 0.5)
+        };
+        if (targetCount == 0) { targetCount = 1; }
+
+        std::uint64_t accumulated { 0 };
+        for (std::size_t i = 0; i < counts.size(); i++) {
+            accumulated += counts[i];
+
+            if (accumulated >= targetCount) {
+                const std::int64_t highest { bucketHighestValue(i) };
+                return highest < highestValue ? highest : highestValue;
+            }
+        }
+
+        return highestValue;
+    }
+
+    /// <summary>
+    ///  Discards the recorded values.
+    /// </summary>
+    void reset() {
+        counts.clear();
+        totalCount = 0;
+        lowestValue = 0;
+        highestValue = 0;
+        sum = 0;
+    }
+};
+
+/// <summary>
+///  Phases of the operations over a setting that are measured.
+/// </summary>
+enum class StatsPhase {
+    /// <summary>
+    ///  Loading the setting, including the load of its library.
+    /// </summary>
+    Load = 0,
+    /// <summary>
+    ///  Reading a value from the setting.
+    /// </summary>
+    Get,
+    /// <summary>
+    ///  Applying a value to the setting, without waiting for it to complete.
+    /// </summary>
+    Set,
+    /// <summary>
+    ///  Waiting for the setting to finish applying a value.
+    /// </summary>
+    Wait
+};
+
+/// <summary>
+///  Number of values of StatsPhase.
+/// </summary>
+constexpr std::size_t statsPhasesNum { 4 };
+
+/// <summary>
+///  Events that are counted.
+/// </summary>
+enum class StatsCounter {
+    /// <summary>
+    ///  Setting libraries loaded with 'LoadLibrary'.
+    /// </summary>
+    DllLoads = 0,
+    /// <summary>
+    ///  Setting loads served by a library that was already loaded.
+    /// </summary>
+    CacheHits,
+    /// <summary>
+    ///  Settings that didn't finish updating in the expected time.
+    /// </summary>
+    Timeouts,
+    /// <summary>
+    ///  Settings rejected for being in 'KnownFaultySettings'.
+    /// </summary>
+    FaultyRejections,
+    /// <summary>
+    ///  Settings rejected for being in the learned quarantine.
+    /// </summary>
+    QuarantineRejections,
+    /// <summary>
+    ///  Settings rejected for being cataloged as failing to load.
+    /// </summary>
+    CatalogRejections,
+    /// <summary>
+    ///  Actions of a batch answered without being run, see 'planBatch'.
+    /// </summary>
+    CoalescedActions,
+    /// <summary>
+    ///  Actions served by a NativeHandler instead of the system settings.
+    /// </summary>
+    NativeActions,
+    /// <summary>
+    ///  Payloads compiled into a plan by the engine of the Node addon.
+    /// </summary>
+    CompiledPlans,
+    /// <summary>
+    ///  Payloads run from a plan compiled for a previous run.
+    /// </summary>
+    CachedPlanRuns,
+    /// <summary>
+    ///  Actions not run because the deadline of their batch expired.
+    /// </summary>
+    ExpiredActions
+};
+
+/// <summary>
+///  Number of values of StatsCounter.
+/// </summary>
+constexpr std::size_t statsCountersNum { 11 };
+
+/// <summary>
+///  Name used for each StatsPhase in the serialized stats.
+/// </summary>
+inline const char* statsPhaseName(StatsPhase phase) {
+    static const char* const names[statsPhasesNum] { "load", "get", "set", "wait" };
+    return names[static_cast<std::size_t>(phase)];
+}
+
+/// <summary>
+///  Name used for each StatsCounter in the serialized stats.
+/// </summary>
+inline const char* statsCounterName(StatsCounter counter) {
+    static const char* const names[statsCountersNum] {
+        "dllLoads", "cacheHits", "timeouts", "faultyRejections", "quarantineRejections", "catalogRejections",
+        "coalescedActions", "nativeActions", "compiledPlans", "cachedPlanRuns", "expiredActions"
+    };
+    return names[static_cast<std::size_t>(counter)];
+}
+
+/// <summary>
+///  Histograms of one setting, indexed by StatsPhase.
+/// </summary>
+using PhaseHistograms = std::array<LatencyHistogram, statsPhasesNum>;
+
+/// <summary>
+///  Appends a wide string to a JSON string literal using only ASCII, non ASCII
+///  characters are written as '\u' escapes. The result can be widened as is.
+/// </summary>
+inline void appendJsonAscii(WStringView str, std::string& rOut) {
+    static const char hexDigits[] { "0123456789abcdef" };
+
+    for (std::size_t i = 0; i < str.size(); i++) {
+        const std::uint32_t c { static_cast<std::uint32_t>(str[i]) };
+
+        if (c == '"' || c == '\\') {
+            rOut.push_back('\\');
+            rOut.push_back(static_cast<char>(c));
+        } else if (c >= 0x20 && c < 0x80) {
+            rOut.push_back(static_cast<char>(c));
+        } else if (c <= 0xFFFF) {
+            // UTF-16 surrogates are escaped one by one, as JSON expects
+            rOut.append("\\u");
+            rOut.push_back(hexDigits[(c >> 12) & 0xF]);
+            rOut.push_back(hexDigits[(c >> 8) & 0xF]);
+            rOut.push_back(hexDigits[(c >> 4) & 0xF]);
+            rOut.push_back(hexDigits[c & 0xF]);
+        } else {
+            // Characters outside the BMP, found where wchar_t is 32 bits wide
+            const std::uint32_t v { c - 0x10000 };
+            const std::uint32_t pair[2] { 0xD800 + (v >> 10), 0xDC00 + (v & 0x3FF) };
+
+            for (const std::uint32_t unit : pair) {
+                rOut.append("\\u");
+                rOut.push_back(hexDigits[(unit >> 12) & 0xF]);
+                rOut.push_back(hexDigits[(unit >> 8) & 0xF]);
+                rOut.push_back(hexDigits[(unit >> 4) & 0xF]);
+                rOut.push_back(hexDigits[unit & 0xF]);
+            }
+        }
+    }
+}
+
+/// <summary>
+///  Appends the summary of a histogram as a JSON object, latencies are in
+///  microseconds.
+/// </summary>
+inline void appendHistogramJson(const LatencyHistogram& histogram, std::string& rOut) {
+    rOut.append("{\"count\":").append(std::to_string(histogram.count()));
+    rOut.append(",\"minUs\":").append(std::to_string(histogram.minimum()));
+    rOut.append(",\"meanUs\":").append(std::to_string(static_cast<std::int64_t>(histogram.mean() + 0.5)));
+    rOut.append(",\"p50Us\":").append(std::to_string(histogram.valueAtPercentile(50)));
+    rOut.append(",\"p90Us\":").append(std::to_string(histogram.valueAtPercentile(90)));
+    rOut.append(",\"p99Us\":").append(std::to_string(histogram.valueAtPercentile(99)));
+    rOut.append(",\"p999Us\":").append(std::to_string(histogram.valueAtPercentile(99.9)));
+    rOut.append(",\"maxUs\":").append(std::to_string(histogram.maximum()));
+    rOut.append("}");
+}
+
+/// <summary>
+///  Process-wide latency histograms, per setting and per phase, and event
+///  counters. Unlike the tracer it's always collecting, its cost is a lock and
+///  a map lookup per operation, negligible next to the calls it measures.
+/// </summary>
+class SettingsStats {
+private:
+    NativeMutex histogramsMutex {};
+    std::map<std::wstring, PhaseHistograms> settings {};
+    std::array<std::atomic<std::uint64_t>, statsCountersNum> counters {};
+    std::chrono::steady_clock::time_point origin { std::chrono::steady_clock::now() };
+
+public:
+    SettingsStats() {
+        for (auto& counter : counters) { counter.store(0); }
+    }
+    SettingsStats(const SettingsStats&) = delete;
+    SettingsStats& operator=(const SettingsStats&) = delete;
+
+    /// <summary>
+    ///  Gets the process-wide stats.
+    /// </summary>
+    static SettingsStats& instance() {
+        static SettingsStats stats {};
+        return stats;
+    }
+
+    /// <summary>
+    ///  Microseconds elapsed since the stats were created or reset.
+    /// </summary>
+    std::int64_t uptimeUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin
+        ).count();
+    }
+
+    /// <summary>
+    ///  Records the latency of a phase over a setting.
+    /// </summary>
+    void record(WStringView settingId, StatsPhase phase, std::int64_t latencyUs) {
+        NativeLockGuard lock { histogramsMutex };
+        settings[settingId.str()][static_cast<std::size_t>(phase)].record(latencyUs);
+    }
+
+    /// <summary>
+    ///  Increments one of the counters by the supplied amount.
+    /// </summary>
+    void increment(StatsCounter counter, std::uint64_t amount = 1) {
+        counters[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    ///  Gets the current value of one of the counters.
+    /// </summary>
+    std::uint64_t getCounter(StatsCounter counter) const {
+        return counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    ///  Gets a copy of the histograms of a setting, empty if nothing was
+    ///  recorded for it.
+    /// </summary>
+    PhaseHistograms getSetting(WStringView settingId) {
+        NativeLockGuard lock { histogramsMutex };
+        const auto entry = settings.find(settingId.str());
+
+        return entry != settings.end() ? entry->second : PhaseHistograms {};
+    }
+
+    /// <summary>
+    ///  Gets the histograms of every setting merged into one per phase.
+    /// </summary>
+    PhaseHistograms getTotals() {
+        NativeLockGuard lock { histogramsMutex };
+        PhaseHistograms totals {};
+
+        for (const auto& entry : settings) {
+            for (std::size_t i = 0; i < statsPhasesNum; i++) {
+                totals[i].merge(entry.second[i]);
+            }
+        }
+
+        return totals;
+    }
+
+    /// <summary>
+    ///  Discards the recorded latencies and resets the counters.
+    /// </summary>
+    void reset() {
+        NativeLockGuard lock { histogramsMutex };
+
+        settings.clear();
+        for (auto& counter : counters) { counter.store(0); }
+        origin = std::chrono::steady_clock::now();
+    }
+
+    /// <summary>
+    ///  Serializes the stats as an ASCII JSON object holding the uptime, the
+    ///  counters, the histograms of each phase over every setting, and the
+    ///  histograms of each setting. Phases without latencies are omitted.
+    /// </summary>
+    /// <param name="settingId">
+    ///  If not empty, only the histograms of this setting are included.
+    /// </param>
+    std::string toJson(WStringView settingId = WStringView {}) {
+        const PhaseHistograms totals { getTotals() };
+        std::string json {};
+
+        json.append("{\"uptimeMs\":").append(std::to_string(uptimeUs() / 1000));
+
+        json.append(",\"counters\":{");
+        for (std::size_t i = 0; i < statsCountersNum; i++) {
+            const StatsCounter counter { static_cast<StatsCounter>(i) };
+
+            if (i != 0) { json.append(","); }
+            json.append("\"").append(statsCounterName(counter)).append("\":");
+            json.append(std::to_string(getCounter(counter)));
+        }
+        json.append("}");
+
+        json.append(",\"phases\":");
+        appendPhasesJson(totals, json);
+
+        json.append(",\"settings\":{");
+        {
+            NativeLockGuard lock { histogramsMutex };
+            bool first { true };
+
+            for (const auto& entry : settings) {
+                if (settingId.empty() == false && settingId != entry.first) { continue; }
+
+                if (first == false) { json.append(","); }
+                first = false;
+
+                json.append("\"");
+                appendJsonAscii(WStringView { entry.first }, json);
+                json.append("\":");
+                appendPhasesJson(entry.second, json);
+            }
+        }
+        json.append("}}");
+
+        return json;
+    }
+
+    /// <summary>
+    ///  Writes the JSON stats to the supplied stream.
+    /// </summary>
+    void writeJson(std::ostream& out) {
+        out << toJson();
+    }
+
+private:
+    static void appendPhasesJson(const PhaseHistograms& histograms, std::string& rOut) {
+        bool first { true };
+
+        rOut.append("{");
+        for (std::size_t i = 0; i < statsPhasesNum; i++) {
+            if (histograms[i].count() == 0) { continue; }
+
+            if (first == false) { rOut.append(","); }
+            first = false;
+
+            rOut.append("\"").append(statsPhaseName(static_cast<StatsPhase>(i))).append("\":");
+            appendHistogramJson(histograms[i], rOut);
+        }
+        rOut.append("}");
+    }
+};
+
+/// <summary>
+///  Records the latency of the phase spanning the lifetime of the scope.
+///
+///  NOTE: 'settingId' isn't copied until the scope ends, so it needs to outlive
+///  the scope.
+/// </summary>
+class StatsScope {
+private:
+    WStringView settingId {};
+    StatsPhase phase { StatsPhase::Load };
+    std::chrono::steady_clock::time_point start { std::chrono::steady_clock::now() };
+
+public:
+    StatsScope(StatsPhase phase, WStringView settingId) : settingId(settingId), phase(phase) {}
+    ~StatsScope() {
+        const std::int64_t latencyUs {
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start
+            ).count()
+        };
+
+        SettingsStats::instance().record(settingId, phase, latencyUs);
+    }
+
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+};
@@ -0,0 +1,209 @@
+/**
+ * Deterministic behavior of the simulated settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+///  Operations of a simulated setting in which failures can be injected.
+/// </summary>
+enum class SimulatedOperation {
+    GetSetting = 0,
+    GetValue,
+    SetValue,
+    GetProperty,
+    Invoke
+};
+
+/// <summary>
+///  Number of values in SimulatedOperation.
+/// </summary>
+constexpr std::size_t simulatedOperationsNum { 5 };
+
+/// <summary>
+///  Failure injected into one of the operations of a simulated setting.
+/// </summary>
+struct SimulatedFailure {
+    /// <summary>
+    ///  The error code returned by the failing calls, 0 disables the failure.
+    /// </summary>
+    std::int32_t errorCode;
+    /// <summary>
+    ///  Number of successful calls before the first failure.
+    /// </summary>
+    std::uint32_t skipCalls;
+    /// <summary>
+    ///  Once failing, one every 'failEvery' calls fails, 1 makes every call fail.
+    /// </summary>
+    std::uint32_t failEvery;
+};
+
+/// <summary>
+///  Timings and failures of a simulated setting. Timings are measured in
+///  'IsUpdating' polls instead of wall clock time, so the simulation is
+///  deterministic regardless of the sleeps done between the polls. The only
+///  wall clock timings are the optional latencies of the calls, used to replay
+///  recorded sessions.
+/// </summary>
+struct SimulatedBehavior {
+    /// <summary>
+    ///  Value used in 'changeEventPolls' for settings that never raise
+    ///  'SettingChanged'.
+    /// </summary>
+    static constexpr std::int32_t neverRaised { -1 };
+
+    /// <summary>
+    ///  Number of polls in which 'IsUpdating' stays TRUE after the setting is
+    ///  created, or after one of its values is set.
+    /// </summary>
+    std::uint32_t updatingPolls { 0 };
+    /// <summary>
+    ///  Number of polls after setting a value before 'SettingChanged' is raised.
+    ///  With 0 the event is raised from within 'SetValue'.
+    /// </summary>
+    std::int32_t changeEventPolls { 0 };
+    /// <summary>
+    ///  Failures injected in each operation, indexed by SimulatedOperation.
+    /// </summary>
+    std::array<SimulatedFailure, simulatedOperationsNum> failures {};
+    /// <summary>
+    ///  Time spent by each call to the operations, in microseconds, indexed by
+    ///  SimulatedOperation. With 0 the calls return right away.
+    /// </summary>
+    std::array<std::uint32_t, simulatedOperationsNum> latenciesUs {};
+
+    /// <summary>
+    ///  Injects a failure in the supplied operation.
+    /// </summary>
+    SimulatedBehavior& fail(SimulatedOperation op, std::int32_t errorCode, std::uint32_t skipCalls = 0, std::uint32_t failEvery = 1) {
+        failures[static_cast<std::size_t>(op)] = SimulatedFailure { errorCode, skipCalls, failEvery };
+        return *this;
+    }
+    /// <summary>
+    ///  Sets the time spent by each call to the supplied operation.
+    /// </summary>
+    SimulatedBehavior& delay(SimulatedOperation op, std::uint32_t latencyUs) {
+        latenciesUs[static_cast<std::size_t>(op)] = latencyUs;
+        return *this;
+    }
+};
+
+/// <summary>
+///  Tracks the state of a simulated setting following its SimulatedBehavior.
+///  It holds no platform specific code, the COM objects of the simulated
+///  backend forward the calls they receive to it.
+/// </summary>
+class SimulatedSettingState {
+private:
+    SimulatedBehavior behavior {};
+    std::uint32_t remainingUpdatingPolls { 0 };
+    std::int32_t remainingEventPolls { SimulatedBehavior::neverRaised };
+    std::array<std::uint32_t, simulatedOperationsNum> calls {};
+    std::uint32_t isUpdatingPolls { 0 };
+
+public:
+    SimulatedSettingState() {}
+    explicit SimulatedSettingState(const SimulatedBehavior& behavior) :
+        behavior(behavior), remainingUpdatingPolls(behavior.updatingPolls) {}
+
+    const SimulatedBehavior& getBehavior() const { return behavior; }
+    /// <summary>
+    ///  Replaces the behavior, restarting the 'IsUpdating' countdown.
+    /// </summary>
+    void setBehavior(const SimulatedBehavior& newBehavior) {
+        behavior = newBehavior;
+        remainingUpdatingPolls = behavior.updatingPolls;
+        remainingEventPolls = SimulatedBehavior::neverRaised;
+    }
+
+    /// <summary>
+    ///  Registers a call to the supplied operation, returning the error code that
+    ///  the call should fail with, or 0 if it should succeed.
+    /// </summary>
+    std::int32_t onCall(SimulatedOperation op) {
+        const std::size_t index { static_cast<std::size_t>(op) };
+        const SimulatedFailure& failure { behavior.failures[index] };
+        const std::uint32_t callIndex { calls[index]++ };
+
+        if (failure.errorCode == 0 || callIndex < failure.skipCalls) {
+            return 0;
+        }
+
+        const std::uint32_t failEvery { failure.failEvery == 0 ? 1 : failure.failEvery };
+        return (callIndex - failure.skipCalls) % failEvery == 0 ? failure.errorCode : 0;
+    }
+
+    /// <summary>
+    ///  Registers that a value has been set, returning true if 'SettingChanged'
+    ///  should be raised right away.
+    /// </summary>
+    bool onValueSet() {
+        remainingUpdatingPolls = behavior.updatingPolls;
+
+        if (behavior.changeEventPolls == 0) {
+            remainingEventPolls = SimulatedBehavior::neverRaised;
+            return true;
+        } else {
+            remainingEventPolls = behavior.changeEventPolls;
+            return false;
+        }
+    }
+
+    /// <summary>
+    ///  Registers a poll of 'IsUpdating'.
+    /// </summary>
+    /// <param name="rRaiseChanged">
+    ///  Set to true if 'SettingChanged' should be raised after this poll.
+    /// </param>
+    /// <returns>The value that 'IsUpdating' should report.</returns>
+    bool pollIsUpdating(bool& rRaiseChanged) {
+        isUpdatingPolls++;
+        rRaiseChanged = false;
+
+        if (remainingEventPolls > 0) {
+            remainingEventPolls--;
+
+            if (remainingEventPolls == 0) {
+                remainingEventPolls = SimulatedBehavior::neverRaised;
+                rRaiseChanged = true;
+            }
+        }
+
+        if (remainingUpdatingPolls > 0) {
+            remainingUpdatingPolls--;
+            return true;
+        }
+
+        return false;
+    }
+
+    /// <summary>
+    ///  Time that each call to the supplied operation should take, in microseconds.
+    /// </summary>
+    std::uint32_t latencyOf(SimulatedOperation op) const {
+        return behavior.latenciesUs[static_cast<std::size_t>(op)];
+    }
+
+    /// <summary>
+    ///  Number of calls received by the supplied operation, failed ones included.
+    /// </summary>
+    std::uint32_t callsTo(SimulatedOperation op) const {
+        return calls[static_cast<std::size_t>(op)];
+    }
+    /// <summary>
+    ///  Number of times 'IsUpdating' has been polled.
+    /// </summary>
+    std::uint32_t pollsCount() const { return isUpdatingPolls; }
+};
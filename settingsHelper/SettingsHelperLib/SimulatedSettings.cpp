@@ -0,0 +1,582 @@
+/**
+ * In-memory settings backend, used to exercise the library without the system
+ * settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "SimulatedSettings.h"
+#include "DynamicSettingsDatabase.h"
+#include "IPropertyValueUtils.h"
+
+#include <chrono>
+
+#pragma comment (lib, "WindowsApp.lib")
+
+/// <summary>
+///  Gets the contents of a HSTRING, empty for NULL strings.
+/// </summary>
+std::wstring hstringToWString(HSTRING hStr) {
+    UINT32 length { 0 };
+    PCWSTR buffer { WindowsGetStringRawBuffer(hStr, &length) };
+
+    return std::wstring { buffer, length };
+}
+
+/// <summary>
+///  Registers a call to the supplied operation, spending the latency set for it
+///  in the behavior of the setting.
+/// </summary>
+/// <returns>The error code the call should fail with, or ERROR_SUCCESS.</returns>
+HRESULT simulateCall(SimulatedSettingState& state, SimulatedOperation op) {
+    const std::uint32_t latencyUs { state.latencyOf(op) };
+
+    if (latencyUs != 0) {
+        // Sleep has a resolution of milliseconds, the wait is spun instead so
+        // short latencies are honored
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds { latencyUs };
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            SwitchToThread();
+        }
+    }
+
+    return state.onCall(op);
+}
+
+// -----------------------------------------------------------------------------
+//                         SimulatedSettingItem
+// -----------------------------------------------------------------------------
+
+//  ---------------------------  Private  --------------------------------------
+
+void SimulatedSettingItem::raiseSettingChanged(const std::wstring& valueId) {
+    HSTRING hValueId { NULL };
+    WindowsCreateString(valueId.c_str(), static_cast<UINT32>(valueId.size()), &hValueId);
+
+    // Handlers may unregister themselves while being invoked
+    const auto curHandlers = this->handlers;
+    for (const auto& handler : curHandlers) {
+        handler.second->Invoke(static_cast<IInspectable*>(this), hValueId);
+    }
+
+    WindowsDeleteString(hValueId);
+}
+
+//  ---------------------------  Public  ---------------------------------------
+
+SimulatedSettingItem::SimulatedSettingItem(std::wstring id, SettingType type, const SimulatedBehavior& behavior) :
+    id(std::move(id)), type(type), state(behavior) {}
+
+void SimulatedSettingItem::putValue(const std::wstring& valueId, IInspectable* value) {
+    this->values[valueId] = value;
+}
+
+void SimulatedSettingItem::putProperty(const std::wstring& propId, IInspectable* value) {
+    this->properties[propId] = value;
+}
+
+ATL::CComPtr<IInspectable> SimulatedSettingItem::peekValue(const std::wstring& valueId) const {
+    const auto value = this->values.find(valueId);
+    return value != this->values.end() ? value->second : ATL::CComPtr<IInspectable> { NULL };
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingItem::QueryInterface(REFIID riid, void** ppv) {
+    if (ppv == NULL) { return E_POINTER; }
+
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IInspectable) || riid == __uuidof(ISettingItem)) {
+        *ppv = static_cast<ISettingItem*>(this);
+        AddRef();
+
+        return S_OK;
+    }
+
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SimulatedSettingItem::AddRef() {
+    return ++this->refCount;
+}
+
+ULONG STDMETHODCALLTYPE SimulatedSettingItem::Release() {
+    const ULONG count { --this->refCount };
+    if (count == 0) { delete this; }
+
+    return count;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingItem::GetIids(ULONG* iidCount, IID** iids) {
+    *iidCount = 0;
+    *iids = NULL;
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingItem::GetRuntimeClassName(HSTRING* className) {
+    *className = NULL;
+    return E_NOTIMPL;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingItem::GetTrustLevel(TrustLevel* trustLevel) {
+    *trustLevel = BaseTrust;
+    return S_OK;
+}
+
+int SimulatedSettingItem::get_Id(HSTRING* rId) {
+    return WindowsCreateString(this->id.c_str(), static_cast<UINT32>(this->id.size()), rId);
+}
+
+int SimulatedSettingItem::get_SettingType(SettingType* val) {
+    *val = this->type;
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::get_IsSetByGroupPolicy(BOOL* val) {
+    *val = FALSE;
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::get_IsEnabled(BOOL* val) {
+    *val = TRUE;
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::get_IsApplicable(BOOL* val) {
+    *val = TRUE;
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::get_Description(HSTRING* desc) {
+    return WindowsCreateString(this->description.c_str(), static_cast<UINT32>(this->description.size()), desc);
+}
+
+int SimulatedSettingItem::get_IsUpdating(BOOL* val) {
+    bool raiseChanged { false };
+    *val = this->state.pollIsUpdating(raiseChanged) ? TRUE : FALSE;
+
+    if (raiseChanged) {
+        raiseSettingChanged(L"Value");
+    }
+
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::GetValue(HSTRING__* name, IInspectable** item) {
+    const HRESULT injected { simulateCall(this->state, SimulatedOperation::GetValue) };
+    if (injected != ERROR_SUCCESS) { return injected; }
+
+    const auto value = this->values.find(hstringToWString(name));
+    if (value == this->values.end()) { return E_INVALIDARG; }
+
+    return value->second.CopyTo(item);
+}
+
+HRESULT SimulatedSettingItem::SetValue(HSTRING__* name, IInspectable* item) {
+    const HRESULT injected { simulateCall(this->state, SimulatedOperation::SetValue) };
+    if (injected != ERROR_SUCCESS) { return injected; }
+
+    const std::wstring valueId { hstringToWString(name) };
+    this->values[valueId] = item;
+
+    if (this->state.onValueSet()) {
+        raiseSettingChanged(valueId);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::GetProperty(HSTRING__* name, IInspectable** item) {
+    const HRESULT injected { simulateCall(this->state, SimulatedOperation::GetProperty) };
+    if (injected != ERROR_SUCCESS) { return injected; }
+
+    const auto prop = this->properties.find(hstringToWString(name));
+    if (prop == this->properties.end()) { return E_NOTIMPL; }
+
+    return prop->second.CopyTo(item);
+}
+
+int SimulatedSettingItem::SetProperty(HSTRING__* name, IInspectable* item) {
+    this->properties[hstringToWString(name)] = item;
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::Invoke(ABI::Windows::UI::Core::ICoreWindow*, IInspectable*) {
+    if (this->type != SettingType::Action) { return E_NOTIMPL; }
+
+    return simulateCall(this->state, SimulatedOperation::Invoke);
+}
+
+int SimulatedSettingItem::add_SettingChanged(
+    ABI::Windows::Foundation::ITypedEventHandler<IInspectable*, HSTRING__*>* eventHnd,
+    EventRegistrationToken* token
+) {
+    if (eventHnd == NULL || token == NULL) { return E_POINTER; }
+
+    token->value = this->nextToken++;
+    this->handlers.push_back({ token->value, eventHnd });
+
+    return ERROR_SUCCESS;
+}
+
+int SimulatedSettingItem::remove_SettingChanged(EventRegistrationToken token) {
+    for (auto handler = this->handlers.begin(); handler != this->handlers.end(); handler++) {
+        if (handler->first == token.value) {
+            this->handlers.erase(handler);
+            break;
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+//                         SimulatedSettingsVector
+// -----------------------------------------------------------------------------
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::QueryInterface(REFIID riid, void** ppv) {
+    if (ppv == NULL) { return E_POINTER; }
+
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IInspectable)) {
+        *ppv = static_cast<IInspectable*>(this);
+        AddRef();
+
+        return S_OK;
+    }
+
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SimulatedSettingsVector::AddRef() {
+    return ++this->refCount;
+}
+
+ULONG STDMETHODCALLTYPE SimulatedSettingsVector::Release() {
+    const ULONG count { --this->refCount };
+    if (count == 0) { delete this; }
+
+    return count;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::GetIids(ULONG* iidCount, IID** iids) {
+    *iidCount = 0;
+    *iids = NULL;
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::GetRuntimeClassName(HSTRING* className) {
+    *className = NULL;
+    return E_NOTIMPL;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::GetTrustLevel(TrustLevel* trustLevel) {
+    *trustLevel = BaseTrust;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::GetAt(unsigned index, IInspectable** item) {
+    if (index >= this->items.size()) { return E_BOUNDS; }
+
+    return this->items[index].CopyTo(item);
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::get_Size(unsigned* size) {
+    *size = static_cast<unsigned>(this->items.size());
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::GetView(
+    ABI::Windows::Foundation::Collections::IVectorView<IInspectable*>** view
+) {
+    *view = NULL;
+    return E_NOTIMPL;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::IndexOf(IInspectable* value, unsigned* index, boolean* found) {
+    *found = false;
+
+    for (std::size_t i = 0; i < this->items.size(); i++) {
+        if (this->items[i] == value) {
+            *index = static_cast<unsigned>(i);
+            *found = true;
+            break;
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::SetAt(unsigned index, IInspectable* item) {
+    if (index >= this->items.size()) { return E_BOUNDS; }
+
+    this->items[index] = item;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::InsertAt(unsigned index, IInspectable* item) {
+    if (index > this->items.size()) { return E_BOUNDS; }
+
+    this->items.insert(this->items.begin() + index, ATL::CComPtr<IInspectable> { item });
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::RemoveAt(unsigned index) {
+    if (index >= this->items.size()) { return E_BOUNDS; }
+
+    this->items.erase(this->items.begin() + index);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::Append(IInspectable* item) {
+    this->items.push_back(ATL::CComPtr<IInspectable> { item });
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::RemoveAtEnd() {
+    if (this->items.empty()) { return E_BOUNDS; }
+
+    this->items.pop_back();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::Clear() {
+    this->items.clear();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::GetMany(
+    unsigned startIndex, unsigned capacity, IInspectable** value, unsigned* actual
+) {
+    *actual = 0;
+
+    for (unsigned i = startIndex; i < this->items.size() && *actual < capacity; i++, (*actual)++) {
+        this->items[i].CopyTo(&value[*actual]);
+    }
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsVector::ReplaceAll(unsigned count, IInspectable** value) {
+    this->items.assign(value, value + count);
+    return S_OK;
+}
+
+// -----------------------------------------------------------------------------
+//                         SimulatedSettingsDatabase
+// -----------------------------------------------------------------------------
+
+void SimulatedSettingsDatabase::addSetting(const ATL::CComPtr<SimulatedSettingItem>& setting) {
+    this->settings[setting->getId()] = setting;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsDatabase::QueryInterface(REFIID riid, void** ppv) {
+    if (ppv == NULL) { return E_POINTER; }
+
+    if (
+        riid == __uuidof(IUnknown) ||
+        riid == __uuidof(IInspectable) ||
+        riid == __uuidof(IDynamicSettingsDatabase)
+    ) {
+        *ppv = static_cast<IDynamicSettingsDatabase*>(this);
+        AddRef();
+
+        return S_OK;
+    }
+
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SimulatedSettingsDatabase::AddRef() {
+    return ++this->refCount;
+}
+
+ULONG STDMETHODCALLTYPE SimulatedSettingsDatabase::Release() {
+    const ULONG count { --this->refCount };
+    if (count == 0) { delete this; }
+
+    return count;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsDatabase::GetIids(ULONG* iidCount, IID** iids) {
+    *iidCount = 0;
+    *iids = NULL;
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsDatabase::GetRuntimeClassName(HSTRING* className) {
+    *className = NULL;
+    return E_NOTIMPL;
+}
+
+HRESULT STDMETHODCALLTYPE SimulatedSettingsDatabase::GetTrustLevel(TrustLevel* trustLevel) {
+    *trustLevel = BaseTrust;
+    return S_OK;
+}
+
+HRESULT SimulatedSettingsDatabase::GetSetting(HSTRING id, ISettingItem** setting) {
+    const auto dbSetting = this->settings.find(hstringToWString(id));
+    if (dbSetting == this->settings.end()) { return E_INVALIDARG; }
+
+    dbSetting->second->AddRef();
+    *setting = dbSetting->second;
+
+    return ERROR_SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+//                         SimulatedSettingsBackend
+// -----------------------------------------------------------------------------
+
+void SimulatedSettingsBackend::addSetting(const ATL::CComPtr<SimulatedSettingItem>& setting) {
+    this->settings[SettingAtom { setting->getId() }] = setting;
+}
+
+SimulatedSettingItem* SimulatedSettingsBackend::findSetting(const SettingAtom& settingId) const {
+    const auto setting = this->settings.find(settingId);
+    return setting != this->settings.end() ? static_cast<SimulatedSettingItem*>(setting->second) : NULL;
+}
+
+HRESULT SimulatedSettingsBackend::load() {
+    this->loaded = true;
+    return ERROR_SUCCESS;
+}
+
+BOOL SimulatedSettingsBackend::isLoaded() const {
+    return this->loaded;
+}
+
+HRESULT SimulatedSettingsBackend::getSetting(const SettingAtom& settingId, ISettingItem** rSetting) {
+    SimulatedSettingItem* setting { findSetting(settingId) };
+    if (setting == NULL) { return ERROR_OPEN_FAILED; }
+
+    const HRESULT injected { simulateCall(setting->getState(), SimulatedOperation::GetSetting) };
+    if (injected != ERROR_SUCCESS) { return injected; }
+
+    setting->AddRef();
+    *rSetting = setting;
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT SimulatedSettingsBackend::getSettingIds(std::vector<std::wstring>& rSettingIds) {
+    for (const auto& setting : this->settings) {
+        rSettingIds.push_back(setting.first.str());
+    }
+
+    return ERROR_SUCCESS;
+}
+
+HRESULT SimulatedSettingsBackend::unload() {
+    return ERROR_SUCCESS;
+}
+
+// -----------------------------------------------------------------------------
+//                         Factory functions
+// -----------------------------------------------------------------------------
+
+ATL::CComPtr<SimulatedSettingItem> createSimulatedSetting(
+    const std::wstring& settingId,
+    SettingType type,
+    IInspectable* value,
+    const SimulatedBehavior& behavior
+) {
+    ATL::CComPtr<SimulatedSettingItem> setting {};
+    setting.Attach(new SimulatedSettingItem { settingId, type, behavior });
+
+    if (value != NULL) {
+        setting->putValue(L"Value", value);
+    }
+
+    return setting;
+}
+
+/// <summary>
+///  Creates a Boolean IPropertyValue holding 'false'.
+/// </summary>
+ATL::CComPtr<IInspectable> createFalseValue() {
+    VARIANT variant {};
+    variant.vt = VARENUM::VT_BOOL;
+    variant.boolVal = VARIANT_FALSE;
+
+    ATL::CComPtr<IPropertyValue> propValue { NULL };
+    createPropertyValue(variant, propValue);
+
+    return ATL::CComPtr<IInspectable> { static_cast<IInspectable*>(propValue) };
+}
+
+ATL::CComPtr<SimulatedSettingItem> createSimulatedCollection(
+    const std::wstring& settingId,
+    const std::vector<std::wstring>& elemIds,
+    const SimulatedBehavior& elemBehavior
+) {
+    const SettingAtom collectionId { settingId };
+    std::vector<SettingAtom> dbSettingIds {};
+
+    if (isSupportedDb(collectionId)) {
+        getSupportedDbSettings(DynamicSettingDatabase { collectionId, NULL }, dbSettingIds);
+    }
+
+    ATL::CComPtr<SimulatedSettingsVector> elems {};
+    elems.Attach(new SimulatedSettingsVector {});
+
+    for (std::size_t i = 0; i < elemIds.size(); i++) {
+        ATL::CComPtr<SimulatedSettingItem> elem {
+            createSimulatedSetting(elemIds[i], SettingType::Boolean, NULL, elemBehavior)
+        };
+        elem->setDescription(L"Simulated Application " + std::to_wstring(i));
+
+        if (dbSettingIds.empty() == false) {
+            ATL::CComPtr<SimulatedSettingsDatabase> database {};
+            database.Attach(new SimulatedSettingsDatabase {});
+
+            for (const auto& dbSettingId : dbSettingIds) {
+                database->addSetting(
+                    createSimulatedSetting(dbSettingId.str(), SettingType::Boolean, createFalseValue(), elemBehavior)
+                );
+            }
+
+            elem->putProperty(L"DynamicSettingsDatabaseValue", static_cast<IDynamicSettingsDatabase*>(database));
+        }
+
+        elems->Append(static_cast<ISettingItem*>(elem));
+    }
+
+    return createSimulatedSetting(
+        settingId,
+        SettingType::SettingCollection,
+        static_cast<IInspectable*>(elems),
+        SimulatedBehavior {}
+    );
+}
+
+ATL::CComPtr<SimulatedSettingItem> createSimulatedCollection(
+    const std::wstring& settingId,
+    std::size_t elemsNum,
+    std::vector<std::wstring>& elemIds,
+    const SimulatedBehavior& elemBehavior
+) {
+    std::vector<std::wstring> newElemIds {};
+    newElemIds.reserve(elemsNum);
+
+    for (std::size_t i = 0; i < elemsNum; i++) {
+        newElemIds.push_back(L"Microsoft.SimulatedApplication" + std::to_wstring(i) + L"_8wekyb3d8bbwe");
+    }
+
+    ATL::CComPtr<SimulatedSettingItem> collection {
+        createSimulatedCollection(settingId, newElemIds, elemBehavior)
+    };
+    elemIds.insert(elemIds.end(), newElemIds.begin(), newElemIds.end());
+
+    return collection;
+}
@@ -0,0 +1,248 @@
+/**
+ * In-memory settings backend, used to exercise the library without the system
+ * settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "IDynamicSettingsDatabase.h"
+#include "ISettingItem.h"
+#include "SettingAtom.h"
+#include "SettingItemEventHandler.h"
+#include "SettingsBackend.h"
+#include "SimulatedBehavior.h"
+
+#include <atlbase.h>
+#include <windows.foundation.h>
+#include <windows.foundation.collections.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// <summary>
+///  In-memory ISettingItem. Values and properties are stored by id, and the
+///  timings and failures of the operations follow its SimulatedBehavior.
+/// </summary>
+class SimulatedSettingItem : public ISettingItem {
+private:
+    std::atomic<ULONG> refCount { 1 };
+    std::wstring id {};
+    std::wstring description {};
+    SettingType type { SettingType::Empty };
+    std::map<std::wstring, ATL::CComPtr<IInspectable>> values {};
+    std::map<std::wstring, ATL::CComPtr<IInspectable>> properties {};
+    SimulatedSettingState state {};
+    std::vector<std::pair<INT64, ATL::CComPtr<ITypedEventHandler<IInspectable*, HSTRING>>>> handlers {};
+    INT64 nextToken { 1 };
+
+    /// <summary>
+    ///  Invokes the registered 'SettingChanged' handlers.
+    /// </summary>
+    void raiseSettingChanged(const std::wstring& valueId);
+
+public:
+    SimulatedSettingItem(std::wstring id, SettingType type, const SimulatedBehavior& behavior);
+
+    /// <summary>
+    ///  Sets a value without going through the simulation, meant for
+    ///  initializing the setting.
+    /// </summary>
+    void putValue(const std::wstring& valueId, IInspectable* value);
+    /// <summary>
+    ///  Sets a property without going through the simulation, meant for
+    ///  initializing the setting.
+    /// </summary>
+    void putProperty(const std::wstring& propId, IInspectable* value);
+    /// <summary>
+    ///  Gets a value without going through the simulation, NULL if the value
+    ///  isn't present.
+    /// </summary>
+    ATL::CComPtr<IInspectable> peekValue(const std::wstring& valueId) const;
+    void setDescription(std::wstring desc) { description = std::move(desc); }
+    const std::wstring& getId() const { return id; }
+    SimulatedSettingState& getState() { return state; }
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // IInspectable
+    HRESULT STDMETHODCALLTYPE GetIids(ULONG* iidCount, IID** iids) override;
+    HRESULT STDMETHODCALLTYPE GetRuntimeClassName(HSTRING* className) override;
+    HRESULT STDMETHODCALLTYPE GetTrustLevel(TrustLevel* trustLevel) override;
+
+    // ISettingItem
+    int get_Id(HSTRING* rId) override;
+    int get_SettingType(SettingType* val) override;
+    int get_IsSetByGroupPolicy(BOOL* val) override;
+    int get_IsEnabled(BOOL* val) override;
+    int get_IsApplicable(BOOL* val) override;
+    int get_Description(HSTRING* desc) override;
+    int get_IsUpdating(BOOL* val) override;
+    int GetValue(HSTRING__* name, IInspectable** item) override;
+    HRESULT SetValue(HSTRING__* name, IInspectable* item) override;
+    int GetProperty(HSTRING__* name, IInspectable** item) override;
+    int SetProperty(HSTRING__* name, IInspectable* item) override;
+    int Invoke(ABI::Windows::UI::Core::ICoreWindow* wnd, IInspectable* rect) override;
+    int add_SettingChanged(
+        ABI::Windows::Foundation::ITypedEventHandler<IInspectable*, HSTRING__*>* eventHnd,
+        EventRegistrationToken* token
+    ) override;
+    int remove_SettingChanged(EventRegistrationToken token) override;
+};
+
+/// <summary>
+///  In-memory IVector<IInspectable*>, used as the value of a simulated
+///  collection setting.
+/// </summary>
+class SimulatedSettingsVector : public ABI::Windows::Foundation::Collections::IVector<IInspectable*> {
+private:
+    std::atomic<ULONG> refCount { 1 };
+    std::vector<ATL::CComPtr<IInspectable>> items {};
+
+public:
+    SimulatedSettingsVector() {}
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // IInspectable
+    HRESULT STDMETHODCALLTYPE GetIids(ULONG* iidCount, IID** iids) override;
+    HRESULT STDMETHODCALLTYPE GetRuntimeClassName(HSTRING* className) override;
+    HRESULT STDMETHODCALLTYPE GetTrustLevel(TrustLevel* trustLevel) override;
+
+    // IVector
+    HRESULT STDMETHODCALLTYPE GetAt(unsigned index, IInspectable** item) override;
+    HRESULT STDMETHODCALLTYPE get_Size(unsigned* size) override;
+    HRESULT STDMETHODCALLTYPE GetView(
+        ABI::Windows::Foundation::Collections::IVectorView<IInspectable*>** view
+    ) override;
+    HRESULT STDMETHODCALLTYPE IndexOf(IInspectable* value, unsigned* index, boolean* found) override;
+    HRESULT STDMETHODCALLTYPE SetAt(unsigned index, IInspectable* item) override;
+    HRESULT STDMETHODCALLTYPE InsertAt(unsigned index, IInspectable* item) override;
+    HRESULT STDMETHODCALLTYPE RemoveAt(unsigned index) override;
+    HRESULT STDMETHODCALLTYPE Append(IInspectable* item) override;
+    HRESULT STDMETHODCALLTYPE RemoveAtEnd() override;
+    HRESULT STDMETHODCALLTYPE Clear() override;
+    HRESULT STDMETHODCALLTYPE GetMany(unsigned startIndex, unsigned capacity, IInspectable** value, unsigned* actual);
+    HRESULT STDMETHODCALLTYPE ReplaceAll(unsigned count, IInspectable** value);
+};
+
+/// <summary>
+///  In-memory IDynamicSettingsDatabase, holding the inner settings of a
+///  simulated setting.
+/// </summary>
+class SimulatedSettingsDatabase : public IDynamicSettingsDatabase {
+private:
+    std::atomic<ULONG> refCount { 1 };
+    std::map<std::wstring, ATL::CComPtr<SimulatedSettingItem>> settings {};
+
+public:
+    SimulatedSettingsDatabase() {}
+
+    /// <summary>
+    ///  Adds a setting to the database, keyed by its id.
+    /// </summary>
+    void addSetting(const ATL::CComPtr<SimulatedSettingItem>& setting);
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // IInspectable
+    HRESULT STDMETHODCALLTYPE GetIids(ULONG* iidCount, IID** iids) override;
+    HRESULT STDMETHODCALLTYPE GetRuntimeClassName(HSTRING* className) override;
+    HRESULT STDMETHODCALLTYPE GetTrustLevel(TrustLevel* trustLevel) override;
+
+    // IDynamicSettingsDatabase
+    HRESULT GetSetting(HSTRING id, ISettingItem** setting) override;
+};
+
+/// <summary>
+///  Settings backend holding SimulatedSettingItems, it doesn't require the
+///  settings libraries or the system settings store.
+/// </summary>
+class SimulatedSettingsBackend : public SettingsBackend {
+private:
+    BOOL loaded { false };
+    std::unordered_map<SettingAtom, ATL::CComPtr<SimulatedSettingItem>> settings {};
+
+public:
+    SimulatedSettingsBackend() {}
+    SimulatedSettingsBackend(const SimulatedSettingsBackend&) = delete;
+    SimulatedSettingsBackend& operator=(const SimulatedSettingsBackend&) = delete;
+
+    /// <summary>
+    ///  Adds a setting to the backend, keyed by its id. Replaces any previous
+    ///  setting with the same id.
+    /// </summary>
+    void addSetting(const ATL::CComPtr<SimulatedSettingItem>& setting);
+    /// <summary>
+    ///  Gets the setting with the supplied id, NULL if it isn't present.
+    /// </summary>
+    SimulatedSettingItem* findSetting(const SettingAtom& settingId) const;
+
+    HRESULT load() override;
+    BOOL isLoaded() const override;
+    /// <summary>
+    ///  Gets the setting with the supplied id.
+    /// </summary>
+    /// <returns>
+    ///  ERROR_SUCCESS, the failure injected for SimulatedOperation::GetSetting,
+    ///  or ERROR_OPEN_FAILED if the setting isn't present, like the system
+    ///  backend does for unknown ids.
+    /// </returns>
+    HRESULT getSetting(const SettingAtom& settingId, ISettingItem** rSetting) override;
+    /// <summary>
+    ///  Gets the ids of the settings added to the backend.
+    /// </summary>
+    HRESULT getSettingIds(std::vector<std::wstring>& rSettingIds) override;
+    HRESULT unload() override;
+};
+
+/// <summary>
+///  Creates a simulated setting holding the supplied 'Value'.
+/// </summary>
+ATL::CComPtr<SimulatedSettingItem> createSimulatedSetting(
+    const std::wstring& settingId,
+    SettingType type,
+    IInspectable* value,
+    const SimulatedBehavior& behavior = SimulatedBehavior {}
+);
+/// <summary>
+///  Creates a simulated collection setting holding the supplied number of
+///  elements. If the collection id is one of the supported dynamic databases,
+///  each element exposes a database holding its inner Boolean settings.
+/// </summary>
+/// <param name="elemIds">Filled with the ids of the created elements.</param>
+ATL::CComPtr<SimulatedSettingItem> createSimulatedCollection(
+    const std::wstring& settingId,
+    std::size_t elemsNum,
+    std::vector<std::wstring>& elemIds,
+    const SimulatedBehavior& elemBehavior = SimulatedBehavior {}
+);
+/// <summary>
+///  Creates a simulated collection setting holding elements with the supplied
+///  ids, like the overload generating the ids.
+/// </summary>
+ATL::CComPtr<SimulatedSettingItem> createSimulatedCollection(
+    const std::wstring& settingId,
+    const std::vector<std::wstring>& elemIds,
+    const SimulatedBehavior& elemBehavior = SimulatedBehavior {}
+);
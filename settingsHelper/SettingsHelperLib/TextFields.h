@@ -0,0 +1,71 @@
+/**
+ * Helpers for the tab separated text files written by the helper.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// <summary>
+///  Narrows a field of a text file, which can only hold printable ASCII.
+/// </summary>
+/// <returns>False if the string holds other characters.</returns>
+inline bool toTextField(const std::wstring& str, std::string& rField) {
+    std::string field {};
+    field.reserve(str.size());
+
+    for (const auto c : str) {
+        if (c < 0x20 || c >= 0x7F) { return false; }
+        field.push_back(static_cast<char>(c));
+    }
+
+    rField = std::move(field);
+
+    return true;
+}
+
+/// <summary>
+///  Splits a line of a text file into its tab separated fields.
+/// </summary>
+inline std::vector<std::string> splitTextFields(const std::string& line) {
+    std::vector<std::string> fields {};
+    std::size_t start { 0 };
+
+    while (true) {
+        const std::size_t end { line.find('\t', start) };
+        fields.push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+
+        if (end == std::string::npos) { break; }
+        start = end + 1;
+    }
+
+    return fields;
+}
+
+/// <summary>
+///  Parses a field holding a non negative integer in the supplied base.
+/// </summary>
+/// <returns>False if the field isn't a valid integer.</returns>
+inline bool parseTextInteger(const std::string& field, std::int64_t& rValue, int base = 10) {
+    if (field.empty() || field.front() == '-') { return false; }
+
+    char* end { nullptr };
+    const long long value { std::strtoll(field.c_str(), &end, base) };
+    if (end == nullptr || *end != '\0' || value < 0) { return false; }
+
+    rValue = static_cast<std::int64_t>(value);
+
+    return true;
+}
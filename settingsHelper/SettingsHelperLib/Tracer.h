@@ -0,0 +1,252 @@
+/**
+ * Phase level tracing in the Chrome trace event format.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeSync.h"
+#include "WStringView.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+///  A phase recorded by the tracer, serialized as a complete event ("ph": "X").
+/// </summary>
+struct TraceEvent {
+    /// <summary>
+    ///  Name of the phase, it should be a string literal.
+    /// </summary>
+    const char* name;
+    /// <summary>
+    ///  Start of the phase, in microseconds since the tracer creation.
+    /// </summary>
+    std::int64_t startUs;
+    /// <summary>
+    ///  Duration of the phase, in microseconds.
+    /// </summary>
+    std::int64_t durationUs;
+    /// <summary>
+    ///  The thread in which the phase took place.
+    /// </summary>
+    std::uint32_t threadId;
+    /// <summary>
+    ///  Optional name of the argument of the phase, it should be a string
+    ///  literal, or nullptr if the phase has no argument.
+    /// </summary>
+    const char* argName;
+    /// <summary>
+    ///  The value of the argument of the phase, e.g the target setting id.
+    /// </summary>
+    std::wstring argValue;
+};
+
+/// <summary>
+///  Appends a wide string to a UTF-8 encoded JSON string literal, escaping
+///  the characters not allowed in JSON strings.
+/// </summary>
+inline void appendJsonUtf8(WStringView str, std::string& rOut) {
+    static const char hexDigits[] { "0123456789abcdef" };
+
+    for (std::size_t i = 0; i < str.size(); i++) {
+        std::uint32_t c { static_cast<std::uint32_t>(str[i]) };
+
+        // Combine UTF-16 surrogate pairs, found where wchar_t is 16 bits wide
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < str.size()) {
+            const std::uint32_t low { static_cast<std::uint32_t>(str[i + 1]) };
+
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+
+        if (c == '"' || c == '\\') {
+            rOut.push_back('\\');
+            rOut.push_back(static_cast<char>(c));
+        } else if (c < 0x20) {
+            rOut.append("\\u00");
+            rOut.push_back(hexDigits[c >> 4]);
+            rOut.push_back(hexDigits[c & 0xF]);
+        } else if (c < 0x80) {
+            rOut.push_back(static_cast<char>(c));
+        } else if (c < 0x800) {
+            rOut.push_back(static_cast<char>(0xC0 | (c >> 6)));
+            rOut.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            rOut.push_back(static_cast<char>(0xE0 | (c >> 12)));
+            rOut.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            rOut.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else {
+            rOut.push_back(static_cast<char>(0xF0 | (c >> 18)));
+            rOut.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+            rOut.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            rOut.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+    }
+}
+
+/// <summary>
+///  Process-wide tracer. While disabled, the only cost of a 'TraceScope' is
+///  checking the enabled flag.
+///
+///  The recorded events can be written as a JSON trace that can be loaded in
+///  chrome://tracing or https://ui.perfetto.dev.
+/// </summary>
+class Tracer {
+private:
+    std::atomic<bool> enabled { false };
+    NativeMutex eventsMutex {};
+    std::vector<TraceEvent> events {};
+    const std::chrono::steady_clock::time_point origin { std::chrono::steady_clock::now() };
+
+public:
+    Tracer() {}
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /// <summary>
+    ///  Gets the process-wide tracer.
+    /// </summary>
+    static Tracer& instance() {
+        static Tracer tracer {};
+        return tracer;
+    }
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void enable() { enabled.store(true, std::memory_order_relaxed); }
+    void disable() { enabled.store(false, std::memory_order_relaxed); }
+
+    /// <summary>
+    ///  Microseconds elapsed since the tracer creation.
+    /// </summary>
+    std::int64_t nowUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin
+        ).count();
+    }
+
+    /// <summary>
+    ///  Records a phase.
+    /// </summary>
+    void addEvent(TraceEvent event) {
+        NativeLockGuard lock { eventsMutex };
+        events.push_back(std::move(event));
+    }
+
+    /// <summary>
+    ///  Gets a copy of the recorded phases.
+    /// </summary>
+    std::vector<TraceEvent> getEvents() {
+        NativeLockGuard lock { eventsMutex };
+        return events;
+    }
+
+    /// <summary>
+    ///  Discards the recorded phases.
+    /// </summary>
+    void clear() {
+        NativeLockGuard lock { eventsMutex };
+        events.clear();
+    }
+
+    /// <summary>
+    ///  Serializes the recorded phases in the trace event JSON format.
+    /// </summary>
+    std::string toJson() {
+        NativeLockGuard lock { eventsMutex };
+        std::string json {};
+
+        json.append("{\"traceEvents\":[");
+        json.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,");
+        json.append("\"args\":{\"name\":\"SettingsHelper\"}}");
+
+        for (const auto& event : events) {
+            json.append(",{\"name\":\"").append(event.name).append("\"");
+            json.append(",\"cat\":\"settingsHelper\",\"ph\":\"X\"");
+            json.append(",\"ts\":").append(std::to_string(event.startUs));
+            json.append(",\"dur\":").append(std::to_string(event.durationUs));
+            json.append(",\"pid\":1,\"tid\":").append(std::to_string(event.threadId));
+
+            if (event.argName != nullptr) {
+                json.append(",\"args\":{\"").append(event.argName).append("\":\"");
+                appendJsonUtf8(WStringView { event.argValue }, json);
+                json.append("\"}");
+            }
+
+            json.append("}");
+        }
+
+        json.append("],\"displayTimeUnit\":\"ms\"}");
+
+        return json;
+    }
+
+    /// <summary>
+    ///  Writes the JSON trace to the supplied stream.
+    /// </summary>
+    void writeJson(std::ostream& out) {
+        out << toJson();
+    }
+};
+
+/// <summary>
+///  Records the phase spanning the lifetime of the scope, if the tracer is
+///  enabled when the scope is created.
+///
+///  NOTE: 'argValue' isn't copied until the scope ends, so it needs to outlive
+///  the scope.
+/// </summary>
+class TraceScope {
+private:
+    Tracer* tracer { nullptr };
+    const char* name { nullptr };
+    const char* argName { nullptr };
+    WStringView argValue {};
+    std::int64_t startUs { 0 };
+
+public:
+    explicit TraceScope(const char* name) : TraceScope(name, nullptr, WStringView {}) {}
+    TraceScope(const char* name, const char* argName, WStringView argValue) {
+        Tracer& instance { Tracer::instance() };
+
+        if (instance.isEnabled()) {
+            this->tracer = &instance;
+            this->name = name;
+            this->argName = argName;
+            this->argValue = argValue;
+            this->startUs = instance.nowUs();
+        }
+    }
+    ~TraceScope() {
+        if (tracer != nullptr) {
+            const std::int64_t endUs { tracer->nowUs() };
+
+            tracer->addEvent(
+                TraceEvent {
+                    name,
+                    startUs,
+                    endUs - startUs,
+                    currentThreadId(),
+                    argName,
+                    argName != nullptr ? argValue.str() : std::wstring {}
+                }
+            );
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
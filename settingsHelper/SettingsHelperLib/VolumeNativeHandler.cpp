@@ -0,0 +1,271 @@
+/**
+ * Native handler of the audio volume settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "VolumeNativeHandler.h"
+
+#include <Windows.h>
+#include <atlbase.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include <endpointvolume.h>
+
+#include <cwchar>
+#include <string>
+
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Flags the cached endpoint as stale when the default render device
+    ///  changes. Notifications arrive on a thread of the audio service.
+    /// </summary>
+    class DefaultDeviceWatcher : public IMMNotificationClient {
+    private:
+        volatile LONG refCount { 1 };
+        volatile LONG changed { 0 };
+
+    public:
+        /// <summary>
+        ///  Checks if the default device changed since the last call.
+        /// </summary>
+        BOOL takeChanged() {
+            return InterlockedExchange(&changed, 0) != 0;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override {
+            return InterlockedIncrement(&refCount);
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override {
+            const ULONG count { static_cast<ULONG>(InterlockedDecrement(&refCount)) };
+            if (count == 0) { delete this; }
+
+            return count;
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override {
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient)) {
+                *ppv = static_cast<IMMNotificationClient*>(this);
+                AddRef();
+
+                return S_OK;
+            }
+
+            *ppv = NULL;
+            return E_NOINTERFACE;
+        }
+
+        HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR) override {
+            if (flow == eRender && role == eMultimedia) {
+                InterlockedExchange(&changed, 1);
+            }
+
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR) override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR) override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR, DWORD) override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY) override { return S_OK; }
+    };
+
+    /// <summary>
+    ///  Parses a serialized level, a JSON number in the range [0, 1].
+    /// </summary>
+    HRESULT parseLevel(const wstring& value, float& rLevel) {
+        const wchar_t* start { value.c_str() };
+        wchar_t* end { nullptr };
+        const double level { std::wcstod(start, &end) };
+
+        if (end == start || *end != L'\0' || !(level >= 0.0 && level <= 1.0)) {
+            return E_INVALIDARG;
+        }
+
+        rLevel = static_cast<float>(level);
+
+        return ERROR_SUCCESS;
+    }
+
+    /// <summary>
+    ///  Parses a serialized JSON boolean.
+    /// </summary>
+    HRESULT parseMuted(const wstring& value, BOOL& rMuted) {
+        if (value != L"true" && value != L"false") {
+            return E_INVALIDARG;
+        }
+
+        rMuted = value == L"true";
+
+        return ERROR_SUCCESS;
+    }
+
+    class VolumeNativeHandler : public NativeHandler {
+    private:
+        ATL::CComPtr<IMMDeviceEnumerator> pEnumerator { NULL };
+        ATL::CComPtr<IAudioEndpointVolume> pEndpointVolume { NULL };
+        DefaultDeviceWatcher* pWatcher { nullptr };
+
+        /// <summary>
+        ///  Gets the volume interface of the default endpoint, resolving it
+        ///  again if the default device changed.
+        /// </summary>
+        HRESULT getEndpointVolume(ATL::CComPtr<IAudioEndpointVolume>& rVolume) {
+            const BOOL stale { pWatcher == nullptr || pWatcher->takeChanged() };
+
+            if (pEndpointVolume == NULL || stale) {
+                pEndpointVolume.Release();
+
+                ATL::CComPtr<IMMDevice> pDevice { NULL };
+                HRESULT errCode { pEnumerator->GetDefaultAudioEndpoint(eRender, eMultimedia, &pDevice) };
+
+                if (errCode == ERROR_SUCCESS) {
+                    errCode = pDevice->Activate(
+                        __uuidof(IAudioEndpointVolume), CLSCTX_ALL, NULL, reinterpret_cast<void**>(&pEndpointVolume)
+                    );
+                }
+
+                if (errCode != ERROR_SUCCESS) { return errCode; }
+            }
+
+            rVolume = pEndpointVolume;
+
+            return ERROR_SUCCESS;
+        }
+
+        HRESULT handleLevel(
+            IAudioEndpointVolume*   pVolume,
+            const NativeRequest&    request,
+            wstring&                rVal,
+            wstring*                pAppliedVal
+        ) {
+            float level { 0 };
+            HRESULT errCode { pVolume->GetMasterVolumeLevelScalar(&level) };
+
+            if (errCode == ERROR_SUCCESS) {
+                rVal = std::to_wstring(level);
+            }
+
+            if (errCode == ERROR_SUCCESS && request.method == ActionMethod::SetValue) {
+                float newLevel { 0 };
+                errCode = parseLevel(request.value, newLevel);
+
+                if (errCode == ERROR_SUCCESS && newLevel != level) {
+                    errCode = pVolume->SetMasterVolumeLevelScalar(newLevel, NULL);
+                }
+
+                // The endpoint may round the level, it's read back as the applied value
+                if (errCode == ERROR_SUCCESS && pAppliedVal != nullptr) {
+                    if (pVolume->GetMasterVolumeLevelScalar(&newLevel) == ERROR_SUCCESS) {
+                        *pAppliedVal = std::to_wstring(newLevel);
+                    }
+                }
+            }
+
+            return errCode;
+        }
+
+        HRESULT handleMuted(
+            IAudioEndpointVolume*   pVolume,
+            const NativeRequest&    request,
+            wstring&                rVal,
+            wstring*                pAppliedVal
+        ) {
+            BOOL muted { FALSE };
+            HRESULT errCode { pVolume->GetMute(&muted) };
+
+            if (errCode == ERROR_SUCCESS) {
+                rVal = muted ? L"true" : L"false";
+            }
+
+            if (errCode == ERROR_SUCCESS && request.method == ActionMethod::SetValue) {
+                BOOL newMuted { FALSE };
+                errCode = parseMuted(request.value, newMuted);
+
+                if (errCode == ERROR_SUCCESS && newMuted != muted) {
+                    errCode = pVolume->SetMute(newMuted, NULL);
+                }
+
+                if (errCode == ERROR_SUCCESS && pAppliedVal != nullptr) {
+                    if (pVolume->GetMute(&newMuted) == ERROR_SUCCESS) {
+                        *pAppliedVal = newMuted ? L"true" : L"false";
+                    }
+                }
+            }
+
+            return errCode;
+        }
+
+    public:
+        std::int32_t load() override {
+            HRESULT errCode {
+                CoCreateInstance(
+                    __uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, IID_PPV_ARGS(&pEnumerator)
+                )
+            };
+
+            if (errCode == ERROR_SUCCESS) {
+                pWatcher = new DefaultDeviceWatcher {};
+
+                // Without notifications the endpoint is resolved for every request
+                if (pEnumerator->RegisterEndpointNotificationCallback(pWatcher) != ERROR_SUCCESS) {
+                    pWatcher->Release();
+                    pWatcher = nullptr;
+                }
+            }
+
+            return errCode;
+        }
+
+        std::int32_t handle(const NativeRequest& request, wstring& rVal, wstring* pAppliedVal) override {
+            const BOOL isLevel { request.valueId == L"Value" };
+            const BOOL isMuted { request.valueId == L"Muted" };
+
+            if (isLevel == FALSE && isMuted == FALSE) { return E_INVALIDARG; }
+            if (request.method != ActionMethod::GetValue && request.method != ActionMethod::SetValue) {
+                return E_NOTIMPL;
+            }
+
+            ATL::CComPtr<IAudioEndpointVolume> pVolume { NULL };
+            HRESULT errCode { getEndpointVolume(pVolume) };
+
+            if (errCode == ERROR_SUCCESS) {
+                errCode = isLevel ?
+                    handleLevel(pVolume, request, rVal, pAppliedVal) :
+                    handleMuted(pVolume, request, rVal, pAppliedVal);
+            }
+
+            // A removed device invalidates the endpoint, the next request resolves it again
+            if (errCode == AUDCLNT_E_DEVICE_INVALIDATED) {
+                pEndpointVolume.Release();
+            }
+
+            return errCode;
+        }
+
+        void unload() override {
+            pEndpointVolume.Release();
+
+            if (pWatcher != nullptr) {
+                pEnumerator->UnregisterEndpointNotificationCallback(pWatcher);
+                pWatcher->Release();
+                pWatcher = nullptr;
+            }
+
+            pEnumerator.Release();
+        }
+    };
+}
+
+std::unique_ptr<NativeHandler> createVolumeNativeHandler() {
+    return std::unique_ptr<NativeHandler> { new VolumeNativeHandler {} };
+}
@@ -0,0 +1,30 @@
+/**
+ * Native handler of the audio volume settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "NativeHandlers.h"
+
+#include <memory>
+
+/// <summary>
+///  Namespace of the settings served by the volume handler.
+/// </summary>
+constexpr const wchar_t* volumeNamespace { L"Native.Volume" };
+
+/// <summary>
+///  Creates the handler of the master volume of the default render endpoint,
+///  serving 'Value', the level normalized from 0 to 1, and 'Muted'. The
+///  endpoint is resolved on first use and kept until the default device
+///  changes, same as the resident mode of 'VolumeControl.exe' does.
+/// </summary>
+std::unique_ptr<NativeHandler> createVolumeNativeHandler();
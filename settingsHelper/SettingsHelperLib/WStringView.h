@@ -0,0 +1,77 @@
+/**
+ * Non-owning view over a sequence of wide characters.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cwchar>
+#include <string>
+
+/// <summary>
+///  Minimal stand-in for std::wstring_view, which isn't available with the
+///  toolset used by this solution. It only depends on the standard library so
+///  the code using it can be compiled and tested in any platform.
+///
+///  NOTE: The view doesn't own the characters it points to, so the referred
+///  buffer must outlive it.
+/// </summary>
+class WStringView {
+private:
+    const wchar_t* _data { nullptr };
+    std::size_t _size { 0 };
+
+public:
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    WStringView() {}
+    WStringView(const wchar_t* data, std::size_t size) : _data(data), _size(size) {}
+    WStringView(const wchar_t* str) : _data(str), _size(str == nullptr ? 0 : std::wcslen(str)) {}
+    WStringView(const std::wstring& str) : _data(str.data()), _size(str.size()) {}
+
+    const wchar_t* data() const { return _data; }
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    const wchar_t* begin() const { return _data; }
+    const wchar_t* end() const { return _data + _size; }
+
+    wchar_t operator[](std::size_t pos) const { return _data[pos]; }
+
+    /// <summary>
+    ///  Returns a view over the subrange [pos, pos + count), clamped to the
+    ///  size of the current view.
+    /// </summary>
+    WStringView substr(std::size_t pos, std::size_t count = npos) const {
+        if (pos > _size) { pos = _size; }
+        if (count > _size - pos) { count = _size - pos; }
+
+        return WStringView { _data + pos, count };
+    }
+
+    /// <summary>
+    ///  Creates an owning copy of the viewed characters.
+    /// </summary>
+    std::wstring str() const { return std::wstring { _data, _size }; }
+
+    bool operator==(const WStringView& other) const {
+        return _size == other._size &&
+            (_size == 0 || std::wmemcmp(_data, other._data, _size) == 0);
+    }
+    bool operator!=(const WStringView& other) const { return !(*this == other); }
+};
+
+inline bool operator==(const std::wstring& str, const WStringView& view) { return WStringView { str } == view; }
+inline bool operator==(const WStringView& view, const std::wstring& str) { return view == WStringView { str }; }
+inline bool operator!=(const std::wstring& str, const WStringView& view) { return !(str == view); }
+inline bool operator!=(const WStringView& view, const std::wstring& str) { return !(view == str); }
+inline bool operator==(const WStringView& view, const wchar_t* str) { return view == WStringView { str }; }
+inline bool operator!=(const WStringView& view, const wchar_t* str) { return !(view == str); }
@@ -0,0 +1,344 @@
+/**
+ * Supervisor of a pool of worker processes executing the payload actions.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "WorkerPool.h"
+#include "BatchDeadline.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+using std::string;
+using std::wstring;
+
+// -----------------------------------------------------------------------------
+//                               Protocol
+// -----------------------------------------------------------------------------
+
+namespace {
+    bool isKnownFrameType(std::uint8_t type) {
+        return
+            type == static_cast<std::uint8_t>(FrameType::LoadPayload) ||
+            type == static_cast<std::uint8_t>(FrameType::RunAction) ||
+            type == static_cast<std::uint8_t>(FrameType::ActionResult) ||
+            type == static_cast<std::uint8_t>(FrameType::SessionEvent);
+    }
+}
+
+void encodeFrame(FrameType type, const string& body, string& rOut) {
+    const std::uint32_t length { static_cast<std::uint32_t>(body.size() + 1) };
+
+    for (int i = 0; i < 4; i++) {
+        rOut.push_back(static_cast<char>((length >> (8 * i)) & 0xFF));
+    }
+
+    rOut.push_back(static_cast<char>(type));
+    rOut.append(body);
+}
+
+string toFrameBody(const wstring& str) {
+    return string { reinterpret_cast<const char*>(str.data()), str.size() * sizeof(wchar_t) };
+}
+
+wstring fromFrameBody(const string& body) {
+    wstring str(body.size() / sizeof(wchar_t), L'\0');
+
+    if (str.empty() == false) {
+        std::memcpy(&str[0], body.data(), str.size() * sizeof(wchar_t));
+    }
+
+    return str;
+}
+
+void FrameDecoder::feed(const char* data, std::size_t size) {
+    buffer.append(data, size);
+}
+
+bool FrameDecoder::next(Frame& rFrame) {
+    if (corrupted || buffer.size() < 5) { return false; }
+
+    std::uint32_t length { 0 };
+    for (int i = 0; i < 4; i++) {
+        length |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(buffer[i])) << (8 * i);
+    }
+
+    const std::uint8_t type { static_cast<std::uint8_t>(buffer[4]) };
+    if (length == 0 || length > maxFrameSize || isKnownFrameType(type) == false) {
+        corrupted = true;
+        return false;
+    }
+
+    if (buffer.size() < 4 + static_cast<std::size_t>(length)) { return false; }
+
+    rFrame.type = static_cast<FrameType>(type);
+    rFrame.body = buffer.substr(5, length - 1);
+    buffer.erase(0, 4 + static_cast<std::size_t>(length));
+
+    return true;
+}
+
+bool sendFrame(WorkerChannel& channel, FrameType type, const string& body) {
+    string frame {};
+    frame.reserve(body.size() + 5);
+    encodeFrame(type, body, frame);
+
+    return channel.write(frame.data(), frame.size());
+}
+
+ChannelStatus receiveFrame(WorkerChannel& channel, FrameDecoder& decoder, Frame& rFrame, std::uint32_t timeoutMs) {
+    const auto start = std::chrono::steady_clock::now();
+    char buffer[4096];
+
+    while (decoder.next(rFrame) == false) {
+        if (decoder.isCorrupted()) { return ChannelStatus::Closed; }
+
+        std::uint32_t remainingMs { infiniteTimeoutMs };
+        if (timeoutMs != infiniteTimeoutMs) {
+            const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start
+            ).count();
+
+            if (elapsedMs >= timeoutMs) { return ChannelStatus::Timeout; }
+            remainingMs = timeoutMs - static_cast<std::uint32_t>(elapsedMs);
+        }
+
+        std::size_t read { 0 };
+        const ChannelStatus status { channel.read(buffer, sizeof(buffer), read, remainingMs) };
+        if (status != ChannelStatus::Data) { return status; }
+
+        decoder.feed(buffer, read);
+    }
+
+    return ChannelStatus::Data;
+}
+
+// -----------------------------------------------------------------------------
+//                               Worker
+// -----------------------------------------------------------------------------
+
+int runWorker(WorkerChannel& channel, WorkerSession& session) {
+    FrameDecoder decoder {};
+    Frame frame {};
+
+    while (receiveFrame(channel, decoder, frame, infiniteTimeoutMs) == ChannelStatus::Data) {
+        if (frame.type == FrameType::LoadPayload) {
+            session.loadPayload(fromFrameBody(frame.body));
+        } else if (frame.type == FrameType::RunAction) {
+            const std::uint32_t index { static_cast<std::uint32_t>(std::strtoul(frame.body.c_str(), NULL, 10)) };
+            const wstring result { session.runAction(index) };
+            std::vector<string> events {};
+            session.takeEvents(events);
+
+            for (const auto& event : events) {
+                if (sendFrame(channel, FrameType::SessionEvent, event) == false) {
+                    return 0;
+                }
+            }
+
+            if (sendFrame(channel, FrameType::ActionResult, toFrameBody(result)) == false) {
+                return 0;
+            }
+        } else {
+            return 1;
+        }
+    }
+
+    return decoder.isCorrupted() ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+//                               Supervisor
+// -----------------------------------------------------------------------------
+
+WorkerPool::WorkerPool(WorkerFactory factory, std::size_t size, std::uint32_t timeoutMs) :
+    factory(std::move(factory)), slots(size == 0 ? 1 : size), timeoutMs(timeoutMs) {}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+bool WorkerPool::spawn(Slot& slot) {
+    slot.channel = factory();
+    slot.decoder = FrameDecoder {};
+    slot.payloadGeneration = 0;
+
+    return slot.channel != nullptr;
+}
+
+std::size_t WorkerPool::start() {
+    std::size_t started { 0 };
+
+    for (auto& slot : slots) {
+        if (slot.channel != nullptr || spawn(slot)) {
+            started++;
+        }
+    }
+
+    return started;
+}
+
+void WorkerPool::setPayload(const wstring& payload) {
+    this->payload = payload;
+    this->payloadGeneration++;
+}
+
+void WorkerPool::setEventListener(WorkerEventListener listener) {
+    this->eventListener = std::move(listener);
+}
+
+bool WorkerPool::dispatch(Slot& slot, std::uint32_t index) {
+    // A worker that died while idle hasn't received the action yet, so it's
+    // replaced and the action sent again, once
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (slot.channel == nullptr && spawn(slot) == false) {
+            return false;
+        }
+
+        bool sent { true };
+        if (slot.payloadGeneration != payloadGeneration) {
+            sent = sendFrame(*slot.channel, FrameType::LoadPayload, toFrameBody(payload));
+            slot.payloadGeneration = payloadGeneration;
+        }
+        if (sent) {
+            sent = sendFrame(*slot.channel, FrameType::RunAction, std::to_string(index));
+        }
+
+        if (sent) {
+            return true;
+        }
+
+        slot.channel->terminate();
+        slot.channel.reset();
+        restarts++;
+    }
+
+    return false;
+}
+
+void WorkerPool::replace(Slot& slot) {
+    slot.channel->terminate();
+    slot.channel.reset();
+    restarts++;
+
+    // Keep the pool warm for the next actions
+    spawn(slot);
+}
+
+ChannelStatus WorkerPool::receiveResult(Slot& slot, Frame& rFrame, std::uint32_t timeoutMs) {
+    while (true) {
+        const ChannelStatus received { receiveFrame(*slot.channel, slot.decoder, rFrame, timeoutMs) };
+
+        if (received != ChannelStatus::Data || rFrame.type != FrameType::SessionEvent) {
+            return received;
+        }
+
+        if (eventListener) { eventListener(rFrame.body); }
+    }
+}
+
+std::uint32_t WorkerPool::actionTimeoutMs() const {
+    const BatchDeadline* pDeadline { BatchDeadline::current() };
+    if (pDeadline == nullptr) { return timeoutMs; }
+
+    const std::uint32_t remainingMs { pDeadline->remainingMs() };
+    return remainingMs < timeoutMs ? remainingMs : timeoutMs;
+}
+
+WorkerStatus WorkerPool::runAction(std::uint32_t index, wstring& rResult) {
+    Slot& slot { slots[nextSlot] };
+    nextSlot = (nextSlot + 1) % slots.size();
+
+    if (dispatch(slot, index) == false) {
+        return WorkerStatus::Unavailable;
+    }
+
+    Frame frame {};
+    const ChannelStatus received { receiveResult(slot, frame, actionTimeoutMs()) };
+
+    if (received == ChannelStatus::Data && frame.type == FrameType::ActionResult) {
+        rResult = fromFrameBody(frame.body);
+        return WorkerStatus::Completed;
+    }
+
+    replace(slot);
+
+    return received == ChannelStatus::Timeout ? WorkerStatus::TimedOut : WorkerStatus::Crashed;
+}
+
+void WorkerPool::runActions(
+    const std::vector<std::uint32_t>& indices,
+    std::vector<WorkerStatus>& rStatuses,
+    std::vector<wstring>& rResults
+) {
+    using Clock = std::chrono::steady_clock;
+    const std::size_t idle { static_cast<std::size_t>(-1) };
+
+    rStatuses.assign(indices.size(), WorkerStatus::Unavailable);
+    rResults.assign(indices.size(), wstring {});
+
+    // The action each slot is running, and by when it has to complete
+    std::vector<std::size_t> running(slots.size(), idle);
+    std::vector<Clock::time_point> expiries(slots.size());
+    std::size_t next { 0 };
+    std::size_t pending { indices.size() };
+
+    while (pending > 0) {
+        for (std::size_t i = 0; i < slots.size() && next < indices.size(); i++) {
+            if (running[i] != idle) { continue; }
+
+            if (dispatch(slots[i], indices[next])) {
+                running[i] = next;
+                expiries[i] = Clock::now() + std::chrono::milliseconds { actionTimeoutMs() };
+            } else {
+                pending--;
+            }
+
+            next++;
+        }
+
+        // The workers are polled in turns, waiting just a bit on each of them
+        for (std::size_t i = 0; i < slots.size(); i++) {
+            if (running[i] == idle) { continue; }
+
+            Slot& slot { slots[i] };
+            Frame frame {};
+            const ChannelStatus received { receiveResult(slot, frame, 1) };
+            WorkerStatus status { WorkerStatus::Completed };
+
+            if (received == ChannelStatus::Data && frame.type == FrameType::ActionResult) {
+                rResults[running[i]] = fromFrameBody(frame.body);
+            } else if (received == ChannelStatus::Timeout) {
+                if (Clock::now() < expiries[i]) { continue; }
+
+                status = WorkerStatus::TimedOut;
+            } else {
+                status = WorkerStatus::Crashed;
+            }
+
+            if (status != WorkerStatus::Completed) {
+                replace(slot);
+            }
+
+            rStatuses[running[i]] = status;
+            running[i] = idle;
+            pending--;
+        }
+    }
+}
+
+void WorkerPool::stop() {
+    for (auto& slot : slots) {
+        slot.channel.reset();
+    }
+}
@@ -0,0 +1,340 @@
+/**
+ * Supervisor of a pool of worker processes executing the payload actions.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//                               Protocol
+// -----------------------------------------------------------------------------
+
+/// <summary>
+///  Kinds of the frames exchanged between the supervisor and the workers.
+/// </summary>
+enum class FrameType : std::uint8_t {
+    /// <summary>
+    ///  Supervisor to worker, the body holds the payload whose actions are
+    ///  going to be requested.
+    /// </summary>
+    LoadPayload = 'P',
+    /// <summary>
+    ///  Supervisor to worker, the body holds the index of the action to run.
+    /// </summary>
+    RunAction = 'A',
+    /// <summary>
+    ///  Worker to supervisor, the body holds the serialized result of the last
+    ///  requested action.
+    /// </summary>
+    ActionResult = 'R',
+    /// <summary>
+    ///  Worker to supervisor, sent before the result of an action, the body
+    ///  holds an event reported by the session while running it.
+    /// </summary>
+    SessionEvent = 'E'
+};
+
+/// <summary>
+///  A message exchanged between the supervisor and a worker. On the wire it's
+///  a little endian 32 bits length, followed by the type and the body.
+/// </summary>
+struct Frame {
+    FrameType type { FrameType::LoadPayload };
+    std::string body {};
+};
+
+/// <summary>
+///  Largest frame accepted, bigger lengths mean a corrupted stream.
+/// </summary>
+constexpr std::uint32_t maxFrameSize { 64 * 1024 * 1024 };
+
+/// <summary>
+///  Appends the wire representation of a frame to the supplied buffer.
+/// </summary>
+void encodeFrame(FrameType type, const std::string& body, std::string& rOut);
+/// <summary>
+///  Stores a wide string as the body of a frame. Both ends run the same
+///  binary, so the characters are copied as they are.
+/// </summary>
+std::string toFrameBody(const std::wstring& str);
+/// <summary>
+///  Gets the wide string stored with 'toFrameBody'.
+/// </summary>
+std::wstring fromFrameBody(const std::string& body);
+
+/// <summary>
+///  Splits the bytes read from a stream into frames.
+/// </summary>
+class FrameDecoder {
+private:
+    std::string buffer {};
+    bool corrupted { false };
+
+public:
+    /// <summary>
+    ///  Adds bytes read from the stream.
+    /// </summary>
+    void feed(const char* data, std::size_t size);
+    /// <summary>
+    ///  Extracts the next complete frame, if any.
+    /// </summary>
+    /// <returns>True if a frame was extracted.</returns>
+    bool next(Frame& rFrame);
+    /// <summary>
+    ///  True once a frame with an invalid length or type has been found, the
+    ///  stream can't be trusted from then on.
+    /// </summary>
+    bool isCorrupted() const { return corrupted; }
+};
+
+// -----------------------------------------------------------------------------
+//                               Channels
+// -----------------------------------------------------------------------------
+
+/// <summary>
+///  Outcome of reading from a channel.
+/// </summary>
+enum class ChannelStatus {
+    /// <summary>
+    ///  Some bytes were read.
+    /// </summary>
+    Data,
+    /// <summary>
+    ///  The other end is gone, e.g the worker process died.
+    /// </summary>
+    Closed,
+    /// <summary>
+    ///  Nothing arrived within the supplied time.
+    /// </summary>
+    Timeout
+};
+
+/// <summary>
+///  A byte stream to the other end, a worker from the supervisor side or the
+///  supervisor from the worker side.
+/// </summary>
+class WorkerChannel {
+public:
+    virtual ~WorkerChannel() {}
+
+    /// <summary>
+    ///  Writes all the supplied bytes.
+    /// </summary>
+    /// <returns>False if the other end is gone.</returns>
+    virtual bool write(const char* data, std::size_t size) = 0;
+    /// <summary>
+    ///  Reads the available bytes, waiting up to 'timeoutMs' for some to arrive,
+    ///  or without limit if it's 'infiniteTimeoutMs'.
+    /// </summary>
+    virtual ChannelStatus read(char* buffer, std::size_t capacity, std::size_t& rRead, std::uint32_t timeoutMs) = 0;
+    /// <summary>
+    ///  Kills the other end, used with workers that stopped responding.
+    /// </summary>
+    virtual void terminate() = 0;
+};
+
+/// <summary>
+///  Timeout used to wait without limit.
+/// </summary>
+constexpr std::uint32_t infiniteTimeoutMs { 0xFFFFFFFF };
+
+/// <summary>
+///  Writes a frame to the supplied channel.
+/// </summary>
+/// <returns>False if the other end is gone.</returns>
+bool sendFrame(WorkerChannel& channel, FrameType type, const std::string& body);
+/// <summary>
+///  Reads from the channel until the decoder holds a complete frame.
+/// </summary>
+/// <param name="timeoutMs">The maximum time to wait for the whole frame.</param>
+/// <returns>
+///  Data if a frame was received, Closed if the other end is gone or the stream
+///  is corrupted, or Timeout.
+/// </returns>
+ChannelStatus receiveFrame(WorkerChannel& channel, FrameDecoder& decoder, Frame& rFrame, std::uint32_t timeoutMs);
+
+// -----------------------------------------------------------------------------
+//                               Worker
+// -----------------------------------------------------------------------------
+
+/// <summary>
+///  What a worker does with the frames it receives.
+/// </summary>
+class WorkerSession {
+public:
+    virtual ~WorkerSession() {}
+
+    /// <summary>
+    ///  Prepares the actions of a payload to be run.
+    /// </summary>
+    virtual void loadPayload(const std::wstring& payload) = 0;
+    /// <summary>
+    ///  Runs one of the actions of the loaded payload.
+    /// </summary>
+    /// <returns>The serialized result of the action.</returns>
+    virtual std::wstring runAction(std::uint32_t index) = 0;
+    /// <summary>
+    ///  Moves the events reported while running the last action into
+    ///  'rEvents', which are sent to the supervisor before its result.
+    /// </summary>
+    virtual void takeEvents(std::vector<std::string>& rEvents) { rEvents.clear(); }
+};
+
+/// <summary>
+///  Serves the requests of the supervisor until the channel is closed.
+/// </summary>
+/// <returns>0 if the channel was closed, 1 if the stream was corrupted.</returns>
+int runWorker(WorkerChannel& channel, WorkerSession& session);
+
+// -----------------------------------------------------------------------------
+//                               Supervisor
+// -----------------------------------------------------------------------------
+
+/// <summary>
+///  Outcome of running an action in a worker.
+/// </summary>
+enum class WorkerStatus {
+    /// <summary>
+    ///  The worker returned the result of the action.
+    /// </summary>
+    Completed,
+    /// <summary>
+    ///  The worker died while running the action.
+    /// </summary>
+    Crashed,
+    /// <summary>
+    ///  The worker didn't answer in time, and was killed.
+    /// </summary>
+    TimedOut,
+    /// <summary>
+    ///  No worker could be started.
+    /// </summary>
+    Unavailable
+};
+
+/// <summary>
+///  Starts a new worker, returning the channel to it, or nullptr on failure.
+/// </summary>
+using WorkerFactory = std::function<std::unique_ptr<WorkerChannel>()>;
+/// <summary>
+///  Called with the body of each event sent by a worker, see
+///  'FrameType::SessionEvent'.
+/// </summary>
+using WorkerEventListener = std::function<void(const std::string&)>;
+
+/// <summary>
+///  Pool of pre-warmed workers, each in its own process, that run the actions
+///  of a payload so a setting library crashing only takes its worker down.
+///  Actions are dispatched in order to the workers in turns, and a worker that
+///  crashes or hangs is replaced right away, so the next action finds a warm
+///  one.
+///
+///  The pool isn't thread safe, it's driven by the thread processing the
+///  payload.
+/// </summary>
+class WorkerPool {
+private:
+    struct Slot {
+        std::unique_ptr<WorkerChannel> channel {};
+        FrameDecoder decoder {};
+        std::uint64_t payloadGeneration { 0 };
+    };
+
+    WorkerFactory factory {};
+    WorkerEventListener eventListener {};
+    std::vector<Slot> slots {};
+    std::uint32_t timeoutMs { 0 };
+    std::size_t nextSlot { 0 };
+    std::wstring payload {};
+    std::uint64_t payloadGeneration { 0 };
+    std::size_t restarts { 0 };
+
+    bool spawn(Slot& slot);
+    bool dispatch(Slot& slot, std::uint32_t index);
+    void replace(Slot& slot);
+    ChannelStatus receiveResult(Slot& slot, Frame& rFrame, std::uint32_t timeoutMs);
+    /// <summary>
+    ///  Time an action dispatched now has to complete, cut short to the time
+    ///  left by the deadline of the current batch, if any.
+    /// </summary>
+    std::uint32_t actionTimeoutMs() const;
+
+public:
+    /// <summary>
+    ///  Default time a worker has to complete an action.
+    /// </summary>
+    static constexpr std::uint32_t defaultTimeoutMs { 60 * 1000 };
+
+    /// <summary>
+    ///  Constructs a pool, no worker is started until 'start' is called.
+    /// </summary>
+    /// <param name="factory">Starts the workers.</param>
+    /// <param name="size">Number of workers, at least one is used.</param>
+    /// <param name="timeoutMs">
+    ///  Time a worker has to complete an action, less if the deadline of the
+    ///  batch expires before.
+    /// </param>
+    WorkerPool(WorkerFactory factory, std::size_t size, std::uint32_t timeoutMs = defaultTimeoutMs);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+
+    /// <summary>
+    ///  Starts every worker, so they are ready before the first action.
+    /// </summary>
+    /// <returns>The number of workers started.</returns>
+    std::size_t start();
+    /// <summary>
+    ///  Sets the payload whose actions are going to be run. Each worker gets
+    ///  it before running its first action of the payload.
+    /// </summary>
+    void setPayload(const std::wstring& payload);
+    /// <summary>
+    ///  Sets the listener of the events sent by the workers, called from the
+    ///  thread driving the pool.
+    /// </summary>
+    void setEventListener(WorkerEventListener listener);
+    /// <summary>
+    ///  Runs one of the actions of the payload in the next worker.
+    /// </summary>
+    /// <param name="index">The index of the action in the payload.</param>
+    /// <param name="rResult">Filled with the serialized result, if completed.</param>
+    WorkerStatus runAction(std::uint32_t index, std::wstring& rResult);
+    /// <summary>
+    ///  Runs several actions of the payload at once, keeping every worker busy
+    ///  until all of them are done. Only meant for actions that don't depend on
+    ///  each other, as they complete in any order.
+    /// </summary>
+    /// <param name="indices">The indexes of the actions in the payload.</param>
+    /// <param name="rStatuses">Filled with the outcome of each action.</param>
+    /// <param name="rResults">Filled with the serialized result of each completed action.</param>
+    void runActions(
+        const std::vector<std::uint32_t>& indices,
+        std::vector<WorkerStatus>& rStatuses,
+        std::vector<std::wstring>& rResults
+    );
+    /// <summary>
+    ///  Closes the channels to the workers, which makes them exit.
+    /// </summary>
+    void stop();
+
+    std::size_t size() const { return slots.size(); }
+    /// <summary>
+    ///  Number of workers replaced after crashing or timing out.
+    /// </summary>
+    std::size_t getRestarts() const { return restarts; }
+};
@@ -0,0 +1,333 @@
+/**
+ * Channels between the supervisor and the worker processes.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "stdafx.h"
+#include "WorkerProcess.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+#include <vector>
+
+namespace {
+    /// <summary>
+    ///  Channel over a pair of anonymous pipes. From the supervisor side it
+    ///  also owns the worker process, which is used to detect its death.
+    /// </summary>
+    class PipeWorkerChannel : public WorkerChannel {
+    private:
+        HANDLE hWrite { NULL };
+        HANDLE hRead { NULL };
+        HANDLE hProcess { NULL };
+        BOOL ownsPipes { TRUE };
+
+    public:
+        PipeWorkerChannel(HANDLE hWrite, HANDLE hRead, HANDLE hProcess, BOOL ownsPipes) :
+            hWrite(hWrite), hRead(hRead), hProcess(hProcess), ownsPipes(ownsPipes) {}
+        PipeWorkerChannel(const PipeWorkerChannel&) = delete;
+        PipeWorkerChannel& operator=(const PipeWorkerChannel&) = delete;
+
+        ~PipeWorkerChannel() {
+            if (ownsPipes) {
+                // Closing the worker input makes it exit on its own
+                CloseHandle(hWrite);
+                CloseHandle(hRead);
+            }
+
+            if (hProcess != NULL) {
+                if (WaitForSingleObject(hProcess, 1000) != WAIT_OBJECT_0) {
+                    TerminateProcess(hProcess, 1);
+                }
+                CloseHandle(hProcess);
+            }
+        }
+
+        bool write(const char* data, std::size_t size) override {
+            while (size > 0) {
+                DWORD written { 0 };
+                const DWORD chunk { static_cast<DWORD>(size > MAXDWORD ? MAXDWORD : size) };
+
+                if (WriteFile(hWrite, data, chunk, &written, NULL) == FALSE) { return false; }
+
+                data += written;
+                size -= written;
+            }
+
+            return true;
+        }
+
+        ChannelStatus read(char* buffer, std::size_t capacity, std::size_t& rRead, std::uint32_t timeoutMs) override {
+            const DWORD toRead { static_cast<DWORD>(capacity > MAXDWORD ? MAXDWORD : capacity) };
+            DWORD read { 0 };
+
+            if (timeoutMs == infiniteTimeoutMs) {
+                // A closed pipe makes the read fail with ERROR_BROKEN_PIPE
+                if (ReadFile(hRead, buffer, toRead, &read, NULL) == FALSE || read == 0) {
+                    return ChannelStatus::Closed;
+                }
+
+                rRead = read;
+                return ChannelStatus::Data;
+            }
+
+            // Anonymous pipes can't be read asynchronously, so they are polled
+            const auto start = std::chrono::steady_clock::now();
+
+            while (true) {
+                DWORD available { 0 };
+                if (PeekNamedPipe(hRead, NULL, 0, NULL, &available, NULL) == FALSE) {
+                    return ChannelStatus::Closed;
+                }
+
+                if (available > 0) {
+                    if (ReadFile(hRead, buffer, (std::min)(toRead, available), &read, NULL) == FALSE) {
+                        return ChannelStatus::Closed;
+                    }
+
+                    rRead = read;
+                    return ChannelStatus::Data;
+                }
+
+                if (hProcess != NULL && WaitForSingleObject(hProcess, 0) == WAIT_OBJECT_0) {
+                    return ChannelStatus::Closed;
+                }
+
+                const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start
+                ).count();
+                if (elapsedMs >= timeoutMs) { return ChannelStatus::Timeout; }
+
+                Sleep(1);
+            }
+        }
+
+        void terminate() override {
+            if (hProcess != NULL) {
+                TerminateProcess(hProcess, 1);
+                WaitForSingleObject(hProcess, INFINITE);
+            }
+        }
+    };
+}
+
+std::unique_ptr<WorkerChannel> spawnWorkerProcess(
+    const std::wstring& exePath,
+    std::size_t workerId,
+    const std::wstring& switches
+) {
+    SECURITY_ATTRIBUTES secAttrs {};
+    secAttrs.nLength = sizeof(SECURITY_ATTRIBUTES);
+    secAttrs.bInheritHandle = TRUE;
+
+    HANDLE hChildInRead { NULL };
+    HANDLE hChildInWrite { NULL };
+    HANDLE hChildOutRead { NULL };
+    HANDLE hChildOutWrite { NULL };
+
+    if (CreatePipe(&hChildInRead, &hChildInWrite, &secAttrs, 0) == FALSE) {
+        return nullptr;
+    }
+    if (CreatePipe(&hChildOutRead, &hChildOutWrite, &secAttrs, 0) == FALSE) {
+        CloseHandle(hChildInRead);
+        CloseHandle(hChildInWrite);
+        return nullptr;
+    }
+
+    // Only the worker ends of the pipes are inherited
+    SetHandleInformation(hChildInWrite, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(hChildOutRead, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOW startupInfo {};
+    startupInfo.cb = sizeof(STARTUPINFOW);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+    startupInfo.hStdInput = hChildInRead;
+    startupInfo.hStdOutput = hChildOutWrite;
+    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    std::wstring cmdLine { L"\"" + exePath + L"\" -worker " + std::to_wstring(workerId) };
+    if (switches.empty() == false) {
+        cmdLine.append(L" ").append(switches);
+    }
+    std::vector<wchar_t> cmdLineBuf(cmdLine.begin(), cmdLine.end());
+    cmdLineBuf.push_back(L'\0');
+
+    PROCESS_INFORMATION procInfo {};
+    const BOOL created {
+        CreateProcessW(
+            exePath.c_str(),
+            cmdLineBuf.data(),
+            NULL,
+            NULL,
+            TRUE,
+            CREATE_NO_WINDOW,
+            NULL,
+            NULL,
+            &startupInfo,
+            &procInfo
+        )
+    };
+
+    CloseHandle(hChildInRead);
+    CloseHandle(hChildOutWrite);
+
+    if (created == FALSE) {
+        CloseHandle(hChildInWrite);
+        CloseHandle(hChildOutRead);
+        return nullptr;
+    }
+
+    CloseHandle(procInfo.hThread);
+
+    return std::unique_ptr<WorkerChannel> {
+        new PipeWorkerChannel { hChildInWrite, hChildOutRead, procInfo.hProcess, TRUE }
+    };
+}
+
+std::unique_ptr<WorkerChannel> openSupervisorChannel() {
+    return std::unique_ptr<WorkerChannel> {
+        new PipeWorkerChannel { GetStdHandle(STD_OUTPUT_HANDLE), GetStdHandle(STD_INPUT_HANDLE), NULL, FALSE }
+    };
+}
+
+#else
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    /// <summary>
+    ///  Channel over one end of a socket pair. From the supervisor side it
+    ///  also owns the forked worker, which is reaped when the channel goes.
+    /// </summary>
+    class SocketWorkerChannel : public WorkerChannel {
+    private:
+        int fd { -1 };
+        pid_t pid { 0 };
+
+    public:
+        SocketWorkerChannel(int fd, pid_t pid) : fd(fd), pid(pid) {}
+        SocketWorkerChannel(const SocketWorkerChannel&) = delete;
+        SocketWorkerChannel& operator=(const SocketWorkerChannel&) = delete;
+
+        ~SocketWorkerChannel() {
+            // Other forked workers hold copies of the descriptor, so the socket
+            // is shut down for an idle worker to see it closing and exit
+            shutdown(fd, SHUT_RDWR);
+            close(fd);
+
+            if (pid > 0) {
+                int status { 0 };
+                while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+            }
+        }
+
+        bool write(const char* data, std::size_t size) override {
+            while (size > 0) {
+                // MSG_NOSIGNAL avoids SIGPIPE if the worker is already gone
+                const ssize_t sent { send(fd, data, size, MSG_NOSIGNAL) };
+
+                if (sent < 0) {
+                    if (errno == EINTR) { continue; }
+                    return false;
+                }
+
+                data += sent;
+                size -= static_cast<std::size_t>(sent);
+            }
+
+            return true;
+        }
+
+        ChannelStatus read(char* buffer, std::size_t capacity, std::size_t& rRead, std::uint32_t timeoutMs) override {
+            const auto start = std::chrono::steady_clock::now();
+
+            while (true) {
+                int pollTimeoutMs { -1 };
+                if (timeoutMs != infiniteTimeoutMs) {
+                    const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start
+                    ).count();
+                    if (elapsedMs >= timeoutMs) { return ChannelStatus::Timeout; }
+
+                    pollTimeoutMs = static_cast<int>(timeoutMs - elapsedMs);
+                }
+
+                pollfd pollFd {};
+                pollFd.fd = fd;
+                pollFd.events = POLLIN;
+
+                const int ready { poll(&pollFd, 1, pollTimeoutMs) };
+                if (ready < 0) {
+                    if (errno == EINTR) { continue; }
+                    return ChannelStatus::Closed;
+                }
+                if (ready == 0) { return ChannelStatus::Timeout; }
+
+                const ssize_t received { recv(fd, buffer, capacity, 0) };
+                if (received < 0 && errno == EINTR) { continue; }
+                if (received <= 0) { return ChannelStatus::Closed; }
+
+                rRead = static_cast<std::size_t>(received);
+                return ChannelStatus::Data;
+            }
+        }
+
+        void terminate() override {
+            if (pid > 0) {
+                kill(pid, SIGKILL);
+            }
+        }
+    };
+}
+
+std::unique_ptr<WorkerChannel> forkWorkerProcess(const std::function<int(WorkerChannel&)>& workerMain) {
+    int fds[2] { -1, -1 };
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return nullptr;
+    }
+
+    const pid_t pid { fork() };
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return nullptr;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+
+        int exitCode { 0 };
+        {
+            SocketWorkerChannel supervisor { fds[1], 0 };
+            exitCode = workerMain(supervisor);
+        }
+
+        // Skip the atexit handlers inherited from the supervisor
+        _exit(exitCode);
+    }
+
+    close(fds[1]);
+
+    return std::unique_ptr<WorkerChannel> { new SocketWorkerChannel { fds[0], pid } };
+}
+
+#endif
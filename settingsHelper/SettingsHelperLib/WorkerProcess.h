@@ -0,0 +1,56 @@
+/**
+ * Channels between the supervisor and the worker processes.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include "WorkerPool.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+
+/// <summary>
+///  Starts a worker process running the supplied executable with the switches
+///  '-worker <workerId>', its standard input and output being the channel to it.
+/// </summary>
+/// <param name="exePath">The executable of the worker, usually this same one.</param>
+/// <param name="workerId">Number identifying the worker, only informative.</param>
+/// <param name="switches">
+///  Extra switches added to the command line of the worker, already quoted.
+/// </param>
+/// <returns>The channel to the worker, or nullptr if it couldn't be started.</returns>
+std::unique_ptr<WorkerChannel> spawnWorkerProcess(
+    const std::wstring& exePath,
+    std::size_t workerId,
+    const std::wstring& switches = std::wstring {}
+);
+/// <summary>
+///  Gets the channel to the supervisor from inside a worker process, which is
+///  made of the standard input and output of the process.
+/// </summary>
+std::unique_ptr<WorkerChannel> openSupervisorChannel();
+
+#else
+
+/// <summary>
+///  Starts a worker by forking the current process, the child runs the
+///  supplied function over its end of a socket pair and exits with the value
+///  it returns. Used to exercise the supervisor on POSIX systems, where the
+///  setting libraries don't exist.
+/// </summary>
+/// <returns>The channel to the worker, or nullptr if it couldn't be started.</returns>
+std::unique_ptr<WorkerChannel> forkWorkerProcess(const std::function<int(WorkerChannel&)>& workerMain);
+
+#endif
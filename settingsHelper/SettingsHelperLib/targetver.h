@@ -17,4 +17,8 @@
 // If you wish to build your application for a previous Windows platform, include WinSDKVer.h and
 // set the _WIN32_WINNT macro to the platform you wish to support before including SDKDDKVer.h.
 
+// The portable parts of the library are also built outside Windows, by the
+// Node addon tests.
+#ifdef _WIN32
 #include <SDKDDKVer.h>
+#endif
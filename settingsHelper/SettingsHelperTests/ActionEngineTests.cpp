@@ -0,0 +1,127 @@
+/**
+ * Tests for the engine running batches in a dedicated thread.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <ActionEngine.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Backend answering each batch with a single result holding the payload
+    ///  and its deadline, and recording the threads it was called from.
+    /// </summary>
+    class EchoBackend : public EngineBackend {
+    private:
+        bool startResult { true };
+        std::atomic<std::uint32_t>& stops;
+
+    public:
+        std::atomic<std::uint32_t> startThread { 0 };
+        std::atomic<std::uint32_t> batchThread { 0 };
+        std::atomic<bool> mixedThreads { false };
+
+        EchoBackend(bool startResult, std::atomic<std::uint32_t>& stops) : startResult(startResult), stops(stops) {}
+
+        bool start() override {
+            startThread = currentThreadId();
+            return startResult;
+        }
+
+        vector<EngineResult> runBatch(const wstring& payload, std::uint32_t deadlineMs) override {
+            if (batchThread.exchange(currentThreadId()) != 0 && batchThread != startThread) {
+                mixedThreads = true;
+            }
+
+            EngineResult result {};
+            result.settingId = L"echo";
+            result.returnValue = payload;
+            result.errorMessage = std::to_wstring(deadlineMs);
+
+            return vector<EngineResult> { result };
+        }
+
+        void stop() override {
+            if (currentThreadId() != startThread) { mixedThreads = true; }
+            stops++;
+        }
+    };
+}
+
+TEST(ActionEngine, RunsBatchesInOrder) {
+    std::atomic<std::uint32_t> stops { 0 };
+    EchoBackend* pBackend { new EchoBackend { true, stops } };
+    ActionEngine engine { std::unique_ptr<EngineBackend> { pBackend } };
+
+    ASSERT_TRUE(engine.start());
+    EXPECT_FALSE(engine.start());
+
+    NativeMutex resultsMutex {};
+    vector<wstring> results {};
+    vector<wstring> deadlines {};
+
+    for (int i = 0; i < 50; i++) {
+        const bool submitted {
+            engine.submit(
+                std::to_wstring(i), i * 10, [&resultsMutex, &results, &deadlines](vector<EngineResult> batchResults) {
+                    NativeLockGuard lock { resultsMutex };
+                    results.push_back(batchResults.at(0).returnValue);
+                    deadlines.push_back(batchResults.at(0).errorMessage);
+                }
+            )
+        };
+        EXPECT_TRUE(submitted);
+    }
+
+    // Batches queued before stopping are still run
+    engine.stop();
+    EXPECT_FALSE(engine.submit(L"late", 0, [](vector<EngineResult>) { FAIL(); }));
+
+    ASSERT_EQ(results.size(), 50);
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(results[i], std::to_wstring(i));
+        // Each batch gets its own deadline
+        EXPECT_EQ(deadlines[i], std::to_wstring(i * 10));
+    }
+
+    EXPECT_EQ(engine.getBatchesRun(), 50);
+    EXPECT_EQ(stops, 1);
+    // The backend is only used from the engine thread
+    EXPECT_NE(pBackend->startThread, currentThreadId());
+    EXPECT_FALSE(pBackend->mixedThreads);
+}
+
+TEST(ActionEngine, FailedStart) {
+    std::atomic<std::uint32_t> stops { 0 };
+    ActionEngine engine { std::unique_ptr<EngineBackend> { new EchoBackend { false, stops } } };
+
+    EXPECT_FALSE(engine.start());
+    EXPECT_FALSE(engine.submit(L"payload", 0, [](vector<EngineResult>) { FAIL(); }));
+
+    engine.stop();
+    EXPECT_EQ(stops, 0);
+}
+
+TEST(ActionEngine, StoppedWithoutStarting) {
+    std::atomic<std::uint32_t> stops { 0 };
+    ActionEngine engine { std::unique_ptr<EngineBackend> { new EchoBackend { true, stops } } };
+
+    engine.stop();
+    EXPECT_FALSE(engine.start());
+    EXPECT_EQ(stops, 0);
+}
@@ -0,0 +1,94 @@
+/**
+ * Tests for the action methods table.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <ActionMethod.h>
+
+#include <cstddef>
+#include <string>
+
+TEST(ActionMethod, TableIsIndexedByMethod) {
+    for (std::size_t i = 0; i < actionMethodsNum; i++) {
+        EXPECT_EQ(static_cast<std::size_t>(actionMethodsTable()[i].method), i);
+    }
+}
+
+TEST(ActionMethod, NamesRoundTrip) {
+    for (std::size_t i = 1; i < actionMethodsNum; i++) {
+        const ActionMethodInfo& info { actionMethodsTable()[i] };
+        EXPECT_EQ(parseActionMethod(WStringView { info.name }), info.method);
+    }
+}
+
+TEST(ActionMethod, UnknownNames) {
+    EXPECT_EQ(parseActionMethod(WStringView { L"" }), ActionMethod::Unknown);
+    EXPECT_EQ(parseActionMethod(WStringView { L"getvalue" }), ActionMethod::Unknown);
+    EXPECT_EQ(parseActionMethod(WStringView { L"GetValues" }), ActionMethod::Unknown);
+
+    // Views over a larger buffer only match their own contents
+    std::wstring buffer { L"GetValueAndMore" };
+    EXPECT_EQ(parseActionMethod(WStringView { buffer.data(), 8 }), ActionMethod::GetValue);
+    EXPECT_EQ(parseActionMethod(WStringView { buffer.data(), 7 }), ActionMethod::Unknown);
+}
+
+TEST(ActionMethod, RequiredParams) {
+    for (std::size_t i = 0; i < actionMethodsNum; i++) {
+        const ActionMethodInfo& info { actionMethodsTable()[i] };
+        const bool requiresParams {
+            info.method == ActionMethod::SetValue ||
+            info.method == ActionMethod::Snapshot ||
+            info.method == ActionMethod::Restore
+        };
+
+        EXPECT_EQ(info.requiresParams, requiresParams);
+    }
+}
+
+TEST(ActionMethod, OnlySetValueSetsValues) {
+    for (std::size_t i = 0; i < actionMethodsNum; i++) {
+        const ActionMethodInfo& info { actionMethodsTable()[i] };
+        EXPECT_EQ(info.setsValues, info.method == ActionMethod::SetValue);
+    }
+}
+
+TEST(ActionMethod, Barriers) {
+    for (std::size_t i = 0; i < actionMethodsNum; i++) {
+        const ActionMethodInfo& info { actionMethodsTable()[i] };
+        const bool isBarrier {
+            info.method == ActionMethod::Invoke ||
+            info.method == ActionMethod::Snapshot ||
+            info.method == ActionMethod::Restore
+        };
+
+        EXPECT_EQ(info.isBarrier, isBarrier);
+    }
+}
+
+TEST(ActionMethod, OnlyReadsAcceptSelectors) {
+    for (std::size_t i = 0; i < actionMethodsNum; i++) {
+        const ActionMethodInfo& info { actionMethodsTable()[i] };
+        const bool acceptsSelectors {
+            info.method == ActionMethod::GetValue || info.method == ActionMethod::GetMetadata
+        };
+
+        EXPECT_EQ(info.acceptsSelectors, acceptsSelectors);
+        // Selected settings are never set, nor given parameters
+        EXPECT_FALSE(info.acceptsSelectors && (info.requiresParams || info.setsValues || info.isBarrier));
+    }
+}
+
+TEST(ActionMethod, OnlyGetValueProjectsFields) {
+    for (std::size_t i = 0; i < actionMethodsNum; i++) {
+        const ActionMethodInfo& info { actionMethodsTable()[i] };
+        EXPECT_EQ(info.projectsFields, info.method == ActionMethod::GetValue);
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * Tests for the batch arena.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <BatchArena.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+TEST(BatchArena, AllocationsAreAligned) {
+    BatchArena arena { 256 };
+
+    for (std::size_t i = 1; i < 64; i++) {
+        void* mem { arena.allocate(i, 8) };
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mem) % 8, 0);
+    }
+
+    EXPECT_EQ(arena.allocations(), 63);
+}
+
+TEST(BatchArena, ResetReusesBlocks) {
+    BatchArena arena { 1024 };
+
+    for (int batch = 0; batch < 10; batch++) {
+        for (int i = 0; i < 100; i++) {
+            arena.allocate(64, 8);
+        }
+
+        arena.reset();
+    }
+
+    // The first batch determines the memory required by the following ones
+    BatchArena reference { 1024 };
+    for (int i = 0; i < 100; i++) {
+        reference.allocate(64, 8);
+    }
+
+    EXPECT_EQ(arena.capacity(), reference.capacity());
+    EXPECT_EQ(arena.allocations(), 0);
+}
+
+TEST(BatchArena, OversizedAllocations) {
+    BatchArena arena { 64 };
+
+    unsigned char* mem { static_cast<unsigned char*>(arena.allocate(4096, 16)) };
+    mem[0] = 1;
+    mem[4095] = 1;
+
+    EXPECT_GE(arena.capacity(), 4096);
+}
+
+TEST(BatchArena, AllocatorUsesCurrentArena) {
+    BatchArena arena {};
+
+    {
+        BatchScope scope { arena };
+        BatchVector<std::wstring> values {};
+
+        values.push_back(L"SystemSettings_Accessibility_Magnifier_IsEnabled");
+        values.push_back(L"SystemSettings_Display_BlueLight_ManualToggleQuickAction");
+
+        EXPECT_EQ(values.get_allocator().arena(), &arena);
+        EXPECT_GT(arena.allocations(), 0);
+    }
+
+    EXPECT_EQ(BatchArena::current(), nullptr);
+
+    BatchVector<int> heapValues { 1, 2, 3 };
+    EXPECT_EQ(heapValues.get_allocator().arena(), nullptr);
+}
+
+TEST(BatchArena, MovedContainersKeepTheirArena) {
+    BatchArena arena {};
+    BatchVector<int> target {};
+
+    {
+        BatchScope scope { arena };
+        BatchVector<int> values { 1, 2, 3 };
+        target = std::move(values);
+    }
+
+    EXPECT_EQ(target.get_allocator().arena(), &arena);
+    EXPECT_EQ(target.size(), 3);
+}
+
+TEST(BatchArena, NestedScopes) {
+    BatchArena outer {};
+    BatchArena inner {};
+
+    BatchScope outerScope { outer };
+    {
+        BatchScope innerScope { inner };
+        EXPECT_EQ(BatchArena::current(), &inner);
+    }
+
+    EXPECT_EQ(BatchArena::current(), &outer);
+}
@@ -0,0 +1,79 @@
+/**
+ * Tests for the latency budget of the batches.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <BatchDeadline.h>
+
+#include <cstdint>
+
+TEST(BatchDeadline, RemainingTime) {
+    BatchDeadline expired { 0 };
+    EXPECT_TRUE(expired.expired());
+    EXPECT_EQ(expired.remainingMs(), 0);
+
+    BatchDeadline pending { 60 * 1000 };
+    EXPECT_FALSE(pending.expired());
+    EXPECT_GT(pending.remainingMs(), 0);
+    EXPECT_LE(pending.remainingMs(), 60 * 1000);
+}
+
+TEST(BatchDeadline, ScopesAreNested) {
+    EXPECT_EQ(BatchDeadline::current(), nullptr);
+    EXPECT_FALSE(batchDeadlineExpired());
+
+    BatchDeadline outer { 60 * 1000 };
+    BatchDeadline inner { 0 };
+    {
+        DeadlineScope outerScope { &outer };
+        EXPECT_EQ(BatchDeadline::current(), &outer);
+        EXPECT_FALSE(batchDeadlineExpired());
+
+        {
+            DeadlineScope innerScope { &inner };
+            EXPECT_EQ(BatchDeadline::current(), &inner);
+            EXPECT_TRUE(batchDeadlineExpired());
+
+            // Installing no deadline lifts the one of the enclosing scope
+            DeadlineScope noScope { nullptr };
+            EXPECT_EQ(BatchDeadline::current(), nullptr);
+            EXPECT_FALSE(batchDeadlineExpired());
+        }
+
+        EXPECT_EQ(BatchDeadline::current(), &outer);
+    }
+
+    EXPECT_EQ(BatchDeadline::current(), nullptr);
+}
+
+TEST(BatchDeadline, BoundPolls) {
+    // Without a deadline the waits are left as they are
+    EXPECT_EQ(boundPolls(10, 100), 10);
+    EXPECT_EQ(boundPolls(UINT32_MAX, 10), UINT32_MAX);
+
+    BatchDeadline expired { 0 };
+    {
+        DeadlineScope scope { &expired };
+        EXPECT_EQ(boundPolls(10, 100), 0);
+        EXPECT_EQ(boundPolls(UINT32_MAX, 10), 0);
+    }
+
+    BatchDeadline pending { 60 * 1000 };
+    {
+        DeadlineScope scope { &pending };
+        EXPECT_EQ(boundPolls(10, 100), 10);
+        // Only the polls fitting in the time left are done
+        const std::uint32_t polls { boundPolls(UINT32_MAX, 10) };
+        EXPECT_GT(polls, 0);
+        EXPECT_LE(polls, 6000);
+        EXPECT_EQ(boundPolls(10, 0), 10);
+    }
+}
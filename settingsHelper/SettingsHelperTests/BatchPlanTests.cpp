@@ -0,0 +1,319 @@
+/**
+ * Tests for the coalescing of the actions of a batch.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <BatchPlan.h>
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    PlanAction planAction(const wchar_t* settingPath, ActionMethod method, bool selectsElements = false) {
+        PlanAction action {};
+        action.settingPath = WStringView { settingPath };
+        action.method = method;
+        action.valid = true;
+        action.selectsElements = selectsElements;
+
+        return action;
+    }
+
+    void expectStep(const PlannedAction& planned, PlanStep step, std::size_t source = 0) {
+        EXPECT_EQ(planned.step, step);
+
+        if (step != PlanStep::Run) {
+            EXPECT_EQ(planned.source, source);
+        }
+    }
+}
+
+TEST(BatchPlan, RepeatedGets) {
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::GetValue),
+        planAction(L"A.Value", ActionMethod::GetValue),
+        planAction(L"A.Inner", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::GetMetadata),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::GetStats)
+    };
+    vector<PlannedAction> plan {};
+
+    EXPECT_EQ(planBatch(actions, plan), 2);
+    ASSERT_EQ(plan.size(), actions.size());
+
+    expectStep(plan[0], PlanStep::Run);
+    expectStep(plan[1], PlanStep::Run);
+    // The value of a setting can be named with or without its id
+    expectStep(plan[2], PlanStep::ReuseResult, 0);
+    expectStep(plan[3], PlanStep::Run);
+    expectStep(plan[4], PlanStep::Run);
+    expectStep(plan[5], PlanStep::ReuseResult, 0);
+    expectStep(plan[6], PlanStep::Run);
+}
+
+TEST(BatchPlan, GetsAfterSets) {
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"A.Inner", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::Invoke),
+        planAction(L"A", ActionMethod::GetValue)
+    };
+    vector<PlannedAction> plan {};
+
+    EXPECT_EQ(planBatch(actions, plan), 2);
+
+    expectStep(plan[0], PlanStep::Run);
+    expectStep(plan[1], PlanStep::Run);
+    expectStep(plan[2], PlanStep::Run);
+    // Reads after a set are answered with the value that was set
+    expectStep(plan[3], PlanStep::ReadSetValue, 1);
+    // Other values of the setting may have changed
+    expectStep(plan[4], PlanStep::Run);
+    expectStep(plan[5], PlanStep::ReadSetValue, 1);
+    // Invoking a setting may change any other
+    expectStep(plan[6], PlanStep::Run);
+    expectStep(plan[7], PlanStep::Run);
+}
+
+TEST(BatchPlan, SupersededSets) {
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::Invoke),
+        planAction(L"A", ActionMethod::SetValue)
+    };
+    vector<PlannedAction> plan {};
+
+    EXPECT_EQ(planBatch(actions, plan), 3);
+
+    // Sets nothing observed are answered by the one replacing them
+    expectStep(plan[0], PlanStep::Superseded, 2);
+    expectStep(plan[2], PlanStep::Superseded, 3);
+    expectStep(plan[3], PlanStep::Run);
+    // Reading the value keeps the set, which answers the read
+    expectStep(plan[1], PlanStep::Run);
+    expectStep(plan[4], PlanStep::ReadSetValue, 1);
+    expectStep(plan[5], PlanStep::Run);
+    // So does an invoke in between
+    expectStep(plan[6], PlanStep::Run);
+    expectStep(plan[7], PlanStep::Run);
+}
+
+TEST(BatchPlan, SetsInSameLibrary) {
+    vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"C", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"C", ActionMethod::GetValue),
+        planAction(L"D", ActionMethod::GetValue),
+        planAction(L"D", ActionMethod::GetValue)
+    };
+    const wchar_t* const libraries[] { L"a.dll", L"a.dll", L"c.dll", L"a.dll", L"a.dll", L"c.dll", L"", L"" };
+    for (std::size_t i = 0; i < actions.size(); i++) {
+        actions[i].library = WStringView { libraries[i] };
+    }
+
+    vector<PlannedAction> plan {};
+    EXPECT_EQ(planBatch(actions, plan), 3);
+
+    // Setting B may change A, which is read again, while C is left alone
+    expectStep(plan[0], PlanStep::Run);
+    expectStep(plan[1], PlanStep::Superseded, 3);
+    expectStep(plan[3], PlanStep::Run);
+    expectStep(plan[4], PlanStep::Run);
+    expectStep(plan[5], PlanStep::ReadSetValue, 2);
+    // Settings of unknown libraries are only changed by their own sets
+    expectStep(plan[6], PlanStep::Run);
+    expectStep(plan[7], PlanStep::ReuseResult, 6);
+
+    // Setting a value of a library also drops the pending sets of the others
+    const vector<PlanAction> pendingActions {
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::SetValue)
+    };
+    vector<PlanAction> sameLibrary { pendingActions };
+    for (auto& action : sameLibrary) {
+        action.library = WStringView { L"a.dll" };
+    }
+
+    EXPECT_EQ(planBatch(sameLibrary, plan), 0);
+    expectStep(plan[0], PlanStep::Run);
+    EXPECT_EQ(planBatch(pendingActions, plan), 1);
+    expectStep(plan[0], PlanStep::Superseded, 2);
+
+    // And reading a setting of the library observes the pending sets of the others
+    vector<PlanAction> observedLibrary {
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::SetValue)
+    };
+    for (auto& action : observedLibrary) {
+        action.library = WStringView { L"a.dll" };
+    }
+
+    EXPECT_EQ(planBatch(observedLibrary, plan), 0);
+    expectStep(plan[0], PlanStep::Run);
+    expectStep(plan[1], PlanStep::Run);
+    expectStep(plan[2], PlanStep::Run);
+
+    observedLibrary[1].library = WStringView { L"b.dll" };
+    EXPECT_EQ(planBatch(observedLibrary, plan), 1);
+    expectStep(plan[0], PlanStep::Superseded, 2);
+}
+
+TEST(BatchPlan, UncoalescedActions) {
+    PlanAction invalid { planAction(L"A", ActionMethod::GetValue) };
+    invalid.valid = false;
+
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::GetValue, true),
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::SetValue, true),
+        planAction(L"A", ActionMethod::GetValue),
+        invalid,
+        planAction(L"A.B.C", ActionMethod::GetValue),
+        planAction(L"A.B.C", ActionMethod::GetValue)
+    };
+    vector<PlannedAction> plan {};
+
+    // Collection elements are always run, and they observe the setting
+    EXPECT_EQ(planBatch(actions, plan), 0);
+    for (const auto& planned : plan) {
+        expectStep(planned, PlanStep::Run);
+    }
+}
+
+TEST(BatchPlan, ProjectedGets) {
+    PlanAction projected { planAction(L"A", ActionMethod::GetValue) };
+    projected.projectsFields = true;
+
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::GetValue),
+        projected,
+        projected,
+        planAction(L"A", ActionMethod::SetValue),
+        projected,
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::GetValue)
+    };
+    vector<PlannedAction> plan {};
+
+    // Results holding metadata are neither reused nor taken from a SetValue,
+    // and they observe the values set before them
+    EXPECT_EQ(planBatch(actions, plan), 1);
+    for (std::size_t i = 0; i < 6; i++) {
+        expectStep(plan[i], PlanStep::Run);
+    }
+    expectStep(plan[6], PlanStep::ReadSetValue, 5);
+}
+
+TEST(BatchPlan, GroupByLibrary) {
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"B", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"C", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::SetValue),
+        planAction(L"D", ActionMethod::Invoke),
+        planAction(L"B", ActionMethod::GetValue),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::SetValue)
+    };
+    const vector<wstring> libraries {
+        L"a.dll", L"b.dll", L"a.dll", L"", L"b.dll", L"d.dll", L"b.dll", L"a.dll", L"b.dll"
+    };
+    vector<std::size_t> order {};
+
+    groupByLibrary(actions, libraries, order);
+
+    // Libraries in order of appearance, keeping the order of their actions, and
+    // nothing crosses the invoke
+    EXPECT_EQ(order, (vector<std::size_t> { 0, 2, 1, 4, 3, 5, 6, 8, 7 }));
+
+    // The planned steps refer to earlier actions of the same setting, which
+    // are still run before them
+    vector<PlannedAction> plan {};
+    planBatch(actions, plan);
+    vector<bool> done(actions.size(), false);
+
+    for (const std::size_t i : order) {
+        if (plan[i].step == PlanStep::ReuseResult || plan[i].step == PlanStep::ReadSetValue) {
+            EXPECT_TRUE(done[plan[i].source]);
+        }
+
+        done[i] = true;
+    }
+}
+
+TEST(BatchPlan, GroupByLibraryEdges) {
+    vector<std::size_t> order { 42 };
+
+    groupByLibrary({}, {}, order);
+    EXPECT_TRUE(order.empty());
+
+    const vector<PlanAction> invokes {
+        planAction(L"A", ActionMethod::Invoke),
+        planAction(L"B", ActionMethod::Invoke)
+    };
+    groupByLibrary(invokes, { L"a.dll", L"a.dll" }, order);
+    EXPECT_EQ(order, (vector<std::size_t> { 0, 1 }));
+
+    // Actions whose library is unknown are grouped together
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"X", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::GetValue),
+        planAction(L"Y", ActionMethod::GetValue)
+    };
+    groupByLibrary(actions, { L"a.dll", L"", L"a.dll", L"" }, order);
+    EXPECT_EQ(order, (vector<std::size_t> { 0, 2, 1, 3 }));
+}
+
+TEST(BatchPlan, SnapshotAndRestoreAreBarriers) {
+    const vector<PlanAction> actions {
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"Saved", ActionMethod::Snapshot),
+        planAction(L"A", ActionMethod::SetValue),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"Saved", ActionMethod::Restore),
+        planAction(L"A", ActionMethod::GetValue),
+        planAction(L"B", ActionMethod::GetValue)
+    };
+    vector<PlannedAction> plan {};
+
+    // The snapshot observes the first set, and the restore may change the setting
+    EXPECT_EQ(planBatch(actions, plan), 1);
+    expectStep(plan[0], PlanStep::Run);
+    expectStep(plan[3], PlanStep::ReadSetValue, 2);
+    expectStep(plan[5], PlanStep::Run);
+
+    vector<std::size_t> order {};
+    groupByLibrary(actions, { L"a.dll", L"", L"a.dll", L"a.dll", L"", L"a.dll", L"" }, order);
+    EXPECT_EQ(order, (vector<std::size_t> { 0, 1, 2, 3, 4, 5, 6 }));
+}
@@ -0,0 +1,58 @@
+/**
+ * Helper for running test code from several threads.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// <thread> can't be included in the tests compiled with /clr
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <thread>
+#endif
+
+/// <summary>
+///  Runs each of the supplied tasks in its own thread, waiting for all of them
+///  to finish.
+/// </summary>
+inline void runConcurrently(std::vector<std::function<void()>>& tasks) {
+#ifdef _WIN32
+    std::vector<HANDLE> threads {};
+
+    for (auto& task : tasks) {
+        LPTHREAD_START_ROUTINE runTask = [](LPVOID param) -> DWORD {
+            (*static_cast<std::function<void()>*>(param))();
+            return 0;
+        };
+
+        threads.push_back(CreateThread(NULL, 0, runTask, &task, 0, NULL));
+    }
+
+    WaitForMultipleObjects(static_cast<DWORD>(threads.size()), threads.data(), TRUE, INFINITE);
+
+    for (const auto& thread : threads) {
+        CloseHandle(thread);
+    }
+#else
+    std::vector<std::thread> threads {};
+
+    for (auto& task : tasks) {
+        threads.emplace_back(task);
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+#endif
+}
@@ -0,0 +1,198 @@
+/**
+ * Tests for the registry of native handlers.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <NativeHandlers.h>
+#include <SettingsStats.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  What a FakeHandler was asked to do, kept outside of it as the registry
+    ///  owns the handler.
+    /// </summary>
+    struct FakeHandlerLog {
+        int loads { 0 };
+        int unloads { 0 };
+        std::int32_t loadError { 0 };
+        vector<wstring> valueIds {};
+        vector<wstring> values {};
+    };
+
+    /// <summary>
+    ///  Handler holding a single value, reported with the namespace it serves.
+    /// </summary>
+    class FakeHandler : public NativeHandler {
+    private:
+        FakeHandlerLog& log;
+        wstring name {};
+        wstring value { L"0" };
+
+    public:
+        FakeHandler(FakeHandlerLog& log, const wchar_t* name) : log(log), name(name) {}
+
+        std::int32_t load() override {
+            log.loads++;
+            return log.loadError;
+        }
+
+        std::int32_t handle(const NativeRequest& request, wstring& rVal, wstring* pAppliedVal) override {
+            log.valueIds.push_back(request.valueId.str());
+            log.values.push_back(request.value);
+
+            rVal = name + L":" + value;
+
+            if (request.method == ActionMethod::SetValue) {
+                value = request.value;
+
+                if (pAppliedVal != nullptr) {
+                    *pAppliedVal = value;
+                }
+            }
+
+            return 0;
+        }
+
+        void unload() override {
+            log.unloads++;
+        }
+    };
+
+    std::unique_ptr<NativeHandler> fakeHandler(FakeHandlerLog& log, const wchar_t* name) {
+        return std::unique_ptr<NativeHandler> { new FakeHandler { log, name } };
+    }
+}
+
+TEST(NativeHandlers, Add) {
+    FakeHandlerLog log {};
+    NativeHandlers handlers {};
+
+    EXPECT_TRUE(handlers.add(L"Native.Volume", fakeHandler(log, L"volume")));
+    EXPECT_TRUE(handlers.add(L"Native.Volume.Capture", fakeHandler(log, L"capture")));
+    EXPECT_FALSE(handlers.add(L"Native.Volume", fakeHandler(log, L"again")));
+    EXPECT_FALSE(handlers.add(L"", fakeHandler(log, L"empty")));
+    EXPECT_FALSE(handlers.add(L".Native", fakeHandler(log, L"leading")));
+    EXPECT_FALSE(handlers.add(L"Native.", fakeHandler(log, L"trailing")));
+    EXPECT_FALSE(handlers.add(L"Native.Mouse", nullptr));
+
+    EXPECT_EQ(handlers.namespaces(), (vector<wstring> { L"Native.Volume", L"Native.Volume.Capture" }));
+}
+
+TEST(NativeHandlers, MatchesWholeSegments) {
+    FakeHandlerLog log {};
+    NativeHandlers handlers {};
+    handlers.add(L"Native.Volume", fakeHandler(log, L"volume"));
+
+    EXPECT_TRUE(handlers.serves(L"Native.Volume"));
+    EXPECT_TRUE(handlers.serves(L"Native.Volume.Muted"));
+    EXPECT_FALSE(handlers.serves(L"Native.VolumeLevel"));
+    EXPECT_FALSE(handlers.serves(L"Native.Volume."));
+    EXPECT_FALSE(handlers.serves(L"Native"));
+    EXPECT_FALSE(handlers.serves(L"SystemSettings_Accessibility_Magnifier_IsEnabled"));
+
+    wstring val {};
+    EXPECT_NE(handlers.handle(L"Native.Mouse", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(log.loads, 0);
+}
+
+TEST(NativeHandlers, LongestNamespaceWins) {
+    FakeHandlerLog volumeLog {};
+    FakeHandlerLog captureLog {};
+    NativeHandlers handlers {};
+    handlers.add(L"Native.Volume", fakeHandler(volumeLog, L"volume"));
+    handlers.add(L"Native.Volume.Capture", fakeHandler(captureLog, L"capture"));
+
+    wstring val {};
+    EXPECT_EQ(handlers.handle(L"Native.Volume", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(val, L"volume:0");
+    EXPECT_EQ(handlers.handle(L"Native.Volume.Muted", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(val, L"volume:0");
+    EXPECT_EQ(handlers.handle(L"Native.Volume.Capture.Muted", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(val, L"capture:0");
+
+    // The namespace alone is the 'Value' of the handler
+    EXPECT_EQ(volumeLog.valueIds, (vector<wstring> { L"Value", L"Muted" }));
+    EXPECT_EQ(captureLog.valueIds, (vector<wstring> { L"Muted" }));
+}
+
+TEST(NativeHandlers, LoadedOnceUntilUnloaded) {
+    FakeHandlerLog log {};
+    NativeHandlers handlers {};
+    handlers.add(L"Native.Volume", fakeHandler(log, L"volume"));
+
+    // Unloading handlers that were never loaded does nothing
+    handlers.unload();
+    EXPECT_EQ(log.unloads, 0);
+
+    wstring val {};
+    wstring appliedVal {};
+    EXPECT_EQ(handlers.handle(L"Native.Volume", ActionMethod::SetValue, L"0.5", val, &appliedVal), 0);
+    EXPECT_EQ(val, L"volume:0");
+    EXPECT_EQ(appliedVal, L"0.5");
+    EXPECT_EQ(handlers.handle(L"Native.Volume", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(val, L"volume:0.5");
+    EXPECT_EQ(log.values, (vector<wstring> { L"0.5", L"" }));
+    EXPECT_EQ(log.loads, 1);
+
+    handlers.unload();
+    EXPECT_EQ(log.unloads, 1);
+
+    EXPECT_EQ(handlers.handle(L"Native.Volume", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(log.loads, 2);
+}
+
+TEST(NativeHandlers, FailedLoadIsRetried) {
+    FakeHandlerLog log {};
+    log.loadError = static_cast<std::int32_t>(0x80004005);
+    NativeHandlers handlers {};
+    handlers.add(L"Native.Volume", fakeHandler(log, L"volume"));
+
+    wstring val {};
+    EXPECT_EQ(handlers.handle(L"Native.Volume", ActionMethod::GetValue, L"", val), log.loadError);
+    EXPECT_TRUE(log.valueIds.empty());
+
+    log.loadError = 0;
+    EXPECT_EQ(handlers.handle(L"Native.Volume", ActionMethod::GetValue, L"", val), 0);
+    EXPECT_EQ(log.loads, 2);
+
+    // Only loaded handlers are unloaded, also when the registry is destroyed
+    handlers.unload();
+    EXPECT_EQ(log.unloads, 1);
+}
+
+TEST(NativeHandlers, CountedInStats) {
+    FakeHandlerLog log {};
+    NativeHandlers handlers {};
+    handlers.add(L"Native.Volume", fakeHandler(log, L"volume"));
+
+    SettingsStats& stats { SettingsStats::instance() };
+    stats.reset();
+
+    wstring val {};
+    handlers.handle(L"Native.Volume", ActionMethod::GetValue, L"", val);
+    handlers.handle(L"Native.Volume", ActionMethod::SetValue, L"1", val);
+
+    EXPECT_EQ(stats.getCounter(StatsCounter::NativeActions), 2);
+
+    const std::string json { stats.toJson(L"Native.Volume") };
+    EXPECT_NE(json.find("\"get\":{\"count\":1,"), std::string::npos);
+    EXPECT_NE(json.find("\"set\":{\"count\":1,"), std::string::npos);
+
+    stats.reset();
+}
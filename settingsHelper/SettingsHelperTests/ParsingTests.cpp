@@ -13,6 +13,8 @@
 #include "pch.h"
 #include <SettingItem.h>
 #include <Payload.h>
+#include <PayloadProc.h>
+#include <SettingsCatalog.h>
 
 #include <windows.foundation.h>
 #include <windows.data.json.h>
@@ -79,7 +81,7 @@ TEST(ParseJSONPayload, getPayloadMagnifier) {
     ASSERT_EQ(1, actions.size());
 
     EXPECT_EQ(actions.front().first.settingID, std::wstring { L"SystemSettings_Accessibility_Magnifier_IsEnabled" });
-    EXPECT_EQ(actions.front().first.method, std::wstring{ L"GetValue" });
+    EXPECT_EQ(actions.front().first.method, ActionMethod::GetValue);
 }
 
 const wstring setPayload = LR"foo(
@@ -101,7 +103,7 @@ TEST(ParseJSONPayload, setPayloadMagnifier) {
     ASSERT_EQ(1, actions.size());
 
     EXPECT_EQ(actions.front().first.settingID, std::wstring { L"SystemSettings_Accessibility_Magnifier_IsEnabled" });
-    EXPECT_EQ(actions.front().first.method, std::wstring{ L"SetValue" });
+    EXPECT_EQ(actions.front().first.method, ActionMethod::SetValue);
 
     ASSERT_EQ(1, actions.front().first.params.size());
     boolean paramValue = false;
@@ -110,3 +112,327 @@ TEST(ParseJSONPayload, setPayloadMagnifier) {
 
     EXPECT_EQ(paramValue, boolean {true});
 }
+
+const wstring invokePayload = LR"foo(
+[
+  {
+    "settingID": "SystemSettings_Gaming_XboxNetworkingAttemptFix",
+    "method": "Invoke"
+  }
+]
+)foo";
+
+TEST(ParseJSONPayload, invokePayload) {
+    std::vector<pair<Action, HRESULT>> actions {};
+
+    HRESULT res = parsePayload(invokePayload, actions);
+
+    EXPECT_EQ(ERROR_SUCCESS, res);
+    ASSERT_EQ(1, actions.size());
+    EXPECT_EQ(actions.front().first.method, ActionMethod::Invoke);
+    EXPECT_TRUE(actions.front().first.params.empty());
+}
+
+const wstring snapshotPayload = LR"foo(
+[
+  {
+    "settingID": "Saved",
+    "method": "Snapshot",
+    "parameters": [ "SystemSettings_Accessibility_Magnifier_IsEnabled", "SystemSettings_Notifications_AppList" ]
+  },
+  { "settingID": "Saved", "method": "Snapshot", "parameters": [ { "elemId": "Elem" } ] },
+  { "settingID": "Saved", "method": "Snapshot" },
+  { "settingID": "Saved", "method": "Restore", "parameters": [ "R1NTAQA=" ] },
+  { "settingID": "Saved", "method": "Restore" }
+]
+)foo";
+
+TEST(ParseJSONPayload, snapshotPayload) {
+    std::vector<pair<Action, HRESULT>> actions {};
+
+    HRESULT res = parsePayload(snapshotPayload, actions);
+
+    EXPECT_EQ(E_INVALIDARG, res);
+    ASSERT_EQ(5, actions.size());
+
+    // Setting ids are listed as plain values, not as elements
+    EXPECT_EQ(ERROR_SUCCESS, actions[0].second);
+    EXPECT_EQ(actions[0].first.method, ActionMethod::Snapshot);
+    EXPECT_EQ(2, actions[0].first.params.size());
+    EXPECT_EQ(E_INVALIDARG, actions[1].second);
+    EXPECT_EQ(WEB_E_JSON_VALUE_NOT_FOUND, actions[2].second);
+
+    EXPECT_EQ(ERROR_SUCCESS, actions[3].second);
+    EXPECT_EQ(actions[3].first.method, ActionMethod::Restore);
+    EXPECT_EQ(WEB_E_JSON_VALUE_NOT_FOUND, actions[4].second);
+}
+
+const wstring selectorPayload = LR"foo(
+[
+  { "settingID": "SystemSettings_Accessibility_*", "method": "GetValue" },
+  { "settingID": "SystemSettings_Display_Scal?", "method": "GetMetadata" },
+  { "settingID": "SystemSettings_Accessibility_*", "method": "SetValue", "parameters": [ true ] },
+  { "settingID": "SystemSettings_Accessibility_*", "method": "GetValue", "parameters": [ { "elemId": "Elem" } ] },
+  { "settingID": "SystemSettings_Accessibility_*", "method": "Invoke" }
+]
+)foo";
+
+TEST(ParseJSONPayload, selectorPayload) {
+    std::vector<pair<Action, HRESULT>> actions {};
+
+    HRESULT res = parsePayload(selectorPayload, actions);
+
+    EXPECT_EQ(E_INVALIDARG, res);
+    ASSERT_EQ(5, actions.size());
+
+    // Selectors are only accepted by the methods reading the settings, without parameters
+    EXPECT_EQ(ERROR_SUCCESS, actions[0].second);
+    EXPECT_EQ(actions[0].first.settingID, L"SystemSettings_Accessibility_*");
+    EXPECT_EQ(ERROR_SUCCESS, actions[1].second);
+    EXPECT_EQ(E_INVALIDARG, actions[2].second);
+    EXPECT_EQ(E_INVALIDARG, actions[3].second);
+    EXPECT_EQ(E_INVALIDARG, actions[4].second);
+}
+
+const wstring fieldsPayload = LR"foo(
+[
+  {
+    "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled",
+    "method": "GetValue",
+    "fields": [ "isEnabled", "description" ]
+  },
+  { "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled", "method": "GetValue", "fields": [] },
+  { "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled", "method": "GetValue", "fields": [ "IsEnabled" ] },
+  { "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled", "method": "GetValue", "fields": [ true ] },
+  { "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled", "method": "GetMetadata", "fields": [ "type" ] }
+]
+)foo";
+
+TEST(ParseJSONPayload, fieldsPayload) {
+    std::vector<pair<Action, HRESULT>> actions {};
+
+    HRESULT res = parsePayload(fieldsPayload, actions);
+
+    EXPECT_EQ(E_INVALIDARG, res);
+    ASSERT_EQ(5, actions.size());
+
+    EXPECT_EQ(ERROR_SUCCESS, actions[0].second);
+    EXPECT_TRUE(hasSettingField(actions[0].first.fields, SettingField::IsEnabled));
+    EXPECT_TRUE(hasSettingField(actions[0].first.fields, SettingField::Description));
+    EXPECT_FALSE(hasSettingField(actions[0].first.fields, SettingField::Type));
+    EXPECT_EQ(ERROR_SUCCESS, actions[1].second);
+    EXPECT_EQ(0, actions[1].first.fields);
+
+    // Field names are case sensitive strings, only accepted by GetValue
+    EXPECT_EQ(E_INVALIDARG, actions[2].second);
+    EXPECT_EQ(E_INVALIDARG, actions[3].second);
+    EXPECT_EQ(E_INVALIDARG, actions[4].second);
+}
+
+const wstring unknownMethodPayload = LR"foo(
+[
+  {
+    "settingID": "SystemSettings_Accessibility_Magnifier_IsEnabled",
+    "method": "getvalue"
+  }
+]
+)foo";
+
+TEST(ParseJSONPayload, unknownMethodPayload) {
+    std::vector<pair<Action, HRESULT>> actions {};
+
+    HRESULT res = parsePayload(unknownMethodPayload, actions);
+
+    EXPECT_EQ(E_INVALIDARG, res);
+    ASSERT_EQ(1, actions.size());
+    EXPECT_EQ(E_INVALIDARG, actions.front().second);
+}
+
+/// <summary>
+///  Builds the 'argv' for the supplied arguments, pointing into their buffers.
+/// </summary>
+vector<wchar_t*> buildArgv(vector<wstring>& args) {
+    vector<wchar_t*> argv {};
+
+    for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+
+    return argv;
+}
+
+const wstring catalogedPayload = LR"foo(
+[
+  { "settingID": "SystemSettings_Test_TimeSpan", "method": "SetValue", "parameters": [ "00:05:00" ] },
+  { "settingID": "SystemSettings_Test_TimeSpan", "method": "SetValue", "parameters": [ "five minutes" ] },
+  { "settingID": "SystemSettings_Test_Boolean", "method": "SetValue", "parameters": [ "true" ] },
+  { "settingID": "SystemSettings_Test_Boolean", "method": "SetValue", "parameters": [ true ] },
+  { "settingID": "SystemSettings_Test_TimeSpan", "method": "GetValue" },
+  { "settingID": "SystemSettings_Test_Unknown", "method": "SetValue", "parameters": [ "five minutes" ] }
+]
+)foo";
+
+TEST(ParseJSONPayload, catalogedValueTypes) {
+    SettingsCatalog catalog { L"10.0.17763" };
+
+    CatalogEntry timeSpanEntry {};
+    timeSpanEntry.settingId = L"SystemSettings_Test_TimeSpan";
+    timeSpanEntry.valueType = PropertyType::PropertyType_TimeSpan;
+    catalog.add(timeSpanEntry);
+
+    CatalogEntry booleanEntry {};
+    booleanEntry.settingId = L"SystemSettings_Test_Boolean";
+    booleanEntry.valueType = PropertyType::PropertyType_Boolean;
+    catalog.add(booleanEntry);
+
+    std::vector<pair<Action, HRESULT>> actions {};
+    EXPECT_EQ(E_INVALIDARG, parsePayload(catalogedPayload, actions, &catalog));
+    ASSERT_EQ(6, actions.size());
+
+    // Values are already of the type of the setting value after parsing
+    ASSERT_EQ(ERROR_SUCCESS, actions[0].second);
+    PropertyType paramType { PropertyType::PropertyType_Empty };
+    actions[0].first.params.front().iPropVal->get_Type(&paramType);
+    EXPECT_EQ(PropertyType::PropertyType_TimeSpan, paramType);
+
+    // Malformed values are rejected before loading the setting
+    EXPECT_EQ(E_INVALIDARG, actions[1].second);
+    EXPECT_EQ(E_INVALIDARG, actions[2].second);
+    EXPECT_EQ(ERROR_SUCCESS, actions[3].second);
+    EXPECT_EQ(ERROR_SUCCESS, actions[4].second);
+
+    // Settings that aren't cataloged are converted once they are loaded
+    ASSERT_EQ(ERROR_SUCCESS, actions[5].second);
+    actions[5].first.params.front().iPropVal->get_Type(&paramType);
+    EXPECT_EQ(PropertyType::PropertyType_String, paramType);
+}
+
+TEST(SerializeJSON, escapedStrings) {
+    std::wstring json {};
+    appendJsonString(std::wstring { L"a\"b\\c\nd\te\r\b\f" } + L'\0' + L"\x1f", json);
+
+    EXPECT_EQ(L"\"a\\\"b\\\\c\\nd\\te\\r\\b\\f\\u0000\\u001f\"", json);
+
+    // Serialized values are valid JSON holding the original string
+    ABI::Windows::Data::Json::IJsonValueStatics* jsonValueFactory = NULL;
+    HSTRING hJsonValueClass = NULL;
+    WindowsCreateString(
+        RuntimeClass_Windows_Data_Json_JsonValue,
+        static_cast<UINT32>(wcslen(RuntimeClass_Windows_Data_Json_JsonValue)),
+        &hJsonValueClass
+    );
+    GetActivationFactory(hJsonValueClass, &jsonValueFactory);
+
+    HSTRING hJson = NULL;
+    WindowsCreateString(json.c_str(), static_cast<UINT32>(json.size()), &hJson);
+
+    ABI::Windows::Data::Json::IJsonValue* jValue = NULL;
+    HSTRING hParsed = NULL;
+    ASSERT_EQ(S_OK, jsonValueFactory->Parse(hJson, &jValue));
+    ASSERT_EQ(S_OK, jValue->GetString(&hParsed));
+
+    UINT32 length { 0 };
+    LPCWSTR pParsed { WindowsGetStringRawBuffer(hParsed, &length) };
+    EXPECT_EQ(std::wstring { L"a\"b\\c\nd\te\r\b\f" } + L'\0' + L"\x1f", std::wstring(pParsed, length));
+
+    WindowsDeleteString(hParsed);
+    WindowsDeleteString(hJson);
+    WindowsDeleteString(hJsonValueClass);
+    jValue->Release();
+    jsonValueFactory->Release();
+}
+
+TEST(ParseInputOptions, switchesInAnyOrder) {
+    vector<wstring> args {
+        L"SettingsHelper.exe", L"-trace", L"trace.json", L"-file", L"payload.json", L"-record", L"session.jsonl",
+        L"-stats", L"stats.json", L"-quarantine", L"quarantine.txt", L"-workers", L"4",
+        L"-catalog", L"catalog.txt"
+    };
+    vector<wchar_t*> argv { buildArgv(args) };
+    pair<int, wchar_t**> input { static_cast<int>(argv.size()), argv.data() };
+    InputOptions options {};
+
+    EXPECT_EQ(ERROR_SUCCESS, getInputOptions(&input, options));
+    EXPECT_EQ(L"payload.json", options.filePath);
+    EXPECT_EQ(L"trace.json", options.tracePath);
+    EXPECT_EQ(L"session.jsonl", options.recordingPath);
+    EXPECT_EQ(L"stats.json", options.statsPath);
+    EXPECT_EQ(L"quarantine.txt", options.quarantinePath);
+    EXPECT_EQ(L"catalog.txt", options.catalogPath);
+    EXPECT_EQ(4, options.workersNum);
+    EXPECT_TRUE(options.workerId.empty());
+    EXPECT_EQ(0, options.deadlineMs);
+}
+
+TEST(ParseInputOptions, noSwitches) {
+    vector<wstring> args { L"SettingsHelper.exe" };
+    vector<wchar_t*> argv { buildArgv(args) };
+    pair<int, wchar_t**> input { static_cast<int>(argv.size()), argv.data() };
+    InputOptions options {};
+
+    EXPECT_EQ(ERROR_SUCCESS, getInputOptions(&input, options));
+    EXPECT_TRUE(options.filePath.empty());
+    EXPECT_TRUE(options.tracePath.empty());
+    EXPECT_TRUE(options.recordingPath.empty());
+    EXPECT_TRUE(options.statsPath.empty());
+    EXPECT_TRUE(options.quarantinePath.empty());
+    EXPECT_TRUE(options.catalogPath.empty());
+    EXPECT_EQ(0, options.workersNum);
+    EXPECT_TRUE(options.workerId.empty());
+}
+
+TEST(ParseInputOptions, invalidSwitches) {
+    vector<wstring> unknownArgs { L"SettingsHelper.exe", L"-payload", L"payload.json" };
+    vector<wstring> danglingArgs { L"SettingsHelper.exe", L"-file", L"payload.json", L"-trace" };
+    vector<wchar_t*> unknownArgv { buildArgv(unknownArgs) };
+    vector<wchar_t*> danglingArgv { buildArgv(danglingArgs) };
+    pair<int, wchar_t**> unknownInput { static_cast<int>(unknownArgv.size()), unknownArgv.data() };
+    pair<int, wchar_t**> danglingInput { static_cast<int>(danglingArgv.size()), danglingArgv.data() };
+    InputOptions options {};
+
+    EXPECT_EQ(E_INVALIDARG, getInputOptions(&unknownInput, options));
+    EXPECT_EQ(E_INVALIDARG, getInputOptions(&danglingInput, options));
+    EXPECT_TRUE(options.filePath.empty());
+}
+
+TEST(ParseInputOptions, workerSwitches) {
+    vector<wstring> workerArgs { L"SettingsHelper.exe", L"-worker", L"3" };
+    vector<wstring> tooManyArgs { L"SettingsHelper.exe", L"-workers", L"65" };
+    vector<wstring> invalidArgs { L"SettingsHelper.exe", L"-workers", L"-1" };
+    vector<wchar_t*> workerArgv { buildArgv(workerArgs) };
+    vector<wchar_t*> tooManyArgv { buildArgv(tooManyArgs) };
+    vector<wchar_t*> invalidArgv { buildArgv(invalidArgs) };
+    pair<int, wchar_t**> workerInput { static_cast<int>(workerArgv.size()), workerArgv.data() };
+    pair<int, wchar_t**> tooManyInput { static_cast<int>(tooManyArgv.size()), tooManyArgv.data() };
+    pair<int, wchar_t**> invalidInput { static_cast<int>(invalidArgv.size()), invalidArgv.data() };
+    InputOptions options {};
+
+    EXPECT_EQ(ERROR_SUCCESS, getInputOptions(&workerInput, options));
+    EXPECT_EQ(L"3", options.workerId);
+    EXPECT_EQ(0, options.workersNum);
+
+    EXPECT_EQ(E_INVALIDARG, getInputOptions(&tooManyInput, options));
+    EXPECT_EQ(E_INVALIDARG, getInputOptions(&invalidInput, options));
+}
+
+TEST(ParseInputOptions, deadlineSwitch) {
+    vector<wstring> deadlineArgs { L"SettingsHelper.exe", L"-deadline", L"1500" };
+    vector<wstring> tooLongArgs { L"SettingsHelper.exe", L"-deadline", L"600001" };
+    vector<wstring> invalidArgs { L"SettingsHelper.exe", L"-deadline", L"1.5" };
+    vector<wchar_t*> deadlineArgv { buildArgv(deadlineArgs) };
+    vector<wchar_t*> tooLongArgv { buildArgv(tooLongArgs) };
+    vector<wchar_t*> invalidArgv { buildArgv(invalidArgs) };
+    pair<int, wchar_t**> deadlineInput { static_cast<int>(deadlineArgv.size()), deadlineArgv.data() };
+    pair<int, wchar_t**> tooLongInput { static_cast<int>(tooLongArgv.size()), tooLongArgv.data() };
+    pair<int, wchar_t**> invalidInput { static_cast<int>(invalidArgv.size()), invalidArgv.data() };
+    InputOptions options {};
+
+    EXPECT_EQ(ERROR_SUCCESS, getInputOptions(&deadlineInput, options));
+    EXPECT_EQ(1500, options.deadlineMs);
+    // The switch takes precedence over the environment
+    addEnvironmentOptions(options);
+    EXPECT_EQ(1500, options.deadlineMs);
+
+    EXPECT_EQ(E_INVALIDARG, getInputOptions(&tooLongInput, options));
+    EXPECT_EQ(E_INVALIDARG, getInputOptions(&invalidInput, options));
+}
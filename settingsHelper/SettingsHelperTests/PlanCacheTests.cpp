@@ -0,0 +1,88 @@
+/**
+ * Tests for the cache of compiled plans.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <PlanCache.h>
+
+#include <memory>
+#include <string>
+
+using std::wstring;
+
+namespace {
+    struct FakePlan {
+        int id { 0 };
+    };
+
+    std::unique_ptr<FakePlan> fakePlan(int id) {
+        return std::unique_ptr<FakePlan> { new FakePlan { id } };
+    }
+}
+
+TEST(PlanCache, HashPayload) {
+    EXPECT_EQ(hashPayload(L""), 14695981039346656037ull);
+    EXPECT_EQ(hashPayload(L"[]"), hashPayload(wstring { L"[]" }));
+    EXPECT_NE(hashPayload(L"[{ \"a\": 1 }]"), hashPayload(L"[{ \"a\": 2 }]"));
+    // Characters are hashed whole, not only their low byte
+    EXPECT_NE(hashPayload(L"\u0141"), hashPayload(L"A"));
+}
+
+TEST(PlanCache, FindAndInsert) {
+    PlanCache<FakePlan> cache { 4 };
+    const wstring payload { L"[{ \"settingID\": \"A\", \"method\": \"GetValue\" }]" };
+
+    EXPECT_EQ(cache.find(payload), nullptr);
+
+    FakePlan* pInserted { cache.insert(payload, fakePlan(1)) };
+    ASSERT_NE(pInserted, nullptr);
+    EXPECT_EQ(pInserted->id, 1);
+
+    FakePlan* pFound { cache.find(payload) };
+    EXPECT_EQ(pFound, pInserted);
+    EXPECT_EQ(cache.find(payload + L" "), nullptr);
+
+    // Inserting the same payload again replaces its plan
+    cache.insert(payload, fakePlan(2));
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(cache.find(payload)->id, 2);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.find(payload), nullptr);
+}
+
+TEST(PlanCache, EvictsLeastRecentlyUsed) {
+    PlanCache<FakePlan> cache { 2 };
+
+    cache.insert(L"a", fakePlan(1));
+    cache.insert(L"b", fakePlan(2));
+    // Using 'a' makes 'b' the least recently used one
+    ASSERT_NE(cache.find(L"a"), nullptr);
+    cache.insert(L"c", fakePlan(3));
+
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache.find(L"b"), nullptr);
+    ASSERT_NE(cache.find(L"a"), nullptr);
+    ASSERT_NE(cache.find(L"c"), nullptr);
+    EXPECT_EQ(cache.find(L"a")->id, 1);
+    EXPECT_EQ(cache.find(L"c")->id, 3);
+}
+
+TEST(PlanCache, Disabled) {
+    PlanCache<FakePlan> cache { 0 };
+
+    EXPECT_EQ(cache.insert(L"a", fakePlan(1)), nullptr);
+    EXPECT_EQ(cache.find(L"a"), nullptr);
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.capacity(), 0);
+}
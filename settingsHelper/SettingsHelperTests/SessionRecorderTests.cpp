@@ -0,0 +1,172 @@
+/**
+ * Tests for the session recorder.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SessionRecorder.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    RecordedSession buildSession() {
+        RecordedSession session {};
+        session.startUs = 1500;
+        session.durationUs = 320000;
+        session.payload = L"[{ \"settingID\": \"SystemSettings_Accessibility_Magnifier_IsEnabled\", \"method\": \"GetValue\" }]";
+        session.output = L"[{\"settingID\": \"SystemSettings_Accessibility_Magnifier_IsEnabled\"}]\n";
+
+        RecordedCall getSetting {};
+        getSetting.op = "GetSetting";
+        getSetting.settingId = L"SystemSettings_Notifications_AppList";
+        getSetting.startUs = 10;
+        getSetting.durationUs = 2500;
+        getSetting.settingType = 8;
+
+        RecordedCall getValue {};
+        getValue.op = "GetValue";
+        getValue.settingId = L"SystemSettings_Notifications_AppList";
+        getValue.valueId = L"Value";
+        getValue.startUs = 2600;
+        getValue.durationUs = 700;
+        getValue.elements = { L"Microsoft.WindowsStore_8wekyb3d8bbwe", L"Caf\u00e9 \u00e4\u00f6 \u20ac" };
+
+        RecordedCall setValue {};
+        setValue.op = "SetValue";
+        setValue.settingId = L"SystemSettings_Accessibility_Magnifier_IsEnabled";
+        setValue.valueId = L"Value";
+        setValue.startUs = 3400;
+        setValue.durationUs = 90;
+        setValue.result = static_cast<std::int32_t>(0x80070005);
+        setValue.valueType = 6;
+        setValue.value = L"\"C:\\\\Windows\\t\"";
+
+        session.calls = { getSetting, getValue, setValue };
+
+        return session;
+    }
+
+    void expectEqualCalls(const RecordedCall& fst, const RecordedCall& snd) {
+        EXPECT_EQ(fst.op, snd.op);
+        EXPECT_EQ(fst.settingId, snd.settingId);
+        EXPECT_EQ(fst.valueId, snd.valueId);
+        EXPECT_EQ(fst.startUs, snd.startUs);
+        EXPECT_EQ(fst.durationUs, snd.durationUs);
+        EXPECT_EQ(fst.result, snd.result);
+        EXPECT_EQ(fst.settingType, snd.settingType);
+        EXPECT_EQ(fst.valueType, snd.valueType);
+        EXPECT_EQ(fst.value, snd.value);
+        EXPECT_EQ(fst.elements, snd.elements);
+    }
+}
+
+TEST(SessionRecorder, SerializationRoundTrip) {
+    const RecordedSession session { buildSession() };
+    const std::string json { sessionToJson(session) };
+
+    EXPECT_EQ(json.find('\n'), std::string::npos);
+
+    RecordedSession parsed {};
+    ASSERT_TRUE(parseRecordedSession(json, parsed));
+
+    EXPECT_EQ(parsed.startUs, session.startUs);
+    EXPECT_EQ(parsed.durationUs, session.durationUs);
+    EXPECT_EQ(parsed.payload, session.payload);
+    EXPECT_EQ(parsed.output, session.output);
+    ASSERT_EQ(parsed.calls.size(), session.calls.size());
+
+    for (std::size_t i = 0; i < session.calls.size(); i++) {
+        expectEqualCalls(parsed.calls[i], session.calls[i]);
+    }
+}
+
+TEST(SessionRecorder, ReadRecordedSessions) {
+    const std::string line { sessionToJson(buildSession()) };
+    std::istringstream recording { line + "\n\n" + line + "\r\n" };
+    vector<RecordedSession> sessions {};
+
+    ASSERT_TRUE(readRecordedSessions(recording, sessions));
+    EXPECT_EQ(sessions.size(), 2);
+
+    const vector<std::string> malformed {
+        "{\"version\":1}",
+        "{\"version\":2" + line.substr(line.find(',')),
+        line.substr(0, line.size() - 1),
+        line + "}",
+        "[]"
+    };
+
+    for (const auto& invalidLine : malformed) {
+        std::istringstream invalidRecording { line + "\n" + invalidLine + "\n" };
+        vector<RecordedSession> invalidSessions {};
+
+        EXPECT_FALSE(readRecordedSessions(invalidRecording, invalidSessions)) << invalidLine;
+        EXPECT_TRUE(invalidSessions.empty());
+    }
+}
+
+TEST(SessionRecorder, RecordScope) {
+    SessionRecorder& recorder { SessionRecorder::instance() };
+    const wstring settingId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    const wstring valueId { L"Value" };
+
+    recorder.disable();
+    recorder.begin(L"[]");
+    {
+        RecordScope scope { "GetValue", settingId, valueId };
+        EXPECT_FALSE(scope.isRecording());
+    }
+    EXPECT_TRUE(recorder.getSession().calls.empty());
+
+    recorder.enable();
+    recorder.begin(L"[{}]");
+    {
+        RecordScope scope { "GetValue", settingId, valueId };
+        ASSERT_TRUE(scope.isRecording());
+
+        scope.setResult(0);
+        scope.setValue(11, L"true");
+    }
+    {
+        RecordScope scope { "GetSetting", settingId, WStringView {} };
+        scope.setResult(static_cast<std::int32_t>(0x8007006E));
+    }
+    recorder.end(L"output");
+    recorder.disable();
+
+    const RecordedSession session { recorder.getSession() };
+    recorder.clear();
+
+    EXPECT_EQ(session.payload, L"[{}]");
+    EXPECT_EQ(session.output, L"output");
+    ASSERT_EQ(session.calls.size(), 2);
+
+    EXPECT_EQ(session.calls[0].op, "GetValue");
+    EXPECT_EQ(session.calls[0].settingId, settingId);
+    EXPECT_EQ(session.calls[0].valueId, valueId);
+    EXPECT_EQ(session.calls[0].valueType, 11);
+    EXPECT_EQ(session.calls[0].value, L"true");
+    EXPECT_EQ(session.calls[1].op, "GetSetting");
+    EXPECT_TRUE(session.calls[1].valueId.empty());
+    EXPECT_EQ(session.calls[1].result, static_cast<std::int32_t>(0x8007006E));
+    EXPECT_EQ(session.calls[1].valueType, -1);
+
+    for (const auto& call : session.calls) {
+        EXPECT_GE(call.startUs, 0);
+        EXPECT_GE(call.durationUs, 0);
+        EXPECT_LE(call.startUs + call.durationUs, session.durationUs);
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * Tests for the replay of recorded sessions.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <IPropertyValueUtils.h>
+#include <Payload.h>
+#include <PayloadProc.h>
+#include <SessionReplay.h>
+#include <SettingUtils.h>
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+namespace {
+    const wstring magnifierId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    const wstring appListId { L"SystemSettings_Notifications_AppList" };
+
+    ATL::CComPtr<IInspectable> createBoolValue(bool value) {
+        VARIANT variant {};
+        variant.vt = VARENUM::VT_BOOL;
+        variant.boolVal = value ? VARIANT_TRUE : VARIANT_FALSE;
+
+        ATL::CComPtr<IPropertyValue> propValue { NULL };
+        createPropertyValue(variant, propValue);
+
+        return ATL::CComPtr<IInspectable> { static_cast<IInspectable*>(propValue) };
+    }
+
+    RecordedCall buildCall(const char* op, const wstring& settingId, std::int64_t durationUs, HRESULT result) {
+        RecordedCall call {};
+        call.op = op;
+        call.settingId = settingId;
+        call.durationUs = durationUs;
+        call.result = result;
+
+        return call;
+    }
+}
+
+TEST(SessionReplay, RecordAndReplay) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    vector<wstring> elemIds {};
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+    backend.addSetting(createSimulatedCollection(appListId, 3, elemIds));
+
+    const wstring payload {
+        L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" },"
+        L" { \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] },"
+        L" { \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" },"
+        L" { \"settingID\": \"" + appListId + L".SystemSettings_Notifications_AppNotificationSoundToggle\", "
+        L"\"method\": \"GetValue\", \"parameters\": [ { \"elemId\": \"" + elemIds[2] + L"\" } ] }]"
+    };
+
+    SessionRecorder& recorder { SessionRecorder::instance() };
+    Batch batch {};
+
+    recorder.enable();
+    recorder.begin(payload);
+    {
+        BatchScope scope { batch.arena };
+
+        parsePayload(payload, batch.actions);
+        handleBatchActions(sAPI, batch);
+        recorder.end(buildOutputStr(batch.results));
+    }
+    recorder.disable();
+    batch.reset();
+
+    const RecordedSession session { recorder.getSession() };
+    recorder.clear();
+
+    ASSERT_FALSE(session.calls.empty());
+    EXPECT_EQ(session.calls.front().op, "GetSetting");
+    EXPECT_EQ(session.calls.front().settingId, magnifierId);
+    EXPECT_EQ(session.calls.front().settingType, static_cast<std::int32_t>(SettingType::Boolean));
+
+    // The replay starts from the values first read, so it reproduces the output
+    ReplayResult result {};
+    ASSERT_EQ(replaySession(session, 0, result), ERROR_SUCCESS);
+    EXPECT_TRUE(result.outputMatches);
+    EXPECT_EQ(result.output, session.output);
+
+    // Sessions survive their serialization
+    RecordedSession parsed {};
+    ASSERT_TRUE(parseRecordedSession(sessionToJson(session), parsed));
+    ASSERT_EQ(replaySession(parsed, 0, result), ERROR_SUCCESS);
+    EXPECT_TRUE(result.outputMatches);
+}
+
+TEST(SessionReplay, LatenciesAndFailures) {
+    RecordedSession session {};
+
+    RecordedCall loadMagnifier { buildCall("GetSetting", magnifierId, 3000, ERROR_SUCCESS) };
+    loadMagnifier.settingType = static_cast<std::int32_t>(SettingType::Boolean);
+    RecordedCall readMagnifier { buildCall("GetValue", magnifierId, 1000, ERROR_SUCCESS) };
+    readMagnifier.valueId = L"Value";
+    readMagnifier.valueType = static_cast<std::int32_t>(PropertyType::PropertyType_Boolean);
+    readMagnifier.value = L"true";
+    RecordedCall failedRead { buildCall("GetValue", magnifierId, 500, E_FAIL) };
+    failedRead.valueId = L"Value";
+
+    session.calls = {
+        loadMagnifier,
+        readMagnifier,
+        failedRead,
+        buildCall("GetSetting", appListId, 10, E_ACCESSDENIED)
+    };
+
+    SimulatedSettingsBackend backend {};
+    ASSERT_EQ(buildReplayBackend(session, 2.0, backend), ERROR_SUCCESS);
+
+    SimulatedSettingItem* pMagnifier { backend.findSetting(SettingAtom { magnifierId }) };
+    ASSERT_NE(pMagnifier, nullptr);
+    EXPECT_EQ(pMagnifier->getState().latencyOf(SimulatedOperation::GetSetting), 1500);
+    EXPECT_EQ(pMagnifier->getState().latencyOf(SimulatedOperation::GetValue), 375);
+
+    ATL::CComPtr<IPropertyValue> value {};
+    value.Attach(static_cast<IPropertyValue*>(pMagnifier->peekValue(L"Value").Detach()));
+    wstring valueStr {};
+    toString(value, valueStr);
+    EXPECT_EQ(valueStr, L"true");
+
+    // The failure is injected at the same call in which it was recorded
+    const SimulatedFailure& failure {
+        pMagnifier->getState().getBehavior().failures[static_cast<std::size_t>(SimulatedOperation::GetValue)]
+    };
+    EXPECT_EQ(failure.errorCode, E_FAIL);
+    EXPECT_EQ(failure.skipCalls, 1);
+
+    // Settings that never loaded keep failing with the recorded error
+    SettingAPI sAPI { backend };
+    SettingItem appList {};
+    backend.load();
+    EXPECT_EQ(sAPI.loadBaseSetting(appListId, appList), E_ACCESSDENIED);
+    EXPECT_EQ(sAPI.loadBaseSetting(appListId, appList), E_ACCESSDENIED);
+
+    SimulatedSettingsBackend fastBackend {};
+    ASSERT_EQ(buildReplayBackend(session, 0, fastBackend), ERROR_SUCCESS);
+    EXPECT_EQ(
+        fastBackend.findSetting(SettingAtom { magnifierId })->getState().latencyOf(SimulatedOperation::GetSetting), 0
+    );
+
+    SimulatedSettingsBackend invalidBackend {};
+    EXPECT_EQ(buildReplayBackend(session, -1.0, invalidBackend), E_INVALIDARG);
+}
@@ -0,0 +1,94 @@
+/**
+ * Tests for the interned setting identifiers.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include "ConcurrentRunner.h"
+
+#include <SettingAtom.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+TEST(SettingAtom, SameIdSameAtom) {
+    std::wstring settingId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    std::wstring payloadBuf { L"SystemSettings_Accessibility_Magnifier_IsEnabled.Value" };
+
+    SettingAtom fromStr { settingId };
+    SettingAtom fromView { WStringView { payloadBuf.data(), settingId.size() } };
+
+    EXPECT_EQ(fromStr, fromView);
+    EXPECT_EQ(fromStr.id(), fromView.id());
+    EXPECT_EQ(fromStr.str(), settingId);
+    EXPECT_EQ(&fromStr.str(), &fromView.str());
+}
+
+TEST(SettingAtom, DifferentIdsDifferentAtoms) {
+    SettingAtom magnifier { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    SettingAtom blueLight { L"SystemSettings_Display_BlueLight_ManualToggleQuickAction" };
+
+    EXPECT_NE(magnifier, blueLight);
+    EXPECT_NE(magnifier.id(), blueLight.id());
+}
+
+TEST(SettingAtom, EmptyAtom) {
+    SettingAtom empty {};
+
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.id(), 0);
+    EXPECT_EQ(empty.str(), std::wstring {});
+    EXPECT_EQ(empty, SettingAtom { L"" });
+}
+
+TEST(SettingAtom, LookupDoesntIntern) {
+    const std::size_t size { SettingAtomTable::instance().size() };
+
+    SettingAtom unknown { SettingAtom::lookup(WStringView { L"SettingAtom_LookupDoesntIntern" }) };
+
+    EXPECT_TRUE(unknown.empty());
+    EXPECT_EQ(SettingAtomTable::instance().size(), size);
+
+    SettingAtom known { L"SettingAtom_LookupDoesntIntern" };
+    EXPECT_EQ(SettingAtom::lookup(WStringView { L"SettingAtom_LookupDoesntIntern" }), known);
+}
+
+TEST(SettingAtom, UsableAsKey) {
+    std::unordered_map<SettingAtom, int> values {};
+
+    values[SettingAtom { L"SystemSettings_Taskbar_Location" }] = 1;
+    values[SettingAtom { L"SystemSettings_Notifications_AppList" }] = 2;
+
+    EXPECT_EQ(values[SettingAtom { L"SystemSettings_Taskbar_Location" }], 1);
+    EXPECT_EQ(values.size(), 2);
+}
+
+TEST(SettingAtom, ConcurrentInterning) {
+    const int threadsNum { 8 };
+    const int idsNum { 500 };
+    std::vector<std::vector<SettingAtom>> atoms(threadsNum);
+    std::vector<std::function<void()>> tasks {};
+
+    for (int t = 0; t < threadsNum; t++) {
+        tasks.push_back([&atoms, t, idsNum]() {
+            for (int i = 0; i < idsNum; i++) {
+                atoms[t].push_back(SettingAtom { L"SettingAtom_Concurrent_" + std::to_wstring(i) });
+            }
+        });
+    }
+
+    runConcurrently(tasks);
+
+    for (int t = 1; t < threadsNum; t++) {
+        EXPECT_EQ(atoms[t], atoms[0]);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * Tests for the metadata fields requested along with the setting values.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SettingFields.h>
+
+#include <cstdint>
+
+TEST(SettingFields, TableCoversEveryField) {
+    std::uint32_t fields { 0 };
+
+    for (std::size_t i = 0; i < settingFieldsNum; i++) {
+        const SettingFieldInfo& info { settingFieldsTable()[i] };
+
+        // Fields are reported in the order of their values
+        EXPECT_EQ(static_cast<std::uint32_t>(info.field), 1u << i);
+        EXPECT_TRUE(parseSettingField(WStringView { info.name }, fields));
+    }
+
+    EXPECT_EQ(fields, allSettingFields);
+}
+
+TEST(SettingFields, ParseNames) {
+    std::uint32_t fields { 0 };
+
+    EXPECT_TRUE(parseSettingField(L"isSetByGroupPolicy", fields));
+    EXPECT_TRUE(parseSettingField(L"isSetByGroupPolicy", fields));
+    EXPECT_EQ(fields, static_cast<std::uint32_t>(SettingField::IsSetByGroupPolicy));
+
+    EXPECT_FALSE(parseSettingField(L"IsSetByGroupPolicy", fields));
+    EXPECT_FALSE(parseSettingField(L"value", fields));
+    EXPECT_FALSE(parseSettingField(L"", fields));
+    EXPECT_EQ(fields, static_cast<std::uint32_t>(SettingField::IsSetByGroupPolicy));
+
+    EXPECT_TRUE(hasSettingField(fields, SettingField::IsSetByGroupPolicy));
+    EXPECT_FALSE(hasSettingField(fields, SettingField::Type));
+}
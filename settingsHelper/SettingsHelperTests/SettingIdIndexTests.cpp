@@ -0,0 +1,138 @@
+/**
+ * Tests for the radix index expanding the setting selectors.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SettingIdIndex.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+namespace {
+    const vector<wstring> indexedIds {
+        L"SystemSettings_Accessibility_Magnifier_IsEnabled",
+        L"SystemSettings_Accessibility_Magnifier_ZoomLevel",
+        L"SystemSettings_Accessibility_HighContrast_IsEnabled",
+        L"SystemSettings_Accessibility_Narrator_IsEnabled",
+        L"SystemSettings_Display_Scale",
+        L"SystemSettings_Display",
+        L"SystemSettings_Notifications_DoNotDisturb_Toggle",
+        L"Volume"
+    };
+
+    void fillIndex(SettingIdIndex& index) {
+        for (const auto& id : indexedIds) {
+            index.add(WStringView { id });
+        }
+    }
+
+    vector<wstring> expand(const SettingIdIndex& index, const wchar_t* selector) {
+        vector<wstring> ids {};
+        index.expand(WStringView { selector }, ids);
+
+        return ids;
+    }
+}
+
+TEST(SettingIdIndex, Selectors) {
+    EXPECT_TRUE(isSettingSelector(L"SystemSettings_Accessibility_*"));
+    EXPECT_TRUE(isSettingSelector(L"SystemSettings_Display_Scal?"));
+    EXPECT_FALSE(isSettingSelector(L"SystemSettings_Display_Scale"));
+    EXPECT_FALSE(isSettingSelector(L""));
+
+    EXPECT_TRUE(matchesSelector(L"*", L"Volume"));
+    EXPECT_TRUE(matchesSelector(L"*", L""));
+    EXPECT_TRUE(matchesSelector(L"Vol*", L"Vol"));
+    EXPECT_TRUE(matchesSelector(L"V?lume", L"Volume"));
+    EXPECT_TRUE(matchesSelector(L"*_IsEnabled", L"SystemSettings_Accessibility_Magnifier_IsEnabled"));
+    EXPECT_TRUE(matchesSelector(L"*Magnifier*Enabled", L"SystemSettings_Accessibility_Magnifier_IsEnabled"));
+    EXPECT_TRUE(matchesSelector(L"a*b*c", L"aXbYbZc"));
+
+    EXPECT_FALSE(matchesSelector(L"Volume", L"Volume_"));
+    EXPECT_FALSE(matchesSelector(L"V?lume", L"Vlume"));
+    EXPECT_FALSE(matchesSelector(L"*_IsEnabled", L"SystemSettings_Display_Scale"));
+    EXPECT_FALSE(matchesSelector(L"a*b*c", L"aXbYcZ"));
+}
+
+TEST(SettingIdIndex, AddIds) {
+    SettingIdIndex index {};
+    EXPECT_EQ(index.size(), 0u);
+
+    fillIndex(index);
+    EXPECT_EQ(index.size(), indexedIds.size());
+
+    // Repeated and empty ids aren't added
+    index.add(L"SystemSettings_Display");
+    index.add(L"");
+    EXPECT_EQ(index.size(), indexedIds.size());
+
+    vector<wstring> ids {};
+    index.findPrefix(L"", ids);
+    vector<wstring> sortedIds { indexedIds };
+    std::sort(sortedIds.begin(), sortedIds.end());
+    EXPECT_EQ(ids, sortedIds);
+
+    index.clear();
+    ids.clear();
+    index.findPrefix(L"", ids);
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST(SettingIdIndex, FindPrefix) {
+    SettingIdIndex index {};
+    fillIndex(index);
+
+    vector<wstring> ids {};
+    index.findPrefix(L"SystemSettings_Display", ids);
+    EXPECT_EQ(ids, (vector<wstring> { L"SystemSettings_Display", L"SystemSettings_Display_Scale" }));
+
+    // Prefixes ending inside an edge
+    ids.clear();
+    index.findPrefix(L"SystemSettings_Accessibility_Mag", ids);
+    EXPECT_EQ(ids, (vector<wstring> {
+        L"SystemSettings_Accessibility_Magnifier_IsEnabled",
+        L"SystemSettings_Accessibility_Magnifier_ZoomLevel"
+    }));
+
+    ids.clear();
+    index.findPrefix(L"SystemSettings_Displax", ids);
+    index.findPrefix(L"SystemSettings_Display_Scale_", ids);
+    index.findPrefix(L"Unknown", ids);
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST(SettingIdIndex, Expand) {
+    SettingIdIndex index {};
+    fillIndex(index);
+
+    EXPECT_EQ(expand(index, L"SystemSettings_Accessibility_*"), (vector<wstring> {
+        L"SystemSettings_Accessibility_HighContrast_IsEnabled",
+        L"SystemSettings_Accessibility_Magnifier_IsEnabled",
+        L"SystemSettings_Accessibility_Magnifier_ZoomLevel",
+        L"SystemSettings_Accessibility_Narrator_IsEnabled"
+    }));
+    EXPECT_EQ(expand(index, L"*_IsEnabled").size(), 3u);
+    EXPECT_EQ(expand(index, L"SystemSettings_*_Toggle"), (vector<wstring> {
+        L"SystemSettings_Notifications_DoNotDisturb_Toggle"
+    }));
+    EXPECT_EQ(expand(index, L"V?lume"), (vector<wstring> { L"Volume" }));
+    EXPECT_EQ(expand(index, L"*").size(), indexedIds.size());
+
+    // Ids without wildcards only select themselves
+    EXPECT_EQ(expand(index, L"SystemSettings_Display"), (vector<wstring> { L"SystemSettings_Display" }));
+    EXPECT_TRUE(expand(index, L"SystemSettings_Sound_*").empty());
+}
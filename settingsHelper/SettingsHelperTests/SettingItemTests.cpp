@@ -601,7 +601,8 @@ TEST(GetSettingValue, GetNotificationMaxCollectionItems) {
 ///  NOTE: This test should remain commented, as it's only used for development purposes.
 ///
 ///  This test is used for trying to load all the possible settings present in the system,
-///  in order to find which are faulty, or which libraries should not be used.
+///  in order to find which are faulty, or which libraries should not be used. The
+///  SettingsCatalog tool does the same in worker processes, surviving faulty libraries.
 /// </summary>
 TEST(GetAllSettingsValues, GetAllPossibleSettings) {
     CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
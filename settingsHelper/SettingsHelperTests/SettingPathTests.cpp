@@ -0,0 +1,143 @@
+/**
+ * Tests for the setting path tokenizer.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <SettingPathTokenizer.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+/// <summary>
+///  Straightforward reference implementation of the path splitting, a delimiter
+///  splits the path if the number of escape characters preceding it is even.
+/// </summary>
+vector<wstring> referenceSplit(const wstring& path, wchar_t delim, wchar_t esc) {
+    vector<wstring> segments {};
+    wstring current {};
+
+    for (size_t i = 0; i < path.size(); i++) {
+        if (path[i] == delim) {
+            size_t escCount { 0 };
+            while (escCount < i && path[i - escCount - 1] == esc) {
+                escCount++;
+            }
+
+            if (escCount % 2 == 0) {
+                segments.push_back(current);
+                current.clear();
+                continue;
+            }
+        }
+
+        current.push_back(path[i]);
+    }
+
+    segments.push_back(current);
+
+    return segments;
+}
+
+vector<WStringView> tokenize(const wstring& path) {
+    vector<WStringView> segments {};
+    SettingPathTokenizer tokenizer { path };
+    WStringView segment {};
+
+    while (tokenizer.next(segment)) {
+        segments.push_back(segment);
+    }
+
+    return segments;
+}
+
+TEST(SettingPathTokenizer, SplitsEscapedPath) {
+    wstring settingId {
+        L".SystemSettings_Notifications_AppList.Microsoft\\.Windows\\.Cortana_cw5n1h2txyewy9."
+    };
+
+    vector<WStringView> segments { tokenize(settingId) };
+
+    ASSERT_EQ(segments.size(), 4);
+    EXPECT_TRUE(segments[0].empty());
+    EXPECT_TRUE(segments[1] == L"SystemSettings_Notifications_AppList");
+    EXPECT_TRUE(segments[2] == L"Microsoft\\.Windows\\.Cortana_cw5n1h2txyewy9");
+    EXPECT_TRUE(segments[3].empty());
+}
+
+TEST(SettingPathTokenizer, LeadingDelimiterWithoutEscapes) {
+    wstring settingId { L".SystemSettings_Notifications_AppList" };
+
+    vector<WStringView> segments { tokenize(settingId) };
+
+    ASSERT_EQ(segments.size(), 2);
+    EXPECT_TRUE(segments[0].empty());
+    EXPECT_TRUE(segments[1] == L"SystemSettings_Notifications_AppList");
+}
+
+TEST(SettingPathTokenizer, EscapedEscapeCharacter) {
+    wstring settingId { L"A\\\\.B" };
+
+    vector<WStringView> segments { tokenize(settingId) };
+
+    ASSERT_EQ(segments.size(), 2);
+    EXPECT_TRUE(segments[0] == L"A\\\\");
+    EXPECT_TRUE(segments[1] == L"B");
+}
+
+TEST(SettingPathTokenizer, FixedCapacitySegments) {
+    SettingPathSegments<2> segments {};
+
+    EXPECT_TRUE(tokenizeSettingPath(WStringView { L"Base.Inner" }, segments));
+    ASSERT_EQ(segments.size(), 2);
+    EXPECT_TRUE(segments[0] == L"Base");
+    EXPECT_TRUE(segments[1] == L"Inner");
+
+    EXPECT_FALSE(tokenizeSettingPath(WStringView { L"Base.Inner.Other" }, segments));
+    EXPECT_FALSE(tokenizeSettingPath(WStringView { L"Base." }, segments));
+    EXPECT_FALSE(tokenizeSettingPath(WStringView { L"" }, segments));
+}
+
+/// <summary>
+///  Compares the tokenizer against the reference implementation using random
+///  paths built from the characters that are meaningful for the tokenizer.
+/// </summary>
+TEST(SettingPathTokenizer, FuzzEquivalence) {
+    const wchar_t alphabet[] { L'a', L'B', L'.', L'\\' };
+    std::mt19937 rng { 0x5E77 };
+    std::uniform_int_distribution<size_t> lengthDist { 0, 24 };
+    std::uniform_int_distribution<size_t> charDist { 0, 3 };
+
+    for (int it = 0; it < 20000; it++) {
+        wstring path {};
+        size_t length { lengthDist(rng) };
+
+        for (size_t i = 0; i < length; i++) {
+            path.push_back(alphabet[charDist(rng)]);
+        }
+
+        vector<wstring> expected { referenceSplit(path, L'.', L'\\') };
+        vector<WStringView> segments { tokenize(path) };
+
+        ASSERT_EQ(segments.size(), expected.size()) << "Path: '" << std::string(path.begin(), path.end()) << "'";
+
+        for (size_t i = 0; i < segments.size(); i++) {
+            ASSERT_TRUE(segments[i] == expected[i]) << "Path: '" << std::string(path.begin(), path.end()) << "'";
+
+            // Segments must point into the tokenized path
+            ASSERT_TRUE(segments[i].begin() >= path.data());
+            ASSERT_TRUE(segments[i].end() <= path.data() + path.size());
+        }
+    }
+}
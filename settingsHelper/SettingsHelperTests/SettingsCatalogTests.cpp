@@ -0,0 +1,239 @@
+/**
+ * Tests for the catalog of settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SettingsCatalog.h>
+#include <WorkerProcess.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+TEST(SettingsCatalog, LineRoundTrip) {
+    CatalogEntry entry {};
+    entry.settingId = L"SystemSettings_Accessibility_Magnifier_IsEnabled";
+    entry.dll = L"C:\\Windows\\System32\\SettingsHandlers_Accessibility.dll";
+    entry.settingType = 1;
+    entry.valueType = 11;
+    entry.loadUs = 1520;
+    entry.updatePolls = 3;
+
+    string line {};
+    ASSERT_TRUE(formatCatalogLine(entry, line));
+
+    CatalogEntry parsed {};
+    ASSERT_TRUE(parseCatalogLine(line, parsed));
+    EXPECT_EQ(parsed.settingId, entry.settingId);
+    EXPECT_EQ(parsed.dll, entry.dll);
+    EXPECT_EQ(parsed.settingType, 1);
+    EXPECT_EQ(parsed.valueType, 11);
+    EXPECT_EQ(parsed.loadUs, 1520);
+    EXPECT_EQ(parsed.updatePolls, 3);
+    EXPECT_EQ(parsed.status, CatalogStatus::Ok);
+
+    CatalogEntry failed {};
+    failed.settingId = L"SystemSettings_Broken";
+    failed.status = CatalogStatus::Failed;
+    failed.errorCode = 0x80070005;
+
+    ASSERT_TRUE(formatCatalogLine(failed, line));
+    EXPECT_EQ(line, "SystemSettings_Broken\t\t-1\t-1\t0\t0\tfailed\t0x80070005");
+    ASSERT_TRUE(parseCatalogLine(line, parsed));
+    EXPECT_EQ(parsed.status, CatalogStatus::Failed);
+    EXPECT_EQ(parsed.errorCode, 0x80070005);
+    EXPECT_EQ(parsed.settingType, -1);
+
+    // Ids that can't be written as a field are left out
+    CatalogEntry unwritable {};
+    unwritable.settingId = L"caf\u00e9";
+    EXPECT_FALSE(formatCatalogLine(unwritable, line));
+}
+
+TEST(SettingsCatalog, MalformedLines) {
+    CatalogEntry entry {};
+
+    EXPECT_FALSE(parseCatalogLine("", entry));
+    EXPECT_FALSE(parseCatalogLine("id\tdll\t1\t2\t3\t4\tok", entry));
+    EXPECT_FALSE(parseCatalogLine("\tdll\t1\t2\t3\t4\tok\t0x00000000", entry));
+    EXPECT_FALSE(parseCatalogLine("id\tdll\tone\t2\t3\t4\tok\t0x00000000", entry));
+    EXPECT_FALSE(parseCatalogLine("id\tdll\t1\t2\t-3\t4\tok\t0x00000000", entry));
+    EXPECT_FALSE(parseCatalogLine("id\tdll\t1\t2\t3\t4\tbroken\t0x00000000", entry));
+    EXPECT_FALSE(parseCatalogLine("id\tdll\t1\t2\t3\t4\tok\t00000000", entry));
+    EXPECT_FALSE(parseCatalogLine("id\tdll\t1\t2\t3\t4\tok\t0x100000000", entry));
+    EXPECT_TRUE(parseCatalogLine("id\tdll\t1\t2\t3\t4\ttimedOut\t0x00000000", entry));
+    EXPECT_EQ(entry.status, CatalogStatus::TimedOut);
+}
+
+TEST(SettingsCatalog, ReadWrite) {
+    SettingsCatalog catalog { L"10.0.17763" };
+
+    CatalogEntry slow {};
+    slow.settingId = L"SystemSettings_Slow";
+    slow.updatePolls = 20;
+    CatalogEntry crashed {};
+    crashed.settingId = L"SystemSettings_Crashing";
+    crashed.status = CatalogStatus::Crashed;
+
+    catalog.add(slow);
+    catalog.add(crashed);
+
+    std::stringstream stream {};
+    ASSERT_TRUE(catalog.write(stream));
+
+    const string written { stream.str() };
+    // Entries are sorted by id after the header and the build line
+    EXPECT_EQ(written.find("build\t10.0.17763\n"), written.find('\n') + 1);
+    EXPECT_LT(written.find("SystemSettings_Crashing"), written.find("SystemSettings_Slow"));
+
+    // Malformed entries don't invalidate the rest of the file
+    stream.clear();
+    stream.seekp(0, std::ios::end);
+    stream << "garbage\r\n";
+
+    SettingsCatalog loaded {};
+    ASSERT_TRUE(loaded.read(stream));
+    EXPECT_EQ(loaded.getOsBuild(), L"10.0.17763");
+    EXPECT_EQ(loaded.size(), 2);
+
+    const CatalogEntry* pSlow { loaded.find(L"SystemSettings_Slow") };
+    ASSERT_NE(pSlow, nullptr);
+    EXPECT_EQ(pSlow->updatePolls, 20);
+    const CatalogEntry* pCrashed { loaded.find(L"SystemSettings_Crashing") };
+    ASSERT_NE(pCrashed, nullptr);
+    EXPECT_EQ(pCrashed->status, CatalogStatus::Crashed);
+    EXPECT_EQ(loaded.find(L"SystemSettings_Unknown"), nullptr);
+
+    // Files without the build line are rejected
+    std::stringstream noBuild { "# comment\nSystemSettings_Slow\t\t-1\t-1\t0\t0\tok\t0x00000000\n" };
+    EXPECT_FALSE(loaded.read(noBuild));
+
+    // Catalogs without build can't be written
+    std::stringstream out {};
+    EXPECT_FALSE(SettingsCatalog {}.write(out));
+}
+
+TEST(SettingsCatalog, LoadWaitPolls) {
+    CatalogEntry entry {};
+
+    EXPECT_EQ(SettingsCatalog::loadWaitPolls(nullptr), 10);
+    EXPECT_EQ(SettingsCatalog::loadWaitPolls(&entry), 10);
+
+    entry.updatePolls = 8;
+    EXPECT_EQ(SettingsCatalog::loadWaitPolls(&entry), 16);
+
+    entry.updatePolls = 1000;
+    EXPECT_EQ(SettingsCatalog::loadWaitPolls(&entry), 100);
+}
+
+TEST(SettingsCatalog, SplitPayload) {
+    const vector<wstring> ids { splitCatalogPayload(L"first\nsecond\n\nthird") };
+
+    ASSERT_EQ(ids.size(), 3);
+    EXPECT_EQ(ids[0], L"first");
+    EXPECT_EQ(ids[1], L"second");
+    EXPECT_EQ(ids[2], L"third");
+    EXPECT_TRUE(splitCatalogPayload(L"").empty());
+}
+
+#ifndef _WIN32
+
+namespace {
+    /// <summary>
+    ///  Fake probe whose setting ids tell how they behave: the ones starting
+    ///  with 'crash' abort the worker, the ones starting with 'hang' never
+    ///  answer and the ones starting with 'slow' take 300ms to load.
+    /// </summary>
+    class FakeProbeSession : public WorkerSession {
+    private:
+        vector<wstring> settingIds {};
+
+    public:
+        void loadPayload(const wstring& payload) override {
+            settingIds = splitCatalogPayload(payload);
+        }
+
+        wstring runAction(std::uint32_t index) override {
+            const wstring settingId { settingIds.at(index) };
+
+            if (settingId.compare(0, 5, L"crash") == 0) {
+                std::abort();
+            } else if (settingId.compare(0, 4, L"hang") == 0) {
+                volatile bool hanging { true };
+                while (hanging) {}
+            } else if (settingId.compare(0, 4, L"slow") == 0) {
+                const auto start = std::chrono::steady_clock::now();
+                while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds { 300 }) {}
+            }
+
+            CatalogEntry entry {};
+            entry.settingId = settingId;
+            entry.settingType = 1;
+            entry.updatePolls = static_cast<std::uint32_t>(index);
+
+            string line {};
+            formatCatalogLine(entry, line);
+
+            return wstring { line.begin(), line.end() };
+        }
+    };
+
+    std::unique_ptr<WorkerChannel> forkFakeProbe() {
+        return forkWorkerProcess([](WorkerChannel& supervisor) {
+            FakeProbeSession session {};
+            return runWorker(supervisor, session);
+        });
+    }
+}
+
+TEST(SettingsCatalog, BuildCatalogInWorkers) {
+    WorkerPool pool { forkFakeProbe, 3, 1000 };
+    ASSERT_EQ(pool.start(), 3);
+
+    const vector<wstring> settingIds {
+        L"slow_0", L"slow_1", L"crash_2", L"slow_3", L"hang_4", L"slow_5", L"ok_6"
+    };
+    SettingsCatalog catalog { L"10.0.17763" };
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(buildCatalog(pool, settingIds, catalog), settingIds.size());
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // The slow settings are probed at once, instead of one after the other
+    EXPECT_LT(elapsed, std::chrono::milliseconds { 4 * 300 + 1000 });
+
+    for (const auto& settingId : settingIds) {
+        const CatalogEntry* pEntry { catalog.find(settingId) };
+        ASSERT_NE(pEntry, nullptr);
+
+        if (settingId.compare(0, 5, L"crash") == 0) {
+            EXPECT_EQ(pEntry->status, CatalogStatus::Crashed);
+            EXPECT_EQ(pEntry->settingType, -1);
+        } else if (settingId.compare(0, 4, L"hang") == 0) {
+            EXPECT_EQ(pEntry->status, CatalogStatus::TimedOut);
+        } else {
+            EXPECT_EQ(pEntry->status, CatalogStatus::Ok);
+            EXPECT_EQ(pEntry->settingType, 1);
+        }
+    }
+
+    EXPECT_EQ(catalog.find(L"slow_5")->updatePolls, 5);
+    EXPECT_EQ(pool.getRestarts(), 2);
+}
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * Tests for the learned quarantine of settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SettingsQuarantine.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::wstring;
+
+namespace {
+    const wstring magnifierId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    const wstring appListId { L"SystemSettings_Notifications_AppList" };
+    const std::int64_t ttlSec { 3600 };
+}
+
+TEST(SettingsQuarantine, ExpiresAndDoubles) {
+    SettingsQuarantine quarantine { L"17763.1", ttlSec };
+
+    EXPECT_FALSE(quarantine.isQuarantined(WStringView { magnifierId }, 0));
+    EXPECT_FALSE(quarantine.isModified());
+
+    quarantine.add(WStringView { magnifierId }, QuarantineReason::Timeout, 1000);
+    EXPECT_TRUE(quarantine.isModified());
+    EXPECT_TRUE(quarantine.isQuarantined(WStringView { magnifierId }, 1000));
+    EXPECT_TRUE(quarantine.isQuarantined(WStringView { magnifierId }, 1000 + ttlSec - 1));
+    EXPECT_FALSE(quarantine.isQuarantined(WStringView { appListId }, 1000));
+
+    // Once expired the setting can be probed again
+    const std::int64_t reprobeSec { 1000 + ttlSec };
+    EXPECT_FALSE(quarantine.isQuarantined(WStringView { magnifierId }, reprobeSec));
+    ASSERT_NE(quarantine.find(WStringView { magnifierId }), nullptr);
+
+    // Failing again doubles the quarantine, up to a limit
+    quarantine.add(WStringView { magnifierId }, QuarantineReason::Crash, reprobeSec);
+    const QuarantineEntry* pEntry { quarantine.find(WStringView { magnifierId }) };
+    ASSERT_NE(pEntry, nullptr);
+    EXPECT_EQ(pEntry->failures, 2);
+    EXPECT_EQ(pEntry->reason, QuarantineReason::Crash);
+    EXPECT_EQ(quarantine.expiresAt(*pEntry), reprobeSec + 2 * ttlSec);
+
+    for (int i = 0; i < 10; i++) {
+        quarantine.add(WStringView { magnifierId }, QuarantineReason::Crash, reprobeSec);
+    }
+    EXPECT_EQ(
+        quarantine.expiresAt(*quarantine.find(WStringView { magnifierId })),
+        reprobeSec + (ttlSec << SettingsQuarantine::maxTtlDoublings)
+    );
+
+    // A successful probe releases it
+    quarantine.release(WStringView { magnifierId });
+    EXPECT_EQ(quarantine.find(WStringView { magnifierId }), nullptr);
+    EXPECT_EQ(quarantine.size(), 0);
+}
+
+TEST(SettingsQuarantine, PersistsPerBuild) {
+    SettingsQuarantine oldBuild { L"17134.5", ttlSec };
+    oldBuild.add(WStringView { appListId }, QuarantineReason::NotImplemented, 500);
+
+    std::stringstream oldFile {};
+    ASSERT_TRUE(oldBuild.write(oldFile));
+    EXPECT_FALSE(oldBuild.isModified());
+
+    // Entries of other builds don't apply, but they are kept
+    SettingsQuarantine quarantine { L"17763.1", ttlSec };
+    quarantine.read(oldFile);
+    EXPECT_EQ(quarantine.size(), 0);
+    EXPECT_FALSE(quarantine.isQuarantined(WStringView { appListId }, 500));
+
+    quarantine.add(WStringView { magnifierId }, QuarantineReason::Timeout, 1000);
+
+    std::stringstream file {};
+    ASSERT_TRUE(quarantine.write(file));
+
+    SettingsQuarantine reread { L"17763.1", ttlSec };
+    reread.read(file);
+    ASSERT_EQ(reread.size(), 1);
+    const QuarantineEntry* pEntry { reread.find(WStringView { magnifierId }) };
+    ASSERT_NE(pEntry, nullptr);
+    EXPECT_EQ(pEntry->reason, QuarantineReason::Timeout);
+    EXPECT_EQ(pEntry->sinceSec, 1000);
+    EXPECT_EQ(pEntry->failures, 1);
+
+    file.clear();
+    file.seekg(0);
+    SettingsQuarantine oldReread { L"17134.5", ttlSec };
+    oldReread.read(file);
+    EXPECT_TRUE(oldReread.isQuarantined(WStringView { appListId }, 500));
+    EXPECT_EQ(oldReread.size(), 1);
+}
+
+TEST(SettingsQuarantine, IgnoresMalformedLines) {
+    std::istringstream file {
+        "# comment\r\n"
+        "17763.1\tSystemSettings_Accessibility_Magnifier_IsEnabled\tcrash\t10\t1\r\n"
+        "17763.1\tSystemSettings_Notifications_AppList\tunknown\t10\t1\n"
+        "17763.1\tSystemSettings_Notifications_AppList\tcrash\t-10\t1\n"
+        "17763.1\tSystemSettings_Notifications_AppList\tcrash\t10\t0\n"
+        "17763.1\tSystemSettings_Notifications_AppList\tcrash\t10\n"
+        "17763.1\t\tcrash\t10\t1\n"
+        "garbage\n"
+    };
+
+    SettingsQuarantine quarantine { L"17763.1", ttlSec };
+    quarantine.read(file);
+
+    EXPECT_EQ(quarantine.size(), 1);
+    EXPECT_TRUE(quarantine.isQuarantined(WStringView { magnifierId }, 10));
+
+    // Builds that can't be written aren't persisted
+    SettingsQuarantine unknownBuild { L"", ttlSec };
+    std::ostringstream out {};
+    EXPECT_FALSE(unknownBuild.write(out));
+}
+
+TEST(SettingsQuarantine, RecoversCrashedProbes) {
+    SettingsQuarantine quarantine { L"17763.1", ttlSec };
+    std::vector<wstring> probes {};
+
+    quarantine.setProbeListener([&probes](const wstring& settingId) { probes.push_back(settingId); });
+    quarantine.beginProbe(magnifierId);
+    quarantine.endProbe();
+
+    ASSERT_EQ(probes.size(), 2);
+    EXPECT_EQ(probes[0], magnifierId);
+    EXPECT_TRUE(probes[1].empty());
+
+    std::stringstream marker {};
+    quarantine.writeProbe(marker, appListId);
+
+    // The marker was left behind by a crashed run of the same build
+    SettingsQuarantine nextRun { L"17763.1", ttlSec };
+    EXPECT_TRUE(nextRun.recoverProbe(marker, 2000));
+    const QuarantineEntry* pEntry { nextRun.find(WStringView { appListId }) };
+    ASSERT_NE(pEntry, nullptr);
+    EXPECT_EQ(pEntry->reason, QuarantineReason::Crash);
+    EXPECT_EQ(pEntry->sinceSec, 2000);
+
+    // Markers of other builds, or empty ones, are ignored
+    std::stringstream otherMarker {};
+    quarantine.writeProbe(otherMarker, appListId);
+    SettingsQuarantine otherBuild { L"18362.2", ttlSec };
+    EXPECT_FALSE(otherBuild.recoverProbe(otherMarker, 2000));
+
+    std::istringstream emptyMarker {};
+    EXPECT_FALSE(otherBuild.recoverProbe(emptyMarker, 2000));
+    EXPECT_EQ(otherBuild.size(), 0);
+}
+
+TEST(SettingsQuarantine, ReplaysChanges) {
+    SettingsQuarantine worker { L"17763.1", ttlSec };
+    SettingsQuarantine supervisor { L"17763.1", ttlSec };
+    std::vector<std::string> changes {};
+
+    worker.setChangeListener([&changes](const std::string& change) { changes.push_back(change); });
+    worker.add(WStringView { magnifierId }, QuarantineReason::NotImplemented, 1000);
+    worker.add(WStringView { appListId }, QuarantineReason::Timeout, 1000);
+    worker.release(WStringView { appListId });
+    // Releasing a setting that isn't quarantined changes nothing
+    worker.release(WStringView { appListId });
+
+    ASSERT_EQ(changes.size(), 3);
+
+    for (const auto& change : changes) {
+        EXPECT_TRUE(supervisor.applyChange(change, 2000));
+    }
+
+    // The supervisor ends up holding the same entries
+    ASSERT_EQ(supervisor.size(), 1);
+    const QuarantineEntry* pEntry { supervisor.find(WStringView { magnifierId }) };
+    ASSERT_NE(pEntry, nullptr);
+    EXPECT_EQ(pEntry->reason, QuarantineReason::NotImplemented);
+    EXPECT_EQ(pEntry->sinceSec, 2000);
+    EXPECT_TRUE(supervisor.isModified());
+
+    EXPECT_FALSE(supervisor.applyChange("", 2000));
+    EXPECT_FALSE(supervisor.applyChange("unknown\tSystemSettings_Test", 2000));
+    EXPECT_FALSE(supervisor.applyChange("crash\t", 2000));
+    EXPECT_EQ(supervisor.size(), 1);
+}
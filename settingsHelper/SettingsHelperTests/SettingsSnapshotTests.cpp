@@ -0,0 +1,128 @@
+/**
+ * Tests for the binary snapshots of the settings values.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SettingsSnapshot.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+using std::string;
+using std::wstring;
+
+namespace {
+    SnapshotEntry snapshotEntry(const wchar_t* settingId, std::int32_t valueType, string value) {
+        SnapshotEntry entry {};
+        entry.settingId = settingId;
+        entry.valueType = valueType;
+        entry.value = std::move(value);
+
+        return entry;
+    }
+}
+
+TEST(SettingsSnapshot, Numbers) {
+    EXPECT_EQ(encodeSnapshotNumber(0x0102030405060708ull, 8), string("\x08\x07\x06\x05\x04\x03\x02\x01", 8));
+    EXPECT_EQ(encodeSnapshotNumber(0xFFFFFFFFull, 4), string("\xFF\xFF\xFF\xFF", 4));
+    EXPECT_EQ(encodeSnapshotNumber(1, 1), string("\x01", 1));
+
+    std::uint64_t bits { 0 };
+    EXPECT_TRUE(decodeSnapshotNumber(encodeSnapshotNumber(0x8000000000000001ull, 8), 8, bits));
+    EXPECT_EQ(bits, 0x8000000000000001ull);
+
+    // The value must hold exactly the size of its type
+    EXPECT_FALSE(decodeSnapshotNumber(string("\x01\x02", 2), 4, bits));
+    EXPECT_FALSE(decodeSnapshotNumber(string(9, '\0'), 9, bits));
+}
+
+TEST(SettingsSnapshot, Strings) {
+    const wstring str { L"Caf\u00e9 \u20ac" };
+    EXPECT_EQ(encodeSnapshotString(WStringView { str }), string("Caf\xC3\xA9 \xE2\x82\xAC"));
+
+    wstring decoded {};
+    EXPECT_TRUE(decodeSnapshotString(encodeSnapshotString(WStringView { str }), decoded));
+    EXPECT_EQ(decoded, str);
+
+    EXPECT_TRUE(decodeSnapshotString(string(), decoded));
+    EXPECT_TRUE(decoded.empty());
+
+    EXPECT_FALSE(decodeSnapshotString(string("\xC3"), decoded));
+    EXPECT_FALSE(decodeSnapshotString(string("\xC3\x41"), decoded));
+    EXPECT_FALSE(decodeSnapshotString(string("\x80"), decoded));
+}
+
+TEST(SettingsSnapshot, RoundTrip) {
+    SettingsSnapshot snapshot {};
+    snapshot.add(snapshotEntry(L"SystemSettings_Accessibility_Magnifier_IsEnabled", 11, string("\x01", 1)));
+    snapshot.add(snapshotEntry(L"SystemSettings_Display_Scale.Inner", 6, encodeSnapshotNumber(42, 8)));
+    snapshot.add(snapshotEntry(L"SystemSettings_Notifications_Sound", 12, encodeSnapshotString(L"\u00e9t\u00e9")));
+    snapshot.add(snapshotEntry(L"SystemSettings_Empty_String", 12, string()));
+
+    const wstring text { snapshot.encode() };
+    EXPECT_EQ(text.size() % 4, 0u);
+    const wchar_t* const base64Chars { L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=" };
+    EXPECT_EQ(text.find_first_not_of(base64Chars), wstring::npos);
+
+    SettingsSnapshot decoded {};
+    ASSERT_TRUE(decoded.decode(WStringView { text }));
+    ASSERT_EQ(decoded.size(), snapshot.size());
+
+    for (std::size_t i = 0; i < snapshot.size(); i++) {
+        EXPECT_EQ(decoded.getEntries()[i].settingId, snapshot.getEntries()[i].settingId);
+        EXPECT_TRUE(decoded.getEntries()[i].sameValue(snapshot.getEntries()[i]));
+    }
+
+    // An empty snapshot is still valid
+    SettingsSnapshot empty {};
+    EXPECT_TRUE(decoded.decode(WStringView { empty.encode() }));
+    EXPECT_EQ(decoded.size(), 0u);
+}
+
+TEST(SettingsSnapshot, SameValue) {
+    const SnapshotEntry entry { snapshotEntry(L"A", 11, string("\x01", 1)) };
+
+    EXPECT_TRUE(entry.sameValue(snapshotEntry(L"B", 11, string("\x01", 1))));
+    EXPECT_FALSE(entry.sameValue(snapshotEntry(L"A", 11, string("\x00", 1))));
+    EXPECT_FALSE(entry.sameValue(snapshotEntry(L"A", 1, string("\x01", 1))));
+}
+
+TEST(SettingsSnapshot, InvalidText) {
+    SettingsSnapshot snapshot {};
+    snapshot.add(snapshotEntry(L"A", 11, string("\x01", 1)));
+    snapshot.add(snapshotEntry(L"B", 11, string("\x00", 1)));
+    const wstring text { snapshot.encode() };
+
+    SettingsSnapshot decoded {};
+    decoded.add(snapshotEntry(L"Kept", 11, string("\x01", 1)));
+
+    EXPECT_FALSE(decoded.decode(WStringView { L"" }));
+    EXPECT_FALSE(decoded.decode(WStringView { L"R1NT" }));
+    EXPECT_FALSE(decoded.decode(WStringView { L"not base64!" }));
+    EXPECT_FALSE(decoded.decode(WStringView { text.substr(0, text.size() - 4) }));
+    EXPECT_FALSE(decoded.decode(WStringView { text + L"AAAA" }));
+
+    // Another header, or another format version, which is the 4th byte
+    wstring otherHeader { text };
+    otherHeader[0] = L'S';
+    EXPECT_FALSE(decoded.decode(WStringView { otherHeader }));
+
+    wstring otherVersion { text };
+    ASSERT_EQ(otherVersion[5], L'Q');
+    otherVersion[5] = L'g';
+    EXPECT_FALSE(decoded.decode(WStringView { otherVersion }));
+
+    // A failed decode leaves the entries as they were
+    ASSERT_EQ(decoded.size(), 1u);
+    EXPECT_EQ(decoded.getEntries().front().settingId, L"Kept");
+}
@@ -0,0 +1,206 @@
+/**
+ * Tests for the latency histograms and counters.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include "ConcurrentRunner.h"
+
+#include <SettingsStats.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+TEST(LatencyHistogram, BucketBounds) {
+    // Values below the sub-buckets count have their own bucket
+    for (std::int64_t value = 0; value < LatencyHistogram::subBucketsNum; value++) {
+        const std::size_t index { LatencyHistogram::bucketIndex(value) };
+        EXPECT_EQ(LatencyHistogram::bucketLowestValue(index), value);
+        EXPECT_EQ(LatencyHistogram::bucketHighestValue(index), value);
+    }
+
+    const std::vector<std::int64_t> values { 16, 17, 100, 1000, 123456, 10000000, LatencyHistogram::maxTrackableValue };
+    for (const auto value : values) {
+        const std::size_t index { LatencyHistogram::bucketIndex(value) };
+        const std::int64_t lowest { LatencyHistogram::bucketLowestValue(index) };
+        const std::int64_t highest { LatencyHistogram::bucketHighestValue(index) };
+
+        EXPECT_LE(lowest, value);
+        EXPECT_GE(highest, value);
+        // The relative error is bounded by the sub-buckets count
+        EXPECT_LE((highest - lowest) * LatencyHistogram::subBucketsNum, lowest) << value;
+        if (value < LatencyHistogram::maxTrackableValue) {
+            EXPECT_EQ(LatencyHistogram::bucketIndex(highest + 1), index + 1);
+        }
+    }
+
+    EXPECT_EQ(LatencyHistogram::bucketIndex(-5), 0);
+    EXPECT_EQ(
+        LatencyHistogram::bucketIndex(LatencyHistogram::maxTrackableValue * 4),
+        LatencyHistogram::bucketIndex(LatencyHistogram::maxTrackableValue)
+    );
+}
+
+TEST(LatencyHistogram, Percentiles) {
+    LatencyHistogram histogram {};
+    EXPECT_EQ(histogram.valueAtPercentile(50), 0);
+
+    for (std::int64_t value = 1; value <= 1000; value++) {
+        histogram.record(value);
+    }
+
+    EXPECT_EQ(histogram.count(), 1000);
+    EXPECT_EQ(histogram.minimum(), 1);
+    EXPECT_EQ(histogram.maximum(), 1000);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 500.5);
+
+    const std::vector<double> percentiles { 10, 50, 90, 99, 99.9 };
+    for (const auto percentile : percentiles) {
+        const double expected { percentile * 10 };
+        const double reported { static_cast<double>(histogram.valueAtPercentile(percentile)) };
+
+        EXPECT_GE(reported, expected) << percentile;
+        EXPECT_LE(reported, expected * (1 + 1.0 / LatencyHistogram::subBucketsNum)) << percentile;
+    }
+
+    EXPECT_EQ(histogram.valueAtPercentile(0), 1);
+    EXPECT_EQ(histogram.valueAtPercentile(100), 1000);
+
+    // A single slow call dominates the tail, but not the median
+    LatencyHistogram outlier {};
+    for (int i = 0; i < 999; i++) { outlier.record(200); }
+    outlier.record(2000000);
+
+    EXPECT_LE(outlier.valueAtPercentile(50), 207);
+    EXPECT_LE(outlier.valueAtPercentile(99.9), 207);
+    EXPECT_EQ(outlier.valueAtPercentile(100), 2000000);
+}
+
+TEST(LatencyHistogram, Merge) {
+    LatencyHistogram fst {};
+    LatencyHistogram snd {};
+    LatencyHistogram empty {};
+
+    fst.record(10);
+    fst.record(20);
+    snd.record(5);
+    snd.record(40000);
+
+    fst.merge(empty);
+    EXPECT_EQ(fst.count(), 2);
+
+    fst.merge(snd);
+    EXPECT_EQ(fst.count(), 4);
+    EXPECT_EQ(fst.minimum(), 5);
+    EXPECT_EQ(fst.maximum(), 40000);
+    EXPECT_EQ(fst.valueAtPercentile(25), 5);
+
+    empty.merge(fst);
+    EXPECT_EQ(empty.count(), 4);
+    EXPECT_EQ(empty.minimum(), 5);
+
+    fst.reset();
+    EXPECT_EQ(fst.count(), 0);
+    EXPECT_EQ(fst.maximum(), 0);
+}
+
+TEST(SettingsStats, RecordAndSerialize) {
+    SettingsStats stats {};
+    const std::wstring magnifierId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    const std::wstring appListId { L"SystemSettings_Notifications_AppList" };
+
+    stats.record(WStringView { magnifierId }, StatsPhase::Load, 3000);
+    stats.record(WStringView { magnifierId }, StatsPhase::Get, 100);
+    stats.record(WStringView { appListId }, StatsPhase::Get, 300);
+    stats.increment(StatsCounter::DllLoads);
+    stats.increment(StatsCounter::CacheHits);
+    stats.increment(StatsCounter::CacheHits);
+
+    EXPECT_EQ(stats.getCounter(StatsCounter::CacheHits), 2);
+    EXPECT_EQ(stats.getCounter(StatsCounter::Timeouts), 0);
+    EXPECT_EQ(stats.getSetting(WStringView { magnifierId })[static_cast<std::size_t>(StatsPhase::Load)].count(), 1);
+    EXPECT_EQ(stats.getSetting(WStringView { L"Unknown" })[0].count(), 0);
+
+    const PhaseHistograms totals { stats.getTotals() };
+    EXPECT_EQ(totals[static_cast<std::size_t>(StatsPhase::Get)].count(), 2);
+    EXPECT_EQ(totals[static_cast<std::size_t>(StatsPhase::Get)].maximum(), 300);
+    EXPECT_EQ(totals[static_cast<std::size_t>(StatsPhase::Set)].count(), 0);
+
+    const std::string json { stats.toJson() };
+    const std::string counters {
+        "\"counters\":{\"dllLoads\":1,\"cacheHits\":2,\"timeouts\":0,\"faultyRejections\":0,"
+        "\"quarantineRejections\":0,\"catalogRejections\":0,\"coalescedActions\":0,\"nativeActions\":0,"
+        "\"compiledPlans\":0,\"cachedPlanRuns\":0,\"expiredActions\":0}"
+    };
+    EXPECT_NE(json.find(counters), std::string::npos);
+    EXPECT_NE(json.find("\"phases\":{\"load\":{\"count\":1,"), std::string::npos);
+    EXPECT_NE(json.find("\"SystemSettings_Notifications_AppList\":{\"get\":{\"count\":1,\"minUs\":300,"), std::string::npos);
+    // Phases without latencies are left out
+    EXPECT_EQ(json.find("\"set\""), std::string::npos);
+
+    const std::string filtered { stats.toJson(WStringView { appListId }) };
+    EXPECT_EQ(filtered.find("Magnifier"), std::string::npos);
+    EXPECT_NE(filtered.find("AppList"), std::string::npos);
+
+    stats.reset();
+    EXPECT_EQ(stats.getCounter(StatsCounter::CacheHits), 0);
+    EXPECT_NE(stats.toJson().find("\"settings\":{}"), std::string::npos);
+}
+
+TEST(SettingsStats, AsciiSerialization) {
+    std::string json {};
+    appendJsonAscii(WStringView { L"a\"b\\c\n\u00e9\u20ac" }, json);
+
+    EXPECT_EQ(json, "a\\\"b\\\\c\\u000a\\u00e9\\u20ac");
+}
+
+TEST(SettingsStats, ConcurrentRecords) {
+    SettingsStats stats {};
+    const std::wstring settingId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    const int threadsNum { 8 };
+    const int recordsNum { 1000 };
+    std::vector<std::function<void()>> tasks {};
+
+    for (int i = 0; i < threadsNum; i++) {
+        tasks.push_back([&stats, &settingId, recordsNum]() {
+            for (int j = 0; j < recordsNum; j++) {
+                stats.record(WStringView { settingId }, StatsPhase::Wait, j);
+                stats.increment(StatsCounter::Timeouts);
+            }
+        });
+    }
+
+    runConcurrently(tasks);
+
+    EXPECT_EQ(
+        stats.getSetting(WStringView { settingId })[static_cast<std::size_t>(StatsPhase::Wait)].count(),
+        threadsNum * recordsNum
+    );
+    EXPECT_EQ(stats.getCounter(StatsCounter::Timeouts), threadsNum * recordsNum);
+}
+
+TEST(SettingsStats, StatsScope) {
+    SettingsStats& stats { SettingsStats::instance() };
+    const std::wstring settingId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+
+    stats.reset();
+    {
+        StatsScope scope { StatsPhase::Set, WStringView { settingId } };
+    }
+
+    const PhaseHistograms histograms { stats.getSetting(WStringView { settingId }) };
+    EXPECT_EQ(histograms[static_cast<std::size_t>(StatsPhase::Set)].count(), 1);
+    EXPECT_GE(histograms[static_cast<std::size_t>(StatsPhase::Set)].minimum(), 0);
+
+    stats.reset();
+}
@@ -0,0 +1,113 @@
+/**
+ * Tests for the behavior of the simulated settings.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <SimulatedBehavior.h>
+
+#include <vector>
+
+TEST(SimulatedBehavior, DefaultNeverFails) {
+    SimulatedSettingState state { SimulatedBehavior {} };
+    bool raiseChanged { true };
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(state.onCall(SimulatedOperation::GetValue), 0);
+    }
+
+    EXPECT_FALSE(state.pollIsUpdating(raiseChanged));
+    EXPECT_FALSE(raiseChanged);
+    EXPECT_TRUE(state.onValueSet());
+    EXPECT_EQ(state.callsTo(SimulatedOperation::GetValue), 10);
+}
+
+TEST(SimulatedBehavior, UpdatingPolls) {
+    SimulatedBehavior behavior {};
+    behavior.updatingPolls = 2;
+    SimulatedSettingState state { behavior };
+    bool raiseChanged { false };
+
+    EXPECT_TRUE(state.pollIsUpdating(raiseChanged));
+    EXPECT_TRUE(state.pollIsUpdating(raiseChanged));
+    EXPECT_FALSE(state.pollIsUpdating(raiseChanged));
+
+    // Setting a value restarts the countdown
+    state.onValueSet();
+    EXPECT_TRUE(state.pollIsUpdating(raiseChanged));
+    EXPECT_TRUE(state.pollIsUpdating(raiseChanged));
+    EXPECT_FALSE(state.pollIsUpdating(raiseChanged));
+    EXPECT_EQ(state.pollsCount(), 6);
+}
+
+TEST(SimulatedBehavior, ChangeEventTiming) {
+    SimulatedBehavior delayed {};
+    delayed.changeEventPolls = 3;
+    SimulatedSettingState state { delayed };
+    std::vector<bool> raised {};
+
+    EXPECT_FALSE(state.onValueSet());
+
+    for (int i = 0; i < 5; i++) {
+        bool raiseChanged { false };
+        state.pollIsUpdating(raiseChanged);
+        raised.push_back(raiseChanged);
+    }
+
+    EXPECT_EQ(raised, (std::vector<bool> { false, false, true, false, false }));
+
+    SimulatedBehavior never {};
+    never.changeEventPolls = SimulatedBehavior::neverRaised;
+    state.setBehavior(never);
+
+    EXPECT_FALSE(state.onValueSet());
+
+    for (int i = 0; i < 100; i++) {
+        bool raiseChanged { false };
+        state.pollIsUpdating(raiseChanged);
+        EXPECT_FALSE(raiseChanged);
+    }
+}
+
+TEST(SimulatedBehavior, FailureInjection) {
+    const std::int32_t accessDenied { static_cast<std::int32_t>(0x80070005) };
+    SimulatedBehavior behavior {};
+    behavior.fail(SimulatedOperation::SetValue, accessDenied, 2, 3);
+    SimulatedSettingState state { behavior };
+    std::vector<std::int32_t> results {};
+
+    for (int i = 0; i < 9; i++) {
+        results.push_back(state.onCall(SimulatedOperation::SetValue));
+    }
+
+    // Two successful calls, then one failure every three calls
+    EXPECT_EQ(
+        results,
+        (std::vector<std::int32_t> { 0, 0, accessDenied, 0, 0, accessDenied, 0, 0, accessDenied })
+    );
+
+    // Other operations aren't affected
+    EXPECT_EQ(state.onCall(SimulatedOperation::GetValue), 0);
+    EXPECT_EQ(state.callsTo(SimulatedOperation::SetValue), 9);
+}
+
+TEST(SimulatedBehavior, Latencies) {
+    SimulatedBehavior behavior {};
+    behavior.delay(SimulatedOperation::GetSetting, 1500).delay(SimulatedOperation::SetValue, 20);
+    SimulatedSettingState state { behavior };
+
+    EXPECT_EQ(state.latencyOf(SimulatedOperation::GetSetting), 1500);
+    EXPECT_EQ(state.latencyOf(SimulatedOperation::SetValue), 20);
+    EXPECT_EQ(state.latencyOf(SimulatedOperation::GetValue), 0);
+
+    state.setBehavior(SimulatedBehavior {});
+    EXPECT_EQ(state.latencyOf(SimulatedOperation::GetSetting), 0);
+}
@@ -0,0 +1,757 @@
+/**
+ * Tests for the simulated settings backend.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include <BatchDeadline.h>
+#include <IPropertyValueUtils.h>
+#include <Payload.h>
+#include <PayloadProc.h>
+#include <Constants.h>
+#include <SettingAtom.h>
+#include <SettingUtils.h>
+#include <SettingsQuarantine.h>
+#include <SettingsStats.h>
+#include <SimulatedSettings.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+
+#pragma comment (lib, "WindowsApp.lib")
+
+namespace {
+    const wstring magnifierId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+    const wstring appListId { L"SystemSettings_Notifications_AppList" };
+
+    ATL::CComPtr<IInspectable> createBoolValue(bool value) {
+        VARIANT variant {};
+        variant.vt = VARENUM::VT_BOOL;
+        variant.boolVal = value ? VARIANT_TRUE : VARIANT_FALSE;
+
+        ATL::CComPtr<IPropertyValue> propValue { NULL };
+        createPropertyValue(variant, propValue);
+
+        return ATL::CComPtr<IInspectable> { static_cast<IInspectable*>(propValue) };
+    }
+
+    Result runAction(SettingAPI& sAPI, const wstring& payload) {
+        vector<pair<Action, HRESULT>> actions {};
+        Result result {};
+
+        parsePayload(payload, actions);
+        EXPECT_EQ(actions.size(), 1);
+
+        if (actions.size() == 1) {
+            handleAction(sAPI, actions.front().first, result);
+        }
+
+        return result;
+    }
+}
+
+TEST(SimulatedSettings, UnknownSetting) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingItem setting {};
+
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), ERROR_INVALID_HANDLE_STATE);
+
+    backend.load();
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), ERROR_OPEN_FAILED);
+
+    // Loading unknown ids doesn't intern them
+    const wstring unknownId { L"SystemSettings_Unknown_NeverInterned" };
+    EXPECT_EQ(sAPI.loadBaseSetting(unknownId, setting), ERROR_OPEN_FAILED);
+    EXPECT_TRUE(SettingAtom::lookup(WStringView { unknownId }).empty());
+
+    // Neither do payloads targeting them, which still report the id they were given
+    Result result { runAction(sAPI, L"[{ \"settingID\": \"" + unknownId + L"\", \"method\": \"GetValue\" }]") };
+    EXPECT_TRUE(result.isError);
+    EXPECT_EQ(result.settingID, unknownId);
+    EXPECT_TRUE(SettingAtom::lookup(WStringView { unknownId }).empty());
+}
+
+TEST(SimulatedSettings, GetAndSetValue) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+
+    Result getResult { runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }]") };
+    EXPECT_FALSE(getResult.isError);
+    EXPECT_EQ(getResult.returnValue, L"false");
+
+    Result setResult {
+        runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] }]")
+    };
+    EXPECT_FALSE(setResult.isError);
+
+    SimulatedSettingItem* pSetting { backend.findSetting(SettingAtom { magnifierId }) };
+    ASSERT_NE(pSetting, nullptr);
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::SetValue), 1);
+
+    ATL::CComPtr<IPropertyValue> newValue {};
+    newValue.Attach(static_cast<IPropertyValue*>(pSetting->peekValue(L"Value").Detach()));
+    wstring newValueStr {};
+    toString(newValue, newValueStr);
+    EXPECT_EQ(newValueStr, L"true");
+}
+
+TEST(SimulatedSettings, UpdatingDelays) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingItem setting {};
+
+    SimulatedBehavior shortUpdate {};
+    shortUpdate.updatingPolls = 3;
+    SimulatedBehavior endlessUpdate {};
+    endlessUpdate.updatingPolls = 1000;
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false), shortUpdate));
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(false), endlessUpdate));
+
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), ERROR_SUCCESS);
+    EXPECT_EQ(backend.findSetting(SettingAtom { magnifierId })->getState().pollsCount(), 4);
+
+    // Settings that don't finish updating can't be loaded
+    EXPECT_EQ(sAPI.loadBaseSetting(appListId, setting), E_INVALIDARG);
+}
+
+TEST(SimulatedSettings, MissingChangeEventTimesOut) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingItem setting {};
+
+    SimulatedBehavior behavior {};
+    behavior.changeEventPolls = SimulatedBehavior::neverRaised;
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false), behavior));
+    ASSERT_EQ(sAPI.loadBaseSetting(magnifierId, setting), ERROR_SUCCESS);
+
+    // Updating the setting never ends, and the change event is never raised
+    behavior.updatingPolls = 1000;
+    backend.findSetting(SettingAtom { magnifierId })->getState().setBehavior(behavior);
+
+    ATL::CComPtr<IPropertyValue> value {};
+    value.Attach(static_cast<IPropertyValue*>(createBoolValue(true).Detach()));
+
+    EXPECT_EQ(setting.SetValue(L"Value", value), ERROR_TIMEOUT);
+}
+
+TEST(SimulatedSettings, FailureInjection) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingItem setting {};
+
+    SimulatedBehavior behavior {};
+    behavior.fail(SimulatedOperation::GetSetting, E_ACCESSDENIED, 1);
+    behavior.fail(SimulatedOperation::GetValue, E_FAIL, 0, 3);
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false), behavior));
+
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), ERROR_SUCCESS);
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), E_ACCESSDENIED);
+
+    // Successful reads get the value twice, so only the first and third reads
+    // hit the failing calls
+    ATL::CComPtr<IInspectable> value {};
+    EXPECT_EQ(setting.GetValue(L"Value", value), E_FAIL);
+    EXPECT_EQ(setting.GetValue(L"Value", value), ERROR_SUCCESS);
+    EXPECT_EQ(setting.GetValue(L"Value", value), E_FAIL);
+
+    Result result { runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }]") };
+    EXPECT_TRUE(result.isError);
+}
+
+TEST(SimulatedSettings, CollectionDatabase) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    vector<wstring> elemIds {};
+
+    backend.load();
+    backend.addSetting(createSimulatedCollection(appListId, 3, elemIds));
+    ASSERT_EQ(elemIds.size(), 3);
+
+    Result result {
+        runAction(
+            sAPI,
+            L"[{ \"settingID\": \"" + appListId + L".SystemSettings_Notifications_AppNotificationSoundToggle\", "
+            L"\"method\": \"GetValue\", \"parameters\": [ { \"elemId\": \"" + elemIds[1] + L"\" } ] }]"
+        )
+    };
+
+    EXPECT_FALSE(result.isError);
+    EXPECT_NE(result.returnValue.find(elemIds[1]), wstring::npos);
+    EXPECT_EQ(result.returnValue.find(elemIds[0]), wstring::npos);
+
+    // Element ids come from the collection and aren't interned
+    for (const auto& elemId : elemIds) {
+        EXPECT_TRUE(SettingAtom::lookup(WStringView { elemId }).empty());
+    }
+}
+
+TEST(SimulatedSettings, LoadSettingAPIWithBackend) {
+    static SimulatedSettingsBackend backend {};
+    HRESULT errCode { ERROR_SUCCESS };
+
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(true)));
+
+    SettingAPI& simAPI { LoadSettingAPI(backend, errCode) };
+    EXPECT_EQ(errCode, ERROR_SUCCESS);
+    EXPECT_EQ(&simAPI.getBackend(), &backend);
+
+    // Later loads keep using the supplied backend
+    SettingAPI& sameAPI { LoadSettingAPI(errCode) };
+    EXPECT_EQ(&sameAPI, &simAPI);
+    EXPECT_EQ(&sameAPI.getBackend(), &backend);
+
+    SettingItem setting {};
+    EXPECT_EQ(sameAPI.loadBaseSetting(magnifierId, setting), ERROR_SUCCESS);
+
+    // Restore the backend used by the rest of the tests
+    LoadSettingAPI(systemSettingsBackend(), errCode);
+    EXPECT_EQ(&sameAPI.getBackend(), &systemSettingsBackend());
+}
+
+TEST(SimulatedSettings, CollectedStats) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingItem setting {};
+    SettingsStats& stats { SettingsStats::instance() };
+
+    SimulatedBehavior endlessUpdate {};
+    endlessUpdate.updatingPolls = 1000;
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(false), endlessUpdate));
+    stats.reset();
+
+    runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }]");
+    runAction(
+        sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] }]"
+    );
+    EXPECT_EQ(sAPI.loadBaseSetting(appListId, setting), E_INVALIDARG);
+    EXPECT_EQ(sAPI.loadBaseSetting(constants::KnownFaultySettings().front(), setting), E_INVALIDARG);
+
+    const PhaseHistograms magnifierStats { stats.getSetting(WStringView { magnifierId }) };
+    EXPECT_EQ(magnifierStats[static_cast<std::size_t>(StatsPhase::Load)].count(), 2);
+    // 'SetValue' reads the current value before applying the new one
+    EXPECT_EQ(magnifierStats[static_cast<std::size_t>(StatsPhase::Get)].count(), 2);
+    EXPECT_EQ(magnifierStats[static_cast<std::size_t>(StatsPhase::Set)].count(), 1);
+    EXPECT_EQ(magnifierStats[static_cast<std::size_t>(StatsPhase::Wait)].count(), 1);
+
+    EXPECT_EQ(stats.getCounter(StatsCounter::Timeouts), 1);
+    EXPECT_EQ(stats.getCounter(StatsCounter::FaultyRejections), 1);
+
+    // 'GetStats' doesn't load the setting, and only reports the requested one
+    Result statsResult { runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetStats\" }]") };
+    EXPECT_FALSE(statsResult.isError);
+    EXPECT_NE(statsResult.returnValue.find(L"\"" + magnifierId + L"\":{\"load\":{\"count\":2"), wstring::npos);
+    EXPECT_EQ(statsResult.returnValue.find(appListId), wstring::npos);
+    EXPECT_EQ(stats.getSetting(WStringView { magnifierId })[static_cast<std::size_t>(StatsPhase::Load)].count(), 2);
+
+    Result allStats { runAction(sAPI, L"[{ \"settingID\": \"\", \"method\": \"GetStats\" }]") };
+    EXPECT_FALSE(allStats.isError);
+    EXPECT_NE(allStats.returnValue.find(appListId), wstring::npos);
+
+    stats.reset();
+}
+
+TEST(SimulatedSettings, LearnedQuarantine) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingItem setting {};
+    SettingsQuarantine quarantine { L"17763.1" };
+    SettingsStats& stats { SettingsStats::instance() };
+
+    SimulatedBehavior notImplemented {};
+    notImplemented.fail(SimulatedOperation::GetSetting, E_NOTIMPL);
+    SimulatedBehavior endlessUpdate {};
+    endlessUpdate.updatingPolls = 1000;
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false), notImplemented));
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(false), endlessUpdate));
+    sAPI.setQuarantine(&quarantine);
+    stats.reset();
+
+    vector<wstring> probes {};
+    quarantine.setProbeListener([&probes](const wstring& settingId) { probes.push_back(settingId); });
+
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), E_NOTIMPL);
+    EXPECT_EQ(sAPI.loadBaseSetting(appListId, setting), E_INVALIDARG);
+    ASSERT_EQ(quarantine.size(), 2);
+    EXPECT_EQ(quarantine.find(WStringView { magnifierId })->reason, QuarantineReason::NotImplemented);
+    EXPECT_EQ(quarantine.find(WStringView { appListId })->reason, QuarantineReason::Timeout);
+    EXPECT_EQ(probes, (vector<wstring> { magnifierId, L"", appListId, L"" }));
+
+    // Quarantined settings are rejected without reaching the backend
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), E_INVALIDARG);
+    EXPECT_EQ(backend.findSetting(SettingAtom { magnifierId })->getState().callsTo(SimulatedOperation::GetSetting), 1);
+    EXPECT_EQ(stats.getCounter(StatsCounter::QuarantineRejections), 1);
+
+    // Once expired, a successful probe releases the setting
+    SettingsQuarantine expired { L"17763.1", 0 };
+    expired.add(WStringView { magnifierId }, QuarantineReason::Crash, 0);
+    backend.findSetting(SettingAtom { magnifierId })->getState().setBehavior(SimulatedBehavior {});
+    sAPI.setQuarantine(&expired);
+
+    EXPECT_EQ(sAPI.loadBaseSetting(magnifierId, setting), ERROR_SUCCESS);
+    EXPECT_EQ(expired.size(), 0);
+
+    sAPI.setQuarantine(nullptr);
+    stats.reset();
+}
+
+TEST(SimulatedSettings, ProbeMarkers) {
+    wchar_t tempDir[MAX_PATH] {};
+    GetTempPathW(MAX_PATH, tempDir);
+    const wstring quarantinePath { wstring { tempDir } + L"ProbeMarkersTest.quarantine" };
+    const wstring staleProbePath { quarantinePath + L".probe.1" };
+    const wstring ownProbePath { quarantinePath + L".probe." + std::to_wstring(GetCurrentProcessId()) };
+
+    DeleteFileW(quarantinePath.c_str());
+    {
+        std::ofstream staleProbe { staleProbePath, std::ios::binary | std::ios::trunc };
+        staleProbe << "17763.1\t" << std::string { magnifierId.begin(), magnifierId.end() } << "\n";
+    }
+
+    {
+        SettingsQuarantine quarantine { L"17763.1" };
+        ASSERT_EQ(readQuarantine(quarantinePath, quarantine), ERROR_SUCCESS);
+        EXPECT_EQ(recoverProbeMarkers(quarantinePath, quarantine), 1);
+
+        // The marker left by a crashed process quarantines its setting
+        ASSERT_NE(quarantine.find(WStringView { magnifierId }), nullptr);
+        EXPECT_EQ(quarantine.find(WStringView { magnifierId })->reason, QuarantineReason::Crash);
+        EXPECT_EQ(GetFileAttributesW(staleProbePath.c_str()), INVALID_FILE_ATTRIBUTES);
+        EXPECT_NE(GetFileAttributesW(ownProbePath.c_str()), INVALID_FILE_ATTRIBUTES);
+
+        // The marker held by a running process isn't taken as left behind
+        quarantine.beginProbe(appListId);
+        SettingsQuarantine other { L"17763.1" };
+        ASSERT_EQ(readQuarantine(quarantinePath, other), ERROR_SUCCESS);
+        EXPECT_EQ(recoverProbeMarkers(quarantinePath, other), 0);
+        EXPECT_EQ(other.find(WStringView { appListId }), nullptr);
+        quarantine.endProbe();
+    }
+
+    // The marker is removed along with the quarantine
+    EXPECT_EQ(GetFileAttributesW(ownProbePath.c_str()), INVALID_FILE_ATTRIBUTES);
+}
+
+TEST(SimulatedSettings, WorkerSession) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(true)));
+
+    PayloadWorkerSession session { sAPI };
+    session.loadPayload(
+        L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }, { \"method\": \"GetValue\" }]"
+    );
+
+    // The worker answers with the same serialization used for the output
+    const wstring result { session.runAction(0) };
+    EXPECT_NE(result.find(L"\"isError\": false"), wstring::npos);
+    EXPECT_NE(result.find(L"\"returnValue\": true"), wstring::npos);
+
+    EXPECT_NE(session.runAction(1).find(L"Invalid payload"), wstring::npos);
+    EXPECT_NE(session.runAction(2).find(L"Invalid payload"), wstring::npos);
+
+    // Selectors are expanded in the worker, which answers for every selected setting
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(false)));
+    session.loadPayload(L"[{ \"settingID\": \"SystemSettings_*\", \"method\": \"GetValue\" }]");
+
+    const wstring selected { session.runAction(0) };
+    EXPECT_NE(selected.find(magnifierId), wstring::npos);
+    EXPECT_NE(selected.find(appListId), wstring::npos);
+    EXPECT_EQ(selected.find(L"\"isError\": true"), wstring::npos);
+
+    std::vector<std::string> events {};
+    session.takeEvents(events);
+    EXPECT_TRUE(events.empty());
+}
+
+TEST(SimulatedSettings, CoalescedBatch) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+
+    const wstring getAction { L"{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }" };
+    const wstring setTrueAction {
+        L"{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] }"
+    };
+    const wstring setFalseAction {
+        L"{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ false ] }"
+    };
+
+    Batch batch {};
+    BatchScope batchScope { batch.arena };
+    parsePayload(
+        L"[" + getAction + L"," + getAction + L"," + setFalseAction + L"," + setTrueAction + L"," + getAction + L"]",
+        batch.actions
+    );
+    handleBatchActions(sAPI, batch);
+
+    // One result per action, even for the ones that weren't run
+    ASSERT_EQ(batch.results.size(), 5);
+    for (const auto& result : batch.results) {
+        EXPECT_FALSE(result.isError);
+        EXPECT_EQ(result.settingID, magnifierId);
+    }
+    EXPECT_EQ(batch.results[0].returnValue, L"false");
+    EXPECT_EQ(batch.results[1].returnValue, L"false");
+    // Both sets report the value before the batch changed it
+    EXPECT_EQ(batch.results[2].returnValue, L"false");
+    EXPECT_EQ(batch.results[3].returnValue, L"false");
+    EXPECT_EQ(batch.results[4].returnValue, L"true");
+
+    const SimulatedSettingItem* pSetting { backend.findSetting(SettingAtom { magnifierId }) };
+    ASSERT_NE(pSetting, nullptr);
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::SetValue), 1);
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::GetSetting), 2);
+}
+
+TEST(SimulatedSettings, FailedReplacingSet) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    // Only the first call to 'SetValue' fails
+    SimulatedBehavior behavior {};
+    behavior.fail(SimulatedOperation::SetValue, E_FAIL, 0, 1000);
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false), behavior));
+
+    const wstring getAction { L"{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }" };
+    const wstring setAction {
+        L"{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] }"
+    };
+
+    Batch batch {};
+    BatchScope batchScope { batch.arena };
+    parsePayload(L"[" + setAction + L"," + setAction + L"," + getAction + L"]", batch.actions);
+    handleBatchActions(sAPI, batch);
+
+    // The replaced set runs as soon as the one replacing it fails, so the
+    // read after both of them sees its value
+    ASSERT_EQ(batch.results.size(), 3);
+    EXPECT_FALSE(batch.results[0].isError);
+    EXPECT_EQ(batch.results[0].returnValue, L"false");
+    EXPECT_TRUE(batch.results[1].isError);
+    EXPECT_FALSE(batch.results[2].isError);
+    EXPECT_EQ(batch.results[2].returnValue, L"true");
+
+    const SimulatedSettingItem* pSetting { backend.findSetting(SettingAtom { magnifierId }) };
+    ASSERT_NE(pSetting, nullptr);
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::SetValue), 2);
+}
+
+namespace {
+    /// <summary>
+    ///  Native handler echoing the requests it serves.
+    /// </summary>
+    class EchoNativeHandler : public NativeHandler {
+    public:
+        std::int32_t load() override { return ERROR_SUCCESS; }
+
+        std::int32_t handle(const NativeRequest& request, wstring& rVal, wstring* pAppliedVal) override {
+            if (request.method == ActionMethod::Invoke) { return E_NOTIMPL; }
+
+            rVal = L"\"" + request.valueId.str() + L"\"";
+
+            if (pAppliedVal != nullptr) {
+                *pAppliedVal = request.value;
+            }
+
+            return ERROR_SUCCESS;
+        }
+
+        void unload() override {}
+    };
+}
+
+TEST(SimulatedSettings, NativeHandlerActions) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    NativeHandlers handlers {};
+    handlers.add(L"Native.Echo", std::unique_ptr<NativeHandler> { new EchoNativeHandler {} });
+    sAPI.setNativeHandlers(handlers);
+
+    backend.load();
+
+    // Served without reaching the backend, which doesn't know the setting
+    Result getResult { runAction(sAPI, L"[{ \"settingID\": \"Native.Echo.Muted\", \"method\": \"GetValue\" }]") };
+    EXPECT_FALSE(getResult.isError);
+    EXPECT_EQ(getResult.returnValue, L"\"Muted\"");
+
+    Result setResult {
+        runAction(sAPI, L"[{ \"settingID\": \"Native.Echo\", \"method\": \"SetValue\", \"parameters\": [ true ] }]")
+    };
+    EXPECT_FALSE(setResult.isError);
+    EXPECT_EQ(setResult.returnValue, L"\"Value\"");
+
+    Result invokeResult { runAction(sAPI, L"[{ \"settingID\": \"Native.Echo\", \"method\": \"Invoke\" }]") };
+    EXPECT_TRUE(invokeResult.isError);
+    EXPECT_NE(invokeResult.errorMessage.find(L"native setting"), wstring::npos);
+
+    Result systemResult { runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }]") };
+    EXPECT_TRUE(systemResult.isError);
+}
+
+TEST(SimulatedSettings, CompiledPlan) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+
+    const wstring payload {
+        L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] },"
+        L" { \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" },"
+        L" { \"settingID\": \"Unknown\", \"method\": \"GetValue\" }]"
+    };
+
+    CompiledPlan plan {};
+    EXPECT_EQ(compilePayload(sAPI, payload, nullptr, plan), ERROR_SUCCESS);
+    ASSERT_EQ(plan.batch.actions.size(), 3);
+    EXPECT_EQ(plan.coalesced, 1);
+    EXPECT_FALSE(plan.selectsSettings);
+    // The simulated backend doesn't load libraries, so the payload order is kept
+    EXPECT_EQ(plan.order, (vector<std::size_t> { 0, 1, 2 }));
+
+    // Running the plan again applies the actions again, without parsing them
+    for (int run = 0; run < 2; run++) {
+        vector<Result> results {};
+        runCompiledPlan(sAPI, plan, results);
+
+        ASSERT_EQ(results.size(), 3);
+        EXPECT_FALSE(results[0].isError);
+        EXPECT_EQ(results[1].returnValue, L"true");
+        EXPECT_TRUE(results[2].isError);
+    }
+
+    const SimulatedSettingItem* pSetting { backend.findSetting(SettingAtom { magnifierId }) };
+    ASSERT_NE(pSetting, nullptr);
+    // The value was already set by the first run
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::SetValue), 1);
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::GetSetting), 2);
+}
+
+TEST(SimulatedSettings, SnapshotAndRestore) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(true)));
+
+    Result snapshot {
+        runAction(
+            sAPI,
+            L"[{ \"settingID\": \"Saved\", \"method\": \"Snapshot\", \"parameters\": [ \"" +
+            magnifierId + L"\", \"" + appListId + L"\" ] }]"
+        )
+    };
+    ASSERT_FALSE(snapshot.isError);
+    EXPECT_EQ(snapshot.settingID, L"Saved");
+    ASSERT_GT(snapshot.returnValue.size(), 2);
+    EXPECT_EQ(snapshot.returnValue.front(), L'"');
+
+    runAction(
+        sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"SetValue\", \"parameters\": [ true ] }]"
+    );
+
+    const wstring restoreAction {
+        L"[{ \"settingID\": \"Saved\", \"method\": \"Restore\", \"parameters\": [ " + snapshot.returnValue + L" ] }]"
+    };
+    Result restored { runAction(sAPI, restoreAction) };
+    EXPECT_FALSE(restored.isError);
+    EXPECT_EQ(restored.returnValue, L"[\"" + magnifierId + L"\"]");
+
+    // Only the setting that changed since the snapshot is set back
+    const SimulatedSettingItem* pMagnifier { backend.findSetting(SettingAtom { magnifierId }) };
+    const SimulatedSettingItem* pAppList { backend.findSetting(SettingAtom { appListId }) };
+    ASSERT_NE(pMagnifier, nullptr);
+    ASSERT_NE(pAppList, nullptr);
+    EXPECT_EQ(pMagnifier->getState().callsTo(SimulatedOperation::SetValue), 2);
+    EXPECT_EQ(pAppList->getState().callsTo(SimulatedOperation::SetValue), 0);
+
+    // Restoring it again finds nothing to set
+    Result unchanged { runAction(sAPI, restoreAction) };
+    EXPECT_FALSE(unchanged.isError);
+    EXPECT_EQ(unchanged.returnValue, L"[]");
+    EXPECT_EQ(pMagnifier->getState().callsTo(SimulatedOperation::SetValue), 2);
+
+    Result malformed {
+        runAction(sAPI, L"[{ \"settingID\": \"Saved\", \"method\": \"Restore\", \"parameters\": [ \"R1NT\" ] }]")
+    };
+    EXPECT_TRUE(malformed.isError);
+
+    Result unknown {
+        runAction(sAPI, L"[{ \"settingID\": \"Saved\", \"method\": \"Snapshot\", \"parameters\": [ \"Unknown\" ] }]")
+    };
+    EXPECT_TRUE(unknown.isError);
+    EXPECT_NE(unknown.errorMessage.find(L"'Unknown'"), wstring::npos);
+}
+
+TEST(SimulatedSettings, SelectorActions) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    const wstring highContrastId { L"SystemSettings_Accessibility_HighContrast_IsEnabled" };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(true)));
+    backend.addSetting(createSimulatedSetting(highContrastId, SettingType::Boolean, createBoolValue(false)));
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(true)));
+
+    Batch batch {};
+    BatchScope batchScope { batch.arena };
+    parsePayload(
+        L"[{ \"settingID\": \"SystemSettings_Accessibility_*\", \"method\": \"GetValue\" },"
+        L" { \"settingID\": \"" + appListId + L"\", \"method\": \"GetValue\" },"
+        L" { \"settingID\": \"SystemSettings_Sound_*\", \"method\": \"GetValue\" }]",
+        batch.actions
+    );
+    handleBatchActions(sAPI, batch);
+
+    // Each selected setting gets its result, in the order of their ids
+    ASSERT_EQ(batch.results.size(), 4);
+    EXPECT_EQ(batch.results[0].settingID, highContrastId);
+    EXPECT_EQ(batch.results[0].returnValue, L"false");
+    EXPECT_EQ(batch.results[1].settingID, magnifierId);
+    EXPECT_EQ(batch.results[1].returnValue, L"true");
+    EXPECT_EQ(batch.results[2].settingID, appListId);
+    EXPECT_FALSE(batch.results[2].isError);
+
+    // Selectors matching nothing fail
+    EXPECT_EQ(batch.results[3].settingID, L"SystemSettings_Sound_*");
+    EXPECT_TRUE(batch.results[3].isError);
+
+    // Compiled plans tell they hold selectors, as the settings they select may change
+    const wstring selectorPayload {
+        L"[{ \"settingID\": \"SystemSettings_Accessibility_*\", \"method\": \"GetValue\" }]"
+    };
+    CompiledPlan plan {};
+    EXPECT_EQ(compilePayload(sAPI, selectorPayload, nullptr, plan), ERROR_SUCCESS);
+    EXPECT_TRUE(plan.selectsSettings);
+    EXPECT_EQ(plan.batch.actions.size(), 2);
+}
+
+TEST(SimulatedSettings, ProjectedFields) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(false)));
+
+    Result projected {
+        runAction(
+            sAPI,
+            L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\", "
+            L"\"fields\": [ \"description\", \"type\", \"isEnabled\" ] }]"
+        )
+    };
+    EXPECT_FALSE(projected.isError);
+    // Fields are reported in a fixed order, whatever the order they are requested in
+    EXPECT_EQ(
+        projected.returnValue,
+        L"{ \"value\": false, \"type\": \"Boolean\", \"isEnabled\": true, \"description\": \"\" }"
+    );
+
+    // The value and every field are read from a single load of the setting
+    const SimulatedSettingItem* pSetting { backend.findSetting(SettingAtom { magnifierId }) };
+    ASSERT_NE(pSetting, nullptr);
+    EXPECT_EQ(pSetting->getState().callsTo(SimulatedOperation::GetSetting), 1);
+
+    Result metadata {
+        runAction(sAPI, L"[{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetMetadata\" }]")
+    };
+    EXPECT_FALSE(metadata.isError);
+    EXPECT_EQ(
+        metadata.returnValue,
+        L"{ \"type\": \"Boolean\", \"isEnabled\": true, \"isApplicable\": true, "
+        L"\"isSetByGroupPolicy\": false, \"description\": \"\" }"
+    );
+
+    Result inner {
+        runAction(
+            sAPI,
+            L"[{ \"settingID\": \"" + magnifierId + L".Inner\", \"method\": \"GetValue\", \"fields\": [ \"type\" ] }]"
+        )
+    };
+    EXPECT_TRUE(inner.isError);
+}
+
+TEST(SimulatedSettings, ExpiredDeadline) {
+    SimulatedSettingsBackend backend {};
+    SettingAPI sAPI { backend };
+    SettingsStats& stats { SettingsStats::instance() };
+
+    SimulatedBehavior slowGet {};
+    slowGet.delay(SimulatedOperation::GetValue, 50 * 1000);
+    SimulatedBehavior endlessUpdate {};
+    endlessUpdate.updatingPolls = 1000;
+
+    backend.load();
+    backend.addSetting(createSimulatedSetting(magnifierId, SettingType::Boolean, createBoolValue(true), slowGet));
+    backend.addSetting(createSimulatedSetting(appListId, SettingType::Boolean, createBoolValue(false), endlessUpdate));
+    stats.reset();
+
+    const wstring getMagnifier { L"{ \"settingID\": \"" + magnifierId + L"\", \"method\": \"GetValue\" }" };
+    const wstring getAppList { L"{ \"settingID\": \"" + appListId + L"\", \"method\": \"GetValue\" }" };
+
+    Batch batch {};
+    BatchScope batchScope { batch.arena };
+    parsePayload(L"[" + getMagnifier + L"," + getAppList + L"," + getMagnifier + L"]", batch.actions);
+
+    // The first read outlasts the deadline of the batch
+    BatchDeadline deadline { 20 };
+    {
+        DeadlineScope deadlineScope { &deadline };
+        handleBatchActions(sAPI, batch);
+    }
+
+    ASSERT_EQ(batch.results.size(), 3);
+    EXPECT_FALSE(batch.results[0].isError);
+    EXPECT_EQ(batch.results[0].returnValue, L"true");
+    EXPECT_TRUE(batch.results[1].isError);
+    EXPECT_EQ(batch.results[1].settingID, appListId);
+    EXPECT_NE(batch.results[1].errorMessage.find(L"deadline"), wstring::npos);
+    // Repeated reads are still answered by the one already run
+    EXPECT_FALSE(batch.results[2].isError);
+    EXPECT_EQ(batch.results[2].returnValue, L"true");
+
+    const SimulatedSettingItem* pAppList { backend.findSetting(SettingAtom { appListId }) };
+    ASSERT_NE(pAppList, nullptr);
+    EXPECT_EQ(pAppList->getState().callsTo(SimulatedOperation::GetSetting), 0);
+    EXPECT_EQ(stats.getCounter(StatsCounter::ExpiredActions), 1);
+
+    // Waits cut short by the deadline aren't counted as the setting timing out
+    SettingItem setting {};
+    DeadlineScope deadlineScope { &deadline };
+    EXPECT_EQ(sAPI.loadBaseSetting(appListId, setting), ERROR_TIMEOUT);
+    EXPECT_EQ(stats.getCounter(StatsCounter::Timeouts), 0);
+}
@@ -0,0 +1,159 @@
+/**
+ * Tests for the phase tracer.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+#include "ConcurrentRunner.h"
+
+#include <Tracer.h>
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    /// <summary>
+    ///  Mimics the phases of an action, without touching the settings API.
+    /// </summary>
+    void mockedAction(const std::wstring& settingId) {
+        TraceScope trace { "handleAction", "settingID", settingId };
+
+        {
+            TraceScope loadTrace { "loadBaseSetting", "settingID", settingId };
+            TraceScope getSettingTrace { "GetSetting" };
+        }
+        {
+            TraceScope setTrace { "_SetValue", "settingID", settingId };
+            TraceScope waitTrace { "SetValueWait" };
+        }
+    }
+
+    /// <summary>
+    ///  Enables the tracer for the lifetime of the fixture, starting with no
+    ///  recorded events.
+    /// </summary>
+    class TracerTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            Tracer::instance().clear();
+            Tracer::instance().enable();
+        }
+        void TearDown() override {
+            Tracer::instance().disable();
+            Tracer::instance().clear();
+        }
+    };
+}
+
+TEST(Tracer, DisabledRecordsNothing) {
+    Tracer::instance().disable();
+    Tracer::instance().clear();
+
+    mockedAction(L"SystemSettings_Accessibility_Magnifier_IsEnabled");
+
+    EXPECT_TRUE(Tracer::instance().getEvents().empty());
+}
+
+TEST_F(TracerTest, RecordsNestedPhases) {
+    const std::wstring settingId { L"SystemSettings_Accessibility_Magnifier_IsEnabled" };
+
+    mockedAction(settingId);
+
+    const std::vector<TraceEvent> events { Tracer::instance().getEvents() };
+    ASSERT_EQ(events.size(), 5);
+
+    // Events are recorded when the scopes end, so inner phases come first
+    EXPECT_STREQ(events[0].name, "GetSetting");
+    EXPECT_STREQ(events[1].name, "loadBaseSetting");
+    EXPECT_STREQ(events[2].name, "SetValueWait");
+    EXPECT_STREQ(events[3].name, "_SetValue");
+    EXPECT_STREQ(events[4].name, "handleAction");
+
+    const TraceEvent& action { events[4] };
+    EXPECT_STREQ(action.argName, "settingID");
+    EXPECT_EQ(action.argValue, settingId);
+    EXPECT_EQ(events[0].argName, nullptr);
+
+    for (const auto& event : events) {
+        EXPECT_GE(event.durationUs, 0);
+        EXPECT_GE(event.startUs, action.startUs);
+        EXPECT_LE(event.startUs + event.durationUs, action.startUs + action.durationUs);
+        EXPECT_EQ(event.threadId, action.threadId);
+    }
+
+    EXPECT_LE(events[1].startUs + events[1].durationUs, events[3].startUs);
+}
+
+TEST_F(TracerTest, ScopeStartedWhileDisabledIsDropped) {
+    Tracer::instance().disable();
+    {
+        TraceScope trace { "loadBaseSetting" };
+        Tracer::instance().enable();
+    }
+
+    EXPECT_TRUE(Tracer::instance().getEvents().empty());
+}
+
+TEST_F(TracerTest, WritesTraceEventJson) {
+    Tracer::instance().addEvent(TraceEvent { "handleAction", 10, 25, 7, "settingID", L"Setting_Id" });
+    Tracer::instance().addEvent(TraceEvent { "parsePayload", 40, 5, 7, nullptr, L"" });
+
+    std::ostringstream out {};
+    Tracer::instance().writeJson(out);
+
+    const std::string expected {
+        "{\"traceEvents\":["
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"SettingsHelper\"}},"
+        "{\"name\":\"handleAction\",\"cat\":\"settingsHelper\",\"ph\":\"X\",\"ts\":10,\"dur\":25,"
+        "\"pid\":1,\"tid\":7,\"args\":{\"settingID\":\"Setting_Id\"}},"
+        "{\"name\":\"parsePayload\",\"cat\":\"settingsHelper\",\"ph\":\"X\",\"ts\":40,\"dur\":5,"
+        "\"pid\":1,\"tid\":7}"
+        "],\"displayTimeUnit\":\"ms\"}"
+    };
+
+    EXPECT_EQ(out.str(), expected);
+}
+
+TEST(Tracer, EscapesJsonArguments) {
+    std::string json {};
+
+    appendJsonUtf8(WStringView { L"a\"b\\c\n\x01" }, json);
+    EXPECT_EQ(json, "a\\\"b\\\\c\\u000a\\u0001");
+
+    json.clear();
+    appendJsonUtf8(WStringView { L"\x00e9\x20ac" }, json);
+    EXPECT_EQ(json, "\xc3\xa9\xe2\x82\xac");
+
+    // U+1F600, as a surrogate pair where wchar_t holds UTF-16
+    json.clear();
+    const std::wstring emoji { sizeof(wchar_t) == 2 ? std::wstring { L"\xD83D\xDE00" } : std::wstring(1, static_cast<wchar_t>(0x1F600)) };
+    appendJsonUtf8(WStringView { emoji }, json);
+    EXPECT_EQ(json, "\xf0\x9f\x98\x80");
+}
+
+TEST_F(TracerTest, ConcurrentScopes) {
+    const int threadsNum { 4 };
+    const int actionsNum { 100 };
+    std::vector<std::function<void()>> tasks {};
+
+    for (int t = 0; t < threadsNum; t++) {
+        tasks.push_back([actionsNum]() {
+            for (int i = 0; i < actionsNum; i++) {
+                mockedAction(L"Tracer_Concurrent_" + std::to_wstring(i));
+            }
+        });
+    }
+
+    runConcurrently(tasks);
+
+    EXPECT_EQ(Tracer::instance().getEvents().size(), threadsNum * actionsNum * 5);
+}
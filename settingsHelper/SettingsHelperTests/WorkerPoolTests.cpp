@@ -0,0 +1,329 @@
+/**
+ * Tests for the pool of worker processes.
+ *
+ * Copyright 2019 Raising the Floor - US
+ *
+ * Licensed under the New BSD license. You may not use this file except in
+ * compliance with this License.
+ *
+ * You may obtain a copy of the License at
+ * https://github.com/GPII/universal/blob/master/LICENSE.txt
+ */
+
+#include "pch.h"
+
+#include <BatchDeadline.h>
+#include <WorkerPool.h>
+#include <WorkerProcess.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+    /// <summary>
+    ///  Channel reading from a fixed input, which is closed once consumed.
+    /// </summary>
+    class MemoryChannel : public WorkerChannel {
+    private:
+        string input {};
+        std::size_t readPos { 0 };
+        std::size_t chunkSize { 0 };
+
+    public:
+        string output {};
+
+        MemoryChannel(string input, std::size_t chunkSize) : input(std::move(input)), chunkSize(chunkSize) {}
+
+        bool write(const char* data, std::size_t size) override {
+            output.append(data, size);
+            return true;
+        }
+
+        ChannelStatus read(char* buffer, std::size_t capacity, std::size_t& rRead, std::uint32_t) override {
+            if (readPos == input.size()) { return ChannelStatus::Closed; }
+
+            rRead = (std::min)((std::min)(capacity, chunkSize), input.size() - readPos);
+            std::memcpy(buffer, input.data() + readPos, rRead);
+            readPos += rRead;
+
+            return ChannelStatus::Data;
+        }
+
+        void terminate() override {}
+    };
+
+    /// <summary>
+    ///  Fake backend whose payload is a list of behaviours, one per action:
+    ///  'ok' answers with the action index, 'event' also reports an event,
+    ///  'crash' aborts the process and 'hang' never answers.
+    /// </summary>
+    class FakeSession : public WorkerSession {
+    private:
+        vector<wstring> behaviours {};
+        vector<string> events {};
+
+    public:
+        std::size_t payloadLoads { 0 };
+
+        void loadPayload(const wstring& payload) override {
+            behaviours.clear();
+            payloadLoads++;
+
+            std::size_t start { 0 };
+            while (start <= payload.size()) {
+                const std::size_t end { (std::min)(payload.find(L',', start), payload.size()) };
+                behaviours.push_back(payload.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+
+        wstring runAction(std::uint32_t index) override {
+            const wstring behaviour { index < behaviours.size() ? behaviours[index] : L"" };
+
+            if (behaviour == L"crash") {
+                std::abort();
+            } else if (behaviour == L"hang") {
+                volatile bool hanging { true };
+                while (hanging) {}
+            } else if (behaviour == L"event") {
+                events.push_back("event-" + std::to_string(index));
+            }
+
+            return L"result-" + std::to_wstring(index) + L"-" + std::to_wstring(payloadLoads);
+        }
+
+        void takeEvents(vector<string>& rEvents) override {
+            rEvents = std::move(events);
+            events.clear();
+        }
+    };
+}
+
+TEST(WorkerPool, FramesRoundTrip) {
+    const wstring payload { L"[{ \"settingID\": \"caf\u00e9\" }]" };
+    string stream {};
+
+    encodeFrame(FrameType::LoadPayload, toFrameBody(payload), stream);
+    encodeFrame(FrameType::RunAction, "7", stream);
+    encodeFrame(FrameType::ActionResult, "", stream);
+
+    // Frames are rebuilt no matter how the bytes arrive
+    FrameDecoder decoder {};
+    vector<Frame> frames {};
+    Frame frame {};
+
+    for (const char byte : stream) {
+        decoder.feed(&byte, 1);
+        while (decoder.next(frame)) { frames.push_back(frame); }
+    }
+
+    EXPECT_FALSE(decoder.isCorrupted());
+    ASSERT_EQ(frames.size(), 3);
+    EXPECT_EQ(frames[0].type, FrameType::LoadPayload);
+    EXPECT_EQ(fromFrameBody(frames[0].body), payload);
+    EXPECT_EQ(frames[1].type, FrameType::RunAction);
+    EXPECT_EQ(frames[1].body, "7");
+    EXPECT_EQ(frames[2].type, FrameType::ActionResult);
+    EXPECT_TRUE(frames[2].body.empty());
+}
+
+TEST(WorkerPool, CorruptedFrames) {
+    Frame frame {};
+
+    FrameDecoder unknownType {};
+    unknownType.feed("\x01\x00\x00\x00X", 5);
+    EXPECT_FALSE(unknownType.next(frame));
+    EXPECT_TRUE(unknownType.isCorrupted());
+
+    FrameDecoder oversized {};
+    oversized.feed("\xFF\xFF\xFF\xFFP", 5);
+    EXPECT_FALSE(oversized.next(frame));
+    EXPECT_TRUE(oversized.isCorrupted());
+
+    // A corrupted stream closes the channel, even with valid bytes after it
+    string stream { "\x00\x00\x00\x00P", 5 };
+    encodeFrame(FrameType::RunAction, "0", stream);
+    MemoryChannel channel { stream, 64 };
+    FakeSession session {};
+
+    EXPECT_EQ(runWorker(channel, session), 1);
+    EXPECT_TRUE(channel.output.empty());
+}
+
+TEST(WorkerPool, WorkerServesActions) {
+    string input {};
+    encodeFrame(FrameType::LoadPayload, toFrameBody(L"ok,ok"), input);
+    encodeFrame(FrameType::RunAction, "1", input);
+    encodeFrame(FrameType::RunAction, "0", input);
+
+    MemoryChannel channel { input, 3 };
+    FakeSession session {};
+
+    EXPECT_EQ(runWorker(channel, session), 0);
+
+    FrameDecoder decoder {};
+    decoder.feed(channel.output.data(), channel.output.size());
+
+    Frame frame {};
+    ASSERT_TRUE(decoder.next(frame));
+    EXPECT_EQ(frame.type, FrameType::ActionResult);
+    EXPECT_EQ(fromFrameBody(frame.body), L"result-1-1");
+    ASSERT_TRUE(decoder.next(frame));
+    EXPECT_EQ(fromFrameBody(frame.body), L"result-0-1");
+    EXPECT_FALSE(decoder.next(frame));
+}
+
+TEST(WorkerPool, WorkerSendsEventsBeforeResults) {
+    string input {};
+    encodeFrame(FrameType::LoadPayload, toFrameBody(L"event,ok"), input);
+    encodeFrame(FrameType::RunAction, "0", input);
+    encodeFrame(FrameType::RunAction, "1", input);
+
+    MemoryChannel channel { input, 64 };
+    FakeSession session {};
+
+    EXPECT_EQ(runWorker(channel, session), 0);
+
+    FrameDecoder decoder {};
+    decoder.feed(channel.output.data(), channel.output.size());
+
+    Frame frame {};
+    ASSERT_TRUE(decoder.next(frame));
+    EXPECT_EQ(frame.type, FrameType::SessionEvent);
+    EXPECT_EQ(frame.body, "event-0");
+    ASSERT_TRUE(decoder.next(frame));
+    EXPECT_EQ(frame.type, FrameType::ActionResult);
+    EXPECT_EQ(fromFrameBody(frame.body), L"result-0-1");
+    ASSERT_TRUE(decoder.next(frame));
+    EXPECT_EQ(frame.type, FrameType::ActionResult);
+    EXPECT_EQ(fromFrameBody(frame.body), L"result-1-1");
+    EXPECT_FALSE(decoder.next(frame));
+}
+
+TEST(WorkerPool, UnavailableWorkers) {
+    WorkerPool pool { []() { return std::unique_ptr<WorkerChannel> {}; }, 2 };
+    wstring result {};
+
+    EXPECT_EQ(pool.start(), 0);
+    pool.setPayload(L"ok");
+    EXPECT_EQ(pool.runAction(0, result), WorkerStatus::Unavailable);
+    EXPECT_TRUE(result.empty());
+}
+
+#ifndef _WIN32
+
+namespace {
+    std::unique_ptr<WorkerChannel> forkFakeWorker() {
+        return forkWorkerProcess([](WorkerChannel& supervisor) {
+            FakeSession session {};
+            return runWorker(supervisor, session);
+        });
+    }
+}
+
+TEST(WorkerPool, CrashedWorkerIsReplaced) {
+    WorkerPool pool { forkFakeWorker, 2, 5000 };
+    ASSERT_EQ(pool.start(), 2);
+
+    pool.setPayload(L"ok,crash,ok,ok");
+
+    vector<WorkerStatus> statuses {};
+    vector<wstring> results {};
+    for (std::uint32_t i = 0; i < 4; i++) {
+        wstring result {};
+        statuses.push_back(pool.runAction(i, result));
+        results.push_back(result);
+    }
+
+    // Only the crashing action fails, the rest of the batch goes on
+    EXPECT_EQ(statuses[0], WorkerStatus::Completed);
+    EXPECT_EQ(statuses[1], WorkerStatus::Crashed);
+    EXPECT_EQ(statuses[2], WorkerStatus::Completed);
+    EXPECT_EQ(statuses[3], WorkerStatus::Completed);
+    EXPECT_EQ(results[0], L"result-0-1");
+    EXPECT_TRUE(results[1].empty());
+    EXPECT_EQ(results[2], L"result-2-1");
+    // The replacement worker got the payload before its first action
+    EXPECT_EQ(results[3], L"result-3-1");
+    EXPECT_EQ(pool.getRestarts(), 1);
+
+    // Workers are kept between payloads, and get the new one
+    pool.setPayload(L"ok");
+    wstring result {};
+    EXPECT_EQ(pool.runAction(0, result), WorkerStatus::Completed);
+    EXPECT_EQ(result, L"result-0-2");
+}
+
+TEST(WorkerPool, ParallelActionsReportEvents) {
+    WorkerPool pool { forkFakeWorker, 2, 5000 };
+    vector<string> events {};
+    ASSERT_EQ(pool.start(), 2);
+
+    pool.setEventListener([&events](const string& event) { events.push_back(event); });
+    pool.setPayload(L"event,ok,crash,event");
+
+    vector<WorkerStatus> statuses {};
+    vector<wstring> results {};
+    pool.runActions({ 0, 1, 2, 3 }, statuses, results);
+
+    ASSERT_EQ(statuses.size(), 4);
+    EXPECT_EQ(statuses[0], WorkerStatus::Completed);
+    EXPECT_EQ(statuses[1], WorkerStatus::Completed);
+    EXPECT_EQ(statuses[2], WorkerStatus::Crashed);
+    EXPECT_EQ(statuses[3], WorkerStatus::Completed);
+    EXPECT_EQ(results[0], L"result-0-1");
+    EXPECT_EQ(results[3], L"result-3-1");
+
+    // Events arrive along with the results, in any order
+    std::sort(events.begin(), events.end());
+    EXPECT_EQ(events, (vector<string> { "event-0", "event-3" }));
+}
+
+TEST(WorkerPool, HungWorkerIsTerminated) {
+    WorkerPool pool { forkFakeWorker, 1, 200 };
+    ASSERT_EQ(pool.start(), 1);
+
+    pool.setPayload(L"hang,ok");
+
+    wstring result {};
+    EXPECT_EQ(pool.runAction(0, result), WorkerStatus::TimedOut);
+    EXPECT_EQ(pool.runAction(1, result), WorkerStatus::Completed);
+    EXPECT_EQ(result, L"result-1-1");
+    EXPECT_EQ(pool.getRestarts(), 1);
+}
+
+TEST(WorkerPool, DeadlineBoundsWaits) {
+    using Clock = std::chrono::steady_clock;
+    WorkerPool pool { forkFakeWorker, 2, 60 * 1000 };
+    ASSERT_EQ(pool.start(), 2);
+
+    pool.setPayload(L"hang,ok,hang");
+
+    // The hung workers are terminated once the batch runs out of time, not
+    // after the timeout of the pool
+    BatchDeadline deadline { 300 };
+    DeadlineScope deadlineScope { &deadline };
+    const Clock::time_point start { Clock::now() };
+
+    vector<WorkerStatus> statuses {};
+    vector<wstring> results {};
+    pool.runActions({ 0, 1 }, statuses, results);
+
+    ASSERT_EQ(statuses.size(), 2);
+    EXPECT_EQ(statuses[0], WorkerStatus::TimedOut);
+    EXPECT_EQ(statuses[1], WorkerStatus::Completed);
+
+    wstring result {};
+    EXPECT_EQ(pool.runAction(2, result), WorkerStatus::TimedOut);
+    EXPECT_LT(Clock::now() - start, std::chrono::seconds { 10 });
+}
+
+#endif